@@ -0,0 +1,338 @@
+// Copyright 2015-2016 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/* Decoding of encoded OTA images (see esp_ota_encoded_header_t) on their
+   way to esp_ota_write: the data goes through the LZSS decoder, then the
+   delta decoder, then a page sized buffer, each stage as it comes. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_err.h"
+#include "esp_partition.h"
+#include "esp_spi_flash.h"
+#include "esp_ota_ops.h"
+#include "rom/crc.h"
+#include "esp_log.h"
+
+#define DECODE_MIN(a,b) ((a) <= (b) ? (a) : (b))
+
+#define LZ_MIN_MATCH 3
+#define LZ_MIN_WINDOW_BITS 8
+#define LZ_MAX_WINDOW_BITS 12
+
+#define DELTA_OP_COPY 0x01
+#define DELTA_OP_ADD  0x02
+#define DELTA_OP_DATA 0x03
+
+#define DECODE_BUF_SIZE 256
+
+struct esp_ota_decoder {
+    esp_ota_handle_t handle;
+    const esp_partition_t *source_part;
+    esp_err_t err;                  /* sticky, once the image is invalid */
+
+    uint32_t header_len;
+    esp_ota_encoded_header_t header;
+
+    const uint8_t *source;          /* mapped source partition */
+    spi_flash_mmap_handle_t source_map;
+
+    uint8_t *window;                /* last bytes out of the LZSS decoder */
+    uint32_t window_pos;            /* bytes out of the LZSS decoder */
+    uint8_t lz_flags;
+    uint8_t lz_flag_bits;           /* items left for lz_flags */
+    uint8_t lz_match_len;           /* bytes of the match in lz_match */
+    uint8_t lz_match[2];
+
+    uint8_t op_len;                 /* bytes of the delta operation in op */
+    uint8_t op[9];
+    uint32_t op_src;                /* source offset of ADD */
+    uint32_t op_left;               /* bytes of ADD or DATA to come */
+
+    uint32_t out_size;              /* bytes of image decoded */
+    uint32_t buf_len;
+    uint8_t buf[DECODE_BUF_SIZE];
+};
+
+static const char *TAG = "esp_ota_decode";
+
+static esp_err_t decode_fail(esp_ota_decoder_handle_t d, const char *what)
+{
+    ESP_LOGE(TAG, "%s at 0x%x of the image", what, d->out_size);
+    d->err = ESP_ERR_OTA_DECODE_FAILED;
+    return d->err;
+}
+
+static esp_err_t flush_buf(esp_ota_decoder_handle_t d)
+{
+    esp_err_t err = esp_ota_write(d->handle, d->buf, d->buf_len);
+    d->buf_len = 0;
+    if (err != ESP_OK) {
+        d->err = err;
+    }
+    return err;
+}
+
+/* Last stage: the image bytes, with add (if not NULL) added to them */
+static esp_err_t image_data(esp_ota_decoder_handle_t d, const uint8_t *data, const uint8_t *add, size_t len)
+{
+    if (len > d->header.image_size - d->out_size) {
+        return decode_fail(d, "image too long");
+    }
+    d->out_size += len;
+    while (len > 0) {
+        size_t n = DECODE_MIN(len, DECODE_BUF_SIZE - d->buf_len);
+        if (add == NULL) {
+            memcpy(d->buf + d->buf_len, data, n);
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                d->buf[d->buf_len + i] = data[i] + add[i];
+            }
+            add += n;
+        }
+        d->buf_len += n;
+        data += n;
+        len -= n;
+        if (d->buf_len == DECODE_BUF_SIZE && flush_buf(d) != ESP_OK) {
+            return d->err;
+        }
+    }
+    return ESP_OK;
+}
+
+static bool source_range_valid(esp_ota_decoder_handle_t d, uint32_t offset, uint32_t len)
+{
+    return offset <= d->header.source_size && len <= d->header.source_size - offset;
+}
+
+static uint32_t op_word(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+/* Delta stage: operations on the source image */
+static esp_err_t delta_data(esp_ota_decoder_handle_t d, const uint8_t *data, size_t len)
+{
+    esp_err_t err = ESP_OK;
+
+    while (len > 0 && err == ESP_OK) {
+        if (d->op_left > 0) {
+            size_t n = DECODE_MIN(len, d->op_left);
+            if (d->op[0] == DELTA_OP_ADD) {
+                err = image_data(d, data, d->source + d->op_src, n);
+                d->op_src += n;
+            } else {
+                err = image_data(d, data, NULL, n);
+            }
+            d->op_left -= n;
+            data += n;
+            len -= n;
+            continue;
+        }
+
+        d->op[d->op_len++] = *data++;
+        len--;
+        size_t op_size = (d->op[0] == DELTA_OP_DATA) ? 5 : 9;
+        if (d->op[0] < DELTA_OP_COPY || d->op[0] > DELTA_OP_DATA) {
+            return decode_fail(d, "invalid delta operation");
+        }
+        if (d->op_len < op_size) {
+            continue;
+        }
+        d->op_len = 0;
+
+        uint32_t op_len = op_word(d->op + op_size - 4);
+        if (op_len == 0) {
+            return decode_fail(d, "empty delta operation");
+        }
+        if (d->op[0] == DELTA_OP_DATA) {
+            d->op_left = op_len;
+            continue;
+        }
+        uint32_t offset = op_word(d->op + 1);
+        if (!source_range_valid(d, offset, op_len)) {
+            return decode_fail(d, "delta operation past the source image");
+        }
+        if (d->op[0] == DELTA_OP_ADD) {
+            d->op_src = offset;
+            d->op_left = op_len;
+        } else {
+            err = image_data(d, d->source + offset, NULL, op_len);
+        }
+    }
+    return err;
+}
+
+/* Output of the LZSS stage, kept in the window */
+static esp_err_t lz_out(esp_ota_decoder_handle_t d, uint8_t b)
+{
+    uint32_t mask = (1 << d->header.window_bits) - 1;
+    d->window[d->window_pos++ & mask] = b;
+    if (d->header.flags & ESP_OTA_ENCODED_DELTA) {
+        return delta_data(d, &b, 1);
+    }
+    return image_data(d, &b, NULL, 1);
+}
+
+static esp_err_t lz_data(esp_ota_decoder_handle_t d, const uint8_t *data, size_t len)
+{
+    uint32_t window_bits = d->header.window_bits;
+    uint32_t mask = (1 << window_bits) - 1;
+    esp_err_t err = ESP_OK;
+
+    for (; len > 0 && err == ESP_OK; data++, len--) {
+        if (d->lz_flag_bits == 0) {
+            d->lz_flags = *data;
+            d->lz_flag_bits = 8;
+            continue;
+        }
+        if ((d->lz_flags & 1) == 0) {
+            err = lz_out(d, *data);
+        } else {
+            d->lz_match[d->lz_match_len++] = *data;
+            if (d->lz_match_len < sizeof(d->lz_match)) {
+                continue;
+            }
+            d->lz_match_len = 0;
+            uint32_t match = d->lz_match[0] | (d->lz_match[1] << 8);
+            uint32_t distance = (match & mask) + 1;
+            uint32_t match_len = (match >> window_bits) + LZ_MIN_MATCH;
+            if (distance > d->window_pos) {
+                return decode_fail(d, "match before the start of the image");
+            }
+            for (uint32_t i = 0; i < match_len && err == ESP_OK; i++) {
+                err = lz_out(d, d->window[(d->window_pos - distance) & mask]);
+            }
+        }
+        d->lz_flags >>= 1;
+        d->lz_flag_bits--;
+    }
+    return err;
+}
+
+static esp_err_t start_decoding(esp_ota_decoder_handle_t d)
+{
+    const esp_ota_encoded_header_t *h = &d->header;
+
+    if (h->magic != ESP_OTA_ENCODED_MAGIC || h->version != 1
+        || (h->flags & ~(ESP_OTA_ENCODED_COMPRESSED | ESP_OTA_ENCODED_DELTA)) != 0
+        || h->image_size == 0) {
+        return decode_fail(d, "invalid header");
+    }
+
+    if (h->flags & ESP_OTA_ENCODED_COMPRESSED) {
+        if (h->window_bits < LZ_MIN_WINDOW_BITS || h->window_bits > LZ_MAX_WINDOW_BITS) {
+            return decode_fail(d, "invalid window size");
+        }
+        d->window = (uint8_t *) malloc(1 << h->window_bits);
+        if (d->window == NULL) {
+            d->err = ESP_ERR_NO_MEM;
+            return d->err;
+        }
+    }
+
+    if (h->flags & ESP_OTA_ENCODED_DELTA) {
+        const void *source;
+        if (d->source_part == NULL || h->source_size == 0 || h->source_size > d->source_part->size) {
+            return decode_fail(d, "delta without its source partition");
+        }
+        spi_flash_caller_t caller = spi_flash_caller_begin(SPI_FLASH_CALLER_OTA);
+        esp_err_t err = esp_partition_mmap(d->source_part, 0, h->source_size, SPI_FLASH_MMAP_DATA,
+                                           &source, &d->source_map);
+        spi_flash_caller_end(caller);
+        if (err != ESP_OK) {
+            d->err = err;
+            return err;
+        }
+        d->source = (const uint8_t *) source;
+        if (crc32_le(0, d->source, h->source_size) != h->source_crc) {
+            return decode_fail(d, "delta for another source image");
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_decoder_begin(esp_ota_handle_t handle, const esp_partition_t *source,
+                                esp_ota_decoder_handle_t *out_decoder)
+{
+    if (out_decoder == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_ota_decoder_handle_t d = (esp_ota_decoder_handle_t) calloc(1, sizeof(struct esp_ota_decoder));
+    if (d == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    d->handle = handle;
+    d->source_part = source;
+    *out_decoder = d;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_decoder_write(esp_ota_decoder_handle_t d, const void *data, size_t size)
+{
+    const uint8_t *p = (const uint8_t *) data;
+
+    if (d == NULL || data == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (d->err != ESP_OK) {
+        return d->err;
+    }
+
+    if (d->header_len < sizeof(esp_ota_encoded_header_t)) {
+        size_t n = DECODE_MIN(size, sizeof(esp_ota_encoded_header_t) - d->header_len);
+        memcpy((uint8_t *) &d->header + d->header_len, p, n);
+        d->header_len += n;
+        p += n;
+        size -= n;
+        if (d->header_len < sizeof(esp_ota_encoded_header_t)
+            || start_decoding(d) != ESP_OK) {
+            return d->err;
+        }
+    }
+
+    if (d->header.flags & ESP_OTA_ENCODED_COMPRESSED) {
+        return lz_data(d, p, size);
+    } else if (d->header.flags & ESP_OTA_ENCODED_DELTA) {
+        return delta_data(d, p, size);
+    }
+    return image_data(d, p, NULL, size);
+}
+
+esp_err_t esp_ota_decoder_end(esp_ota_decoder_handle_t d)
+{
+    if (d == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = d->err;
+    if (err == ESP_OK && d->buf_len > 0) {
+        err = flush_buf(d);
+    }
+    if (err == ESP_OK
+        && (d->header_len < sizeof(esp_ota_encoded_header_t) || d->out_size != d->header.image_size
+            || d->lz_match_len != 0 || d->op_len != 0 || d->op_left != 0)) {
+        err = decode_fail(d, "image incomplete");
+    }
+
+    if (d->source != NULL) {
+        spi_flash_munmap(d->source_map);
+    }
+    free(d->window);
+    free(d);
+    return err;
+}
@@ -34,16 +34,32 @@
 #include "rom/crc.h"
 #include "esp_log.h"
 
+#ifdef CONFIG_SECURE_BOOT_ENABLED
+#include "mbedtls/sha256.h"
+#endif
 
 #define OTA_MAX(a,b) ((a) >= (b) ? (a) : (b)) 
 #define OTA_MIN(a,b) ((a) <= (b) ? (a) : (b)) 
 #define SUB_TYPE_ID(i) (i & 0x0F) 
 
+/* Flash is programmed in pages of this size, esp_ota_write buffers
+   data up to a whole page */
+#define OTA_WRITE_PAGE_SIZE 256
+
 typedef struct ota_ops_entry_ {
     uint32_t handle;
     esp_partition_t part;
-    uint32_t erased_size;
-    uint32_t wrote_size;
+    uint32_t erased_size;       /* erased from the start of the partition */
+    uint32_t wrote_size;        /* passed to esp_ota_write, with write_buf */
+    bool erase_on_write;        /* OTA_WITH_SEQUENTIAL_WRITES */
+    esp_err_t write_err;        /* first error of esp_ota_write, returned from then on */
+    uint32_t write_buf_len;     /* data at wrote_size - write_buf_len */
+    uint8_t write_buf[OTA_WRITE_PAGE_SIZE];
+    esp_image_stream_t image;   /* checks of the data as it is written */
+#ifdef CONFIG_SECURE_BOOT_ENABLED
+    mbedtls_sha256_context sha; /* of the image, without signature block */
+    esp_secure_boot_sig_block_t sig_block;
+#endif
     LIST_ENTRY(ota_ops_entry_) entries;
 } ota_ops_entry_t;
 
@@ -77,12 +93,17 @@ esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp
         return ESP_ERR_NO_MEM;
     }
 
+    // with OTA_WITH_SEQUENTIAL_WRITES esp_ota_write erases as it goes,
     // if input image size is 0 or OTA_SIZE_UNKNOWN, will erase all areas in this partition
-    if ((image_size == 0) || (image_size == OTA_SIZE_UNKNOWN)) {
+    spi_flash_caller_t caller = spi_flash_caller_begin(SPI_FLASH_CALLER_OTA);
+    if (image_size == OTA_WITH_SEQUENTIAL_WRITES) {
+        new_entry->erase_on_write = true;
+    } else if ((image_size == 0) || (image_size == OTA_SIZE_UNKNOWN)) {
         ret = esp_partition_erase_range(partition, 0, partition->size);
     } else {
         ret = esp_partition_erase_range(partition, 0, (image_size / SPI_FLASH_SEC_SIZE + 1) * SPI_FLASH_SEC_SIZE);
     }
+    spi_flash_caller_end(caller);
 
     if (ret != ESP_OK) {
         free(new_entry);
@@ -92,21 +113,130 @@ esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp
 
     LIST_INSERT_HEAD(&s_ota_ops_entries_head, new_entry, entries);
 
-    if ((image_size == 0) || (image_size == OTA_SIZE_UNKNOWN)) {
+    if (image_size == OTA_WITH_SEQUENTIAL_WRITES) {
+        new_entry->erased_size = 0;
+    } else if ((image_size == 0) || (image_size == OTA_SIZE_UNKNOWN)) {
         new_entry->erased_size = partition->size;
     } else {
         new_entry->erased_size = image_size;
     }
 
     memcpy(&new_entry->part, partition, sizeof(esp_partition_t));
+    esp_image_stream_init(&new_entry->image, true);
+#ifdef CONFIG_SECURE_BOOT_ENABLED
+    mbedtls_sha256_init(&new_entry->sha);
+    mbedtls_sha256_starts(&new_entry->sha, 0);
+#endif
     new_entry->handle = ++s_ota_ops_last_handle;
     *out_handle = new_entry->handle;
     return ESP_OK;
 }
 
-esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
+// write to the partition at wrote_size - write_buf_len, erasing the sectors
+// it goes into first with OTA_WITH_SEQUENTIAL_WRITES
+static esp_err_t ota_write_flash(ota_ops_entry_t *it, const void *data, size_t size)
+{
+    esp_err_t ret = ESP_OK;
+    uint32_t offset = it->wrote_size - it->write_buf_len;
+
+    if (offset + size > it->part.size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    spi_flash_caller_t caller = spi_flash_caller_begin(SPI_FLASH_CALLER_OTA);
+    while (it->erase_on_write && it->erased_size < offset + size && ret == ESP_OK) {
+        ret = esp_partition_erase_range(&it->part, it->erased_size, SPI_FLASH_SEC_SIZE);
+        if (ret == ESP_OK) {
+            it->erased_size += SPI_FLASH_SEC_SIZE;
+        }
+    }
+    if (ret == ESP_OK) {
+        ret = esp_partition_write(&it->part, offset, data, size);
+    }
+    spi_flash_caller_end(caller);
+    return ret;
+}
+
+// check the image as it comes, so that esp_ota_end doesn't have to read
+// it back from flash, and a bad image fails as early as possible
+static esp_err_t ota_verify_data(ota_ops_entry_t *it, const void *data, size_t size)
+{
+#ifdef CONFIG_SECURE_BOOT_ENABLED
+    uint32_t offset = it->image.offset;
+#endif
+
+    // the stream stays invalid, esp_ota_end fails it
+    if (esp_image_stream_data(&it->image, data, size) != ESP_OK) {
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+
+#ifdef CONFIG_SECURE_BOOT_ENABLED
+    // image.length is known by the time the data gets past the image
+    const uint8_t *p = (const uint8_t *) data;
+    uint32_t image_end = it->image.length != 0 ? it->image.length : UINT32_MAX;
+    if (offset < image_end) {
+        mbedtls_sha256_update(&it->sha, p, OTA_MIN(size, image_end - offset));
+    }
+    // the signature block follows the image
+    if (it->image.length != 0) {
+        uint32_t sig_end = image_end + sizeof(esp_secure_boot_sig_block_t);
+        uint32_t from = OTA_MAX(offset, image_end);
+        uint32_t to = OTA_MIN(offset + size, sig_end);
+        if (from < to) {
+            memcpy((uint8_t *) &it->sig_block + (from - image_end), p + (from - offset), to - from);
+        }
+    }
+#endif
+    return ESP_OK;
+}
+
+// check data, then write whole pages of it to flash and buffer the rest
+static esp_err_t ota_write(ota_ops_entry_t *it, const void *data, size_t size)
 {
     esp_err_t ret;
+    const uint8_t *p = (const uint8_t *) data;
+
+    ret = ota_verify_data(it, data, size);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // complete the page in the buffer
+    if (it->write_buf_len > 0) {
+        size_t copy = OTA_MIN(size, OTA_WRITE_PAGE_SIZE - it->write_buf_len);
+        memcpy(it->write_buf + it->write_buf_len, p, copy);
+        it->write_buf_len += copy;
+        it->wrote_size += copy;
+        p += copy;
+        size -= copy;
+        if (it->write_buf_len < OTA_WRITE_PAGE_SIZE) {
+            return ESP_OK;
+        }
+        ret = ota_write_flash(it, it->write_buf, OTA_WRITE_PAGE_SIZE);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        it->write_buf_len = 0;
+    }
+
+    // whole pages go straight to flash, the rest to the buffer
+    size_t pages_size = size - size % OTA_WRITE_PAGE_SIZE;
+    if (pages_size > 0) {
+        ret = ota_write_flash(it, p, pages_size);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        it->wrote_size += pages_size;
+        p += pages_size;
+        size -= pages_size;
+    }
+    memcpy(it->write_buf, p, size);
+    it->write_buf_len = size;
+    it->wrote_size += size;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
+{
     ota_ops_entry_t *it;
 
     if (data == NULL) {
@@ -118,12 +248,14 @@ esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
     for (it = LIST_FIRST(&s_ota_ops_entries_head); it != NULL; it = LIST_NEXT(it, entries)) {
         if (it->handle == handle) {
             // must erase the partition before writing to it
-            assert(it->erased_size > 0 && "must erase the partition before writing to it");
-            ret = esp_partition_write(&it->part, it->wrote_size, data, size);
-            if(ret == ESP_OK){
-                it->wrote_size += size;
+            assert((it->erased_size > 0 || it->erase_on_write) && "must erase the partition before writing to it");
+
+            // the checks and the buffer have moved on, the data can't be
+            // passed again after an error
+            if (it->write_err == ESP_OK) {
+                it->write_err = ota_write(it, data, size);
             }
-            return ret;
+            return it->write_err;
         }
     }
 
@@ -138,33 +270,46 @@ esp_err_t esp_ota_end(esp_ota_handle_t handle)
     for (it = LIST_FIRST(&s_ota_ops_entries_head); it != NULL; it = LIST_NEXT(it, entries)) {
         if (it->handle == handle) {
             // an ota handle need to be ended after erased and wrote data in it
-            if ((it->erased_size == 0) || (it->wrote_size == 0)) {
+            bool written = (it->erased_size > 0 || it->erase_on_write) && it->wrote_size > 0;
+            if (!written && it->write_err == ESP_OK) {
                 return ESP_ERR_INVALID_ARG;
             }
 
-#ifdef CONFIG_SECUREBOOTLOADER
-            esp_err_t ret;
-            size_t image_size;
-            if (esp_image_basic_verify(it->part.address, &image_size) != ESP_OK) {
-                return ESP_ERR_OTA_VALIDATE_FAILED;
+            // the rest of the last page, padded to a word with erased flash
+            esp_err_t err = it->write_err;
+            if (err == ESP_OK && it->write_buf_len > 0) {
+                uint32_t padded_len = (it->write_buf_len + 3) & ~3;
+                memset(it->write_buf + it->write_buf_len, 0xff, padded_len - it->write_buf_len);
+                err = ota_write_flash(it, it->write_buf, padded_len);
+            }
+
+            // esp_ota_write has checked the image, and digested it
+            uint32_t image_size = 0;
+            esp_err_t ret = (err == ESP_OK) ? esp_image_stream_finish(&it->image, &image_size) : err;
+#ifdef CONFIG_SECURE_BOOT_ENABLED
+            // the only place the context is freed, it may hold the SHA engine
+            uint8_t digest[32];
+            mbedtls_sha256_finish(&it->sha, digest);
+            mbedtls_sha256_free(&it->sha);
+            if (ret == ESP_OK && it->wrote_size < image_size + sizeof(esp_secure_boot_sig_block_t)) {
+                ESP_LOGE(TAG, "image has no signature block");
+                ret = ESP_FAIL;
             }
-            ret = esp_secure_boot_verify_signature(it->part.address, image_size);
-            if (ret != ESP_OK) {
-                return ESP_ERR_OTA_VALIDATE_FAILED;
+            if (ret == ESP_OK) {
+                ret = esp_secure_boot_verify_signature_block(&it->sig_block, digest);
             }
 #endif
-
+            // the handle is done with, valid image or not
             LIST_REMOVE(it, entries);
-            break;
+            free(it);
+            if (err != ESP_OK) {
+                return err;
+            }
+            return (ret == ESP_OK) ? ESP_OK : ESP_ERR_OTA_VALIDATE_FAILED;
         }
     }
 
-    if (it == NULL) {
-        return ESP_ERR_NOT_FOUND;
-    }
-
-    free(it);
-    return ESP_OK;
+    return ESP_ERR_NOT_FOUND;
 }
 
 static uint32_t ota_select_crc(const ota_select *s)
@@ -283,20 +428,19 @@ static esp_err_t esp_rewrite_ota_data(esp_partition_subtype_t subtype)
     }
 }
 
-esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition)
+static esp_err_t ota_set_boot_partition(const esp_partition_t *partition)
 {
     const esp_partition_t *find_partition = NULL;
     if (partition == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
 
-#ifdef CONFIG_SECUREBOOTLOADER
-    size_t image_size;
-    if (esp_image_basic_verify(partition->address, &image_size) != ESP_OK) {
+#ifdef CONFIG_SECURE_BOOT_ENABLED
+    uint32_t image_size;
+    if (esp_image_basic_verify(partition->address, true, &image_size) != ESP_OK) {
         return ESP_ERR_OTA_VALIDATE_FAILED;
     }
-    ret = esp_secure_boot_verify_signature(partition->address, image_size);
-    if (ret != ESP_OK) {
+    if (esp_secure_boot_verify_signature(partition->address, image_size) != ESP_OK) {
         return ESP_ERR_OTA_VALIDATE_FAILED;
     }
 #endif
@@ -323,6 +467,14 @@ esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition)
     }
 }
 
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition)
+{
+    spi_flash_caller_t caller = spi_flash_caller_begin(SPI_FLASH_CALLER_OTA);
+    esp_err_t ret = ota_set_boot_partition(partition);
+    spi_flash_caller_end(caller);
+    return ret;
+}
+
 const esp_partition_t *esp_ota_get_boot_partition(void)
 {
     esp_err_t ret;
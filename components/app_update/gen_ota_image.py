@@ -0,0 +1,177 @@
+#!/usr/bin/env python
+#
+# Encoded OTA image generation tool
+#
+# Makes an encoded OTA image (see esp_ota_encoded_header_t in
+# include/esp_ota_ops.h) out of an app image, for esp_ota_decoder_write:
+# compressed, and optionally a delta against the app image the device runs.
+#
+#   gen_ota_image.py app.bin app.ota
+#   gen_ota_image.py --source old_app.bin app.bin app.ota
+import argparse
+import struct
+import sys
+import zlib
+
+__version__ = '1.0'
+
+ENCODED_MAGIC = 0x3041544f
+ENCODED_VERSION = 1
+ENCODED_COMPRESSED = 0x01
+ENCODED_DELTA = 0x02
+
+DELTA_OP_COPY = 0x01
+DELTA_OP_ADD = 0x02
+DELTA_OP_DATA = 0x03
+
+LZ_MIN_MATCH = 3
+LZ_CHAIN = 8            # earlier positions tried for each match
+
+DELTA_BLOCK = 16        # bytes that must match to start using the source
+DELTA_MIN_COPY = 16     # shorter runs of equal bytes go in an ADD
+
+
+def lz_compress(data, window_bits):
+    """ Compress LZSS style, greedily """
+    window = 1 << window_bits
+    max_len = LZ_MIN_MATCH + (1 << (16 - window_bits)) - 1
+    out = bytearray()
+    flags_pos = 0
+    flag_bits = 8
+    chains = {}
+    i = 0
+    while i < len(data):
+        best_len, best_dist = 0, 0
+        limit = min(max_len, len(data) - i)
+        if limit >= LZ_MIN_MATCH:
+            for pos in reversed(chains.get(bytes(data[i:i + LZ_MIN_MATCH]), [])):
+                if i - pos > window:
+                    break
+                n = LZ_MIN_MATCH
+                while n < limit and data[pos + n] == data[i + n]:
+                    n += 1
+                if n > best_len:
+                    best_len, best_dist = n, i - pos
+                    if n == limit:
+                        break
+        if flag_bits == 8:
+            flags_pos = len(out)
+            out.append(0)
+            flag_bits = 0
+        if best_len >= LZ_MIN_MATCH:
+            out[flags_pos] |= 1 << flag_bits
+            out += struct.pack('<H', (best_dist - 1) | ((best_len - LZ_MIN_MATCH) << window_bits))
+            step = best_len
+        else:
+            out.append(data[i])
+            step = 1
+        flag_bits += 1
+        for j in range(i, min(i + step, len(data) - LZ_MIN_MATCH + 1)):
+            chain = chains.setdefault(bytes(data[j:j + LZ_MIN_MATCH]), [])
+            chain.append(j)
+            if len(chain) > LZ_CHAIN:
+                del chain[0]
+        i += step
+    return out
+
+
+def delta_ops(source, image, start, src, end):
+    """ Operations for image[start:end] from source at src: COPY for long
+    runs of equal bytes, ADD for the rest """
+    ops = bytearray()
+    i = start
+    while i < end:
+        n = 0
+        while i + n < end and image[i + n] == source[src + n]:
+            n += 1
+        if n >= DELTA_MIN_COPY or i + n == end:
+            if n > 0:
+                ops += struct.pack('<BII', DELTA_OP_COPY, src, n)
+                i += n
+                src += n
+            continue
+        # up to the next long enough run of equal bytes
+        add_end = i + n
+        run = 0
+        while add_end < end and run < DELTA_MIN_COPY:
+            run = run + 1 if image[add_end] == source[src + add_end - i] else 0
+            add_end += 1
+        if run >= DELTA_MIN_COPY:
+            add_end -= run
+        ops += struct.pack('<BII', DELTA_OP_ADD, src, add_end - i)
+        ops += bytearray((image[i + k] - source[src + k]) & 0xff for k in range(add_end - i))
+        src += add_end - i
+        i = add_end
+    return ops
+
+
+def delta_encode(source, image):
+    """ Operations making image out of source, rsync style: look up blocks
+    of the image in the source, then follow the source for as long as most
+    bytes are still the same """
+    index = {}
+    for off in range(0, len(source) - DELTA_BLOCK + 1, 4):
+        index.setdefault(bytes(source[off:off + DELTA_BLOCK]), off)
+    ops = bytearray()
+    data = bytearray()
+    i = 0
+    while i < len(image):
+        src = index.get(bytes(image[i:i + DELTA_BLOCK]))
+        if src is None:
+            data.append(image[i])
+            i += 1
+            continue
+        if data:
+            ops += struct.pack('<BI', DELTA_OP_DATA, len(data)) + data
+            data = bytearray()
+        end = i
+        while end < len(image) and src + end - i < len(source):
+            n = min(DELTA_BLOCK, len(image) - end, len(source) - (src + end - i))
+            same = sum(1 for k in range(n) if image[end + k] == source[src + end - i + k])
+            if same * 2 < n:
+                break
+            end += n
+        ops += delta_ops(source, image, i, src, end)
+        i = end
+    if data:
+        ops += struct.pack('<BI', DELTA_OP_DATA, len(data)) + data
+    return ops
+
+
+def encode(image, source=None, compress=True, window_bits=12):
+    flags = 0
+    payload = image
+    if source is not None:
+        flags |= ENCODED_DELTA
+        payload = delta_encode(source, image)
+    if compress:
+        flags |= ENCODED_COMPRESSED
+        payload = lz_compress(payload, window_bits)
+    header = struct.pack('<IBBBBIII', ENCODED_MAGIC, ENCODED_VERSION, flags,
+                         window_bits if compress else 0, 0, len(image),
+                         len(source) if source is not None else 0,
+                         zlib.crc32(bytes(source)) & 0xffffffff if source is not None else 0)
+    return header + payload
+
+
+def main():
+    parser = argparse.ArgumentParser(description='ESP32 encoded OTA image generator')
+    parser.add_argument('--source', help='App image the device runs, to make a delta against',
+                        type=argparse.FileType('rb'))
+    parser.add_argument('--no-compress', help="Don't compress the image", action='store_true')
+    parser.add_argument('--window-bits', help='log2 of the compression window, 8 to 12',
+                        type=int, default=12, choices=range(8, 13))
+    parser.add_argument('input', help='App image', type=argparse.FileType('rb'))
+    parser.add_argument('output', help='Encoded OTA image', type=argparse.FileType('wb'))
+    args = parser.parse_args()
+
+    image = bytearray(args.input.read())
+    source = bytearray(args.source.read()) if args.source is not None else None
+    encoded = encode(image, source, not args.no_compress, args.window_bits)
+    args.output.write(encoded)
+    sys.stderr.write('%d bytes encoded to %d (%.1f%%)\n' % (len(image), len(encoded),
+                                                           100.0 * len(encoded) / len(image)))
+
+
+if __name__ == '__main__':
+    main()
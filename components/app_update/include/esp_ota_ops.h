@@ -27,12 +27,14 @@ extern "C"
 {
 #endif
 
-#define OTA_SIZE_UNKNOWN 0xffffffff
+#define OTA_SIZE_UNKNOWN 0xffffffff              /*!< for esp_ota_begin: erase the whole partition */
+#define OTA_WITH_SEQUENTIAL_WRITES 0xfffffffe    /*!< for esp_ota_begin: erase sector by sector as esp_ota_write gets there */
 
 #define ESP_ERR_OTA_BASE                         0x1500                     /*!< base error code for ota_ops api */
 #define ESP_ERR_OTA_PARTITION_CONFLICT           (ESP_ERR_OTA_BASE + 0x01)  /*!< want to write or erase current running partition */
 #define ESP_ERR_OTA_SELECT_INFO_INVALID          (ESP_ERR_OTA_BASE + 0x02)  /*!< ota data partition info is error */
 #define ESP_ERR_OTA_VALIDATE_FAILED              (ESP_ERR_OTA_BASE + 0x03)  /*!< validate ota image failed */
+#define ESP_ERR_OTA_DECODE_FAILED                (ESP_ERR_OTA_BASE + 0x04)  /*!< encoded ota image is invalid, or for another source */
 
 /**
  * @brief Opaque handle for application update obtained from app_ops.
@@ -44,6 +46,10 @@ typedef uint32_t esp_ota_handle_t;
  *          if unkown image size ,pass 0x0 or 0xFFFFFFFF, it will erase all the
  *          partition ,Otherwise, erase the required range
  *
+ *          With OTA_WITH_SEQUENTIAL_WRITES nothing is erased here. Instead
+ *          esp_ota_write erases each sector just before it writes into it, so
+ *          the update never stalls for longer than one sector erase.
+ *
  * @param   partition Pointer to partition structure which need to be updated
  *            Must be non-NULL.
  * @param   image_size size of image need to be updated
@@ -59,12 +65,27 @@ esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t image_size, esp
 /**
  * @brief   Write data to input input partition
  *
+ *          Data is written to flash in whole pages of 256 bytes, the last
+ *          incomplete page is kept until the next call or esp_ota_end.
+ *
+ *          The image is checked as it is written: an invalid image header,
+ *          segment header or checksum fails the write it is in, before it
+ *          gets to flash.
+ *          With secure boot the image is digested here, for esp_ota_end to
+ *          check its signature.
+ *
+ *          An error can't be recovered from: the data may have been checked
+ *          or buffered in part, so every later esp_ota_write on the handle
+ *          and esp_ota_end return the same error. Start again with
+ *          esp_ota_begin.
+ *
  * @param   handle  Handle obtained from esp_ota_begin
  * @param   data  Pointer to data write to flash
  * @param   size  data size of recieved data
  *
  * @return: 
  *    - ESP_OK: if write flash data OK 
+ *    - ESP_ERR_OTA_VALIDATE_FAILED: data is not a valid app image
  *    - ESP_ERR_OTA_PARTITION_CONFLICT: operate current running bin  
  *    - ESP_ERR_OTA_SELECT_INFO_INVALID: ota bin select info invalid
  */
@@ -73,14 +94,111 @@ esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size);
 /**
  * @brief   Finish the update and validate written data
  *
+ *          Writes the data esp_ota_write has buffered, then validates the image.
+ *          The checks were done as the data was written, so the image isn't
+ *          read back from flash: this checks that it is complete, and with
+ *          secure boot its signature.
+ *
+ *          The handle is released once the image has been validated, also
+ *          if it is invalid, or if esp_ota_write has failed.
+ *
  * @param   handle  Handle obtained from esp_ota_begin 
  *
  * @return: 
  *    - ESP_OK: if validate ota image pass
  *    - ESP_ERR_OTA_VALIDATE_FAILED: validate the ota image is invalid
+ *    - errors of esp_ota_write, or of writing the last page
  */
 esp_err_t esp_ota_end(esp_ota_handle_t handle);
 
+#define ESP_OTA_ENCODED_MAGIC       0x3041544f  /*!< "OTA0" */
+#define ESP_OTA_ENCODED_COMPRESSED  0x01        /*!< payload is LZSS compressed */
+#define ESP_OTA_ENCODED_DELTA       0x02        /*!< payload is a delta against the source partition */
+
+/**
+ * @brief Header of an encoded OTA image, as made by gen_ota_image.py
+ *
+ * The payload follows the header. With ESP_OTA_ENCODED_DELTA it is a
+ * sequence of operations making the image out of the source image:
+ *  - 0x01, offset, length: copy length bytes of the source at offset
+ *  - 0x02, offset, length, length bytes: add the bytes to those of the
+ *    source at offset (modulo 256)
+ *  - 0x03, length, length bytes: the bytes
+ * with offsets and lengths 32 bit little endian.
+ *
+ * With ESP_OTA_ENCODED_COMPRESSED the payload is compressed LZSS style: a
+ * flag byte for each eight items, bit 0 first, a clear bit for a literal
+ * byte, a set bit for a little endian 16 bit match of the (distance - 1) in
+ * the low window_bits bits and the (length - 3) in the others.
+ */
+typedef struct {
+    uint32_t magic;             /*!< ESP_OTA_ENCODED_MAGIC */
+    uint8_t version;            /*!< 1 */
+    uint8_t flags;              /*!< ESP_OTA_ENCODED_COMPRESSED, ESP_OTA_ENCODED_DELTA */
+    uint8_t window_bits;        /*!< log2 of the LZSS window, 8 to 12 */
+    uint8_t reserved;
+    uint32_t image_size;        /*!< size of the decoded image */
+    uint32_t source_size;       /*!< bytes of the source partition the delta refers to */
+    uint32_t source_crc;        /*!< crc32_le(0, ...) of them */
+} esp_ota_encoded_header_t;
+
+/**
+ * @brief Opaque handle of a decoder of encoded OTA images
+ */
+typedef struct esp_ota_decoder *esp_ota_decoder_handle_t;
+
+/**
+ * @brief   Start decoding an encoded OTA image into an update
+ *
+ *          Data passed to esp_ota_decoder_write is decoded and written
+ *          with esp_ota_write. The decoder needs less than 5 kB of RAM.
+ *
+ * @param   handle  Handle obtained from esp_ota_begin, for example with
+ *                  OTA_WITH_SEQUENTIAL_WRITES as the image size isn't known yet
+ * @param   source  Partition a delta image applies to, usually the one
+ *                  running (esp_ota_get_boot_partition). Can be NULL if
+ *                  the image isn't a delta. It is mapped with
+ *                  esp_partition_mmap for the length of the update.
+ * @param   out_decoder  Decoder handle for esp_ota_decoder_write and
+ *                  esp_ota_decoder_end
+ *
+ * @return:
+ *    - ESP_OK: if the decoder was set up
+ *    - ESP_ERR_NO_MEM: if there is no memory for the decoder
+ */
+esp_err_t esp_ota_decoder_begin(esp_ota_handle_t handle, const esp_partition_t *source,
+                                esp_ota_decoder_handle_t *out_decoder);
+
+/**
+ * @brief   Decode the next part of an encoded OTA image
+ *
+ * @param   decoder  Handle obtained from esp_ota_decoder_begin
+ * @param   data  Next part of the encoded image
+ * @param   size  Length of data
+ *
+ * @return:
+ *    - ESP_OK: if the data was decoded and written
+ *    - ESP_ERR_OTA_DECODE_FAILED: encoded image is invalid, or it is a
+ *      delta for another source image
+ *    - errors of esp_ota_write
+ */
+esp_err_t esp_ota_decoder_write(esp_ota_decoder_handle_t decoder, const void *data, size_t size);
+
+/**
+ * @brief   Finish decoding an encoded OTA image
+ *
+ *          Writes the data still buffered and frees the decoder, whatever the
+ *          result. esp_ota_end must be called after this.
+ *
+ * @param   decoder  Handle obtained from esp_ota_decoder_begin
+ *
+ * @return:
+ *    - ESP_OK: if the whole image was decoded and written
+ *    - ESP_ERR_OTA_DECODE_FAILED: encoded image is invalid or incomplete
+ *    - errors of esp_ota_decoder_write
+ */
+esp_err_t esp_ota_decoder_end(esp_ota_decoder_handle_t decoder);
+
 /**
  * @brief   Set next boot partition, call system_restart() will switch to run it
  *
@@ -0,0 +1,157 @@
+/*
+ * Emulated SPI flash for the OTA host tests, see flash_emu.h
+ */
+#include <string.h>
+
+#include "esp_partition.h"
+#include "bootloader_flash.h"
+#include "rom/crc.h"
+#include "flash_emu.h"
+
+static uint8_t s_flash[FLASH_EMU_SIZE];
+static uint64_t s_time_us;
+static uint32_t s_erase_count;
+static uint32_t s_write_count;
+static uint32_t s_read_bytes;
+
+/* timing data of the NVS flash emulator, in microseconds, for writes of
+   4 bytes to 4096 bytes, and for erasing one sector */
+static const uint32_t write_times[] = {19, 23, 35, 57, 106, 205, 417, 814, 1622, 3200, 6367};
+static const uint32_t sector_erase_time = 37142;
+
+static uint32_t write_time(uint32_t bytes)
+{
+    uint32_t t = 0;
+    /* longer writes cost as much as their 4096 byte pieces */
+    for (; bytes > 4096; bytes -= 4096) {
+        t += write_times[10];
+    }
+    if (bytes <= 4) {
+        return t + write_times[0];
+    }
+    /* interpolate, with 4 << (k - 1) < bytes <= 4 << k */
+    int k = 32 - __builtin_clz((bytes - 1) / 4);
+    uint32_t x1 = 4 << (k - 1), x2 = 4 << k;
+    uint32_t y1 = write_times[k - 1], y2 = write_times[k];
+    return t + y1 + (bytes - x1) * (y2 - y1) / (x2 - x1);
+}
+
+void flash_emu_reset(void)
+{
+    memset(s_flash, 0xff, sizeof(s_flash));
+    s_time_us = 0;
+    s_erase_count = 0;
+    s_write_count = 0;
+    s_read_bytes = 0;
+}
+
+const uint8_t *flash_emu_data(void)
+{
+    return s_flash;
+}
+
+uint64_t flash_emu_time_us(void)
+{
+    return s_time_us;
+}
+
+uint32_t flash_emu_erase_count(void)
+{
+    return s_erase_count;
+}
+
+uint32_t flash_emu_write_count(void)
+{
+    return s_write_count;
+}
+
+uint32_t flash_emu_read_bytes(void)
+{
+    return s_read_bytes;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition,
+                                    uint32_t start_addr, uint32_t size)
+{
+    if (start_addr + size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (start_addr % SPI_FLASH_SEC_SIZE != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (size % SPI_FLASH_SEC_SIZE != 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memset(s_flash + partition->address + start_addr, 0xff, size);
+    s_erase_count += size / SPI_FLASH_SEC_SIZE;
+    s_time_us += (uint64_t) sector_erase_time * (size / SPI_FLASH_SEC_SIZE);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition,
+                              size_t dst_offset, const void *src, size_t size)
+{
+    const uint8_t *data = (const uint8_t *) src;
+    uint8_t *dst = s_flash + partition->address + dst_offset;
+
+    if (dst_offset + size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    /* programming can only clear bits */
+    for (size_t i = 0; i < size; i++) {
+        if ((data[i] & ~dst[i]) != 0) {
+            return ESP_ERR_FLASH_OP_FAIL;
+        }
+    }
+    memcpy(dst, data, size);
+    s_write_count++;
+    s_time_us += write_time(size);
+    return ESP_OK;
+}
+
+/* For esp_image_basic_verify, which the tests use to cross-check */
+esp_err_t bootloader_flash_read(size_t src_addr, void *dest, size_t size, bool allow_decrypt)
+{
+    if (src_addr + size > FLASH_EMU_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dest, s_flash + src_addr, size);
+    s_read_bytes += size;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, uint32_t offset, uint32_t size,
+                             spi_flash_mmap_memory_t memory,
+                             const void **out_ptr, spi_flash_mmap_handle_t *out_handle)
+{
+    if (offset + size > partition->size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_ptr = s_flash + partition->address + offset;
+    *out_handle = 0;
+    return ESP_OK;
+}
+
+/* The OTA data partition isn't part of these tests */
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+        esp_partition_subtype_t subtype, const char *label)
+{
+    return NULL;
+}
+
+void spi_flash_munmap(spi_flash_mmap_handle_t handle)
+{
+}
+
+uint32_t crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
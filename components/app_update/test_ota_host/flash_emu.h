@@ -0,0 +1,25 @@
+/*
+ * Emulated SPI flash for the OTA host tests: the partition API of
+ * esp_partition.h on a buffer in RAM, with the flash timing model of the
+ * NVS host tests (../../nvs_flash/test_nvs_host/spi_flash_emulation.cpp).
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_partition.h"
+
+#define FLASH_EMU_SIZE (4 * 1024 * 1024)
+
+/* erase the whole flash and reset the counters */
+void flash_emu_reset(void);
+
+const uint8_t *flash_emu_data(void);
+
+/* emulated time spent in flash operations so far, in microseconds */
+uint64_t flash_emu_time_us(void);
+
+uint32_t flash_emu_erase_count(void);
+uint32_t flash_emu_write_count(void);
+
+/* bytes read back with bootloader_flash_read */
+uint32_t flash_emu_read_bytes(void);
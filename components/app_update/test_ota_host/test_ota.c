@@ -0,0 +1,305 @@
+/*
+ * Host test of esp_ota_begin/esp_ota_write/esp_ota_end over an emulated
+ * flash (flash_emu.c).
+ *
+ * Writes a 1 MB image in pieces of 1436 bytes (a TCP segment) with the
+ * image size passed to esp_ota_begin, which erases everything up front, and
+ * with OTA_WITH_SEQUENTIAL_WRITES, which erases as the writes get there.
+ * Checks that the image ends up in flash both ways, and prints the
+ * emulated flash time of the whole update and the longest any one call
+ * took (the longest stall of the download).
+ *
+ * Also checks odd write sizes, writes past the end of the partition, and
+ * that esp_ota_write rejects an invalid image as early as it can and
+ * esp_ota_end doesn't read the image back, with the same results as
+ * esp_image_basic_verify.
+ *
+ * With -q nothing is printed unless a check fails.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_ota_ops.h"
+#include "esp_image_format.h"
+#include "flash_emu.h"
+
+#define IMAGE_SIZE  (1024 * 1024)
+#define SEGMENT     1436
+
+static const esp_partition_t s_part = {
+    .type = ESP_PARTITION_TYPE_APP,
+    .subtype = ESP_PARTITION_SUBTYPE_APP_OTA_0,
+    .address = 0x110000,
+    .size = 0x140000,
+    .label = "ota_0",
+};
+
+static uint8_t s_image[IMAGE_SIZE];
+
+typedef struct {
+    uint64_t total_us;
+    uint64_t max_stall_us;
+    uint32_t erases;
+    uint32_t writes;
+} ota_result_t;
+
+static int check(int cond, const char *what)
+{
+    if (!cond) {
+        printf("FAILED: %s\n", what);
+    }
+    return cond ? 0 : 1;
+}
+
+/* Make s_image an app image of at most max_len bytes, four segments of
+   random data, and return its length */
+static size_t make_image(size_t max_len)
+{
+    esp_image_header_t *header = (esp_image_header_t *) s_image;
+    const int segments = 4;
+    size_t data_len = max_len - sizeof(esp_image_header_t)
+                      - segments * sizeof(esp_image_segment_header_t) - 16;
+    size_t offset = sizeof(esp_image_header_t);
+    uint8_t checksum = 0xef;
+
+    srand(1);
+    for (size_t i = 0; i < max_len; i++) {
+        s_image[i] = (uint8_t) rand();
+    }
+    header->magic = ESP_IMAGE_HEADER_MAGIC;
+    header->segment_count = segments;
+    for (int i = 0; i < segments; i++) {
+        esp_image_segment_header_t segment = {
+            .load_addr = 0x3f400000 + i * 0x10000,
+            .data_len = (data_len / segments) & ~3,
+        };
+        memcpy(s_image + offset, &segment, sizeof(segment));
+        offset += sizeof(segment);
+        for (size_t j = 0; j < segment.data_len; j++) {
+            checksum ^= s_image[offset + j];
+        }
+        offset += segment.data_len;
+    }
+    size_t len = (offset + 16) & ~15;
+    memset(s_image + offset, 0, len - offset);
+    s_image[len - 1] = checksum;
+    return len;
+}
+
+static void stall(ota_result_t *res, uint64_t *t)
+{
+    uint64_t now = flash_emu_time_us();
+    if (now - *t > res->max_stall_us) {
+        res->max_stall_us = now - *t;
+    }
+    *t = now;
+}
+
+/* Write image_len bytes of the image in pieces of piece_len, return the
+   number of failed checks */
+static int run_update(size_t begin_size, size_t image_len, size_t piece_len, ota_result_t *res)
+{
+    esp_ota_handle_t handle;
+    uint64_t t = 0;
+    int fails = 0;
+
+    memset(res, 0, sizeof(*res));
+    flash_emu_reset();
+    /* something to erase */
+    memset((uint8_t *) flash_emu_data() + s_part.address, 0, s_part.size);
+
+    fails += check(esp_ota_begin(&s_part, begin_size, &handle) == ESP_OK, "esp_ota_begin");
+    stall(res, &t);
+    for (size_t off = 0; off < image_len && fails == 0; off += piece_len) {
+        size_t len = image_len - off < piece_len ? image_len - off : piece_len;
+        fails += check(esp_ota_write(handle, s_image + off, len) == ESP_OK, "esp_ota_write");
+        stall(res, &t);
+    }
+    fails += check(esp_ota_end(handle) == ESP_OK, "esp_ota_end");
+    stall(res, &t);
+
+    fails += check(memcmp(flash_emu_data() + s_part.address, s_image, image_len) == 0,
+                   "image in flash");
+    res->total_us = flash_emu_time_us();
+    res->erases = flash_emu_erase_count();
+    res->writes = flash_emu_write_count();
+    return fails;
+}
+
+static int test_odd_pieces(void)
+{
+    static const size_t pieces[] = { 1, 3, 255, 256, 257, 1436, 4099 };
+    size_t len = make_image(3 * SPI_FLASH_SEC_SIZE + 5);
+    ota_result_t res;
+    int fails = 0;
+
+    for (int i = 0; i < sizeof(pieces) / sizeof(pieces[0]); i++) {
+        fails += run_update(OTA_WITH_SEQUENTIAL_WRITES, len, pieces[i], &res);
+        fails += run_update(IMAGE_SIZE, len, pieces[i], &res);
+    }
+    return fails;
+}
+
+static int test_partition_end(void)
+{
+    esp_ota_handle_t handle;
+    int fails = 0;
+
+    /* the image is in the first write, the rest is ignored */
+    make_image(IMAGE_SIZE / 4);
+    flash_emu_reset();
+    fails += check(esp_ota_begin(&s_part, OTA_WITH_SEQUENTIAL_WRITES, &handle) == ESP_OK,
+                   "esp_ota_begin");
+    for (size_t off = 0; off < s_part.size && fails == 0; off += IMAGE_SIZE / 4) {
+        fails += check(esp_ota_write(handle, s_image, IMAGE_SIZE / 4) == ESP_OK, "filling the partition");
+    }
+    fails += check(esp_ota_write(handle, s_image, 256) == ESP_ERR_INVALID_SIZE,
+                   "writing past the end of the partition");
+    /* a few bytes would only be buffered, but the handle has failed */
+    fails += check(esp_ota_write(handle, s_image, 4) == ESP_ERR_INVALID_SIZE,
+                   "writing after an error");
+    fails += check(esp_ota_end(handle) == ESP_ERR_INVALID_SIZE, "esp_ota_end after an error");
+    fails += check(esp_ota_end(handle) == ESP_ERR_NOT_FOUND, "handle released");
+    fails += check(flash_emu_erase_count() == s_part.size / SPI_FLASH_SEC_SIZE,
+                   "erasing the partition exactly once");
+    return fails;
+}
+
+/* Write the image in pieces, return the esp_ota_write error, or the
+   esp_ota_end one. *failed_at is where the piece that failed starts.
+   ESP_FAIL if a failed write doesn't fail esp_ota_end as well, or
+   esp_ota_end doesn't release the handle. */
+static esp_err_t write_image(size_t image_len, size_t piece_len, size_t *failed_at)
+{
+    esp_ota_handle_t handle;
+    esp_err_t err = ESP_OK;
+
+    flash_emu_reset();
+    *failed_at = SIZE_MAX;
+    if (esp_ota_begin(&s_part, OTA_WITH_SEQUENTIAL_WRITES, &handle) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    for (size_t off = 0; off < image_len && err == ESP_OK; off += piece_len) {
+        size_t len = image_len - off < piece_len ? image_len - off : piece_len;
+        err = esp_ota_write(handle, s_image + off, len);
+        if (err != ESP_OK) {
+            *failed_at = off;
+        }
+    }
+    esp_err_t end_err = esp_ota_end(handle);
+    if (err == ESP_OK) {
+        err = end_err;
+    } else if (end_err != err) {
+        return ESP_FAIL;
+    }
+    if (esp_ota_end(handle) != ESP_ERR_NOT_FOUND) {
+        return ESP_FAIL;
+    }
+    return err;
+}
+
+static int test_verify(void)
+{
+    const size_t piece = 1024;
+    size_t len = make_image(64 * 1024);
+    size_t second_segment = sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t)
+                            + ((esp_image_segment_header_t *) (s_image + sizeof(esp_image_header_t)))->data_len;
+    uint32_t verified_len;
+    size_t failed_at;
+    int fails = 0;
+
+    fails += check(write_image(len, piece, &failed_at) == ESP_OK, "valid image");
+    fails += check(flash_emu_read_bytes() == 0, "esp_ota_end reads nothing back");
+    fails += check(esp_image_basic_verify(s_part.address, false, &verified_len) == ESP_OK
+                   && verified_len == len, "esp_image_basic_verify of the image");
+
+    s_image[0] = 0;
+    fails += check(write_image(len, piece, &failed_at) == ESP_ERR_OTA_VALIDATE_FAILED
+                   && failed_at == 0, "invalid magic fails the first write");
+    fails += check(flash_emu_write_count() == 0, "invalid image not written");
+
+    make_image(64 * 1024);
+    ((esp_image_segment_header_t *) (s_image + second_segment))->data_len = 5;
+    fails += check(write_image(len, piece, &failed_at) == ESP_ERR_OTA_VALIDATE_FAILED
+                   && failed_at == second_segment / piece * piece,
+                   "invalid segment length fails the write it is in");
+
+    make_image(64 * 1024);
+    s_image[second_segment + 100] ^= 1;
+    fails += check(write_image(len, piece, &failed_at) == ESP_ERR_OTA_VALIDATE_FAILED
+                   && failed_at == (len - 1) / piece * piece,
+                   "bad checksum fails the write it is in");
+
+    make_image(64 * 1024);
+    fails += check(write_image(len - 1, piece, &failed_at) == ESP_ERR_OTA_VALIDATE_FAILED
+                   && failed_at == SIZE_MAX, "truncated image fails esp_ota_end");
+    return fails;
+}
+
+/* Same result as esp_image_basic_verify for images with random header bytes */
+static int test_verify_same_as_basic(void)
+{
+    size_t len = make_image(8 * 1024);
+    esp_image_segment_header_t *segment = (esp_image_segment_header_t *) (s_image + sizeof(esp_image_header_t));
+    int fails = 0;
+
+    for (int i = 0; i < 1000 && fails == 0; i++) {
+        make_image(8 * 1024);
+        switch (i % 3) {
+        case 0:
+            s_image[1] = rand() % 8 + 1;                  /* segment count */
+            break;
+        case 1:
+            segment->data_len = (rand() % 8192) & ~(rand() % 2); /* first segment */
+            break;
+        default:
+            s_image[rand() % len] ^= 1 << (rand() % 8);  /* any byte */
+            break;
+        }
+        esp_partition_erase_range(&s_part, 0, 4 * SPI_FLASH_SEC_SIZE);
+        esp_partition_write(&s_part, 0, s_image, 2 * len);
+
+        esp_image_stream_t stream;
+        uint32_t stream_len, basic_len;
+        esp_image_stream_init(&stream, false);
+        esp_image_stream_data(&stream, s_image, 2 * len);
+        esp_err_t stream_err = esp_image_stream_finish(&stream, &stream_len);
+        esp_err_t basic_err = esp_image_basic_verify(s_part.address, false, &basic_len);
+        fails += check(stream_err == basic_err && (stream_err != ESP_OK || stream_len == basic_len),
+                       "esp_image_stream_data same as esp_image_basic_verify");
+    }
+    return fails;
+}
+
+int main(int argc, char **argv)
+{
+    int quiet = argc > 1 && strcmp(argv[1], "-q") == 0;
+    ota_result_t upfront, lazy;
+    int fails = 0;
+
+    size_t len = make_image(IMAGE_SIZE);
+    fails += run_update(IMAGE_SIZE, len, SEGMENT, &upfront);
+    fails += run_update(OTA_WITH_SEQUENTIAL_WRITES, len, SEGMENT, &lazy);
+    /* at most one sector erase and the writes of one segment per call */
+    fails += check(lazy.max_stall_us < 50000, "longest stall with OTA_WITH_SEQUENTIAL_WRITES");
+    fails += check(lazy.erases == IMAGE_SIZE / SPI_FLASH_SEC_SIZE, "sectors erased");
+    fails += test_odd_pieces();
+    fails += test_partition_end();
+    fails += test_verify();
+    fails += test_verify_same_as_basic();
+
+    if (!quiet) {
+        printf("1 MB image in pieces of %d bytes, emulated flash time\n", SEGMENT);
+        printf("%-28s %10s %14s %8s %8s\n", "esp_ota_begin size", "total ms", "max stall ms", "erases", "writes");
+        printf("%-28s %10.1f %14.1f %8u %8u\n", "image size",
+               upfront.total_us / 1000.0, upfront.max_stall_us / 1000.0, upfront.erases, upfront.writes);
+        printf("%-28s %10.1f %14.1f %8u %8u\n", "OTA_WITH_SEQUENTIAL_WRITES",
+               lazy.total_us / 1000.0, lazy.max_stall_us / 1000.0, lazy.erases, lazy.writes);
+    }
+    if (fails != 0) {
+        printf("%d checks failed\n", fails);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,327 @@
+/*
+ * Host test of esp_ota_decoder_write over an emulated flash (flash_emu.c),
+ * with the encoded images gen_ota_image.py makes.
+ *
+ * "test_ota_decode images" writes two versions of an app image, old.bin
+ * and new.bin: made up code, where the new version has some bytes inserted
+ * and some of its addresses moved, like a rebuild after a small change.
+ * The Makefile encodes new.bin with gen_ota_image.py, plain and compressed,
+ * and as a delta against old.bin.
+ *
+ * "test_ota_decode" then installs each encoded image in an emulated OTA
+ * partition, with old.bin in the running one, and checks that new.bin
+ * comes out. Also checks that a delta against another image, truncated
+ * images, and streams broken in the ways the decoder checks for, fail.
+ *
+ * With -q nothing is printed unless a check fails.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_ota_ops.h"
+#include "esp_image_format.h"
+#include "rom/crc.h"
+#include "flash_emu.h"
+
+#define CODE_SIZE   (256 * 1024)
+#define SEGMENT     1436
+
+static const esp_partition_t s_running = {
+    .type = ESP_PARTITION_TYPE_APP,
+    .subtype = ESP_PARTITION_SUBTYPE_APP_OTA_0,
+    .address = 0x110000,
+    .size = 0x140000,
+    .label = "ota_0",
+};
+
+static const esp_partition_t s_update = {
+    .type = ESP_PARTITION_TYPE_APP,
+    .subtype = ESP_PARTITION_SUBTYPE_APP_OTA_1,
+    .address = 0x250000,
+    .size = 0x140000,
+    .label = "ota_1",
+};
+
+static const char *s_encoded_files[] = { "new_raw.ota", "new.ota", "delta_raw.ota", "delta.ota" };
+
+static int check(int cond, const char *what)
+{
+    if (!cond) {
+        printf("FAILED: %s\n", what);
+    }
+    return cond ? 0 : 1;
+}
+
+static uint32_t next_random(uint32_t *state)
+{
+    *state = *state * 1103515245 + 12345;
+    return *state >> 8;
+}
+
+/* Made up code: instructions out of a small set, addresses, and some
+   random bytes. The new version has 300 bytes inserted and the upper
+   addresses moved. */
+static void make_code(uint8_t *code, size_t len, bool new_version)
+{
+    uint32_t state = 1;
+    uint8_t ops[64][3];
+    size_t i = 0;
+    bool inserted = false;
+
+    for (int k = 0; k < 64; k++) {
+        ops[k][0] = next_random(&state);
+        ops[k][1] = next_random(&state);
+        ops[k][2] = next_random(&state);
+    }
+    while (i + 4 <= len) {
+        uint32_t r = next_random(&state) % 10;
+        if (new_version && !inserted && i >= len * 2 / 5) {
+            for (int k = 0; k < 300 && i < len; k++) {
+                code[i++] = k;
+            }
+            inserted = true;
+            continue;
+        }
+        if (r < 7) {
+            memcpy(code + i, ops[next_random(&state) % 64], 3);
+            i += 3;
+        } else if (r < 9) {
+            uint32_t index = next_random(&state) % 4096;
+            uint32_t addr = 0x400d0000 + 4 * index;
+            if (new_version && index >= 2048) {
+                addr += 0x40;
+            }
+            memcpy(code + i, &addr, 4);
+            i += 4;
+        } else {
+            for (int k = 0; k < 4; k++) {
+                code[i++] = next_random(&state);
+            }
+        }
+    }
+    memset(code + i, 0, len - i);
+}
+
+/* App image with the code in two segments, return its length */
+static size_t make_app_image(uint8_t *image, const uint8_t *code, size_t len)
+{
+    esp_image_header_t header = { .magic = ESP_IMAGE_HEADER_MAGIC, .segment_count = 2 };
+    esp_image_segment_header_t segment;
+    size_t offset = sizeof(header);
+    uint8_t checksum = 0xef;
+
+    memcpy(image, &header, sizeof(header));
+    for (int i = 0; i < 2; i++) {
+        segment.load_addr = 0x400d0000 + i * len / 2;
+        segment.data_len = len / 2;
+        memcpy(image + offset, &segment, sizeof(segment));
+        offset += sizeof(segment);
+        memcpy(image + offset, code + i * len / 2, len / 2);
+        for (size_t k = 0; k < len / 2; k++) {
+            checksum ^= code[i * len / 2 + k];
+        }
+        offset += len / 2;
+    }
+    size_t image_len = (offset + 16) & ~15;
+    memset(image + offset, 0, image_len - offset);
+    image[image_len - 1] = checksum;
+    return image_len;
+}
+
+static int write_file(const char *name, const uint8_t *data, size_t len)
+{
+    FILE *f = fopen(name, "wb");
+    size_t written = f ? fwrite(data, 1, len, f) : 0;
+    if (f) {
+        fclose(f);
+    }
+    return check(written == len, name);
+}
+
+static uint8_t *read_file(const char *name, size_t *len)
+{
+    FILE *f = fopen(name, "rb");
+    if (f == NULL) {
+        printf("can't open %s\n", name);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    *len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = malloc(*len);
+    if (fread(data, 1, *len, f) != *len) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    return data;
+}
+
+static int make_images(void)
+{
+    static uint8_t code[CODE_SIZE];
+    static uint8_t image[CODE_SIZE + 64];
+    int fails = 0;
+
+    make_code(code, sizeof(code), false);
+    fails += write_file("old.bin", image, make_app_image(image, code, sizeof(code)));
+    make_code(code, sizeof(code), true);
+    fails += write_file("new.bin", image, make_app_image(image, code, sizeof(code)));
+    return fails;
+}
+
+/* Flash with the old image in the running partition */
+static void reset_flash(const uint8_t *old_image, size_t old_len)
+{
+    flash_emu_reset();
+    esp_partition_erase_range(&s_running, 0, s_running.size);
+    esp_partition_write(&s_running, 0, old_image, old_len);
+}
+
+static esp_err_t decode_update(const uint8_t *encoded, size_t len, const esp_partition_t *source)
+{
+    esp_ota_handle_t handle;
+    esp_ota_decoder_handle_t decoder;
+    esp_err_t err;
+
+    err = esp_ota_begin(&s_update, OTA_WITH_SEQUENTIAL_WRITES, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = esp_ota_decoder_begin(handle, source, &decoder);
+    if (err != ESP_OK) {
+        return err;
+    }
+    for (size_t off = 0; off < len && err == ESP_OK; off += SEGMENT) {
+        err = esp_ota_decoder_write(decoder, encoded + off, len - off < SEGMENT ? len - off : SEGMENT);
+    }
+    esp_err_t end_err = esp_ota_decoder_end(decoder);
+    if (err == ESP_OK) {
+        err = end_err;
+    }
+    if (err == ESP_OK) {
+        err = esp_ota_end(handle);
+    }
+    return err;
+}
+
+/* Header and payload, decoded with old_image in the running partition */
+static esp_err_t decode_stream(const esp_ota_encoded_header_t *header, const uint8_t *payload,
+                               size_t len, const uint8_t *old_image, size_t old_len)
+{
+    uint8_t stream[sizeof(*header) + 64];
+
+    memcpy(stream, header, sizeof(*header));
+    memcpy(stream + sizeof(*header), payload, len);
+    reset_flash(old_image, old_len);
+    return decode_update(stream, sizeof(*header) + len, &s_running);
+}
+
+static int test_broken_streams(const uint8_t *old_image, size_t old_len)
+{
+    const esp_ota_encoded_header_t compressed = {
+        .magic = ESP_OTA_ENCODED_MAGIC, .version = 1, .flags = ESP_OTA_ENCODED_COMPRESSED,
+        .window_bits = 12, .image_size = 1024,
+    };
+    const esp_ota_encoded_header_t delta = {
+        .magic = ESP_OTA_ENCODED_MAGIC, .version = 1, .flags = ESP_OTA_ENCODED_DELTA,
+        .image_size = 1024, .source_size = old_len, .source_crc = crc32_le(0, old_image, old_len),
+    };
+    esp_ota_encoded_header_t header;
+    int fails = 0;
+
+    header = compressed;
+    header.window_bits = 13;
+    fails += check(decode_stream(&header, (const uint8_t *) "", 0, old_image, old_len) == ESP_ERR_OTA_DECODE_FAILED,
+                   "window too large");
+
+    /* a literal, then a match two bytes back */
+    const uint8_t early_match[] = { 0x02, 0xe9, 0x01, 0x00 };
+    fails += check(decode_stream(&compressed, early_match, sizeof(early_match), old_image, old_len)
+                   == ESP_ERR_OTA_DECODE_FAILED, "match before the start of the image");
+
+    uint8_t copy[9] = { 0x01 };
+    uint32_t offset = old_len - 4, length = 16;
+    memcpy(copy + 1, &offset, 4);
+    memcpy(copy + 5, &length, 4);
+    fails += check(decode_stream(&delta, copy, sizeof(copy), old_image, old_len)
+                   == ESP_ERR_OTA_DECODE_FAILED, "copy past the source image");
+
+    const uint8_t invalid_op[] = { 0x07, 0, 0, 0, 0 };
+    fails += check(decode_stream(&delta, invalid_op, sizeof(invalid_op), old_image, old_len)
+                   == ESP_ERR_OTA_DECODE_FAILED, "invalid delta operation");
+
+    header = delta;
+    header.image_size = 4;
+    const uint8_t too_long[] = { 0x03, 8, 0, 0, 0, 0xe9, 1, 2, 3, 4, 5, 6, 7 };
+    fails += check(decode_stream(&header, too_long, sizeof(too_long), old_image, old_len)
+                   == ESP_ERR_OTA_DECODE_FAILED, "image longer than the header says");
+    return fails;
+}
+
+int main(int argc, char **argv)
+{
+    int quiet = argc > 1 && strcmp(argv[1], "-q") == 0;
+    size_t old_len, new_len, len;
+    uint8_t *old_image, *new_image, *encoded;
+    int fails = 0;
+
+    if (argc > 1 && strcmp(argv[1], "images") == 0) {
+        return make_images();
+    }
+
+    old_image = read_file("old.bin", &old_len);
+    new_image = read_file("new.bin", &new_len);
+    if (old_image == NULL || new_image == NULL) {
+        return 1;
+    }
+
+    if (!quiet) {
+        printf("%zu byte app image, encoded with gen_ota_image.py\n", new_len);
+        printf("%-16s %10s %8s %10s\n", "", "bytes", "%", "flash ms");
+    }
+    for (int i = 0; i < sizeof(s_encoded_files) / sizeof(s_encoded_files[0]); i++) {
+        encoded = read_file(s_encoded_files[i], &len);
+        if (encoded == NULL) {
+            return 1;
+        }
+        reset_flash(old_image, old_len);
+        uint64_t t = flash_emu_time_us();
+        fails += check(decode_update(encoded, len, &s_running) == ESP_OK, s_encoded_files[i]);
+        fails += check(memcmp(flash_emu_data() + s_update.address, new_image, new_len) == 0,
+                       "decoded image in flash");
+        if (!quiet) {
+            printf("%-16s %10zu %8.1f %10.1f\n", s_encoded_files[i], len,
+                   100.0 * len / new_len, (flash_emu_time_us() - t) / 1000.0);
+        }
+        free(encoded);
+    }
+
+    encoded = read_file("delta.ota", &len);
+    if (encoded == NULL) {
+        return 1;
+    }
+    reset_flash(old_image, old_len);
+    fails += check(decode_update(encoded, len, NULL) == ESP_ERR_OTA_DECODE_FAILED,
+                   "delta without source partition");
+    old_image[old_len / 2] ^= 1;
+    reset_flash(old_image, old_len);
+    fails += check(decode_update(encoded, len, &s_running) == ESP_ERR_OTA_DECODE_FAILED,
+                   "delta against another image");
+    old_image[old_len / 2] ^= 1;
+    reset_flash(old_image, old_len);
+    fails += check(decode_update(encoded, len - 100, &s_running) == ESP_ERR_OTA_DECODE_FAILED,
+                   "truncated delta");
+    free(encoded);
+
+    fails += test_broken_streams(old_image, old_len);
+
+    free(old_image);
+    free(new_image);
+    if (fails != 0) {
+        printf("%d checks failed\n", fails);
+        return 1;
+    }
+    return 0;
+}
@@ -15,6 +15,7 @@
 #define __ESP32_IMAGE_FORMAT_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <esp_err.h>
 
 #define ESP_ERR_IMAGE_BASE       0x2000
@@ -36,7 +37,7 @@ typedef enum {
 } esp_image_spi_mode_t;
 
 /* SPI flash clock frequency */
-enum {
+typedef enum {
     ESP_IMAGE_SPI_SPEED_40M,
     ESP_IMAGE_SPI_SPEED_26M,
     ESP_IMAGE_SPI_SPEED_20M,
@@ -130,6 +131,56 @@ esp_err_t esp_image_load_segment_header(uint8_t index, uint32_t src_addr, const
  */
 esp_err_t esp_image_basic_verify(uint32_t src_addr, bool log_errors, uint32_t *length);
 
+/* State of esp_image_stream_data(), see there */
+typedef struct {
+    uint32_t offset;          /* bytes of the image passed in so far */
+    uint32_t length;          /* length as esp_image_basic_verify gives it, 0 until known */
+    uint32_t data_left;       /* of the current segment */
+    uint8_t state;
+    uint8_t segments_left;
+    uint8_t checksum;
+    bool log_errors;
+    uint8_t header_len;       /* bytes in header_buf */
+    uint8_t header_buf[sizeof(esp_image_header_t)];
+} esp_image_stream_t;
+
+/**
+ * @brief Start validating an app image as it is being received.
+ *
+ * @param[out] stream State for esp_image_stream_data.
+ * @param log_errors Log errors verifying the image.
+ */
+void esp_image_stream_init(esp_image_stream_t *stream, bool log_errors);
+
+/**
+ * @brief Validate the next part of an app image.
+ *
+ * Does the checks of esp_image_basic_verify on the data as it comes, without
+ * reading it back from flash. Errors in the image or segment headers are
+ * reported as soon as the header is complete. Data after the end of the
+ * image (for example the secure boot signature block) is ignored.
+ *
+ * Once the last segment header has been passed in, stream->length is the
+ * length of the image including padding and checksum.
+ *
+ * @param stream State set up by esp_image_stream_init.
+ * @param data Next part of the image.
+ * @param len Length of data.
+ *
+ * @return ESP_OK if the image is valid so far, ESP_ERR_IMAGE_INVALID if not.
+ */
+esp_err_t esp_image_stream_data(esp_image_stream_t *stream, const void *data, size_t len);
+
+/**
+ * @brief Finish validating an app image.
+ *
+ * @param stream State passed to esp_image_stream_data.
+ * @param[out] length Length of the image, as with esp_image_basic_verify. Can be null.
+ *
+ * @return ESP_OK if the whole image has been passed in and it is valid,
+ * ESP_ERR_IMAGE_INVALID if not.
+ */
+esp_err_t esp_image_stream_finish(const esp_image_stream_t *stream, uint32_t *length);
 
 typedef struct {
     uint32_t drom_addr;
@@ -80,6 +80,19 @@ typedef struct {
     uint8_t signature[64];
 } esp_secure_boot_sig_block_t;
 
+/** @brief Verify a secure boot signature block against the SHA-256 digest of the data it signs.
+ *
+ * As esp_secure_boot_verify_signature, for callers which have already
+ * digested the data, for example while receiving it.
+ *
+ * @param sig_block Signature block, as appended to the data.
+ * @param image_digest SHA-256 digest (32 bytes) of the data.
+ *
+ * @return ESP_OK if signature is valid, ESP_ERR_IMAGE_INVALID if
+ * signature fails, ESP_FAIL for other failures (ie invalid signature block).
+ */
+esp_err_t esp_secure_boot_verify_signature_block(const esp_secure_boot_sig_block_t *sig_block, const uint8_t *image_digest);
+
 #define FLASH_OFFS_SECURE_BOOT_IV_DIGEST 0
 
 /** @brief Secure boot IV+digest header */
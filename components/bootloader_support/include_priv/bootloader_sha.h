@@ -0,0 +1,53 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+/* Bootloader-only SHA-256 on the SHA hardware registers.
+
+   Unlike ets_sha_update(), data is fed to the engine a whole 64 byte
+   block at a time, and the next block is loaded from (mapped) flash
+   while the engine is still busy with the previous one.
+
+   Only one digest can be in progress at a time. Not available in the
+   app, which has esp_sha() and the mbedTLS SHA API instead.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BOOTLOADER_SHA256_DIGEST_LEN 32
+
+/**
+ * @brief Start a SHA-256 digest, enabling the SHA peripheral
+ */
+void bootloader_sha256_start(void);
+
+/**
+ * @brief Add data to the digest
+ *
+ * Any length is accepted. Fastest when data is word aligned and the
+ * length is a multiple of 64 bytes, apart from the last call.
+ *
+ * @param data Data to digest. May point into bootloader_mmap()ed flash.
+ * @param data_len Length of data in bytes.
+ */
+void bootloader_sha256_data(const void *data, size_t data_len);
+
+/**
+ * @brief Finish the digest and disable the SHA peripheral
+ *
+ * @param digest Buffer for the BOOTLOADER_SHA256_DIGEST_LEN byte digest.
+ */
+void bootloader_sha256_finish(uint8_t *digest);
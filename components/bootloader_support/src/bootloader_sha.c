@@ -0,0 +1,139 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "bootloader_sha.h"
+
+#ifdef BOOTLOADER_BUILD
+#include <stdbool.h>
+#include <string.h>
+
+#include "rom/sha.h"
+#include "soc/hwcrypto_reg.h"
+
+#define BLOCK_WORDS  (64 / sizeof(uint32_t))
+#define DIGEST_WORDS (BOOTLOADER_SHA256_DIGEST_LEN / sizeof(uint32_t))
+
+static uint32_t partial_block[BLOCK_WORDS]; /* bytes not yet fed, as read */
+static size_t partial_len;                  /* bytes in partial_block */
+static size_t total_len;                    /* bytes digested so far */
+static bool first_block;
+
+static inline void wait_idle(void)
+{
+    while (REG_READ(SHA_256_BUSY_REG) != 0) { }
+}
+
+/* Pass one block to the engine. Not waiting for it to finish, so that
+   the caller can read the next block from flash in the meantime.
+*/
+static void feed_block(const uint32_t *words)
+{
+    uint32_t *sha_text = (uint32_t *)(SHA_TEXT_BASE);
+
+    wait_idle();
+    for (int i = 0; i < BLOCK_WORDS; i++) {
+        sha_text[i] = __builtin_bswap32(words[i]);
+    }
+    asm volatile ("memw");
+
+    if (first_block) {
+        REG_WRITE(SHA_256_START_REG, 1);
+        first_block = false;
+    } else {
+        REG_WRITE(SHA_256_CONTINUE_REG, 1);
+    }
+}
+
+void bootloader_sha256_start(void)
+{
+    ets_sha_enable();
+    partial_len = 0;
+    total_len = 0;
+    first_block = true;
+}
+
+void bootloader_sha256_data(const void *data, size_t data_len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    uint32_t block[BLOCK_WORDS];
+
+    total_len += data_len;
+
+    if (partial_len > 0) {
+        size_t copy = sizeof(partial_block) - partial_len;
+        if (copy > data_len) {
+            copy = data_len;
+        }
+        memcpy((uint8_t *)partial_block + partial_len, p, copy);
+        partial_len += copy;
+        p += copy;
+        data_len -= copy;
+        if (partial_len < sizeof(partial_block)) {
+            return;
+        }
+        feed_block(partial_block);
+        partial_len = 0;
+    }
+
+    while (data_len >= sizeof(block)) {
+        /* Reading the block from flash is where the cache misses are,
+           this runs while the engine still works on the previous block */
+        if (((intptr_t)p & 3) == 0) {
+            const uint32_t *w = (const uint32_t *)p;
+            for (int i = 0; i < BLOCK_WORDS; i++) {
+                block[i] = w[i];
+            }
+        } else {
+            memcpy(block, p, sizeof(block));
+        }
+        feed_block(block);
+        p += sizeof(block);
+        data_len -= sizeof(block);
+    }
+
+    if (data_len > 0) {
+        memcpy(partial_block, p, data_len);
+        partial_len = data_len;
+    }
+}
+
+void bootloader_sha256_finish(uint8_t *digest)
+{
+    static const uint8_t padding[64] = { 0x80 };
+    uint64_t bit_len = (uint64_t)total_len * 8;
+    uint8_t length_be[8];
+
+    for (int i = 0; i < 8; i++) {
+        length_be[i] = bit_len >> (56 - 8 * i);
+    }
+
+    /* 0x80 then zeroes up to 56 mod 64, then the 64-bit length */
+    size_t pad_len = (partial_len < 56) ? (56 - partial_len) : (120 - partial_len);
+    bootloader_sha256_data(padding, pad_len);
+    bootloader_sha256_data(length_be, sizeof(length_be));
+
+    wait_idle();
+    REG_WRITE(SHA_256_LOAD_REG, 1);
+    wait_idle();
+
+    uint32_t *sha_text = (uint32_t *)(SHA_TEXT_BASE);
+    for (int i = 0; i < DIGEST_WORDS; i++) {
+        uint32_t w = __builtin_bswap32(sha_text[i]);
+        memcpy(digest + i * sizeof(w), &w, sizeof(w));
+    }
+    asm volatile ("memw");
+
+    ets_sha_disable();
+}
+
+#endif
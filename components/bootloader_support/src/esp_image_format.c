@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #include <string.h>
+#include <sys/param.h>
 
 #include <esp_image_format.h>
 #include <esp_log.h>
@@ -172,3 +173,162 @@ esp_err_t esp_image_basic_verify(uint32_t src_addr, bool log_errors, uint32_t *p
     }
     return ESP_OK;
 }
+
+enum {
+    STREAM_HEADER,
+    STREAM_SEGMENT_HEADER,
+    STREAM_SEGMENT_DATA,
+    STREAM_PADDING,
+    STREAM_DONE,
+    STREAM_INVALID,
+};
+
+void esp_image_stream_init(esp_image_stream_t *stream, bool log_errors)
+{
+    bzero(stream, sizeof(esp_image_stream_t));
+    stream->state = STREAM_HEADER;
+    stream->checksum = ESP_ROM_CHECKSUM_INITIAL;
+    stream->log_errors = log_errors;
+}
+
+/* After a segment: on to the next segment header, or to the padding */
+static esp_err_t stream_next_segment(esp_image_stream_t *stream)
+{
+    if (stream->segments_left > 0) {
+        stream->segments_left--;
+        stream->state = STREAM_SEGMENT_HEADER;
+        return ESP_OK;
+    }
+    if (stream->offset >= SIXTEEN_MB) {
+        if (stream->log_errors) {
+            ESP_LOGE(TAG, "invalid total length 0x%x", stream->offset);
+        }
+        return ESP_ERR_IMAGE_INVALID;
+    }
+    /* image padded to next full 16 byte block, with checksum byte at very end */
+    stream->length = (stream->offset + 16) - (stream->offset + 16) % 16;
+    stream->state = STREAM_PADDING;
+    return ESP_OK;
+}
+
+static esp_err_t stream_header(esp_image_stream_t *stream)
+{
+    if (stream->state == STREAM_HEADER) {
+        esp_image_header_t header;
+        memcpy(&header, stream->header_buf, sizeof(header));
+        if (header.magic != ESP_IMAGE_HEADER_MAGIC) {
+            if (stream->log_errors) {
+                ESP_LOGE(TAG, "image has invalid magic byte");
+            }
+            return ESP_ERR_IMAGE_INVALID;
+        }
+        if (header.segment_count == 0) {
+            if (stream->log_errors) {
+                ESP_LOGE(TAG, "image has no segments");
+            }
+            return ESP_ERR_IMAGE_INVALID;
+        }
+        stream->segments_left = header.segment_count - 1;
+        stream->state = STREAM_SEGMENT_HEADER;
+        return ESP_OK;
+    }
+
+    esp_image_segment_header_t segment_header;
+    memcpy(&segment_header, stream->header_buf, sizeof(segment_header));
+    if ((segment_header.data_len & 3) != 0
+        || segment_header.data_len >= SIXTEEN_MB) {
+        if (stream->log_errors) {
+            ESP_LOGE(TAG, "invalid segment length 0x%x", segment_header.data_len);
+        }
+        return ESP_ERR_IMAGE_INVALID;
+    }
+    stream->data_left = segment_header.data_len;
+    if (stream->data_left == 0) {
+        return stream_next_segment(stream);
+    }
+    stream->state = STREAM_SEGMENT_DATA;
+    return ESP_OK;
+}
+
+esp_err_t esp_image_stream_data(esp_image_stream_t *stream, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *) data;
+    esp_err_t err = ESP_OK;
+
+    while (len > 0 && err == ESP_OK) {
+        size_t n;
+        switch (stream->state) {
+        case STREAM_HEADER:
+        case STREAM_SEGMENT_HEADER: {
+            size_t header_len = (stream->state == STREAM_HEADER) ?
+                sizeof(esp_image_header_t) : sizeof(esp_image_segment_header_t);
+            n = MIN(len, header_len - stream->header_len);
+            memcpy(stream->header_buf + stream->header_len, p, n);
+            stream->header_len += n;
+            if (stream->header_len == header_len) {
+                stream->header_len = 0;
+                /* with offset past the header, for stream_next_segment */
+                stream->offset += n;
+                err = stream_header(stream);
+                stream->offset -= n;
+            }
+            break;
+        }
+        case STREAM_SEGMENT_DATA:
+            n = MIN(len, stream->data_left);
+            for (size_t i = 0; i < n; i++) {
+                stream->checksum ^= p[i];
+            }
+            stream->data_left -= n;
+            if (stream->data_left == 0) {
+                stream->offset += n;
+                err = stream_next_segment(stream);
+                stream->offset -= n;
+            }
+            break;
+        case STREAM_PADDING:
+            n = MIN(len, stream->length - stream->offset);
+            if (stream->offset + n == stream->length) {
+                if (stream->checksum != p[n - 1]) {
+                    if (stream->log_errors) {
+                        ESP_LOGE(TAG, "checksum failed. Calculated 0x%x read 0x%x",
+                                 stream->checksum, p[n - 1]);
+                    }
+                    err = ESP_ERR_IMAGE_INVALID;
+                }
+                stream->state = STREAM_DONE;
+            }
+            break;
+        case STREAM_DONE:
+            n = len;
+            break;
+        default:
+            return ESP_ERR_IMAGE_INVALID;
+        }
+        p += n;
+        len -= n;
+        stream->offset += n;
+    }
+
+    if (err != ESP_OK) {
+        stream->state = STREAM_INVALID;
+    }
+    return err;
+}
+
+esp_err_t esp_image_stream_finish(const esp_image_stream_t *stream, uint32_t *length)
+{
+    if (length != NULL) {
+        *length = 0;
+    }
+    if (stream->state != STREAM_DONE) {
+        if (stream->log_errors && stream->state != STREAM_INVALID) {
+            ESP_LOGE(TAG, "image truncated at 0x%x", stream->offset);
+        }
+        return ESP_ERR_IMAGE_INVALID;
+    }
+    if (length != NULL) {
+        *length = stream->length;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,7 @@
+/*
+ * mbedTLS configuration for the software SHA-256 of sha_emu.c and of the
+ * reference digests
+ */
+#pragma once
+
+#define MBEDTLS_SHA256_C
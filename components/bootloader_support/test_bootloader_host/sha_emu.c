@@ -0,0 +1,149 @@
+/*
+ * The SHA-256 part of the ESP32 SHA accelerator, for bootloader_sha.c on
+ * the host. The blocks written to the text registers are compressed with
+ * mbedtls_sha256_process(), and LOAD puts the state into the text
+ * registers. After START, CONTINUE and LOAD the engine stays busy for
+ * sha_emu_busy_polls reads of SHA_256_BUSY_REG. Timing runs can turn the
+ * compression off with sha_emu_compute, to time only the driver.
+ *
+ * The emulator counts the operations and reports as errors: accesses
+ * while the peripheral is disabled or the engine is busy, text written
+ * while the engine is busy, CONTINUE or LOAD without START, and unknown
+ * registers.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "rom/sha.h"
+#include "soc/hwcrypto_reg.h"
+#include "mbedtls/sha256.h"
+#include "sha_emu.h"
+
+uint32_t sha_emu_text[16];
+int sha_emu_busy_polls = 2;
+bool sha_emu_compute = true;
+sha_emu_stats_t sha_emu_stats;
+
+static bool enabled;
+static bool started;
+static int busy;
+static uint32_t busy_text[16];     /* text registers when the engine started */
+static mbedtls_sha256_context ctx;
+
+static void error(const char *what)
+{
+    printf("sha_emu: %s\n", what);
+    sha_emu_stats.errors++;
+}
+
+void ets_sha_enable(void)
+{
+    if (enabled) {
+        error("enabled twice");
+    }
+    enabled = true;
+    started = false;
+    busy = 0;
+    sha_emu_stats.enables++;
+}
+
+void ets_sha_disable(void)
+{
+    if (!enabled) {
+        error("disabled twice");
+    }
+    if (busy > 0) {
+        error("disabled while busy");
+    }
+    enabled = false;
+}
+
+bool sha_emu_enabled(void)
+{
+    return enabled;
+}
+
+static void run(void)
+{
+    memcpy(busy_text, sha_emu_text, sizeof(busy_text));
+    busy = sha_emu_busy_polls;
+}
+
+static void process_text(void)
+{
+    unsigned char block[64];
+
+    if (!sha_emu_compute) {
+        return;
+    }
+    for (int i = 0; i < 16; i++) {
+        block[4 * i] = sha_emu_text[i] >> 24;
+        block[4 * i + 1] = sha_emu_text[i] >> 16;
+        block[4 * i + 2] = sha_emu_text[i] >> 8;
+        block[4 * i + 3] = sha_emu_text[i];
+    }
+    mbedtls_sha256_process(&ctx, block);
+}
+
+uint32_t sha_emu_read(uintptr_t reg)
+{
+    if (!enabled) {
+        error("read while disabled");
+    }
+    if (reg != SHA_256_BUSY_REG) {
+        error("read of an unknown register");
+        return 0;
+    }
+    sha_emu_stats.polls++;
+    if (busy == 0) {
+        return 0;
+    }
+    if (memcmp(busy_text, sha_emu_text, sizeof(busy_text)) != 0) {
+        error("text written while busy");
+    }
+    sha_emu_stats.busy_polls++;
+    busy--;
+    return 1;
+}
+
+void sha_emu_write(uintptr_t reg, uint32_t value)
+{
+    if (!enabled) {
+        error("write while disabled");
+    }
+    if (busy > 0) {
+        error("write while busy");
+    }
+    if (value != 1) {
+        error("write of a value other than 1");
+    }
+
+    switch (reg) {
+    case SHA_256_START_REG:
+        mbedtls_sha256_init(&ctx);
+        mbedtls_sha256_starts(&ctx, 0);
+        process_text();
+        started = true;
+        sha_emu_stats.starts++;
+        break;
+    case SHA_256_CONTINUE_REG:
+        if (!started) {
+            error("CONTINUE without START");
+        }
+        process_text();
+        sha_emu_stats.continues++;
+        break;
+    case SHA_256_LOAD_REG:
+        if (!started) {
+            error("LOAD without START");
+        }
+        memcpy(sha_emu_text, ctx.state, sizeof(ctx.state));
+        started = false;
+        sha_emu_stats.loads++;
+        break;
+    default:
+        error("write of an unknown register");
+        return;
+    }
+    run();
+}
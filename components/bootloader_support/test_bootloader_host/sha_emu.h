@@ -0,0 +1,26 @@
+/*
+ * SHA accelerator emulation for host tests, see sha_emu.c
+ */
+#pragma once
+
+#include <stdbool.h>
+
+typedef struct {
+    unsigned enables;       /* ets_sha_enable() calls */
+    unsigned starts;        /* SHA_256_START_REG writes */
+    unsigned continues;     /* SHA_256_CONTINUE_REG writes */
+    unsigned loads;         /* SHA_256_LOAD_REG writes */
+    unsigned polls;         /* SHA_256_BUSY_REG reads */
+    unsigned busy_polls;    /* ... that found the engine busy */
+    unsigned errors;        /* register accesses the hardware doesn't allow */
+} sha_emu_stats_t;
+
+extern sha_emu_stats_t sha_emu_stats;
+
+/* reads of SHA_256_BUSY_REG that return 1 after an operation */
+extern int sha_emu_busy_polls;
+
+/* false to skip the SHA-256 computation, the digests are wrong then */
+extern bool sha_emu_compute;
+
+bool sha_emu_enabled(void);
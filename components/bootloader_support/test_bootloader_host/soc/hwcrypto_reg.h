@@ -0,0 +1,30 @@
+/*
+ * The SHA registers of soc/hwcrypto_reg.h, emulated by sha_emu.c: register
+ * reads and writes go to the emulator, the text registers are an array.
+ */
+#ifndef __HWCRYPTO_REG_H__
+#define __HWCRYPTO_REG_H__
+
+#include <stdint.h>
+
+extern uint32_t sha_emu_text[16];
+
+uint32_t sha_emu_read(uintptr_t reg);
+void sha_emu_write(uintptr_t reg, uint32_t value);
+
+#define REG_READ(_r)            sha_emu_read((uintptr_t)(_r))
+#define REG_WRITE(_r, _v)       sha_emu_write((uintptr_t)(_r), (_v))
+
+#define DR_REG_SHA_BASE         0x3ff03000
+
+#define SHA_TEXT_BASE           ((uintptr_t) sha_emu_text)
+
+#define SHA_256_START_REG       ((DR_REG_SHA_BASE) + 0x90)
+#define SHA_256_CONTINUE_REG    ((DR_REG_SHA_BASE) + 0x94)
+#define SHA_256_LOAD_REG        ((DR_REG_SHA_BASE) + 0x98)
+#define SHA_256_BUSY_REG        ((DR_REG_SHA_BASE) + 0x9c)
+
+/* The Xtensa write barrier "memw", assembled to nothing on the host */
+__asm__(".macro memw\n.endm");
+
+#endif
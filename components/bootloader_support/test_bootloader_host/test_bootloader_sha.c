@@ -0,0 +1,289 @@
+/*
+ * Host test of bootloader_sha.c, the SHA-256 of the secure boot image
+ * digest, on the emulated SHA registers of sha_emu.c.
+ *
+ * Checks the digest against the test vectors of FIPS 180-2 and against
+ * mbedtls_sha256() for all lengths up to a few blocks, fed in one and in
+ * several calls and from misaligned buffers, and checks the register
+ * sequence: START, one CONTINUE per further block, then LOAD, never
+ * touching the engine while it is busy.
+ *
+ * Then compares a 1 MB image with the 8 byte ets_sha_update() calls the
+ * bootloader used before (with a model of the ROM function on the same
+ * registers): the register accesses, and the time the driver takes on the
+ * host without the SHA computation. With -q only the checks are run.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bootloader_sha.h"
+#include "mbedtls/sha256.h"
+#include "rom/sha.h"
+#include "soc/hwcrypto_reg.h"
+#include "sha_emu.h"
+
+#define IMAGE_LEN   (1024 * 1024)
+
+static int failures;
+
+#define CHECK(cond) do { if (!(cond)) { \
+    fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+    failures++; } } while (0)
+
+static void hex_digest(const uint8_t *digest, char *hex)
+{
+    for (int i = 0; i < BOOTLOADER_SHA256_DIGEST_LEN; i++) {
+        sprintf(hex + 2 * i, "%02x", digest[i]);
+    }
+}
+
+static void digest_of(const void *data, size_t len, uint8_t *digest)
+{
+    bootloader_sha256_start();
+    bootloader_sha256_data(data, len);
+    bootloader_sha256_finish(digest);
+}
+
+static void test_vectors(void)
+{
+    static const struct {
+        const char *data;
+        const char *digest;
+    } vectors[] = {
+        { "", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+        { "abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+        { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+          "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+    };
+    static char million_a[1000000];
+    uint8_t digest[BOOTLOADER_SHA256_DIGEST_LEN];
+    char hex[2 * BOOTLOADER_SHA256_DIGEST_LEN + 1];
+
+    for (int i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        digest_of(vectors[i].data, strlen(vectors[i].data), digest);
+        hex_digest(digest, hex);
+        CHECK(strcmp(hex, vectors[i].digest) == 0);
+    }
+    memset(million_a, 'a', sizeof(million_a));
+    digest_of(million_a, sizeof(million_a), digest);
+    hex_digest(digest, hex);
+    CHECK(strcmp(hex, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0") == 0);
+}
+
+/* Digest of data[0..len) fed in calls of the given lengths, cycled */
+static void digest_split(const uint8_t *data, size_t len, const size_t *splits, int n_splits,
+                         uint8_t *digest)
+{
+    size_t done = 0;
+
+    bootloader_sha256_start();
+    for (int i = 0; done < len; i = (i + 1) % n_splits) {
+        size_t chunk = splits[i] < len - done ? splits[i] : len - done;
+        bootloader_sha256_data(data + done, chunk);
+        done += chunk;
+    }
+    bootloader_sha256_finish(digest);
+}
+
+static void test_lengths(void)
+{
+    static const size_t splits[][3] = {
+        { 4096, 4096, 4096 },       /* one call */
+        { 1, 1, 1 },
+        { 7, 64, 3 },
+        { 63, 65, 64 },
+        { 56, 8, 120 },
+    };
+    static uint8_t buf[400];
+    uint8_t digest[BOOTLOADER_SHA256_DIGEST_LEN], expect[BOOTLOADER_SHA256_DIGEST_LEN];
+
+    for (int i = 0; i < sizeof(buf); i++) {
+        buf[i] = i * 7 + 3;
+    }
+    for (size_t len = 0; len <= 300; len++) {
+        /* word aligned and misaligned data */
+        for (int offset = 0; offset < 4; offset++) {
+            mbedtls_sha256(buf + offset, len, expect, 0);
+            for (int s = 0; s < sizeof(splits) / sizeof(splits[0]); s++) {
+                memset(&sha_emu_stats, 0, sizeof(sha_emu_stats));
+                digest_split(buf + offset, len, splits[s], 3, digest);
+                CHECK(memcmp(digest, expect, sizeof(digest)) == 0);
+
+                /* padding and length make (len + 9) rounded up to blocks */
+                CHECK(sha_emu_stats.enables == 1);
+                CHECK(sha_emu_stats.starts == 1);
+                CHECK(sha_emu_stats.continues == (len + 9 + 63) / 64 - 1);
+                CHECK(sha_emu_stats.loads == 1);
+                CHECK(sha_emu_stats.errors == 0);
+                CHECK(!sha_emu_enabled());
+            }
+        }
+    }
+}
+
+/* The driver waits for the engine however long it takes */
+static void test_busy(void)
+{
+    static uint8_t buf[1000];
+    uint8_t digest[BOOTLOADER_SHA256_DIGEST_LEN], expect[BOOTLOADER_SHA256_DIGEST_LEN];
+    int saved = sha_emu_busy_polls;
+
+    mbedtls_sha256(buf, sizeof(buf), expect, 0);
+    for (sha_emu_busy_polls = 0; sha_emu_busy_polls < 20; sha_emu_busy_polls += 7) {
+        memset(&sha_emu_stats, 0, sizeof(sha_emu_stats));
+        digest_of(buf, sizeof(buf), digest);
+        CHECK(memcmp(digest, expect, sizeof(digest)) == 0);
+        /* 16 blocks and the LOAD */
+        CHECK(sha_emu_stats.busy_polls == 17 * sha_emu_busy_polls);
+        CHECK(sha_emu_stats.errors == 0);
+    }
+    sha_emu_busy_polls = saved;
+}
+
+/*
+ * A model of the ROM SHA functions the bootloader used before, on the same
+ * registers: ets_sha_update() takes a multiple of 64 bits, buffers it and
+ * hands each full block to the engine, waiting for it to finish.
+ */
+static uint8_t rom_block[64];
+static size_t rom_block_len;
+static uint64_t rom_total_bits;
+static bool rom_started;
+
+static void rom_feed_block(void)
+{
+    uint32_t *sha_text = (uint32_t *)(SHA_TEXT_BASE);
+
+    while (REG_READ(SHA_256_BUSY_REG) != 0) { }
+    for (int i = 0; i < 16; i++) {
+        sha_text[i] = ((uint32_t) rom_block[4 * i] << 24) | (rom_block[4 * i + 1] << 16) |
+                      (rom_block[4 * i + 2] << 8) | rom_block[4 * i + 3];
+    }
+    REG_WRITE(rom_started ? SHA_256_CONTINUE_REG : SHA_256_START_REG, 1);
+    rom_started = true;
+    while (REG_READ(SHA_256_BUSY_REG) != 0) { }
+    rom_block_len = 0;
+}
+
+static void rom_sha_init(void)
+{
+    rom_block_len = 0;
+    rom_total_bits = 0;
+    rom_started = false;
+}
+
+static void rom_sha_update(const uint8_t *input, size_t input_bits)
+{
+    for (size_t i = 0; i < input_bits / 8; i++) {
+        rom_block[rom_block_len++] = input[i];
+        rom_total_bits += 8;
+        if (rom_block_len == sizeof(rom_block)) {
+            rom_feed_block();
+        }
+    }
+}
+
+static void rom_sha_finish(uint8_t *output)
+{
+    uint64_t bits = rom_total_bits;
+    uint32_t *sha_text = (uint32_t *)(SHA_TEXT_BASE);
+
+    rom_block[rom_block_len++] = 0x80;
+    if (rom_block_len > 56) {
+        memset(rom_block + rom_block_len, 0, 64 - rom_block_len);
+        rom_feed_block();
+    }
+    memset(rom_block + rom_block_len, 0, 56 - rom_block_len);
+    for (int i = 0; i < 8; i++) {
+        rom_block[56 + i] = bits >> (56 - 8 * i);
+    }
+    rom_feed_block();
+    REG_WRITE(SHA_256_LOAD_REG, 1);
+    while (REG_READ(SHA_256_BUSY_REG) != 0) { }
+    for (int i = 0; i < 8; i++) {
+        output[4 * i] = sha_text[i] >> 24;
+        output[4 * i + 1] = sha_text[i] >> 16;
+        output[4 * i + 2] = sha_text[i] >> 8;
+        output[4 * i + 3] = sha_text[i];
+    }
+}
+
+/* The loop esp_secure_boot_verify_signature() had, 64 bits per call */
+static void rom_digest(const uint8_t *data, uint32_t length, uint8_t *digest)
+{
+    uint32_t digest_len = length * 8;
+
+    ets_sha_enable();
+    rom_sha_init();
+    while (digest_len > 0) {
+        uint32_t chunk_len = (digest_len > 64) ? 64 : digest_len;
+        rom_sha_update(data, chunk_len);
+        digest_len -= chunk_len;
+        data += chunk_len / 8;
+    }
+    rom_sha_finish(digest);
+    ets_sha_disable();
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void bench(void)
+{
+    static uint8_t image[IMAGE_LEN];
+    uint8_t digest[BOOTLOADER_SHA256_DIGEST_LEN], expect[BOOTLOADER_SHA256_DIGEST_LEN];
+    double t0, rom, blocks;
+    int i, n = 20;
+
+    for (i = 0; i < IMAGE_LEN; i++) {
+        image[i] = rand();
+    }
+    mbedtls_sha256(image, IMAGE_LEN, expect, 0);
+
+    memset(&sha_emu_stats, 0, sizeof(sha_emu_stats));
+    rom_digest(image, IMAGE_LEN, digest);
+    CHECK(memcmp(digest, expect, sizeof(digest)) == 0);
+    printf("1 MB image, 8 byte calls: %u blocks, %u busy register reads\n",
+           sha_emu_stats.starts + sha_emu_stats.continues, sha_emu_stats.polls);
+    memset(&sha_emu_stats, 0, sizeof(sha_emu_stats));
+    digest_of(image, IMAGE_LEN, digest);
+    CHECK(memcmp(digest, expect, sizeof(digest)) == 0);
+    printf("1 MB image, bootloader_sha256: %u blocks, %u busy register reads\n",
+           sha_emu_stats.starts + sha_emu_stats.continues, sha_emu_stats.polls);
+
+    sha_emu_compute = false;
+    t0 = now_sec();
+    for (i = 0; i < n; i++) {
+        rom_digest(image, IMAGE_LEN, digest);
+    }
+    rom = (now_sec() - t0) / n;
+    t0 = now_sec();
+    for (i = 0; i < n; i++) {
+        digest_of(image, IMAGE_LEN, digest);
+    }
+    blocks = (now_sec() - t0) / n;
+    sha_emu_compute = true;
+    printf("1 MB image, driver time on the host without SHA: 8 byte calls %.3f ms, "
+           "bootloader_sha256 %.3f ms\n", rom * 1e3, blocks * 1e3);
+}
+
+int main(int argc, char **argv)
+{
+    test_vectors();
+    test_lengths();
+    test_busy();
+    if (failures == 0 && !(argc > 1 && strcmp(argv[1], "-q") == 0)) {
+        bench();
+    }
+    if (failures != 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
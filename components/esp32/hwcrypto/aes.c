@@ -29,6 +29,7 @@
 #include "hwcrypto/aes.h"
 #include "rom/aes.h"
 #include "soc/dport_reg.h"
+#include "soc/hwcrypto_reg.h"
 #include <sys/lock.h>
 
 static _lock_t aes_lock;
@@ -129,7 +130,7 @@ int esp_aes_setkey_dec( esp_aes_context *ctx, const unsigned char *key,
  *
  * Only call when protected by esp_aes_acquire_hardware().
  */
-static inline int esp_aes_setkey_hardware( esp_aes_context *ctx, int mode)
+int esp_aes_setkey_hardware( esp_aes_context *ctx, int mode)
 {
     if ( mode == ESP_AES_ENCRYPT ) {
         ets_aes_setkey_enc(ctx->enc.key, ctx->enc.aesbits);
@@ -139,6 +140,38 @@ static inline int esp_aes_setkey_hardware( esp_aes_context *ctx, int mode)
     return 0;
 }
 
+/*
+ * Run one block through the unit in two halves, like ets_aes_crypt() does
+ * in one go, so that callers can overlap the CPU work on the previous block
+ * with the unit working on the next one.
+ *
+ * Only call when protected by esp_aes_acquire_hardware().
+ */
+void esp_aes_block_start( const unsigned char input[16] )
+{
+    uint32_t word;
+    int i;
+
+    for ( i = 0; i < 4; i++ ) {
+        memcpy(&word, input + 4 * i, 4);
+        REG_WRITE(AES_TEXT_BASE + 4 * i, word);
+    }
+    REG_WRITE(AES_START_REG, 1);
+}
+
+void esp_aes_block_finish( unsigned char output[16] )
+{
+    uint32_t word;
+    int i;
+
+    while (REG_READ(AES_IDLE_REG) != 1) {
+    }
+    for ( i = 0; i < 4; i++ ) {
+        word = REG_READ(AES_TEXT_BASE + 4 * i);
+        memcpy(output + 4 * i, &word, 4);
+    }
+}
+
 /*
  * AES-ECB block encryption
  */
@@ -204,9 +237,17 @@ int esp_aes_crypt_cbc( esp_aes_context *ctx,
     esp_aes_setkey_hardware(ctx, mode);
 
     if ( mode == ESP_AES_DECRYPT ) {
+        /* blocks decrypt independently: start the next one before
+           chaining the current one */
+        if ( length > 0 ) {
+            esp_aes_block_start(input);
+        }
         while ( length > 0 ) {
             memcpy( temp, input, 16 );
-            ets_aes_crypt(input, output);
+            esp_aes_block_finish(output);
+            if ( length > 16 ) {
+                esp_aes_block_start(input + 16);
+            }
 
             for ( i = 0; i < 16; i++ ) {
                 output[i] = (unsigned char)( output[i] ^ iv[i] );
@@ -341,6 +382,38 @@ int esp_aes_crypt_ctr( esp_aes_context *ctx,
     esp_aes_acquire_hardware();
     esp_aes_setkey_hardware(ctx, ESP_AES_ENCRYPT);
 
+    /* finish a partly used stream block */
+    while ( n != 0 && length > 0 ) {
+        c = *input++;
+        *output++ = (unsigned char)( c ^ stream_block[n] );
+        n = ( n + 1 ) & 0x0F;
+        length--;
+    }
+
+    /* whole blocks: the unit encrypts the next counter block while the
+       current one is applied */
+    if ( length >= 16 ) {
+        esp_aes_block_start(nonce_counter);
+        while ( length >= 16 ) {
+            esp_aes_block_finish(stream_block);
+            for ( i = 16; i > 0; i-- )
+                if ( ++nonce_counter[i - 1] != 0 ) {
+                    break;
+                }
+            if ( length >= 32 ) {
+                esp_aes_block_start(nonce_counter);
+            }
+
+            for ( i = 0; i < 16; i++ ) {
+                output[i] = (unsigned char)( input[i] ^ stream_block[i] );
+            }
+
+            input  += 16;
+            output += 16;
+            length -= 16;
+        }
+    }
+
     while ( length-- ) {
         if ( n == 0 ) {
             ets_aes_crypt(nonce_counter, stream_block);
@@ -59,6 +59,13 @@ static _lock_t memory_block_lock;
 typedef struct {
     _lock_t lock;
     bool in_use;
+    /* digest running in the engine between blocks (see esp_sha_digest_block()),
+       identified by the state buffer its interim state is saved to */
+    void *owner;
+    esp_sha_type owner_type;
+    /* owner ran a block since another digest was last turned away */
+    bool owner_ran;
+    esp_sha_stats_t stats;
 } sha_engine_state;
 
 /* Pointer to state of each concurrent SHA engine.
@@ -134,6 +141,21 @@ inline static bool sha_engines_all_idle() {
 }
 
 static void esp_sha_lock_engine_inner(sha_engine_state *engine);
+static void esp_sha_unlock_engine_inner(sha_engine_state *engine);
+
+/* Save the interim state of the digest running in the engine to its
+   state buffer, so that it carries on in software. Call with the engine
+   lock held; the engine stays in use, for the caller.
+*/
+static void sha_engine_preempt(sha_engine_state *engine)
+{
+    /* the interim state of SHA-384 is a SHA-512 one */
+    esp_sha_type type = (engine->owner_type == SHA2_384) ? SHA2_512 : engine->owner_type;
+
+    esp_sha_read_digest_state(type, engine->owner);
+    engine->owner = NULL;
+    engine->stats.preemptions++;
+}
 
 bool esp_sha_try_lock_engine(esp_sha_type sha_type)
 {
@@ -141,6 +163,10 @@ bool esp_sha_try_lock_engine(esp_sha_type sha_type)
     if(_lock_try_acquire(&engine->lock) != 0) {
         /* This SHA engine is already in use */
         return false;
+    } else if (engine->owner != NULL) {
+        /* A digest is running in this SHA engine */
+        _lock_release(&engine->lock);
+        return false;
     } else {
         esp_sha_lock_engine_inner(engine);
         return true;
@@ -151,7 +177,11 @@ void esp_sha_lock_engine(esp_sha_type sha_type)
 {
     sha_engine_state *engine = &engine_states[sha_engine_index(sha_type)];
     _lock_acquire(&engine->lock);
-    esp_sha_lock_engine_inner(engine);
+    if (engine->owner != NULL) {
+        sha_engine_preempt(engine);
+    } else {
+        esp_sha_lock_engine_inner(engine);
+    }
 }
 
 static void esp_sha_lock_engine_inner(sha_engine_state *engine)
@@ -179,6 +209,12 @@ void esp_sha_unlock_engine(esp_sha_type sha_type)
 {
     sha_engine_state *engine = &engine_states[sha_engine_index(sha_type)];
 
+    esp_sha_unlock_engine_inner(engine);
+    _lock_release(&engine->lock);
+}
+
+static void esp_sha_unlock_engine_inner(sha_engine_state *engine)
+{
     _lock_acquire(&state_change_lock);
 
     assert( engine->in_use && "in_use flag should be set" );
@@ -192,8 +228,6 @@ void esp_sha_unlock_engine(esp_sha_type sha_type)
     }
 
     _lock_release(&state_change_lock);
-
-    _lock_release(&engine->lock);
 }
 
 void esp_sha_wait_idle(void)
@@ -263,6 +297,84 @@ void esp_sha_block(esp_sha_type sha_type, const void *data_block, bool is_first_
     */
 }
 
+bool esp_sha_digest_block(esp_sha_type sha_type, void *state, const void *data_block, bool is_first_block)
+{
+    sha_engine_state *engine = &engine_states[sha_engine_index(sha_type)];
+
+    if (is_first_block) {
+        if (_lock_try_acquire(&engine->lock) != 0) {
+            return false;
+        }
+        if (engine->owner == NULL) {
+            esp_sha_lock_engine_inner(engine);
+        } else if (!engine->owner_ran) {
+            /* the digest in the engine sat idle while another one was
+               turned away already: hand the engine over */
+            sha_engine_preempt(engine);
+        } else {
+            engine->owner_ran = false;
+            _lock_release(&engine->lock);
+            return false;
+        }
+        engine->owner = state;
+        engine->owner_type = sha_type;
+    } else {
+        _lock_acquire(&engine->lock);
+        if (engine->owner != state) {
+            /* preempted, the interim state is in the state buffer */
+            _lock_release(&engine->lock);
+            return false;
+        }
+    }
+
+    esp_sha_block(sha_type, data_block, is_first_block);
+    engine->owner_ran = true;
+    engine->stats.hardware_blocks++;
+
+    _lock_release(&engine->lock);
+    return true;
+}
+
+void esp_sha_digest_read_state(esp_sha_type sha_type, const void *state, void *digest_state)
+{
+    sha_engine_state *engine = &engine_states[sha_engine_index(sha_type)];
+
+    _lock_acquire(&engine->lock);
+    if (engine->owner == state) {
+        esp_sha_read_digest_state(sha_type, digest_state);
+    } else if (digest_state != state) {
+        memcpy(digest_state, state, sha_length(sha_type));
+    }
+    _lock_release(&engine->lock);
+}
+
+void esp_sha_release_digest(esp_sha_type sha_type, const void *state)
+{
+    sha_engine_state *engine = &engine_states[sha_engine_index(sha_type)];
+
+    _lock_acquire(&engine->lock);
+    if (engine->owner == state) {
+        engine->owner = NULL;
+        esp_sha_unlock_engine_inner(engine);
+    }
+    _lock_release(&engine->lock);
+}
+
+void esp_sha_count_software_block(esp_sha_type sha_type)
+{
+    engine_states[sha_engine_index(sha_type)].stats.software_blocks++;
+}
+
+void esp_sha_get_stats(esp_sha_type sha_type, esp_sha_stats_t *stats)
+{
+    *stats = engine_states[sha_engine_index(sha_type)].stats;
+}
+
+void esp_sha_reset_stats(esp_sha_type sha_type)
+{
+    memset(&engine_states[sha_engine_index(sha_type)].stats, 0, sizeof(esp_sha_stats_t));
+}
+
 void esp_sha(esp_sha_type sha_type, const unsigned char *input, size_t ilen, unsigned char *output)
 {
     size_t block_len = block_length(sha_type);
@@ -79,6 +79,38 @@ void esp_aes_acquire_hardware( void );
  */
 void esp_aes_release_hardware( void );
 
+/**
+ * \brief Load the key of an AES context into the hardware unit
+ *
+ * Call with the hardware acquired (esp_aes_acquire_hardware()), before
+ * running blocks with esp_aes_block_start()/esp_aes_block_finish().
+ *
+ * \param ctx     AES context
+ * \param mode    ESP_AES_ENCRYPT or ESP_AES_DECRYPT
+ *
+ * \return        0 if successful
+ */
+int esp_aes_setkey_hardware( esp_aes_context *ctx, int mode );
+
+/**
+ * \brief Start encrypting or decrypting one block in the hardware unit
+ *
+ * Returns as soon as the unit is running, so that the caller can work on
+ * the previous block meanwhile. Call with the hardware acquired and a key
+ * loaded by esp_aes_setkey_hardware(), and collect the result with
+ * esp_aes_block_finish() before starting the next block.
+ *
+ * \param input   Input block
+ */
+void esp_aes_block_start( const unsigned char input[16] );
+
+/**
+ * \brief Wait for the block started by esp_aes_block_start() and read it out
+ *
+ * \param output  Output block
+ */
+void esp_aes_block_finish( unsigned char output[16] );
+
 /**
  * \brief          Initialize AES context
  *
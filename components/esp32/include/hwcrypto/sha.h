@@ -37,6 +37,16 @@
  *   engines, so all engines must be idle before this memory block is
  *   modified.
  *
+ * - SHA-384 and SHA-512 share one engine.
+ *
+ * Digests fed a block at a time with esp_sha_digest_block() share an
+ * engine: a digest keeps the engine while it keeps feeding it, and
+ * gives it up to the next digest which needs it once it has been idle for
+ * a while (or at once to esp_sha_lock_engine()). The interim state of a
+ * digest which gives up the engine is saved to its state buffer, and as
+ * it cannot be loaded back into the engine the digest carries on in
+ * software from there.
+ *
  */
 
 #ifdef __cplusplus
@@ -56,9 +66,8 @@ typedef enum SHA_TYPE esp_sha_type;
  * @note It is not necessary to lock any SHA hardware before calling
  * this function, thread safety is managed internally.
  *
- * @note If a TLS connection is open then this function may block
- * indefinitely waiting for a SHA engine to become available. Use the
- * mbedTLS SHA API to avoid this problem.
+ * @note A digest running in the engine through esp_sha_digest_block()
+ * is moved to software to make room for this function.
  *
  * @param sha_type SHA algorithm to use.
  *
@@ -130,9 +139,8 @@ void esp_sha_read_digest_state(esp_sha_type sha_type, void *digest_state);
  *
  * @param sha_type Type of SHA engine to use.
  *
- * Blocks until engine is available. Note: Can block indefinitely
- * while a TLS connection is open, suggest using
- * esp_sha_try_lock_engine() and failing over to software SHA.
+ * Blocks until engine is available. A digest running in the engine
+ * through esp_sha_digest_block() is moved to software to make room.
  */
 void esp_sha_lock_engine(esp_sha_type sha_type);
 
@@ -143,8 +151,9 @@ void esp_sha_lock_engine(esp_sha_type sha_type);
  *
  * @return Returns true if the SHA engine is locked for exclusive
  * use. Call esp_sha_unlock_sha_engine() when done.  Returns false if
- * the SHA engine is already in use, caller should use software SHA
- * algorithm for this digest.
+ * the SHA engine is already in use (locked, or running a digest for
+ * esp_sha_digest_block()), caller should use software SHA algorithm for
+ * this digest.
  */
 bool esp_sha_try_lock_engine(esp_sha_type sha_type);
 
@@ -199,6 +208,75 @@ void esp_sha_unlock_memory_block(void);
  */
 void esp_sha_wait_idle(void);
 
+/** @brief Run one block of a digest in the SHA engine, if it can have it
+ *
+ * Digests using this function share the engine without locking it: the
+ * engine is claimed by the first block of a digest and released by
+ * esp_sha_release_digest(). A digest is identified by its state buffer,
+ * which holds its interim state in the layout esp_sha_read_digest_state()
+ * reads out (SHA2_512 layout for SHA2_384).
+ *
+ * When the function returns false the block has not been run. Either
+ * the engine is busy with another digest (for the first block), or the
+ * digest has been moved out of the engine to make room for another one
+ * and its interim state saved to the state buffer. The caller runs this
+ * block and the rest of the digest in software, using the state buffer.
+ *
+ * @param sha_type SHA algorithm to use.
+ *
+ * @param state State buffer of the digest.
+ *
+ * @param data_block Pointer to block of data, as for esp_sha_block().
+ *
+ * @param is_first_block True for the first block of the digest.
+ *
+ * @return true if the block has been run in the engine.
+ */
+bool esp_sha_digest_block(esp_sha_type sha_type, void *state, const void *data_block, bool is_first_block);
+
+/** @brief Read out the interim state of a digest run with esp_sha_digest_block()
+ *
+ * Reads it from the engine, or from the state buffer if the digest has
+ * been moved out of the engine.
+ *
+ * @param sha_type SHA algorithm in use, as for esp_sha_read_digest_state().
+ *
+ * @param state State buffer of the digest.
+ *
+ * @param digest_state Buffer for the state, may be the state buffer itself.
+ */
+void esp_sha_digest_read_state(esp_sha_type sha_type, const void *state, void *digest_state);
+
+/** @brief Release the engine from a digest run with esp_sha_digest_block()
+ *
+ * Does nothing if the digest is not in the engine (any more).
+ *
+ * @param sha_type SHA algorithm in use.
+ *
+ * @param state State buffer of the digest.
+ */
+void esp_sha_release_digest(esp_sha_type sha_type, const void *state);
+
+/** @brief Block counters of a SHA engine
+ *
+ * Counted since boot or esp_sha_reset_stats(), for SHA-384 and SHA-512
+ * together.
+ */
+typedef struct {
+    uint32_t hardware_blocks;   /*!< blocks run in the engine by esp_sha_digest_block() */
+    uint32_t software_blocks;   /*!< blocks run in software, see esp_sha_count_software_block() */
+    uint32_t preemptions;       /*!< digests moved out of the engine to make room for another one */
+} esp_sha_stats_t;
+
+/** @brief Count a block of a digest run in software instead of in the engine */
+void esp_sha_count_software_block(esp_sha_type sha_type);
+
+/** @brief Get the block counters of the engine for a SHA algorithm */
+void esp_sha_get_stats(esp_sha_type sha_type, esp_sha_stats_t *stats);
+
+/** @brief Reset the block counters of the engine for a SHA algorithm */
+void esp_sha_reset_stats(esp_sha_type sha_type);
+
 #ifdef __cplusplus
 }
 #endif
@@ -16,6 +16,14 @@
 
 #include "soc.h"
 
+/* registers for AES block encryption/decryption */
+#define AES_START_REG           ((DR_REG_AES_BASE) + 0x000)
+#define AES_IDLE_REG            ((DR_REG_AES_BASE) + 0x004)
+#define AES_MODE_REG            ((DR_REG_AES_BASE) + 0x008)
+#define AES_KEY_BASE            ((DR_REG_AES_BASE) + 0x010)
+#define AES_TEXT_BASE           ((DR_REG_AES_BASE) + 0x030)
+#define AES_ENDIAN              ((DR_REG_AES_BASE) + 0x040)
+
 /* registers for RSA acceleration via Multiple Precision Integer ops */
 #define RSA_MEM_M_BLOCK_BASE          ((DR_REG_RSA_BASE)+0x000)
 /* RB & Z use the same memory block, depending on phase of operation */
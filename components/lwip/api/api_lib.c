@@ -677,6 +677,42 @@ netconn_send(struct netconn *conn, struct netbuf *buf)
   return err;
 }
 
+/**
+ * Send several netbufs over a UDP or RAW netconn with a single call into
+ * the tcpip_thread. Each netbuf is sent like with netconn_send (to its own
+ * address, or to the connected remote if that is 'any').
+ * Sending stops at the first netbuf that fails.
+ *
+ * @param conn the UDP or RAW netconn over which to send data
+ * @param bufs array of netbufs to send
+ * @param count number of netbufs in 'bufs'
+ * @param sent receives the number of netbufs that were sent
+ * @return ERR_OK if all netbufs were sent, else the error of the first
+ *         netbuf that failed
+ */
+err_t
+netconn_send_multi(struct netconn *conn, struct netbuf *bufs, u16_t count, u16_t *sent)
+{
+  API_MSG_VAR_DECLARE(msg);
+  err_t err;
+
+  LWIP_ERROR("netconn_send_multi: invalid conn", (conn != NULL), return ERR_ARG;);
+  LWIP_ERROR("netconn_send_multi: invalid sent", (sent != NULL), return ERR_ARG;);
+  *sent = 0;
+
+  LWIP_DEBUGF(API_LIB_DEBUG, ("netconn_send_multi: sending %"U16_F" netbufs\n", count));
+  API_MSG_VAR_ALLOC(msg);
+  API_MSG_VAR_REF(msg).msg.conn = conn;
+  API_MSG_VAR_REF(msg).msg.msg.bm.bufs = bufs;
+  API_MSG_VAR_REF(msg).msg.msg.bm.count = count;
+  API_MSG_VAR_REF(msg).msg.msg.bm.sent = 0;
+  TCPIP_APIMSG(&API_MSG_VAR_REF(msg), lwip_netconn_do_send_multi, err);
+  *sent = API_MSG_VAR_REF(msg).msg.msg.bm.sent;
+  API_MSG_VAR_FREE(msg);
+
+  return err;
+}
+
 /**
  * Send data over a TCP netconn.
  *
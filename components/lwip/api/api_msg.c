@@ -1366,6 +1366,56 @@ lwip_netconn_do_listen(void *m)
 }
 #endif /* LWIP_TCP */
 
+/**
+ * Send one netbuf on the RAW or UDP pcb of a netconn.
+ *
+ * @param conn the RAW or UDP netconn
+ * @param b the netbuf to send
+ * @return the result of raw_send(to)/udp_send(to), ERR_CONN if there is no pcb
+ */
+static err_t
+lwip_netconn_send_netbuf(struct netconn *conn, struct netbuf *b)
+{
+  err_t err = ERR_CONN;
+
+  if (conn->pcb.tcp != NULL) {
+    switch (NETCONNTYPE_GROUP(conn->type)) {
+#if LWIP_RAW
+    case NETCONN_RAW:
+      if (ip_addr_isany(&b->addr)) {
+        err = raw_send(conn->pcb.raw, b->p);
+      } else {
+        err = raw_sendto(conn->pcb.raw, b->p, &b->addr);
+      }
+      break;
+#endif
+#if LWIP_UDP
+    case NETCONN_UDP:
+#if LWIP_CHECKSUM_ON_COPY
+      if (ip_addr_isany(&b->addr) || IP_IS_ANY_TYPE_VAL(b->addr)) {
+        err = udp_send_chksum(conn->pcb.udp, b->p,
+          b->flags & NETBUF_FLAG_CHKSUM, b->toport_chksum);
+      } else {
+        err = udp_sendto_chksum(conn->pcb.udp, b->p,
+          &b->addr, b->port,
+          b->flags & NETBUF_FLAG_CHKSUM, b->toport_chksum);
+      }
+#else /* LWIP_CHECKSUM_ON_COPY */
+      if (ip_addr_isany_val(b->addr) || IP_IS_ANY_TYPE_VAL(b->addr)) {
+        err = udp_send(conn->pcb.udp, b->p);
+      } else {
+        err = udp_sendto(conn->pcb.udp, b->p, &b->addr, b->port);
+      }
+#endif /* LWIP_CHECKSUM_ON_COPY */
+      break;
+#endif /* LWIP_UDP */
+    default:
+      break;
+    }
+  }
+  return err;
+}
+
 /**
  * Send some data on a RAW or UDP pcb contained in a netconn
  * Called from netconn_send
@@ -1380,41 +1430,34 @@ lwip_netconn_do_send(void *m)
   if (ERR_IS_FATAL(msg->conn->last_err)) {
     msg->err = msg->conn->last_err;
   } else {
-    msg->err = ERR_CONN;
-    if (msg->conn->pcb.tcp != NULL) {
-      switch (NETCONNTYPE_GROUP(msg->conn->type)) {
-#if LWIP_RAW
-      case NETCONN_RAW:
-        if (ip_addr_isany(&msg->msg.b->addr)) {
-          msg->err = raw_send(msg->conn->pcb.raw, msg->msg.b->p);
-        } else {
-          msg->err = raw_sendto(msg->conn->pcb.raw, msg->msg.b->p, &msg->msg.b->addr);
-        }
-        break;
-#endif
-#if LWIP_UDP
-      case NETCONN_UDP:
-#if LWIP_CHECKSUM_ON_COPY
-        if (ip_addr_isany(&msg->msg.b->addr) || IP_IS_ANY_TYPE_VAL(msg->msg.b->addr)) {
-          msg->err = udp_send_chksum(msg->conn->pcb.udp, msg->msg.b->p,
-            msg->msg.b->flags & NETBUF_FLAG_CHKSUM, msg->msg.b->toport_chksum);
-        } else {
-          msg->err = udp_sendto_chksum(msg->conn->pcb.udp, msg->msg.b->p,
-            &msg->msg.b->addr, msg->msg.b->port,
-            msg->msg.b->flags & NETBUF_FLAG_CHKSUM, msg->msg.b->toport_chksum);
-        }
-#else /* LWIP_CHECKSUM_ON_COPY */
-        if (ip_addr_isany_val(msg->msg.b->addr) || IP_IS_ANY_TYPE_VAL(msg->msg.b->addr)) {
-          msg->err = udp_send(msg->conn->pcb.udp, msg->msg.b->p);
-        } else {
-          msg->err = udp_sendto(msg->conn->pcb.udp, msg->msg.b->p, &msg->msg.b->addr, msg->msg.b->port);
-        }
-#endif /* LWIP_CHECKSUM_ON_COPY */
-        break;
-#endif /* LWIP_UDP */
-      default:
+    msg->err = lwip_netconn_send_netbuf(msg->conn, msg->msg.b);
+  }
+  TCPIP_APIMSG_ACK(msg);
+}
+
+/**
+ * Send several netbufs on a RAW or UDP pcb contained in a netconn,
+ * stopping at the first one that fails.
+ * Called from netconn_send_multi
+ *
+ * @param msg the api_msg_msg pointing to the connection
+ */
+void
+lwip_netconn_do_send_multi(void *m)
+{
+  struct api_msg_msg *msg = (struct api_msg_msg*)m;
+  u16_t i;
+
+  msg->err = ERR_OK;
+  if (ERR_IS_FATAL(msg->conn->last_err)) {
+    msg->err = msg->conn->last_err;
+  } else {
+    for (i = 0; i < msg->msg.bm.count; i++) {
+      msg->err = lwip_netconn_send_netbuf(msg->conn, &msg->msg.bm.bufs[i]);
+      if (msg->err != ERR_OK) {
         break;
       }
+      msg->msg.bm.sent++;
     }
   }
   TCPIP_APIMSG_ACK(msg);
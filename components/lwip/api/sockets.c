@@ -232,6 +232,18 @@ struct lwip_sock {
  
   /** counter of how many threads are waiting for this socket using select */
   SELWAIT_T select_waiting;
+#if LWIP_SOCKET_EPOLL
+  /** epoll instance this socket is registered with (NULL if none) */
+  struct lwip_epoll *epoll;
+  /** next socket on the ready list of that epoll instance */
+  struct lwip_sock *epoll_next;
+  /** events requested with lwip_epoll_ctl (0 while a oneshot is disarmed) */
+  u32_t epoll_events;
+  /** user data returned with each event */
+  epoll_data_t epoll_data;
+  /** 1 while this socket is on the ready list */
+  u8_t epoll_queued;
+#endif /* LWIP_SOCKET_EPOLL */
 };
 
 #if ESP_THREAD_SAFE
@@ -345,6 +357,31 @@ struct lwip_select_cb {
   SELECT_SEM_T sem;
 };
 
+#if LWIP_SOCKET_EPOLL
+/** An epoll instance: a FIFO of registered sockets that may be ready.
+ * event_callback() appends a socket when it becomes ready, lwip_epoll_wait()
+ * pops sockets and re-checks them, so no descriptor set is ever scanned.
+ * Protected by SYS_ARCH_PROTECT like the select_cb_list. */
+struct lwip_epoll {
+  /** 1 while this instance is open */
+  u8_t used;
+  /** don't signal the semaphore twice before a waiter has woken up */
+  u8_t sem_signalled;
+  /** number of tasks blocked in lwip_epoll_wait on this instance */
+  SELWAIT_T waiting;
+  /** ready list, linked through lwip_sock.epoll_next */
+  struct lwip_sock *ready_head;
+  struct lwip_sock *ready_tail;
+  /** semaphore to wake up a task waiting in lwip_epoll_wait */
+  sys_sem_t sem;
+};
+
+/** epoll descriptors follow the socket descriptors */
+#define LWIP_EPOLL_FD_BASE       (LWIP_SOCKET_OFFSET + NUM_SOCKETS)
+#define LWIP_IS_EPOLL_FD(fd)     (((fd) >= LWIP_EPOLL_FD_BASE) && \
+                                  ((fd) < LWIP_EPOLL_FD_BASE + LWIP_SOCKET_EPOLL_MAX))
+#endif /* LWIP_SOCKET_EPOLL */
+
 /** A struct sockaddr replacement that has the same alignment as sockaddr_in/
  *  sockaddr_in6 if instantiated.
  */
@@ -392,6 +429,10 @@ static struct lwip_select_cb *select_cb_list;
 /** This counter is increased from lwip_select when the list is changed
     and checked in event_callback to see if it has changed. */
 static volatile int select_cb_ctr;
+#if LWIP_SOCKET_EPOLL
+/** The global array of epoll instances */
+static struct lwip_epoll epolls[LWIP_SOCKET_EPOLL_MAX];
+#endif /* LWIP_SOCKET_EPOLL */
 
 /** Table to quickly map an lwIP error (err_t) to a socket error
   * by using -err as an index */
@@ -455,6 +496,10 @@ static void lwip_setsockopt_callback(void *arg);
 #endif
 static u8_t lwip_getsockopt_impl(int s, int level, int optname, void *optval, socklen_t *optlen);
 static u8_t lwip_setsockopt_impl(int s, int level, int optname, const void *optval, socklen_t optlen);
+#if LWIP_SOCKET_EPOLL
+static void lwip_epoll_sock_detach(struct lwip_sock *sock);
+static int lwip_epoll_close(int epfd);
+#endif /* LWIP_SOCKET_EPOLL */
 
 #if LWIP_IPV4 && LWIP_IPV6
 static void
@@ -596,6 +641,11 @@ alloc_socket(struct netconn *newconn, int accepted)
     sockets[oldest].errevent   = 0;
     sockets[oldest].err        = 0;
     sockets[oldest].select_waiting = 0;
+#if LWIP_SOCKET_EPOLL
+    sockets[oldest].epoll      = NULL;
+    sockets[oldest].epoll_next = NULL;
+    sockets[oldest].epoll_queued = 0;
+#endif /* LWIP_SOCKET_EPOLL */
 
     sockets[oldest].state      = LWIP_SOCK_OPEN;
     sockets[oldest].age        = 0;
@@ -634,6 +684,11 @@ alloc_socket(struct netconn *newconn, int accepted)
       sockets[i].errevent   = 0;
       sockets[i].err        = 0;
       sockets[i].select_waiting = 0;
+#if LWIP_SOCKET_EPOLL
+      sockets[i].epoll      = NULL;
+      sockets[i].epoll_next = NULL;
+      sockets[i].epoll_queued = 0;
+#endif /* LWIP_SOCKET_EPOLL */
 
       return i + LWIP_SOCKET_OFFSET;
     }
@@ -658,6 +713,9 @@ free_socket(struct lwip_sock *sock, int is_tcp)
   SYS_ARCH_DECL_PROTECT(lev);
 
   LWIP_DEBUGF(ESP_THREAD_SAFE_DEBUG, ("free_sockset:free socket s=%p is_tcp=%d\n", sock, is_tcp));
+#if LWIP_SOCKET_EPOLL
+  lwip_epoll_sock_detach(sock);
+#endif /* LWIP_SOCKET_EPOLL */
   lastdata         = sock->lastdata;
   sock->lastdata   = NULL;
   sock->lastoffset = 0;
@@ -838,6 +896,12 @@ lwip_close(int s)
 
   LWIP_DEBUGF(SOCKETS_DEBUG|ESP_THREAD_SAFE_DEBUG, ("lwip_close: (%d)\n", s));
 
+#if LWIP_SOCKET_EPOLL
+  if (LWIP_IS_EPOLL_FD(s)) {
+    return lwip_epoll_close(s);
+  }
+#endif /* LWIP_SOCKET_EPOLL */
+
   sock = get_socket(s);
   if (!sock) {
     LWIP_DEBUGF(SOCKETS_DEBUG|ESP_THREAD_SAFE_DEBUG, ("lwip_close: sock is null, return -1\n"));
@@ -857,6 +921,11 @@ lwip_close(int s)
   lwip_socket_drop_registered_memberships(s);
 #endif /* LWIP_IGMP */
 
+#if LWIP_SOCKET_EPOLL
+  /* the descriptor is gone for the application: stop reporting it */
+  lwip_epoll_sock_detach(sock);
+#endif /* LWIP_SOCKET_EPOLL */
+
   err = netconn_delete(sock->conn);
   if (err != ERR_OK) {
     LWIP_DEBUGF(SOCKETS_DEBUG|ESP_THREAD_SAFE_DEBUG, ("netconn_delete fail, ret=%d\n", err));
@@ -1195,14 +1264,116 @@ lwip_send(int s, const void *data, size_t size, int flags)
   return (err == ERR_OK ? (int)written : -1);
 }
 
+#if LWIP_UDP || LWIP_RAW
+/**
+ * Initialize a netbuf with the destination and data of one message, for
+ * UDP and RAW sockets. The netbuf is owned by the caller (it may live on the
+ * stack); release its data with netbuf_free() after sending. On error,
+ * nothing is left to free.
+ *
+ * @param sock the socket the message is sent on
+ * @param msg the message (destination in msg_name or NULL, data in msg_iov)
+ * @param buf the netbuf to fill
+ * @return ERR_OK, ERR_ARG for an invalid message or ERR_MEM
+ */
+static err_t
+lwip_msghdr_to_netbuf(struct lwip_sock *sock, const struct msghdr *msg, struct netbuf *buf)
+{
+  u16_t remote_port = 0;
+  size_t size = 0;
+  int i;
+
+  LWIP_ERROR("lwip_msghdr_to_netbuf: invalid msghdr iov", (msg->msg_iov != NULL && msg->msg_iovlen != 0),
+             return ERR_ARG;);
+  LWIP_ERROR("lwip_msghdr_to_netbuf: invalid msghdr name", (((msg->msg_name == NULL) && (msg->msg_namelen == 0)) ||
+             IS_SOCK_ADDR_LEN_VALID(msg->msg_namelen)),
+             return ERR_ARG;);
+
+  buf->p = buf->ptr = NULL;
+#if LWIP_CHECKSUM_ON_COPY
+  buf->flags = 0;
+#endif /* LWIP_CHECKSUM_ON_COPY */
+  if (msg->msg_name != NULL) {
+    SOCKADDR_TO_IPADDR_PORT((const struct sockaddr *)msg->msg_name, &buf->addr, remote_port);
+  } else {
+    /* 'any' sends to the connected remote */
+    ip_addr_set_any(NETCONNTYPE_ISIPV6(netconn_type(sock->conn)), &buf->addr);
+  }
+  netbuf_fromport(buf) = remote_port;
+
+  for (i = 0; i < msg->msg_iovlen; i++) {
+    size += msg->msg_iov[i].iov_len;
+  }
+  LWIP_ERROR("lwip_msghdr_to_netbuf: message too long", size <= 0xffff, return ERR_ARG;);
+
+#if LWIP_NETIF_TX_SINGLE_PBUF
+  /* Allocate a new netbuf and copy the data into it. */
+  if (netbuf_alloc(buf, (u16_t)size) == NULL) {
+    return ERR_MEM;
+  }
+#if LWIP_CHECKSUM_ON_COPY
+  if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) != NETCONN_RAW) {
+    /* flatten the IO vectors, summing each one while copying it */
+    u32_t acc = 0;
+    u8_t swapped = 0;
+    size_t offset = 0;
+    for (i = 0; i < msg->msg_iovlen; i++) {
+      u16_t len = (u16_t)msg->msg_iov[i].iov_len;
+      acc += LWIP_CHKSUM_COPY(&((u8_t*)buf->p->payload)[offset], msg->msg_iov[i].iov_base, len);
+      acc = FOLD_U32T(acc);
+      if ((len & 1) != 0) {
+        swapped = 1 - swapped;
+        acc = SWAP_BYTES_IN_WORD(acc);
+      }
+      offset += len;
+    }
+    if (swapped) {
+      acc = SWAP_BYTES_IN_WORD(acc);
+    }
+    netbuf_set_chksum(buf, (u16_t)acc);
+  } else
+#endif /* LWIP_CHECKSUM_ON_COPY */
+  {
+    /* flatten the IO vectors */
+    size_t offset = 0;
+    for (i = 0; i < msg->msg_iovlen; i++) {
+      MEMCPY(&((u8_t*)buf->p->payload)[offset], msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_len);
+      offset += msg->msg_iov[i].iov_len;
+    }
+  }
+#else /* LWIP_NETIF_TX_SINGLE_PBUF */
+  /* create a chained netbuf from the IO vectors. NOTE: we assemble a pbuf chain
+     manually to avoid having to allocate, chain, and delete a netbuf for each iov */
+  for (i = 0; i < msg->msg_iovlen; i++) {
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, 0, PBUF_REF);
+    if (p == NULL) {
+      netbuf_free(buf);
+      return ERR_MEM;
+    }
+    p->payload = msg->msg_iov[i].iov_base;
+    p->len = p->tot_len = (u16_t)msg->msg_iov[i].iov_len;
+    /* netbuf empty, add new pbuf */
+    if (buf->p == NULL) {
+      buf->p = buf->ptr = p;
+    /* add pbuf to existing pbuf chain */
+    } else {
+      pbuf_cat(buf->p, p);
+    }
+  }
+#endif /* LWIP_NETIF_TX_SINGLE_PBUF */
+  return ERR_OK;
+}
+#endif /* LWIP_UDP || LWIP_RAW */
+
 int
 lwip_sendmsg(int s, const struct msghdr *msg, int flags)
 {
   struct lwip_sock *sock;
-  struct netbuf *chain_buf;
-  u16_t remote_port;
-  int i;
+#if LWIP_UDP || LWIP_RAW
+  struct netbuf chain_buf;
+#endif
 #if LWIP_TCP
+  int i;
   u8_t write_flags;
   size_t written;
 #endif
@@ -1263,74 +1434,15 @@ lwip_sendmsg(int s, const struct msghdr *msg, int flags)
              IS_SOCK_ADDR_LEN_VALID(msg->msg_namelen)) ,
              sock_set_errno(sock, err_to_errno(ERR_ARG)); return -1;);
 
-  /* initialize chain buffer with destination */
-  chain_buf = netbuf_new();
-  if (!chain_buf) {
-    sock_set_errno(sock, err_to_errno(ERR_MEM));
-    return -1;
-  }
-  if (msg->msg_name) {
-    SOCKADDR_TO_IPADDR_PORT((const struct sockaddr *)msg->msg_name, &chain_buf->addr, remote_port);
-    netbuf_fromport(chain_buf) = remote_port;
-  }
-#if LWIP_NETIF_TX_SINGLE_PBUF
-  for (i = 0; i < msg->msg_iovlen; i++) {
-    size += msg->msg_iov[i].iov_len;
-  }
-  /* Allocate a new netbuf and copy the data into it. */
-  if (netbuf_alloc(chain_buf, (u16_t)size) == NULL) {
-    err = ERR_MEM;
-  }
-  else {
-    /* flatten the IO vectors */
-    size_t offset = 0;
-    for (i = 0; i < msg->msg_iovlen; i++) {
-      MEMCPY(&((u8_t*)chain_buf->p->payload)[offset], msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_len);
-      offset += msg->msg_iov[i].iov_len;
-    }
-#if LWIP_CHECKSUM_ON_COPY
-    {
-      /* This can be improved by using LWIP_CHKSUM_COPY() and aggregating the checksum for each IO vector */
-      u16_t chksum = ~inet_chksum_pbuf(chain_buf->p);
-      netbuf_set_chksum(chain_buf, chksum);
-    }
-#endif /* LWIP_CHECKSUM_ON_COPY */
-    err = ERR_OK;
-  }
-#else /* LWIP_NETIF_TX_SINGLE_PBUF */
-  /* create a chained netbuf from the IO vectors. NOTE: we assemble a pbuf chain
-     manually to avoid having to allocate, chain, and delete a netbuf for each iov */
-  for (i = 0; i < msg->msg_iovlen; i++) {
-    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, 0, PBUF_REF);
-    if (p == NULL) {
-      err = ERR_MEM; /* let netbuf_delete() cleanup chain_buf */
-      break;
-    }
-    p->payload = msg->msg_iov[i].iov_base;
-    LWIP_ASSERT("iov_len < u16_t", msg->msg_iov[i].iov_len <= 0xFFFF);
-    p->len = p->tot_len = (u16_t)msg->msg_iov[i].iov_len;
-    /* netbuf empty, add new pbuf */
-    if (chain_buf->p == NULL) {
-      chain_buf->p = chain_buf->ptr = p;
-    /* add pbuf to existing pbuf chain */
-    } else {
-      pbuf_cat(chain_buf->p, p);
-    }
-  }    
-  /* save size of total chain */
-  if (err == ERR_OK) {
-    size = netbuf_len(chain_buf);
-  }
-#endif /* LWIP_NETIF_TX_SINGLE_PBUF */
-
+  err = lwip_msghdr_to_netbuf(sock, msg, &chain_buf);
   if (err == ERR_OK) {
+    size = netbuf_len(&chain_buf);
     /* send the data */
-    err = netconn_send(sock->conn, chain_buf);
+    err = netconn_send(sock->conn, &chain_buf);
+    /* deallocated the buffer */
+    netbuf_free(&chain_buf);
   }
 
-  /* deallocated the buffer */
-  netbuf_delete(chain_buf);
-
   sock_set_errno(sock, err_to_errno(err));
   return (err == ERR_OK ? size : -1);
 #else /* LWIP_UDP || LWIP_RAW */
@@ -1449,6 +1561,183 @@ lwip_sendto(int s, const void *data, size_t size, int flags,
   return (err == ERR_OK ? short_size : -1);
 }
 
+#if LWIP_SOCKET_MMSG
+/**
+ * Send several messages with one call. On UDP and RAW sockets, up to
+ * LWIP_SOCKET_MMSG_BATCH datagrams are built into netbufs on the stack and
+ * handed to the tcpip_thread with a single netconn_send_multi, instead of
+ * one api_msg round trip per datagram. TCP sockets send one lwip_sendmsg
+ * per message.
+ *
+ * @return the number of messages sent (msg_len is set for each of them),
+ *         -1 if the first one could not be sent
+ */
+int
+lwip_sendmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags)
+{
+  struct lwip_sock *sock;
+  unsigned int done = 0;
+#if LWIP_UDP || LWIP_RAW
+  struct netbuf bufs[LWIP_SOCKET_MMSG_BATCH];
+  u16_t n, i, sent;
+  err_t err = ERR_OK;
+  err_t send_err;
+#endif /* LWIP_UDP || LWIP_RAW */
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_sendmmsg(%d, %p, %u, 0x%x)\n", s, (void *)msgvec, vlen, flags));
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+  LWIP_ERROR("lwip_sendmmsg: invalid msgvec", (msgvec != NULL) || (vlen == 0),
+             sock_set_errno(sock, err_to_errno(ERR_ARG)); return -1;);
+
+  if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
+    for (done = 0; done < vlen; done++) {
+      int ret = lwip_sendmsg(s, &msgvec[done].msg_hdr, flags);
+      if (ret < 0) {
+        /* errno is set by lwip_sendmsg */
+        return (done > 0) ? (int)done : -1;
+      }
+      msgvec[done].msg_len = (unsigned int)ret;
+    }
+    return (int)done;
+  }
+#if LWIP_UDP || LWIP_RAW
+  LWIP_UNUSED_ARG(flags);
+
+  while ((done < vlen) && (err == ERR_OK)) {
+    /* build a batch; the netbufs are reused for the next one */
+    for (n = 0; (n < LWIP_SOCKET_MMSG_BATCH) && (done + n < vlen); n++) {
+      err = lwip_msghdr_to_netbuf(sock, &msgvec[done + n].msg_hdr, &bufs[n]);
+      if (err != ERR_OK) {
+        break;
+      }
+      msgvec[done + n].msg_len = netbuf_len(&bufs[n]);
+    }
+    if (n == 0) {
+      break;
+    }
+
+    send_err = netconn_send_multi(sock->conn, bufs, n, &sent);
+    if (send_err != ERR_OK) {
+      /* this message comes before the one that could not be built */
+      err = send_err;
+    }
+    for (i = 0; i < n; i++) {
+      netbuf_free(&bufs[i]);
+    }
+    done += sent;
+  }
+
+  if ((done == 0) && (vlen > 0)) {
+    sock_set_errno(sock, err_to_errno(err));
+    return -1;
+  }
+  /* like Linux, an error after the first message is not reported here */
+  sock_set_errno(sock, 0);
+  return (int)done;
+#else /* LWIP_UDP || LWIP_RAW */
+  sock_set_errno(sock, err_to_errno(ERR_ARG));
+  return -1;
+#endif /* LWIP_UDP || LWIP_RAW */
+}
+
+/**
+ * Receive several datagrams with one call (UDP and RAW sockets only).
+ * Only the first datagram is waited for (honouring MSG_DONTWAIT, O_NONBLOCK
+ * and SO_RCVTIMEO), the following ones are taken only if already queued,
+ * as with MSG_WAITFORONE on Linux; that flag is accepted and changes
+ * nothing. Datagrams longer than the iovecs are truncated. MSG_PEEK and
+ * 'timeout' are not supported.
+ *
+ * @return the number of datagrams received (msg_len is set for each of them),
+ *         0 if vlen is 0, -1 if none could be received
+ */
+int
+lwip_recvmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags,
+              struct timeval *timeout)
+{
+  struct lwip_sock *sock;
+  struct netbuf *buf;
+  struct msghdr *hdr;
+  unsigned int n;
+  u16_t off, copylen, buflen;
+  int i;
+  err_t err = ERR_OK;
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmmsg(%d, %p, %u, 0x%x)\n", s, (void *)msgvec, vlen, flags));
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+  LWIP_ERROR("lwip_recvmmsg: invalid msgvec", (msgvec != NULL) || (vlen == 0),
+             sock_set_errno(sock, err_to_errno(ERR_ARG)); return -1;);
+  LWIP_ERROR("lwip_recvmmsg: timeout and MSG_PEEK are not supported",
+             (timeout == NULL) && ((flags & MSG_PEEK) == 0),
+             sock_set_errno(sock, EINVAL); return -1;);
+  if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
+    sock_set_errno(sock, EOPNOTSUPP);
+    return -1;
+  }
+  if (vlen == 0) {
+    /* nothing to receive, as for lwip_sendmmsg */
+    sock_set_errno(sock, 0);
+    return 0;
+  }
+
+  for (n = 0; n < vlen; n++) {
+    if (sock->lastdata != NULL) {
+      /* left by lwip_recvfrom(MSG_PEEK) */
+      buf = (struct netbuf *)sock->lastdata;
+      sock->lastdata = NULL;
+      sock->lastoffset = 0;
+    } else {
+      if (((n > 0) || (flags & MSG_DONTWAIT) || netconn_is_nonblocking(sock->conn)) &&
+          (sock->rcvevent <= 0)) {
+        err = ERR_WOULDBLOCK;
+        break;
+      }
+      err = netconn_recv(sock->conn, &buf);
+      if (err != ERR_OK) {
+        break;
+      }
+    }
+
+    /* scatter the datagram over the IO vectors */
+    hdr = &msgvec[n].msg_hdr;
+    buflen = buf->p->tot_len;
+    off = 0;
+    for (i = 0; (i < hdr->msg_iovlen) && (off < buflen); i++) {
+      copylen = (u16_t)LWIP_MIN(hdr->msg_iov[i].iov_len, (size_t)(buflen - off));
+      pbuf_copy_partial(buf->p, hdr->msg_iov[i].iov_base, copylen, off);
+      off += copylen;
+    }
+    msgvec[n].msg_len = off;
+    hdr->msg_flags = 0;
+    hdr->msg_controllen = 0;
+
+    if ((hdr->msg_name != NULL) && (hdr->msg_namelen > 0)) {
+      union sockaddr_aligned saddr;
+      IPADDR_PORT_TO_SOCKADDR(&saddr, netbuf_fromaddr(buf), netbuf_fromport(buf));
+      if (hdr->msg_namelen > saddr.sa.sa_len) {
+        hdr->msg_namelen = saddr.sa.sa_len;
+      }
+      MEMCPY(hdr->msg_name, &saddr, hdr->msg_namelen);
+    }
+    netbuf_delete(buf);
+  }
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmmsg(%d): %u datagrams\n", s, n));
+  if (n == 0) {
+    sock_set_errno(sock, err_to_errno(err));
+    return -1;
+  }
+  sock_set_errno(sock, 0);
+  return (int)n;
+}
+#endif /* LWIP_SOCKET_MMSG */
+
 int
 lwip_socket(int domain, int type, int protocol)
 {
@@ -1809,6 +2098,418 @@ return_copy_fdsets:
   return nready;
 }
 
+#if LWIP_SOCKET_EPOLL
+/**
+ * Events currently pending on a socket, see lwip_selscan().
+ * Must be called with SYS_ARCH protected.
+ */
+static u32_t
+lwip_epoll_sock_events(struct lwip_sock *sock)
+{
+  u32_t events = 0;
+
+  if ((sock->lastdata != NULL) || (sock->rcvevent > 0)) {
+    events |= EPOLLIN;
+  }
+  if (sock->sendevent != 0) {
+    events |= EPOLLOUT;
+  }
+  if (sock->errevent != 0) {
+    events |= EPOLLERR;
+  }
+  return events;
+}
+
+/** Events reported for a registered socket: errors are always reported,
+ * nothing is reported while a oneshot registration is disarmed. */
+#define LWIP_EPOLL_INTEREST(sock) \
+  (((sock)->epoll_events != 0) ? ((sock)->epoll_events | EPOLLERR) : 0)
+
+/** Append a socket to the ready list. Must be called with SYS_ARCH protected. */
+static void
+lwip_epoll_enqueue(struct lwip_epoll *ep, struct lwip_sock *sock)
+{
+  sock->epoll_next = NULL;
+  sock->epoll_queued = 1;
+  if (ep->ready_tail != NULL) {
+    ep->ready_tail->epoll_next = sock;
+  } else {
+    ep->ready_head = sock;
+  }
+  ep->ready_tail = sock;
+}
+
+/** Wake up one task waiting on this instance, if any.
+ * Must be called with SYS_ARCH protected. */
+static void
+lwip_epoll_signal(struct lwip_epoll *ep)
+{
+  if ((ep->waiting != 0) && !ep->sem_signalled) {
+    ep->sem_signalled = 1;
+    sys_sem_signal(&ep->sem);
+  }
+}
+
+/**
+ * Queue a registered socket if it has an event of interest pending and wake
+ * up a waiter. Called by event_callback() with SYS_ARCH protected: this is
+ * O(1), whatever the number of sockets and waiting tasks.
+ */
+static void
+lwip_epoll_notify(struct lwip_sock *sock)
+{
+  if (sock->epoll_queued ||
+      !(lwip_epoll_sock_events(sock) & LWIP_EPOLL_INTEREST(sock))) {
+    return;
+  }
+  lwip_epoll_enqueue(sock->epoll, sock);
+  lwip_epoll_signal(sock->epoll);
+}
+
+/** Unregister a socket from its epoll instance. Must be called with
+ * SYS_ARCH protected. */
+static void
+lwip_epoll_sock_detach_locked(struct lwip_sock *sock)
+{
+  struct lwip_epoll *ep = sock->epoll;
+  struct lwip_sock *prev = NULL;
+  struct lwip_sock *s;
+
+  if (ep == NULL) {
+    return;
+  }
+  if (sock->epoll_queued) {
+    for (s = ep->ready_head; (s != NULL) && (s != sock); s = s->epoll_next) {
+      prev = s;
+    }
+    LWIP_ASSERT("queued socket is on the ready list", s == sock);
+    if (prev != NULL) {
+      prev->epoll_next = sock->epoll_next;
+    } else {
+      ep->ready_head = sock->epoll_next;
+    }
+    if (ep->ready_tail == sock) {
+      ep->ready_tail = prev;
+    }
+    sock->epoll_queued = 0;
+  }
+  sock->epoll = NULL;
+  sock->epoll_next = NULL;
+}
+
+/** Unregister a socket from its epoll instance (on close). */
+static void
+lwip_epoll_sock_detach(struct lwip_sock *sock)
+{
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  lwip_epoll_sock_detach_locked(sock);
+  SYS_ARCH_UNPROTECT(lev);
+}
+
+/**
+ * Map an epoll descriptor to its instance.
+ *
+ * @param epfd descriptor returned by lwip_epoll_create
+ * @return struct lwip_epoll for the descriptor or NULL if not open
+ */
+static struct lwip_epoll *
+get_epoll(int epfd)
+{
+  if (!LWIP_IS_EPOLL_FD(epfd) || !epolls[epfd - LWIP_EPOLL_FD_BASE].used) {
+    LWIP_DEBUGF(SOCKETS_DEBUG, ("get_epoll(%d): invalid\n", epfd));
+    set_errno(EBADF);
+    return NULL;
+  }
+  return &epolls[epfd - LWIP_EPOLL_FD_BASE];
+}
+
+/**
+ * Move up to maxevents ready sockets from the ready list to 'events'.
+ * Level-triggered sockets that are reported go back to the tail of the list
+ * (they are dropped on the next call once they are no longer ready), so
+ * sockets are served round-robin when maxevents is small.
+ * Must be called with SYS_ARCH protected.
+ */
+static int
+lwip_epoll_collect(struct lwip_epoll *ep, struct epoll_event *events, int maxevents)
+{
+  struct lwip_sock *sock;
+  struct lwip_sock *requeue_head = NULL;
+  struct lwip_sock *requeue_tail = NULL;
+  u32_t ready;
+  int n = 0;
+
+  while ((n < maxevents) && ((sock = ep->ready_head) != NULL)) {
+    ep->ready_head = sock->epoll_next;
+    if (ep->ready_head == NULL) {
+      ep->ready_tail = NULL;
+    }
+    sock->epoll_next = NULL;
+    sock->epoll_queued = 0;
+
+    ready = lwip_epoll_sock_events(sock) & LWIP_EPOLL_INTEREST(sock);
+    if (ready == 0) {
+      /* stale entry: the event has been consumed since it was queued */
+      continue;
+    }
+    events[n].events = ready;
+    events[n].data = sock->epoll_data;
+    n++;
+
+    if (sock->epoll_events & EPOLLONESHOT) {
+      /* disarmed until EPOLL_CTL_MOD */
+      sock->epoll_events = 0;
+    } else if (!(sock->epoll_events & EPOLLET)) {
+      sock->epoll_queued = 1;
+      if (requeue_tail != NULL) {
+        requeue_tail->epoll_next = sock;
+      } else {
+        requeue_head = sock;
+      }
+      requeue_tail = sock;
+    }
+  }
+
+  if (requeue_head != NULL) {
+    if (ep->ready_tail != NULL) {
+      ep->ready_tail->epoll_next = requeue_head;
+    } else {
+      ep->ready_head = requeue_head;
+    }
+    ep->ready_tail = requeue_tail;
+  }
+  return n;
+}
+
+/**
+ * Create an epoll instance. Close it with lwip_close().
+ *
+ * @param size ignored, but must be > 0 (as on Linux)
+ * @return the epoll descriptor; -1 on error
+ */
+int
+lwip_epoll_create(int size)
+{
+  struct lwip_epoll *ep = NULL;
+  int i;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  if (size <= 0) {
+    set_errno(EINVAL);
+    return -1;
+  }
+
+  SYS_ARCH_PROTECT(lev);
+  for (i = 0; i < LWIP_SOCKET_EPOLL_MAX; i++) {
+    if (!epolls[i].used) {
+      ep = &epolls[i];
+      ep->used = 1;
+      break;
+    }
+  }
+  SYS_ARCH_UNPROTECT(lev);
+
+  if (ep == NULL) {
+    LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_create: no free instance\n"));
+    set_errno(EMFILE);
+    return -1;
+  }
+
+  ep->sem_signalled = 0;
+  ep->waiting = 0;
+  ep->ready_head = NULL;
+  ep->ready_tail = NULL;
+  if (sys_sem_new(&ep->sem, 0) != ERR_OK) {
+    SYS_ARCH_SET(ep->used, 0);
+    set_errno(ENOMEM);
+    return -1;
+  }
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_create() = %d\n", LWIP_EPOLL_FD_BASE + i));
+  return LWIP_EPOLL_FD_BASE + i;
+}
+
+/**
+ * Close an epoll instance, called by lwip_close() for epoll descriptors.
+ * Fails with EBUSY while a task is waiting on it.
+ */
+static int
+lwip_epoll_close(int epfd)
+{
+  struct lwip_epoll *ep;
+  int i;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  ep = get_epoll(epfd);
+  if (ep == NULL) {
+    return -1;
+  }
+
+  SYS_ARCH_PROTECT(lev);
+  if (ep->waiting != 0) {
+    SYS_ARCH_UNPROTECT(lev);
+    set_errno(EBUSY);
+    return -1;
+  }
+  for (i = 0; i < NUM_SOCKETS; i++) {
+    if (sockets[i].epoll == ep) {
+      sockets[i].epoll = NULL;
+      sockets[i].epoll_next = NULL;
+      sockets[i].epoll_queued = 0;
+    }
+  }
+  ep->ready_head = NULL;
+  ep->ready_tail = NULL;
+  SYS_ARCH_UNPROTECT(lev);
+
+  sys_sem_free(&ep->sem);
+  SYS_ARCH_SET(ep->used, 0);
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_close(%d)\n", epfd));
+  set_errno(0);
+  return 0;
+}
+
+/**
+ * Add, modify or remove the registration of a socket.
+ * A socket can be registered with one epoll instance at a time; EPOLL_CTL_ADD
+ * fails with EEXIST if it already is. Closing the socket unregisters it.
+ *
+ * @param epfd epoll descriptor
+ * @param op EPOLL_CTL_ADD, EPOLL_CTL_MOD or EPOLL_CTL_DEL
+ * @param s socket
+ * @param event events of interest and user data (unused for EPOLL_CTL_DEL)
+ * @return 0 on success; -1 on error
+ */
+int
+lwip_epoll_ctl(int epfd, int op, int s, struct epoll_event *event)
+{
+  struct lwip_epoll *ep;
+  struct lwip_sock *sock;
+  int err = 0;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_ctl(%d, %d, %d)\n", epfd, op, s));
+
+  ep = get_epoll(epfd);
+  if (ep == NULL) {
+    return -1;
+  }
+  if ((op != EPOLL_CTL_DEL) && (event == NULL)) {
+    set_errno(EINVAL);
+    return -1;
+  }
+
+  SYS_ARCH_PROTECT(lev);
+  sock = tryget_socket(s);
+  if (sock == NULL) {
+    err = EBADF;
+  } else if (op == EPOLL_CTL_ADD) {
+    if (sock->epoll != NULL) {
+      err = EEXIST;
+    } else {
+      sock->epoll = ep;
+      sock->epoll_next = NULL;
+      sock->epoll_queued = 0;
+      sock->epoll_events = event->events;
+      sock->epoll_data = event->data;
+      /* report a socket that is ready already */
+      lwip_epoll_notify(sock);
+    }
+  } else if (sock->epoll != ep) {
+    err = ENOENT;
+  } else if (op == EPOLL_CTL_MOD) {
+    sock->epoll_events = event->events;
+    sock->epoll_data = event->data;
+    lwip_epoll_notify(sock);
+  } else if (op == EPOLL_CTL_DEL) {
+    lwip_epoll_sock_detach_locked(sock);
+  } else {
+    err = EINVAL;
+  }
+  SYS_ARCH_UNPROTECT(lev);
+
+  if (err != 0) {
+    set_errno(err);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Wait for events on the sockets registered with an epoll instance.
+ * Only sockets on the ready list are looked at.
+ *
+ * @param epfd epoll descriptor
+ * @param events array receiving the events
+ * @param maxevents size of 'events' (> 0)
+ * @param timeout in milliseconds, 0 to poll, < 0 to wait forever
+ * @return number of events stored in 'events' (0 on timeout); -1 on error
+ */
+int
+lwip_epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+  struct lwip_epoll *ep;
+  u32_t start = 0;
+  u32_t now;
+  u32_t msectimeout;
+  int nready;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  ep = get_epoll(epfd);
+  if (ep == NULL) {
+    return -1;
+  }
+  if ((events == NULL) || (maxevents <= 0)) {
+    set_errno(EINVAL);
+    return -1;
+  }
+  if (timeout > 0) {
+    start = sys_now();
+  }
+
+  for (;;) {
+    /* timeout left, computed before looking at the list so that an event
+       arriving in between is not missed */
+    msectimeout = 0; /* wait forever */
+    if (timeout > 0) {
+      now = sys_now();
+      if ((u32_t)(now - start) >= (u32_t)timeout) {
+        /* last look at the list below, then give up */
+        timeout = 0;
+      } else {
+        msectimeout = (u32_t)timeout - (u32_t)(now - start);
+      }
+    }
+
+    SYS_ARCH_PROTECT(lev);
+    nready = lwip_epoll_collect(ep, events, maxevents);
+    if ((nready > 0) || (timeout == 0)) {
+      if (ep->ready_head != NULL) {
+        /* more left than we could take: pass the wakeup on */
+        lwip_epoll_signal(ep);
+      }
+      SYS_ARCH_UNPROTECT(lev);
+      break;
+    }
+    ep->waiting++;
+    SYS_ARCH_UNPROTECT(lev);
+
+    sys_arch_sem_wait(&ep->sem, msectimeout);
+
+    SYS_ARCH_PROTECT(lev);
+    ep->waiting--;
+    ep->sem_signalled = 0;
+    SYS_ARCH_UNPROTECT(lev);
+  }
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_wait(%d): nready=%d\n", epfd, nready));
+  return nready;
+}
+#endif /* LWIP_SOCKET_EPOLL */
+
 /**
  * Callback registered in the netconn layer for each socket-netconn.
  * Processes recvevent (data available) and wakes up tasks waiting for select.
@@ -1876,6 +2577,14 @@ event_callback(struct netconn *conn, enum netconn_evt evt, u16_t len)
       break;
   }
 
+#if LWIP_SOCKET_EPOLL
+  /* RCVMINUS/SENDMINUS never make a socket ready */
+  if ((sock->epoll != NULL) &&
+      (evt != NETCONN_EVT_RCVMINUS) && (evt != NETCONN_EVT_SENDMINUS)) {
+    lwip_epoll_notify(sock);
+  }
+#endif /* LWIP_SOCKET_EPOLL */
+
   if (sock->select_waiting == 0) {
     /* noone is waiting for this socket, no need to check select_cb_list */
     SYS_ARCH_UNPROTECT(lev);
@@ -2315,6 +3024,10 @@ lwip_getsockopt_impl(int s, int level, int optname, void *optval, socklen_t *opt
   case IPPROTO_TCP:
     /* Special case: all IPPROTO_TCP option take an int */
     LWIP_SOCKOPT_CHECK_OPTLEN_CONN_PCB_TYPE(sock, *optlen, int, NETCONN_TCP);
+    if (sock->conn->pcb.tcp->state == LISTEN) {
+      /* a listen pcb (struct tcp_pcb_listen) has none of these fields */
+      return EINVAL;
+    }
     switch (optname) {
     case TCP_NODELAY:
       *(int*)optval = tcp_nagle_disabled(sock->conn->pcb.tcp);
@@ -2347,12 +3060,17 @@ lwip_getsockopt_impl(int s, int level, int optname, void *optval, socklen_t *opt
 
 #if ESP_PER_SOC_TCP_WND
     case TCP_WINDOW:
-    *(int*)optval = (int)sock->conn->pcb.tcp->per_soc_tcp_wnd;
-    break;
+      *(int*)optval = (int)sock->conn->pcb.tcp->per_soc_tcp_wnd;
+      break;
     case TCP_SNDBUF:
-    *(int*)optval = (int)sock->conn->pcb.tcp->per_soc_tcp_snd_buf;
-    break;
-#endif
+      *(int*)optval = (int)sock->conn->pcb.tcp->per_soc_tcp_snd_buf;
+      break;
+#if LWIP_TCP_WND_AUTOTUNE
+    case TCP_WINDOW_AUTOTUNE:
+      *(int*)optval = tcp_get_wnd_autotune(sock->conn->pcb.tcp);
+      break;
+#endif /* LWIP_TCP_WND_AUTOTUNE */
+#endif /* ESP_PER_SOC_TCP_WND */
 
     default:
       LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_getsockopt(%d, IPPROTO_TCP, UNIMPL: optname=0x%x, ..)\n",
@@ -2718,6 +3436,10 @@ lwip_setsockopt_impl(int s, int level, int optname, const void *optval, socklen_
   case IPPROTO_TCP:
     /* Special case: all IPPROTO_TCP option take an int */
     LWIP_SOCKOPT_CHECK_OPTLEN_CONN_PCB_TYPE(sock, optlen, int, NETCONN_TCP);
+    if (sock->conn->pcb.tcp->state == LISTEN) {
+      /* a listen pcb (struct tcp_pcb_listen) has none of these fields */
+      return EINVAL;
+    }
     switch (optname) {
     case TCP_NODELAY:
       if (*(const int*)optval) {
@@ -2754,12 +3476,33 @@ lwip_setsockopt_impl(int s, int level, int optname, const void *optval, socklen_
 
 #if ESP_PER_SOC_TCP_WND
     case TCP_WINDOW:
-    sock->conn->pcb.tcp->per_soc_tcp_wnd = ((u32_t)(*(const int*)optval)) * TCP_MSS;
-    break;
     case TCP_SNDBUF:
-    sock->conn->pcb.tcp->per_soc_tcp_snd_buf = ((u32_t)(*(const int*)optval)) * TCP_MSS;
-    break;
-#endif
+      if (*(const int*)optval <= 0) {
+        err = EINVAL;
+        break;
+      }
+      /* in MSS, tcp_set_window()/tcp_set_sndbuf() clamp to TCP_WND_LIMIT */
+      {
+        u32_t size = (u32_t)LWIP_MIN(*(const int*)optval, (int)(TCP_WND_LIMIT / TCP_MSS) + 1) * TCP_MSS;
+        if (optname == TCP_WINDOW) {
+          tcp_set_window(sock->conn->pcb.tcp, size);
+#if LWIP_TCP_WND_AUTOTUNE
+          tcp_set_wnd_autotune(sock->conn->pcb.tcp, 0);
+#endif /* LWIP_TCP_WND_AUTOTUNE */
+        } else {
+          tcp_set_sndbuf(sock->conn->pcb.tcp, size);
+        }
+      }
+      LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_setsockopt(%d, IPPROTO_TCP, %s) -> %"U32_F"\n",
+                  s, (optname == TCP_WINDOW) ? "TCP_WINDOW" : "TCP_SNDBUF",
+                  (u32_t)((optname == TCP_WINDOW) ? sock->conn->pcb.tcp->per_soc_tcp_wnd : sock->conn->pcb.tcp->per_soc_tcp_snd_buf)));
+      break;
+#if LWIP_TCP_WND_AUTOTUNE
+    case TCP_WINDOW_AUTOTUNE:
+      tcp_set_wnd_autotune(sock->conn->pcb.tcp, *(const int*)optval);
+      break;
+#endif /* LWIP_TCP_WND_AUTOTUNE */
+#endif /* ESP_PER_SOC_TCP_WND */
 
     default:
       LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_setsockopt(%d, IPPROTO_TCP, UNIMPL: optname=0x%x, ..)\n",
@@ -3100,6 +3843,25 @@ lwip_send_r(int s, const void *data, size_t size, int flags)
   LWIP_API_UNLOCK();
 }
 
+#if LWIP_SOCKET_MMSG
+int
+lwip_sendmmsg_r(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags)
+{
+  LWIP_API_LOCK();
+  __ret = lwip_sendmmsg(s, msgvec, vlen, flags);
+  LWIP_API_UNLOCK();
+}
+
+int
+lwip_recvmmsg_r(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags,
+                struct timeval *timeout)
+{
+  LWIP_API_LOCK();
+  __ret = lwip_recvmmsg(s, msgvec, vlen, flags, timeout);
+  LWIP_API_UNLOCK();
+}
+#endif /* LWIP_SOCKET_MMSG */
+
 int
 lwip_recvfrom_r(int s, void *mem, size_t len, int flags,
               struct sockaddr *from, socklen_t *fromlen)
@@ -3235,6 +3997,12 @@ lwip_getsockname_r(int s, struct sockaddr *name, socklen_t *namelen)
 int
 lwip_close_r(int s)
 {
+#if LWIP_SOCKET_EPOLL
+  if (LWIP_IS_EPOLL_FD(s)) {
+    return lwip_epoll_close(s);
+  }
+#endif /* LWIP_SOCKET_EPOLL */
+
   LWIP_API_LOCK();
   LWIP_SET_CLOSE_FLAG();
   __ret = lwip_close(s);
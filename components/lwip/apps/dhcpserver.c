@@ -62,8 +62,6 @@
 #define DHCPS_DEBUG          0
 #define DHCPS_LOG printf
 
-#define MAX_STATION_NUM      8
-
 #define DHCPS_STATE_OFFER 1
 #define DHCPS_STATE_DECLINE 2
 #define DHCPS_STATE_ACK 3
@@ -79,9 +77,7 @@ static struct udp_pcb *pcb_dhcps = NULL;
 static ip4_addr_t  broadcast_dhcps;
 static ip4_addr_t server_address;
 static ip4_addr_t client_address;        //added
-static ip4_addr_t client_address_plus;
 
-static list_node *plist = NULL;
 static bool renew = false;
 
 static dhcps_lease_t dhcps_poll;
@@ -129,80 +125,197 @@ void *dhcps_option_info(u8_t op_id, u32_t opt_len)
 }
 
 /******************************************************************************
- * FunctionName : node_insert_to_list
- * Description  : insert the node to the list
- * Parameters   : phead -- the head node of the list
- *                pinsert -- the insert node of the list
- * Returns      : none
+ * Lease table
+ *
+ * Leases live in a fixed table indexed by the offset of their address in
+ * the pool, so the lease of an address is found directly and a bitmap of
+ * the used entries gives the next free address. Leases are also chained in
+ * a hash of the client MAC address, for the lookup on every request, and
+ * in a timer wheel with one slot per minute, so that dhcps_coarse_tmr only
+ * visits the leases which may end in that minute.
 *******************************************************************************/
-void node_insert_to_list(list_node **phead, list_node *pinsert)
+#define DHCPS_LEASE_NUM      (DHCPS_MAX_LEASE + 1)
+#define DHCPS_MAC_HASH_SIZE  128
+#define DHCPS_WHEEL_SLOTS    64
+#define DHCPS_NO_LEASE       0xFF
+
+#if DHCPS_LEASE_NUM >= DHCPS_NO_LEASE
+#error "DHCPS_MAX_LEASE is too large for the lease table"
+#endif
+
+struct dhcps_lease {
+    u8_t mac[6];
+    u8_t in_use;
+    u8_t mac_next;      /* next lease in the same MAC hash bucket */
+    u8_t wheel_prev;    /* neighbours in the same timer wheel slot */
+    u8_t wheel_next;
+    u32_t expiry;       /* value of dhcps_ticks when the lease ends */
+    u32_t touched;      /* value of lease_seq when the lease was last renewed */
+};
+
+static struct dhcps_lease leases[DHCPS_LEASE_NUM];
+static u8_t lease_mac_hash[DHCPS_MAC_HASH_SIZE];
+static u8_t lease_wheel[DHCPS_WHEEL_SLOTS];
+static u32_t lease_used[(DHCPS_LEASE_NUM + 31) / 32];
+static u32_t lease_count;       /* addresses in the pool */
+static u32_t lease_next;        /* where the search for a free address starts */
+static u32_t dhcps_ticks;       /* minutes counted by dhcps_coarse_tmr */
+static u32_t lease_seq;         /* orders the renewals within a minute */
+
+static u32_t lease_mac_bucket(const u8_t *mac)
+{
+    /* the first half of the address is often the same vendor prefix */
+    u32_t key = ((u32_t)mac[3] << 16) | ((u32_t)mac[4] << 8) | mac[5];
+    return (key * 2654435761U) >> 25;
+}
+
+static void lease_reset(void)
+{
+    u32_t start = ntohl(dhcps_poll.start_ip.addr);
+    u32_t end = ntohl(dhcps_poll.end_ip.addr);
+
+    memset(leases, 0, sizeof(leases));
+    memset(lease_mac_hash, DHCPS_NO_LEASE, sizeof(lease_mac_hash));
+    memset(lease_wheel, DHCPS_NO_LEASE, sizeof(lease_wheel));
+    memset(lease_used, 0, sizeof(lease_used));
+    lease_count = (end >= start) ? LWIP_MIN(end - start + 1, DHCPS_LEASE_NUM) : 0;
+    lease_next = 0;
+}
+
+static void lease_ip(u8_t idx, ip4_addr_t *ip)
 {
-    list_node *plist = NULL;
-    struct dhcps_pool *pdhcps_pool = NULL;
-    struct dhcps_pool *pdhcps_node = NULL;
+    ip->addr = htonl(ntohl(dhcps_poll.start_ip.addr) + idx);
+}
+
+static void lease_wheel_unlink(u8_t idx)
+{
+    struct dhcps_lease *lease = &leases[idx];
 
-    if (*phead == NULL) {
-        *phead = pinsert;
+    if (lease->wheel_prev != DHCPS_NO_LEASE) {
+        leases[lease->wheel_prev].wheel_next = lease->wheel_next;
     } else {
-        plist = *phead;
-        pdhcps_node = pinsert->pnode;
-        pdhcps_pool = plist->pnode;
+        lease_wheel[lease->expiry % DHCPS_WHEEL_SLOTS] = lease->wheel_next;
+    }
+    if (lease->wheel_next != DHCPS_NO_LEASE) {
+        leases[lease->wheel_next].wheel_prev = lease->wheel_prev;
+    }
+}
 
-        if (pdhcps_node->ip.addr < pdhcps_pool->ip.addr) {
-            pinsert->pnext = plist;
-            *phead = pinsert;
-        } else {
-            while (plist->pnext != NULL) {
-                pdhcps_pool = plist->pnext->pnode;
+static void lease_wheel_link(u8_t idx)
+{
+    struct dhcps_lease *lease = &leases[idx];
+    u8_t *slot = &lease_wheel[lease->expiry % DHCPS_WHEEL_SLOTS];
 
-                if (pdhcps_node->ip.addr < pdhcps_pool->ip.addr) {
-                    pinsert->pnext = plist->pnext;
-                    plist->pnext = pinsert;
-                    break;
-                }
+    lease->wheel_prev = DHCPS_NO_LEASE;
+    lease->wheel_next = *slot;
+    if (*slot != DHCPS_NO_LEASE) {
+        leases[*slot].wheel_prev = idx;
+    }
+    *slot = idx;
+}
 
-                plist = plist->pnext;
-            }
+/* restart the lease time of a lease which is in the wheel already */
+static void lease_touch(u8_t idx)
+{
+    lease_wheel_unlink(idx);
+    leases[idx].expiry = dhcps_ticks + LWIP_MAX(dhcps_lease_time, 1);
+    leases[idx].touched = lease_seq++;
+    lease_wheel_link(idx);
+}
 
-            if (plist->pnext == NULL) {
-                plist->pnext = pinsert;
-            }
+static u8_t lease_find_mac(const u8_t *mac)
+{
+    u8_t idx;
+
+    for (idx = lease_mac_hash[lease_mac_bucket(mac)]; idx != DHCPS_NO_LEASE; idx = leases[idx].mac_next) {
+        if (memcmp(leases[idx].mac, mac, sizeof(leases[idx].mac)) == 0) {
+            return idx;
         }
     }
+    return DHCPS_NO_LEASE;
+}
+
+static void lease_free(u8_t idx)
+{
+    u8_t *pidx = &lease_mac_hash[lease_mac_bucket(leases[idx].mac)];
 
-//	pinsert->pnext = NULL;
+    while (*pidx != idx) {
+        pidx = &leases[*pidx].mac_next;
+    }
+    *pidx = leases[idx].mac_next;
+    lease_wheel_unlink(idx);
+    lease_used[idx / 32] &= ~(1U << (idx % 32));
+    leases[idx].in_use = 0;
 }
 
-/******************************************************************************
- * FunctionName : node_delete_from_list
- * Description  : remove the node from list
- * Parameters   : phead -- the head node of the list
- *                pdelete -- the remove node of the list
- * Returns      : none
-*******************************************************************************/
-void node_remove_from_list(list_node **phead, list_node *pdelete)
+/* first free entry in [from, to), or DHCPS_NO_LEASE */
+static u8_t lease_find_free(u32_t from, u32_t to)
 {
-    list_node *plist = NULL;
+    u32_t bits;
 
-    plist = *phead;
+    while (from < to) {
+        bits = ~lease_used[from / 32] & (0xFFFFFFFFU << (from % 32));
+        if (bits != 0) {
+            from = (from & ~31U) + __builtin_ctz(bits);
+            return (from < to) ? from : DHCPS_NO_LEASE;
+        }
+        from = (from & ~31U) + 32;
+    }
+    return DHCPS_NO_LEASE;
+}
 
-    if (plist == NULL) {
-        *phead = NULL;
-    } else {
-        if (plist == pdelete) {
-            *phead = plist->pnext;
-            pdelete->pnext = NULL;
-        } else {
-            while (plist != NULL) {
-                if (plist->pnext == pdelete) {
-                    plist->pnext = pdelete->pnext;
-                    pdelete->pnext = NULL;
-                }
+/* The lease ending first makes room when the pool is used up. In a storm
+   many leases end in the same minute, the least recently renewed one goes. */
+static u8_t lease_evict_oldest(void)
+{
+    u32_t left, oldest_left = 0;
+    u8_t idx, oldest = DHCPS_NO_LEASE;
+
+    for (idx = 0; idx < lease_count; idx++) {
+        left = leases[idx].expiry - dhcps_ticks;
+        if (oldest == DHCPS_NO_LEASE || left < oldest_left ||
+                (left == oldest_left && (s32_t)(leases[idx].touched - leases[oldest].touched) < 0)) {
+            oldest = idx;
+            oldest_left = left;
+        }
+    }
+    if (oldest != DHCPS_NO_LEASE) {
+        lease_free(oldest);
+    }
+    return oldest;
+}
 
-                plist = plist->pnext;
-            }
+static u8_t lease_alloc(const u8_t *mac)
+{
+    struct dhcps_lease *lease;
+    u32_t bucket;
+    u8_t idx;
+
+    /* hand out addresses round robin, so a released address is not
+       reused right away */
+    idx = lease_find_free(lease_next, lease_count);
+    if (idx == DHCPS_NO_LEASE) {
+        idx = lease_find_free(0, lease_next);
+    }
+    if (idx == DHCPS_NO_LEASE) {
+        idx = lease_evict_oldest();
+        if (idx == DHCPS_NO_LEASE) {
+            return DHCPS_NO_LEASE;
         }
     }
+    lease_next = (idx + 1 < lease_count) ? idx + 1 : 0;
+
+    lease = &leases[idx];
+    memcpy(lease->mac, mac, sizeof(lease->mac));
+    lease->in_use = 1;
+    lease_used[idx / 32] |= 1U << (idx % 32);
+    bucket = lease_mac_bucket(mac);
+    lease->mac_next = lease_mac_hash[bucket];
+    lease_mac_hash[bucket] = idx;
+    lease->expiry = dhcps_ticks + LWIP_MAX(dhcps_lease_time, 1);
+    lease->touched = lease_seq++;
+    lease_wheel_link(idx);
+    return idx;
 }
 
 /******************************************************************************
@@ -723,114 +836,33 @@ static s16_t parse_msg(struct dhcps_msg *m, u16_t len)
 #if DHCPS_DEBUG
         DHCPS_LOG("dhcps: len = %d\n", len);
 #endif
-        ip4_addr_t addr_tmp;
-
-        struct dhcps_pool *pdhcps_pool = NULL;
-        list_node *pnode = NULL;
-        list_node *pback_node = NULL;
-        ip4_addr_t first_address;
-        bool flag = false;
+        u8_t lease;
 
-        first_address.addr = dhcps_poll.start_ip.addr;
-        client_address.addr = client_address_plus.addr;
         renew = false;
+        lease = lease_find_mac(m->chaddr);
 
-        if (plist != NULL) {
-            for (pback_node = plist; pback_node != NULL; pback_node = pback_node->pnext) {
-                pdhcps_pool = pback_node->pnode;
-
-                if (memcmp(pdhcps_pool->mac, m->chaddr, sizeof(pdhcps_pool->mac)) == 0) {
-                    if (memcmp(&pdhcps_pool->ip.addr, m->ciaddr, sizeof(pdhcps_pool->ip.addr)) == 0) {
-                        renew = true;
-                    }
-
-                    client_address.addr = pdhcps_pool->ip.addr;
-                    pdhcps_pool->lease_timer = dhcps_lease_time;
-                    pnode = pback_node;
-                    goto POOL_CHECK;
-                } else if (pdhcps_pool->ip.addr == client_address_plus.addr) {
-                    addr_tmp.addr = htonl(client_address_plus.addr);
-                    addr_tmp.addr++;
-                    client_address_plus.addr = htonl(addr_tmp.addr);
-                    client_address.addr = client_address_plus.addr;
-                }
+        if (lease != DHCPS_NO_LEASE) {
+            lease_ip(lease, &client_address);
 
-                if (flag == false) { // search the fisrt unused ip
-                    if (first_address.addr < pdhcps_pool->ip.addr) {
-                        flag = true;
-                    } else {
-                        addr_tmp.addr = htonl(first_address.addr);
-                        addr_tmp.addr++;
-                        first_address.addr = htonl(addr_tmp.addr);
-                    }
-                }
+            if (memcmp(&client_address.addr, m->ciaddr, sizeof(client_address.addr)) == 0) {
+                renew = true;
             }
-        } else {
-            client_address.addr = dhcps_poll.start_ip.addr;
-        }
-
-        if (client_address_plus.addr > dhcps_poll.end_ip.addr) {
-            client_address.addr = first_address.addr;
-        }
 
-        if (client_address.addr > dhcps_poll.end_ip.addr) {
-            client_address_plus.addr = dhcps_poll.start_ip.addr;
-            pdhcps_pool = NULL;
-            pnode = NULL;
+            lease_touch(lease);
         } else {
-            pdhcps_pool = (struct dhcps_pool *)malloc(sizeof(struct dhcps_pool));
-            memset(pdhcps_pool , 0x00 , sizeof(struct dhcps_pool));
-
-            pdhcps_pool->ip.addr = client_address.addr;
-            memcpy(pdhcps_pool->mac, m->chaddr, sizeof(pdhcps_pool->mac));
-            pdhcps_pool->lease_timer = dhcps_lease_time;
-            pnode = (list_node *)malloc(sizeof(list_node));
-            memset(pnode , 0x00 , sizeof(list_node));
-
-            pnode->pnode = pdhcps_pool;
-            pnode->pnext = NULL;
-            node_insert_to_list(&plist, pnode);
-
-            if (client_address.addr == dhcps_poll.end_ip.addr) {
-                client_address_plus.addr = dhcps_poll.start_ip.addr;
-            } else {
-                addr_tmp.addr = htonl(client_address.addr);
-                addr_tmp.addr++;
-                client_address_plus.addr = htonl(addr_tmp.addr);
-            }
-        }
-
-POOL_CHECK:
-
-        if ((client_address.addr > dhcps_poll.end_ip.addr) || (ip4_addr_isany(&client_address))) {
-            if (pnode != NULL) {
-                node_remove_from_list(&plist, pnode);
-                free(pnode);
-                pnode = NULL;
-            }
+            lease = lease_alloc(m->chaddr);
 
-            if (pdhcps_pool != NULL) {
-                free(pdhcps_pool);
-                pdhcps_pool = NULL;
+            if (lease == DHCPS_NO_LEASE) {
+                return DHCPS_STATE_NAK;
             }
 
-            return 4;
+            lease_ip(lease, &client_address);
         }
 
         s16_t ret = parse_options(&m->options[4], len);;
 
         if (ret == DHCPS_STATE_RELEASE) {
-            if (pnode != NULL) {
-                node_remove_from_list(&plist, pnode);
-                free(pnode);
-                pnode = NULL;
-            }
-
-            if (pdhcps_pool != NULL) {
-                free(pdhcps_pool);
-                pdhcps_pool = NULL;
-            }
-
+            lease_free(lease);
             memset(&client_address, 0x0, sizeof(client_address));
         }
 
@@ -1043,7 +1075,7 @@ void dhcps_start(struct netif *netif, ip4_addr_t ip)
     server_address.addr = ip.addr;
     dhcps_poll_set(server_address.addr);
 
-    client_address_plus.addr = dhcps_poll.start_ip.addr;
+    lease_reset();
 
     udp_bind(pcb_dhcps, IP_ADDR_ANY, DHCPS_SERVER_PORT);
     udp_recv(pcb_dhcps, handle_dhcp, NULL);
@@ -1074,55 +1106,7 @@ void dhcps_stop(struct netif *netif)
         apnetif->dhcps_pcb = NULL;
     }
 
-    list_node *pnode = NULL;
-    list_node *pback_node = NULL;
-    pnode = plist;
-
-    while (pnode != NULL) {
-        pback_node = pnode;
-        pnode = pback_node->pnext;
-        node_remove_from_list(&plist, pback_node);
-        free(pback_node->pnode);
-        pback_node->pnode = NULL;
-        free(pback_node);
-        pback_node = NULL;
-    }
-}
-
-/******************************************************************************
- * FunctionName : kill_oldest_dhcps_pool
- * Description  : remove the oldest node from list
- * Parameters   : none
- * Returns      : none
-*******************************************************************************/
-static void kill_oldest_dhcps_pool(void)
-{
-    list_node *pre = NULL, *p = NULL;
-    list_node *minpre = NULL, *minp = NULL;
-    struct dhcps_pool *pdhcps_pool = NULL, *pmin_pool = NULL;
-    pre = plist;
-    p = pre->pnext;
-    minpre = pre;
-    minp = p;
-
-    while (p != NULL) {
-        pdhcps_pool = p->pnode;
-        pmin_pool = minp->pnode;
-
-        if (pdhcps_pool->lease_timer < pmin_pool->lease_timer) {
-            minp = p;
-            minpre = pre;
-        }
-
-        pre = p;
-        p = p->pnext;
-    }
-
-    minpre->pnext = minp->pnext;
-    free(minp->pnode);
-    minp->pnode = NULL;
-    free(minp);
-    minp = NULL;
+    lease_reset();
 }
 
 /******************************************************************************
@@ -1133,32 +1117,17 @@ static void kill_oldest_dhcps_pool(void)
 *******************************************************************************/
 void dhcps_coarse_tmr(void)
 {
-    u8_t num_dhcps_pool = 0;
-    list_node *pback_node = NULL;
-    list_node *pnode = NULL;
-    struct dhcps_pool *pdhcps_pool = NULL;
-    pnode = plist;
-
-    while (pnode != NULL) {
-        pdhcps_pool = pnode->pnode;
-        pdhcps_pool->lease_timer --;
-
-        if (pdhcps_pool->lease_timer == 0) {
-            pback_node = pnode;
-            pnode = pback_node->pnext;
-            node_remove_from_list(&plist, pback_node);
-            free(pback_node->pnode);
-            pback_node->pnode = NULL;
-            free(pback_node);
-            pback_node = NULL;
-        } else {
-            pnode = pnode ->pnext;
-            num_dhcps_pool ++;
-        }
-    }
+    u8_t idx, next;
+
+    dhcps_ticks++;
+
+    /* the slot also holds leases ending DHCPS_WHEEL_SLOTS minutes or more later */
+    for (idx = lease_wheel[dhcps_ticks % DHCPS_WHEEL_SLOTS]; idx != DHCPS_NO_LEASE; idx = next) {
+        next = leases[idx].wheel_next;
 
-    if (num_dhcps_pool >= MAX_STATION_NUM) {
-        kill_oldest_dhcps_pool();
+        if (leases[idx].expiry == dhcps_ticks) {
+            lease_free(idx);
+        }
     }
 }
 
@@ -1171,21 +1140,15 @@ void dhcps_coarse_tmr(void)
 *******************************************************************************/
 bool dhcp_search_ip_on_mac(u8_t *mac, ip4_addr_t *ip)
 {
-    struct dhcps_pool *pdhcps_pool = NULL;
-    list_node *pback_node = NULL;
-    bool ret = false;
-
-    for (pback_node = plist; pback_node != NULL; pback_node = pback_node->pnext) {
-        pdhcps_pool = pback_node->pnode;
+    u8_t lease = lease_find_mac(mac);
 
-        if (memcmp(pdhcps_pool->mac, mac, sizeof(pdhcps_pool->mac)) == 0) {
-            memcpy(&ip->addr, &pdhcps_pool->ip.addr, sizeof(pdhcps_pool->ip.addr));
-            ret = true;
-            break;
-        }
+    if (lease == DHCPS_NO_LEASE) {
+        return false;
     }
 
-    return ret;
+    lease_ip(lease, ip);
+    return true;
 }
+
 #endif
 
@@ -53,7 +53,7 @@
  * #define LWIP_CHKSUM <your_checksum_routine>
  *
  * Or you can select from the implementations below by defining
- * LWIP_CHKSUM_ALGORITHM to 1, 2 or 3.
+ * LWIP_CHKSUM_ALGORITHM to 1, 2, 3 or 4.
  */
 
 #ifndef LWIP_CHKSUM
@@ -258,6 +258,121 @@ lwip_standard_chksum(const void *dataptr, int len)
 }
 #endif
 
+#if (LWIP_CHKSUM_ALGORITHM == 4) || (LWIP_CHKSUM_COPY_ALGORITHM == 2)
+#if defined(__XTENSA__)
+/* Xtensa has no carry flag, so an end-around-carry add needs a compare and
+ * branch per word. Summing the two 16-bit halves of each word separately is
+ * branch-free (EXTUI, SRLI, 2x ADD) and cannot overflow 32 bits for
+ * len <= 0x20000.
+ */
+typedef u32_t chksum_acc_t;
+#define CHKSUM_ACC_ADD(acc, w)  ((acc) += ((w) & 0xffffUL) + ((w) >> 16))
+#else /* __XTENSA__ */
+/* Portable variant: a 64-bit accumulator defers all carries to the end. */
+typedef uint64_t chksum_acc_t;
+#define CHKSUM_ACC_ADD(acc, w)  ((acc) += (w))
+#endif /* __XTENSA__ */
+
+/** Fold a word accumulator down to 32 bits (not yet to 16 bits!) */
+static inline u32_t
+chksum_acc_fold(chksum_acc_t acc)
+{
+#if !defined(__XTENSA__)
+  acc = (acc & 0xffffffffULL) + (acc >> 32);
+  acc = (acc & 0xffffffffULL) + (acc >> 32);
+#endif /* !__XTENSA__ */
+  return (u32_t)acc;
+}
+#endif /* (LWIP_CHKSUM_ALGORITHM == 4) || (LWIP_CHKSUM_COPY_ALGORITHM == 2) */
+
+#if (LWIP_CHKSUM_ALGORITHM == 4) /* Alternative version #4 */
+/**
+ * Like version #3, but the inner loop works on 32 bytes (8 words) at a
+ * time and carries are accumulated without branches (see chksum_acc_t).
+ * The head is aligned to a word boundary first, the tail is summed as
+ * 16-bit words plus a dangling byte.
+ *
+ * @param dataptr points to start of data to be summed at any boundary
+ * @param len length of data to be summed (up to and including 0x20000)
+ * @return host order (!) lwip checksum (non-inverted Internet sum)
+ */
+u16_t
+lwip_standard_chksum(const void *dataptr, int len)
+{
+  const u8_t *pb = (const u8_t *)dataptr;
+  const u32_t *pl;
+  chksum_acc_t acc = 0;
+  u32_t sum;
+  u16_t t = 0;
+  /* starts at odd byte address? */
+  int odd = ((mem_ptr_t)pb & 1);
+
+  if (odd && len > 0) {
+    ((u8_t *)&t)[1] = *pb++;
+    len--;
+  }
+
+  /* Get aligned to u32_t */
+  if (((mem_ptr_t)pb & 2) && len > 1) {
+    acc += *(const u16_t *)(const void *)pb;
+    pb += 2;
+    len -= 2;
+  }
+
+  pl = (const u32_t *)(const void *)pb;
+
+  while (len >= 32) {
+    CHKSUM_ACC_ADD(acc, pl[0]);
+    CHKSUM_ACC_ADD(acc, pl[1]);
+    CHKSUM_ACC_ADD(acc, pl[2]);
+    CHKSUM_ACC_ADD(acc, pl[3]);
+    CHKSUM_ACC_ADD(acc, pl[4]);
+    CHKSUM_ACC_ADD(acc, pl[5]);
+    CHKSUM_ACC_ADD(acc, pl[6]);
+    CHKSUM_ACC_ADD(acc, pl[7]);
+    pl += 8;
+    len -= 32;
+  }
+
+  while (len > 3) {
+    CHKSUM_ACC_ADD(acc, *pl);
+    pl++;
+    len -= 4;
+  }
+
+  /* make room in upper bits */
+  sum = chksum_acc_fold(acc);
+  sum = FOLD_U32T(sum);
+
+  pb = (const u8_t *)pl;
+
+  /* 16-bit aligned word remaining? */
+  if (len > 1) {
+    sum += *(const u16_t *)(const void *)pb;
+    pb += 2;
+    len -= 2;
+  }
+
+  /* dangling tail byte remaining? */
+  if (len > 0) {
+    ((u8_t *)&t)[0] = *pb;
+  }
+
+  sum += t;
+
+  /* Fold 32-bit sum to 16 bits
+     calling this twice is probably faster than if statements... */
+  sum = FOLD_U32T(sum);
+  sum = FOLD_U32T(sum);
+
+  if (odd) {
+    sum = SWAP_BYTES_IN_WORD(sum);
+  }
+
+  return (u16_t)sum;
+}
+#endif
+
 /** Parts of the pseudo checksum which are common to IPv4 and IPv6 */
 static u16_t
 inet_cksum_pseudo_base(struct pbuf *p, u8_t proto, u16_t proto_len, u32_t acc)
@@ -610,3 +725,86 @@ lwip_chksum_copy(void *dst, const void *src, u16_t len)
   return LWIP_CHKSUM(dst, len);
 }
 #endif /* (LWIP_CHKSUM_COPY_ALGORITHM == 1) */
+
+#if (LWIP_CHKSUM_COPY_ALGORITHM == 2) /* Version #2 */
+/** Fused copy and checksum: if source and destination have the same
+ * alignment modulo 4, the bulk of the data is copied a word at a time and
+ * every word is added to the checksum while it is still in a register, so
+ * the data is only read once. Other alignments (and very short buffers)
+ * fall back to MEMCPY followed by LWIP_CHKSUM.
+ */
+u16_t
+lwip_chksum_copy(void *dst, const void *src, u16_t len)
+{
+  u8_t *pd = (u8_t *)dst;
+  const u8_t *ps = (const u8_t *)src;
+  u32_t *dl;
+  const u32_t *sl;
+  chksum_acc_t acc = 0;
+  u32_t sum, w0, w1, w2, w3;
+  u16_t head, tail, i;
+
+  if (((((mem_ptr_t)pd) ^ ((mem_ptr_t)ps)) & 3) || (len < 16)) {
+    MEMCPY(dst, src, len);
+    return LWIP_CHKSUM(dst, len);
+  }
+
+  /* copy the unaligned head byte-wise, it is summed separately below */
+  head = (u16_t)((4 - ((mem_ptr_t)ps & 3)) & 3);
+  for (i = 0; i < head; i++) {
+    pd[i] = ps[i];
+  }
+  len -= head;
+
+  dl = (u32_t *)(void *)(pd + head);
+  sl = (const u32_t *)(const void *)(ps + head);
+
+  while (len >= 16) {
+    w0 = sl[0];
+    w1 = sl[1];
+    w2 = sl[2];
+    w3 = sl[3];
+    dl[0] = w0;
+    dl[1] = w1;
+    dl[2] = w2;
+    dl[3] = w3;
+    CHKSUM_ACC_ADD(acc, w0);
+    CHKSUM_ACC_ADD(acc, w1);
+    CHKSUM_ACC_ADD(acc, w2);
+    CHKSUM_ACC_ADD(acc, w3);
+    sl += 4;
+    dl += 4;
+    len -= 16;
+  }
+  while (len > 3) {
+    w0 = *sl++;
+    *dl++ = w0;
+    CHKSUM_ACC_ADD(acc, w0);
+    len -= 4;
+  }
+
+  sum = chksum_acc_fold(acc);
+  sum = FOLD_U32T(sum);
+
+  /* 0..3 trailing bytes start at an even offset from the aligned body */
+  tail = len;
+  if (tail > 0) {
+    MEMCPY(dl, sl, tail);
+    sum += LWIP_CHKSUM(dl, tail);
+  }
+  sum = FOLD_U32T(sum);
+  sum = FOLD_U32T(sum);
+
+  if (head > 0) {
+    /* the body started at an odd offset: its bytes were summed swapped */
+    if (head & 1) {
+      sum = SWAP_BYTES_IN_WORD(sum);
+    }
+    sum += LWIP_CHKSUM(pd, head);
+    sum = FOLD_U32T(sum);
+    sum = FOLD_U32T(sum);
+  }
+
+  return (u16_t)sum;
+}
+#endif /* (LWIP_CHKSUM_COPY_ALGORITHM == 2) */
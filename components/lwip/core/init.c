@@ -127,6 +127,9 @@
 #if (LWIP_TCP && LWIP_WND_SCALE && (TCP_RCV_SCALE > 14))
   #error "The maximum valid window scale value is 14!"
 #endif
+#if (LWIP_TCP && ESP_PER_SOC_TCP_WND && (TCP_WND_LIMIT > (0xFFFFUL << TCP_RCV_SCALE)))
+  #error "TCP_WND_LIMIT is bigger than the configured TCP_RCV_SCALE allows!"
+#endif
 //#if (LWIP_TCP && (TCP_WND > (0xFFFFU << TCP_RCV_SCALE)))
   //#error "TCP_WND is bigger than the configured LWIP_WND_SCALE allows!"
 //#endif
@@ -139,10 +142,20 @@
 #if (LWIP_TCP && (TCP_WND > 0xffff))
   #error "If you want to use TCP, TCP_WND must fit in an u16_t, so, you have to reduce it in your lwipopts.h (or enable window scaling)"
 #endif
+#else
+#if (LWIP_TCP && (TCP_WND_LIMIT > 0xffff))
+  #error "If you want to use TCP, TCP_WND_LIMIT must fit in an u16_t, so, you have to reduce it in your lwipopts.h (or enable window scaling)"
+#endif
 #endif
 
 #endif /* LWIP_WND_SCALE */
 
+#if ESP_PER_SOC_TCP_WND
+#if (LWIP_TCP && ((TCP_WND_DEFAULT > TCP_WND_LIMIT) || (TCP_SND_BUF_DEFAULT > TCP_WND_LIMIT)))
+  #error "TCP_WND_DEFAULT and TCP_SND_BUF_DEFAULT must not be bigger than TCP_WND_LIMIT"
+#endif
+#endif
+
 #if ! ESP_PER_SOC_TCP_WND
 #if (LWIP_TCP && (TCP_SND_QUEUELEN(0) > 0xffff))
   #error "If you want to use TCP, TCP_SND_QUEUELEN must fit in an u16_t, so, you have to reduce it in your lwipopts.h"
@@ -77,6 +77,7 @@ ethip6_send(struct netif *netif, struct pbuf *p, struct eth_addr *src, struct et
   ethhdr->type = PP_HTONS(ETHTYPE_IPV6);
   LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("ethip6_send: sending packet %p\n", (void *)p));
   /* send the packet */
+  NETSTATS_INC(tx_frames);
   return netif->linkoutput(netif, p);
 }
 
@@ -324,6 +324,7 @@ memp_malloc_fn(memp_t type, const char* file, const int line)
 #endif
 
   if (memp != NULL) {
+    NETSTATS_MEMP_ALLOC(type);
     MEMP_STATS_INC(used, type);
     if(MEMP_STATS_GET(used, type) > MEMP_STATS_GET(max, type)) {
       MEMP_STATS_AVAIL(max, type, MEMP_STATS_GET(used, type));
@@ -413,6 +414,7 @@ memp_free(memp_t type, void *mem)
 #endif /* MEMP_OVERFLOW_CHECK >= 2 */
 
   MEMP_STATS_DEC(used, type);
+  NETSTATS_MEMP_FREE(type);
 
 #ifdef LWIP_HOOK_MEMP_AVAILABLE
   do_memp_free_pool(memp_pools[type], mem, &old_first);
@@ -429,4 +431,26 @@ memp_free(memp_t type, void *mem)
 #endif
 }
 
+#elif ESP_NETSTATS && !ESP_CNT_DEBUG /* MEMP_MEM_MALLOC */
+
+void *
+memp_malloc(memp_t type)
+{
+  void *mem = mem_malloc(memp_pools[type]->size);
+
+  if (mem != NULL) {
+    NETSTATS_MEMP_ALLOC(type);
+  }
+  return mem;
+}
+
+void
+memp_free(memp_t type, void *mem)
+{
+  if (mem != NULL) {
+    NETSTATS_MEMP_FREE(type);
+    mem_free(mem);
+  }
+}
+
 #endif /* MEMP_MEM_MALLOC */
@@ -245,6 +245,7 @@ pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
     LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_alloc: allocated pbuf %p\n", (void *)p));
     if (p == NULL) {
       PBUF_POOL_IS_EMPTY();
+      NETSTATS_INC(pbuf_alloc_fail);
       return NULL;
     }
     p->type = type;
@@ -277,6 +278,7 @@ pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
       q = (struct pbuf *)memp_malloc(MEMP_PBUF_POOL);
       if (q == NULL) {
         PBUF_POOL_IS_EMPTY();
+        NETSTATS_INC(pbuf_alloc_fail);
         /* free chain so far allocated */
         pbuf_free(p);
         /* bail out unsuccessfully */
@@ -312,6 +314,7 @@ pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
     /* If pbuf is to be allocated in RAM, allocate memory for it. */
     p = (struct pbuf*)mem_malloc(LWIP_MEM_ALIGN_SIZE(SIZEOF_STRUCT_PBUF + offset) + LWIP_MEM_ALIGN_SIZE(length));
     if (p == NULL) {
+      NETSTATS_INC(pbuf_alloc_fail);
       return NULL;
     }
     /* Set up internal structure of the pbuf. */
@@ -333,6 +336,7 @@ pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
       LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_LEVEL_SERIOUS,
                   ("pbuf_alloc: Could not allocate MEMP_PBUF for PBUF_%s.\n",
                   (type == PBUF_ROM) ? "ROM" : "REF"));
+      NETSTATS_INC(pbuf_alloc_fail);
       return NULL;
     }
     /* caller must set this field properly, afterwards */
@@ -38,6 +38,12 @@
 
 #include "lwip/opt.h"
 
+#if ESP_NETSTATS
+#include "lwip/stats.h"
+
+struct stats_net netstats;
+#endif /* ESP_NETSTATS */
+
 #if LWIP_STATS /* don't build if not configured for use in lwipopts.h */
 
 #include "lwip/def.h"
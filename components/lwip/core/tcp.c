@@ -89,7 +89,7 @@ const char * const tcp_state_str[] = {
 
 
 /* last local TCP port */
-static s16_t tcp_port = TCP_LOCAL_PORT_RANGE_START;
+static u16_t tcp_port = TCP_LOCAL_PORT_RANGE_START;
 
 /* Incremented every coarse grained timer shot (typically every 500 ms). */
 u32_t tcp_ticks;
@@ -117,6 +117,129 @@ struct tcp_pcb ** const tcp_pcb_lists[] = {&tcp_listen_pcbs.pcbs, &tcp_bound_pcb
 
 u8_t tcp_active_pcbs_changed;
 
+#if LWIP_TCP_PCB_HASH
+#if (TCP_PCB_HASH_SIZE & (TCP_PCB_HASH_SIZE - 1)) || (TCP_LISTEN_PCB_HASH_SIZE & (TCP_LISTEN_PCB_HASH_SIZE - 1))
+#error "TCP_PCB_HASH_SIZE and TCP_LISTEN_PCB_HASH_SIZE must be powers of 2"
+#endif
+
+/** Active and TIME-WAIT PCBs, hashed by (remote ip, remote port, local port) */
+static struct tcp_pcb *tcp_conn_hash[TCP_PCB_HASH_SIZE];
+/** Listening PCBs, hashed by local port */
+static struct tcp_pcb_listen *tcp_listen_hash[TCP_LISTEN_PCB_HASH_SIZE];
+
+#define TCP_LISTEN_HASH_BUCKET(port) (((port) ^ ((port) >> 8)) & (TCP_LISTEN_PCB_HASH_SIZE - 1))
+
+static u32_t
+tcp_conn_hash_bucket(const ip_addr_t *remote_ip, u16_t remote_port, u16_t local_port)
+{
+  u32_t h = ((u32_t)remote_port << 16) | local_port;
+#if LWIP_IPV6
+  if (IP_IS_V6(remote_ip)) {
+    const ip6_addr_t *ip6 = ip_2_ip6(remote_ip);
+    h ^= ip6->addr[0] ^ ip6->addr[1] ^ ip6->addr[2] ^ ip6->addr[3];
+  } else
+#endif /* LWIP_IPV6 */
+  {
+#if LWIP_IPV4
+    h ^= ip4_addr_get_u32(ip_2_ip4(remote_ip));
+#endif /* LWIP_IPV4 */
+  }
+  /* mix so that all bits of address and ports reach the low bits */
+  h ^= h >> 16;
+  h *= 0x45d9f3bUL;
+  h ^= h >> 16;
+  return h & (TCP_PCB_HASH_SIZE - 1);
+}
+
+/**
+ * Called from TCP_REG: add a PCB that was just put on pcblist to the
+ * matching demux table. PCBs on tcp_bound_pcbs are not hashed.
+ */
+void
+tcp_pcb_hash_add(struct tcp_pcb **pcblist, struct tcp_pcb *pcb)
+{
+  if (pcblist == &tcp_listen_pcbs.pcbs) {
+    struct tcp_pcb_listen *lpcb = (struct tcp_pcb_listen *)pcb;
+    struct tcp_pcb_listen **bucket = &tcp_listen_hash[TCP_LISTEN_HASH_BUCKET(lpcb->local_port)];
+    lpcb->hash_next = *bucket;
+    *bucket = lpcb;
+  } else if ((pcblist == &tcp_active_pcbs) || (pcblist == &tcp_tw_pcbs)) {
+    struct tcp_pcb **bucket = &tcp_conn_hash[tcp_conn_hash_bucket(&pcb->remote_ip,
+      pcb->remote_port, pcb->local_port)];
+    pcb->hash_next = *bucket;
+    *bucket = pcb;
+  }
+}
+
+/**
+ * Called from TCP_RMV: remove a PCB that was just taken off pcblist from
+ * the matching demux table (if it is in there).
+ */
+void
+tcp_pcb_hash_remove(struct tcp_pcb **pcblist, struct tcp_pcb *pcb)
+{
+  if (pcblist == &tcp_listen_pcbs.pcbs) {
+    struct tcp_pcb_listen *lpcb = (struct tcp_pcb_listen *)pcb;
+    struct tcp_pcb_listen **pp = &tcp_listen_hash[TCP_LISTEN_HASH_BUCKET(lpcb->local_port)];
+    for (; *pp != NULL; pp = &(*pp)->hash_next) {
+      if (*pp == lpcb) {
+        *pp = lpcb->hash_next;
+        break;
+      }
+    }
+    lpcb->hash_next = NULL;
+  } else if ((pcblist == &tcp_active_pcbs) || (pcblist == &tcp_tw_pcbs)) {
+    struct tcp_pcb **pp = &tcp_conn_hash[tcp_conn_hash_bucket(&pcb->remote_ip,
+      pcb->remote_port, pcb->local_port)];
+    for (; *pp != NULL; pp = &(*pp)->hash_next) {
+      if (*pp == pcb) {
+        *pp = pcb->hash_next;
+        break;
+      }
+    }
+    pcb->hash_next = NULL;
+  }
+}
+
+/**
+ * Find the active or TIME-WAIT PCB for an incoming segment. An active PCB
+ * is preferred over a TIME-WAIT one with the same connection tuple.
+ */
+struct tcp_pcb *
+tcp_pcb_hash_lookup(const ip_addr_t *remote_ip, u16_t remote_port,
+                    const ip_addr_t *local_ip, u16_t local_port)
+{
+  struct tcp_pcb *pcb;
+  struct tcp_pcb *tw_pcb = NULL;
+
+  for (pcb = tcp_conn_hash[tcp_conn_hash_bucket(remote_ip, remote_port, local_port)];
+       pcb != NULL; pcb = pcb->hash_next) {
+    if (pcb->remote_port == remote_port &&
+        pcb->local_port == local_port &&
+        ip_addr_cmp(&pcb->remote_ip, remote_ip) &&
+        ip_addr_cmp(&pcb->local_ip, local_ip)) {
+      if (pcb->state != TIME_WAIT) {
+        return pcb;
+      }
+      if (tw_pcb == NULL) {
+        tw_pcb = pcb;
+      }
+    }
+  }
+  return tw_pcb;
+}
+
+/**
+ * Return the first PCB in the listen table bucket for local_port. Callers
+ * walk the chain via hash_next and must still compare local_port.
+ */
+struct tcp_pcb_listen *
+tcp_listen_hash_first(u16_t local_port)
+{
+  return tcp_listen_hash[TCP_LISTEN_HASH_BUCKET(local_port)];
+}
+#endif /* LWIP_TCP_PCB_HASH */
+
 /** Timer counter to handle calling slow-timer from tcp_tmr() */
 static u8_t tcp_timer;
 static u8_t tcp_timer_ctr;
@@ -643,6 +766,9 @@ tcp_recved(struct tcp_pcb *pcb, u16_t len)
     pcb->state != LISTEN);
 
   pcb->rcv_wnd += len;
+#if ESP_PER_SOC_TCP_WND && LWIP_TCP_WND_AUTOTUNE
+  pcb->rcv_copied += len;
+#endif
   if (pcb->rcv_wnd > TCP_WND_MAX(pcb)) {
     pcb->rcv_wnd = TCP_WND_MAX(pcb);
   } else if (pcb->rcv_wnd == 0) {
@@ -672,6 +798,147 @@ tcp_recved(struct tcp_pcb *pcb, u16_t len)
          len, pcb->rcv_wnd, TCP_WND_MAX(pcb) - pcb->rcv_wnd));
 }
 
+#if ESP_PER_SOC_TCP_WND
+/**
+ * Change the receive window of a synchronized pcb: the available window
+ * rcv_wnd moves by the same amount, so data that is already buffered
+ * stays accounted for.
+ *
+ * @return how much extra window would be advertised if we sent an update now
+ */
+static u32_t
+tcp_resize_rcv_wnd(struct tcp_pcb *pcb, tcpwnd_size_t wnd)
+{
+  /* compare the windows in effect, which are limited to 64KB if the
+     connection does not use window scaling */
+  tcpwnd_size_t old_wnd = TCP_WND_MAX(pcb);
+  tcpwnd_size_t new_wnd;
+
+  pcb->per_soc_tcp_wnd = wnd;
+  new_wnd = TCP_WND_MAX(pcb);
+  if (new_wnd >= old_wnd) {
+    pcb->rcv_wnd += new_wnd - old_wnd;
+  } else if (pcb->rcv_wnd > old_wnd - new_wnd) {
+    pcb->rcv_wnd -= old_wnd - new_wnd;
+  } else {
+    /* more data is buffered than the new window holds: tcp_recved()
+       reopens the window as it is read */
+    pcb->rcv_wnd = 0;
+  }
+  if (pcb->rcv_wnd > TCP_WND_MAX(pcb)) {
+    pcb->rcv_wnd = TCP_WND_MAX(pcb);
+  }
+  /* the right edge that was already announced is never moved back */
+  return tcp_update_rcv_ann_wnd(pcb);
+}
+
+/**
+ * Set the receive window of a pcb (in bytes). The window is limited to
+ * TCP_WND_LIMIT and, on a connection without window scaling, to 64KB.
+ * Before the connection is synchronized, this sets the window announced
+ * in the SYN; afterwards, a larger window is announced right away.
+ *
+ * @param pcb the tcp_pcb to change (not a listen pcb)
+ * @param wnd the new receive window
+ */
+void
+tcp_set_window(struct tcp_pcb *pcb, u32_t wnd)
+{
+  LWIP_ASSERT("tcp_set_window: invalid for listen-pcbs", pcb->state != LISTEN);
+
+  wnd = LWIP_MIN(LWIP_MAX(wnd, TCP_MSS), TCP_WND_LIMIT);
+  if ((pcb->state == CLOSED) || (pcb->state == SYN_SENT)) {
+    pcb->per_soc_tcp_wnd = (tcpwnd_size_t)wnd;
+    pcb->rcv_wnd = pcb->rcv_ann_wnd = TCPWND_MIN16(TCP_WND(pcb));
+    return;
+  }
+  if (tcp_resize_rcv_wnd(pcb, (tcpwnd_size_t)wnd) >= TCP_WND_UPDATE_THRESHOLD(pcb)) {
+    tcp_ack_now(pcb);
+    tcp_output(pcb);
+  }
+  LWIP_DEBUGF(TCP_DEBUG, ("tcp_set_window: wnd %"TCPWNDSIZE_F", available %"TCPWNDSIZE_F"\n",
+         TCP_WND(pcb), pcb->rcv_wnd));
+}
+
+/**
+ * Set the send buffer size of a pcb (in bytes). The buffer is not made
+ * smaller than the data that is already queued.
+ *
+ * @param pcb the tcp_pcb to change (not a listen pcb)
+ * @param size the new send buffer size
+ */
+void
+tcp_set_sndbuf(struct tcp_pcb *pcb, u32_t size)
+{
+  tcpwnd_size_t queued;
+
+  LWIP_ASSERT("tcp_set_sndbuf: invalid for listen-pcbs", pcb->state != LISTEN);
+
+  queued = TCP_SND_BUF(pcb) - pcb->snd_buf;
+  size = LWIP_MIN(LWIP_MAX(size, LWIP_MAX(2 * TCP_MSS, queued)), TCP_WND_LIMIT);
+  pcb->per_soc_tcp_snd_buf = (tcpwnd_size_t)size;
+  pcb->snd_buf = (tcpwnd_size_t)(size - queued);
+}
+
+#if LWIP_TCP_WND_AUTOTUNE
+/**
+ * Called by tcp_receive() when in-sequence data was accepted. Autotuning
+ * works in rounds: a round ends when the sender has sent everything up to
+ * the right window edge announced at its start, which takes at least one
+ * round trip. If the application has read at least 3/4 of a window during
+ * the round, the window and not the reader limits the throughput: double
+ * the window, as long as enough heap stays free for the data the larger
+ * window lets in. A slow reader only reopens the window by a few segments
+ * per round and does not make it grow.
+ *
+ * Runs as part of the input processing, so the new window goes out with
+ * the ACK that tcp_input() sends for this segment.
+ */
+void
+tcp_wnd_autotune(struct tcp_pcb *pcb)
+{
+  u32_t wnd;
+  u32_t grow;
+  u32_t copied;
+
+  if (!pcb->wnd_autotune) {
+    return;
+  }
+  /* a round ends once the sender has filled the window announced when it
+     began; a stale mark from before the connection existed is too far ahead */
+  if (TCP_SEQ_LT(pcb->rcv_nxt, pcb->rcv_autotune_seq) &&
+      (pcb->rcv_autotune_seq - pcb->rcv_nxt) <= TCP_WND_LIMIT) {
+    return;
+  }
+  copied = pcb->rcv_copied;
+  pcb->rcv_copied = 0;
+  pcb->rcv_autotune_seq = pcb->rcv_ann_right_edge;
+  if (copied < TCP_WND(pcb) - TCP_WND(pcb) / 4) {
+    return;
+  }
+
+  wnd = LWIP_MIN((u32_t)TCP_WND(pcb) * 2, TCP_WND_LIMIT);
+#if LWIP_WND_SCALE
+  if (!(pcb->flags & TF_WND_SCALE)) {
+    wnd = LWIP_MIN(wnd, 0xFFFF);
+  }
+#endif /* LWIP_WND_SCALE */
+  if (wnd <= TCP_WND(pcb)) {
+    return;
+  }
+  grow = wnd - TCP_WND(pcb);
+  if (TCP_WND_AUTOTUNE_FREE_HEAP() < grow + TCP_WND_AUTOTUNE_HEAP_RESERVE) {
+    LWIP_DEBUGF(TCP_DEBUG, ("tcp_wnd_autotune: not growing wnd %"TCPWNDSIZE_F", low on heap\n",
+           TCP_WND(pcb)));
+    return;
+  }
+  tcp_resize_rcv_wnd(pcb, (tcpwnd_size_t)wnd);
+  tcp_ack_now(pcb);
+  LWIP_DEBUGF(TCP_DEBUG, ("tcp_wnd_autotune: wnd %"TCPWNDSIZE_F"\n", TCP_WND(pcb)));
+}
+#endif /* LWIP_TCP_WND_AUTOTUNE */
+#endif /* ESP_PER_SOC_TCP_WND */
+
 /**
  * Allocate a new local TCP port.
  *
@@ -687,10 +954,9 @@ tcp_new_port(void)
 again:
 
 #if ESP_RANDOM_TCP_PORT
-	tcp_port = system_get_time();
-	if (tcp_port < 0)
-		tcp_port = LWIP_RAND() - tcp_port;
-	tcp_port %= TCP_LOCAL_PORT_RANGE_START;
+	/* stay in the local range: anything below could be 0 (no port) or
+	   the port of a listener */
+	tcp_port = TCP_ENSURE_LOCAL_PORT_RANGE(system_get_time());
 #else
       if (tcp_port++ == TCP_LOCAL_PORT_RANGE_END) {
             tcp_port = TCP_LOCAL_PORT_RANGE_START;
@@ -1014,6 +1280,7 @@ tcp_slowtmr_start:
         LWIP_ASSERT("tcp_slowtmr: first pcb == tcp_active_pcbs", tcp_active_pcbs == pcb);
         tcp_active_pcbs = pcb->next;
       }
+      TCP_PCB_HASH_RMV(&tcp_active_pcbs, pcb);
 
       if (pcb_reset) {
         tcp_rst(pcb->snd_nxt, pcb->rcv_nxt, &pcb->local_ip, &pcb->remote_ip,
@@ -1080,6 +1347,7 @@ tcp_slowtmr_start:
         LWIP_ASSERT("tcp_slowtmr: first pcb == tcp_tw_pcbs", tcp_tw_pcbs == pcb);
         tcp_tw_pcbs = pcb->next;
       }
+      TCP_PCB_HASH_RMV(&tcp_tw_pcbs, pcb);
       pcb2 = pcb;
       pcb = pcb->next;
       memp_free(MEMP_TCP_PCB, pcb2);
@@ -1535,6 +1803,9 @@ tcp_alloc(u8_t prio)
 #if ESP_PER_SOC_TCP_WND
     pcb->per_soc_tcp_wnd = TCP_WND_DEFAULT;
     pcb->per_soc_tcp_snd_buf = TCP_SND_BUF_DEFAULT;
+#if LWIP_TCP_WND_AUTOTUNE
+    pcb->wnd_autotune = 1;
+#endif
 #endif
 
     pcb->prio = prio;
@@ -62,8 +62,16 @@
 
 /** Initial CWND calculation as defined RFC 2581 */
 #define LWIP_TCP_CALC_INITIAL_CWND(mss) LWIP_MIN((4U * (mss)), LWIP_MAX((2U * (mss)), 4380U));
-/** Initial slow start threshold value: we use the full window */
+/** Initial slow start threshold value: we use the full window. With window
+    scaling, the window offered at connection setup may be far below the one
+    used later, so start arbitrarily high as RFC 5681 suggests (the largest
+    window that can be advertised). */
+#if LWIP_WND_SCALE
+#define LWIP_TCP_INITIAL_SSTHRESH(pcb)  (((pcb)->flags & TF_WND_SCALE) ? \
+                                         (tcpwnd_size_t)(0xFFFFUL << 14) : (pcb)->snd_wnd)
+#else /* LWIP_WND_SCALE */
 #define LWIP_TCP_INITIAL_SSTHRESH(pcb)  ((pcb)->snd_wnd)
+#endif /* LWIP_WND_SCALE */
 
 /* These variables are global to all functions involved in the input
    processing of TCP segments. They are set by the tcp_input()
@@ -213,6 +221,17 @@ tcp_input(struct pbuf *p, struct netif *inp)
      for an active connection. */
   prev = NULL;
 
+#if LWIP_TCP_PCB_HASH
+  /* Active and TIME-WAIT PCBs share one connection table. */
+  pcb = tcp_pcb_hash_lookup(ip_current_src_addr(), tcphdr->src,
+                            ip_current_dest_addr(), tcphdr->dest);
+  if ((pcb != NULL) && (pcb->state == TIME_WAIT)) {
+    LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packed for TIME_WAITing connection.\n"));
+    tcp_timewait_input(pcb);
+    pbuf_free(p);
+    return;
+  }
+#else /* LWIP_TCP_PCB_HASH */
   for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
     LWIP_ASSERT("tcp_input: active pcb->state != CLOSED", pcb->state != CLOSED);
     LWIP_ASSERT("tcp_input: active pcb->state != TIME-WAIT", pcb->state != TIME_WAIT);
@@ -237,8 +256,10 @@ tcp_input(struct pbuf *p, struct netif *inp)
     }
     prev = pcb;
   }
+#endif /* LWIP_TCP_PCB_HASH */
 
   if (pcb == NULL) {
+#if !LWIP_TCP_PCB_HASH
     /* If it did not go to an active connection, we check the connections
        in the TIME-WAIT state. */
     for (pcb = tcp_tw_pcbs; pcb != NULL; pcb = pcb->next) {
@@ -256,11 +277,16 @@ tcp_input(struct pbuf *p, struct netif *inp)
         return;
       }
     }
+#endif /* !LWIP_TCP_PCB_HASH */
 
     /* Finally, if we still did not get a match, we check all PCBs that
        are LISTENing for incoming connections. */
     prev = NULL;
+#if LWIP_TCP_PCB_HASH
+    for (lpcb = tcp_listen_hash_first(tcphdr->dest); lpcb != NULL; lpcb = lpcb->hash_next) {
+#else /* LWIP_TCP_PCB_HASH */
     for (lpcb = tcp_listen_pcbs.listen_pcbs; lpcb != NULL; lpcb = lpcb->next) {
+#endif /* LWIP_TCP_PCB_HASH */
       if (lpcb->local_port == tcphdr->dest) {
         if (IP_IS_ANY_TYPE_VAL(lpcb->local_ip)) {
           /* found an ANY TYPE (IPv4/IPv6) match */
@@ -296,6 +322,7 @@ tcp_input(struct pbuf *p, struct netif *inp)
     }
 #endif /* SO_REUSE */
     if (lpcb != NULL) {
+#if !LWIP_TCP_PCB_HASH
       /* Move this PCB to the front of the list so that subsequent
          lookups will be faster (we exploit locality in TCP segment
          arrivals). */
@@ -308,6 +335,7 @@ tcp_input(struct pbuf *p, struct netif *inp)
       } else {
         TCP_STATS_INC(tcp.cachehit);
       }
+#endif /* !LWIP_TCP_PCB_HASH */
 
       LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packed for LISTENing connection.\n"));
       tcp_listen_input(lpcb);
@@ -1412,6 +1440,9 @@ tcp_receive(struct tcp_pcb *pcb)
         pcb->rcv_wnd -= tcplen;
 
         tcp_update_rcv_ann_wnd(pcb);
+#if ESP_PER_SOC_TCP_WND && LWIP_TCP_WND_AUTOTUNE
+        tcp_wnd_autotune(pcb);
+#endif
 
         /* If there is data in the segment, we make preparations to
            pass this up to the application. The ->recv_data variable
@@ -1636,7 +1667,17 @@ tcp_receive(struct tcp_pcb *pcb)
           }
         }
 #endif /* TCP_OOSEQ_MAX_BYTES || TCP_OOSEQ_MAX_PBUFS */
+#if ESP_NETSTATS
+        {
+          u32_t ooseq_len = 0;
+          for (next = pcb->ooseq; next != NULL; next = next->next) {
+            ooseq_len++;
+          }
+          NETSTATS_MAX(tcp_ooseq_max, ooseq_len);
+        }
+#endif /* ESP_NETSTATS */
 #endif /* TCP_QUEUE_OOSEQ */
+        NETSTATS_INC(tcp_ooseq);
       }
     } else {
       /* The incoming segment is not within the window. */
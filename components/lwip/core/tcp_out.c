@@ -1380,6 +1380,7 @@ tcp_rexmit_rto(struct tcp_pcb *pcb)
 
   /* increment number of retransmissions */
   ++pcb->nrtx;
+  NETSTATS_INC(tcp_rexmit_rto);
 
   /* Don't take any RTT measurements after retransmitting. */
   pcb->rttest = 0;
@@ -1452,6 +1453,7 @@ tcp_rexmit_fast(struct tcp_pcb *pcb)
                  (u16_t)pcb->dupacks, pcb->lastack,
                  ntohl(pcb->unacked->tcphdr->seqno)));
     tcp_rexmit(pcb);
+    NETSTATS_INC(tcp_rexmit_fast);
 
     /* Set ssthresh to half of the minimum of the current
      * cwnd and the advertised window */
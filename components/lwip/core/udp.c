@@ -82,6 +82,43 @@ static u16_t udp_port = UDP_LOCAL_PORT_RANGE_START;
 /* exported in udp.h (was static) */
 struct udp_pcb *udp_pcbs;
 
+#if LWIP_UDP_PCB_HASH
+#if UDP_PCB_HASH_SIZE & (UDP_PCB_HASH_SIZE - 1)
+#error "UDP_PCB_HASH_SIZE must be a power of 2"
+#endif
+
+/** PCBs on udp_pcbs, hashed by local port */
+static struct udp_pcb *udp_pcb_hash[UDP_PCB_HASH_SIZE];
+
+#define UDP_HASH_BUCKET(port) (((port) ^ ((port) >> 8)) & (UDP_PCB_HASH_SIZE - 1))
+
+static void
+udp_pcb_hash_add(struct udp_pcb *pcb)
+{
+  struct udp_pcb **bucket = &udp_pcb_hash[UDP_HASH_BUCKET(pcb->local_port)];
+  pcb->hash_next = *bucket;
+  *bucket = pcb;
+}
+
+static void
+udp_pcb_hash_remove(struct udp_pcb *pcb)
+{
+  struct udp_pcb **pp;
+  for (pp = &udp_pcb_hash[UDP_HASH_BUCKET(pcb->local_port)]; *pp != NULL; pp = &(*pp)->hash_next) {
+    if (*pp == pcb) {
+      *pp = pcb->hash_next;
+      break;
+    }
+  }
+  pcb->hash_next = NULL;
+}
+#define UDP_PCB_HASH_ADD(pcb)  udp_pcb_hash_add(pcb)
+#define UDP_PCB_HASH_RMV(pcb)  udp_pcb_hash_remove(pcb)
+#else /* LWIP_UDP_PCB_HASH */
+#define UDP_PCB_HASH_ADD(pcb)
+#define UDP_PCB_HASH_RMV(pcb)
+#endif /* LWIP_UDP_PCB_HASH */
+
 /**
  * Initialize this module.
  */
@@ -265,7 +302,11 @@ udp_input(struct pbuf *p, struct netif *inp)
    * 'Perfect match' pcbs (connected to the remote port & ip address) are
    * preferred. If no perfect match is found, the first unconnected pcb that
    * matches the local port and ip address gets the datagram. */
+#if LWIP_UDP_PCB_HASH
+  for (pcb = udp_pcb_hash[UDP_HASH_BUCKET(dest)]; pcb != NULL; pcb = pcb->hash_next) {
+#else /* LWIP_UDP_PCB_HASH */
   for (pcb = udp_pcbs; pcb != NULL; pcb = pcb->next) {
+#endif /* LWIP_UDP_PCB_HASH */
     /* print the PCB local and remote address */
     LWIP_DEBUGF(UDP_DEBUG, ("pcb ("));
     ip_addr_debug_print(UDP_DEBUG, &pcb->local_ip);
@@ -287,6 +328,7 @@ udp_input(struct pbuf *p, struct netif *inp)
           (ip_addr_isany_val(pcb->remote_ip) ||
           ip_addr_cmp(&pcb->remote_ip, ip_current_src_addr()))) {
         /* the first fully matching PCB */
+#if !LWIP_UDP_PCB_HASH
         if (prev != NULL) {
           /* move the pcb to the front of udp_pcbs so that is
              found faster next time */
@@ -296,12 +338,17 @@ udp_input(struct pbuf *p, struct netif *inp)
         } else {
           UDP_STATS_INC(udp.cachehit);
         }
+#endif /* !LWIP_UDP_PCB_HASH */
         break;
       }
     }
 
     prev = pcb;
   }
+#if LWIP_UDP_PCB_HASH
+  /* no move-to-front within hash buckets */
+  LWIP_UNUSED_ARG(prev);
+#endif /* LWIP_UDP_PCB_HASH */
   /* no fully matching pcb found? then look for an unconnected pcb */
   if (pcb == NULL) {
     pcb = uncon_pcb;
@@ -379,7 +426,11 @@ udp_input(struct pbuf *p, struct netif *inp)
         struct udp_pcb *mpcb;
         u8_t p_header_changed = 0;
         s16_t hdrs_len = (s16_t)(ip_current_header_tot_len() + UDP_HLEN);
+#if LWIP_UDP_PCB_HASH
+        for (mpcb = udp_pcb_hash[UDP_HASH_BUCKET(dest)]; mpcb != NULL; mpcb = mpcb->hash_next) {
+#else /* LWIP_UDP_PCB_HASH */
         for (mpcb = udp_pcbs; mpcb != NULL; mpcb = mpcb->next) {
+#endif /* LWIP_UDP_PCB_HASH */
           if (mpcb != pcb) {
             /* compare PCB local addr+port to UDP destination addr+port */
             if ((mpcb->local_port == dest) &&
@@ -957,6 +1008,10 @@ udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
 
   ip_addr_set_ipaddr(&pcb->local_ip, ipaddr);
 
+  if (rebind) {
+    /* the pcb may be moving to another port bucket */
+    UDP_PCB_HASH_RMV(pcb);
+  }
   pcb->local_port = port;
   mib2_udp_bind(pcb);
   /* pcb not active yet? */
@@ -965,6 +1020,7 @@ udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
     pcb->next = udp_pcbs;
     udp_pcbs = pcb;
   }
+  UDP_PCB_HASH_ADD(pcb);
   LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, ("udp_bind: bound to "));
   ip_addr_debug_print(UDP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, &pcb->local_ip);
   LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, (", port %"U16_F")\n", pcb->local_port));
@@ -1023,6 +1079,7 @@ udp_connect(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
   /* PCB not yet on the list, add PCB now */
   pcb->next = udp_pcbs;
   udp_pcbs = pcb;
+  UDP_PCB_HASH_ADD(pcb);
   return ERR_OK;
 }
 
@@ -1087,6 +1144,7 @@ udp_remove(struct udp_pcb *pcb)
       }
     }
   }
+  UDP_PCB_HASH_RMV(pcb);
   memp_free(MEMP_UDP_PCB, pcb);
 }
 
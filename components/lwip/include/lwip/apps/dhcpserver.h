@@ -169,17 +169,6 @@ enum dhcps_offer_option{
 #define DHCPS_MAX_LEASE 0x64
 #define DHCPS_LEASE_TIME_DEF	(120)
 
-struct dhcps_pool{
-	ip4_addr_t ip;
-	u8_t mac[6];
-	u32_t lease_timer;
-};
-
-typedef struct _list_node{
-	void *pnode;
-	struct _list_node *pnext;
-}list_node;
-
 typedef u32_t dhcps_time_t;
 typedef u8_t dhcps_offer_t;
 
@@ -194,6 +183,7 @@ typedef struct {
 void dhcps_start(struct netif *netif, ip4_addr_t ip);
 void dhcps_stop(struct netif *netif);
 void *dhcps_option_info(u8_t op_id, u32_t opt_len);
+void dhcps_coarse_tmr(void);
 bool dhcp_search_ip_on_mac(u8_t *mac, ip4_addr_t *ip);
 
 #endif
@@ -86,6 +86,10 @@ static inline void memp_free(int type, void *mem)
 
 //#define memp_malloc(type)     mem_malloc(memp_pools[type]->size); ESP_CNT_MEM_MALLOC_INC(type)
 //#define memp_free(type, mem)  mem_free(mem); ESP_CNT_MEM_FREE_INC(type)
+#elif ESP_NETSTATS
+/* in memp.c, counting the elements in use */
+void *memp_malloc(memp_t type);
+void  memp_free(memp_t type, void *mem);
 #else
 #define memp_malloc(type)     mem_malloc(memp_pools[type]->size)
 #define memp_free(type, mem)  mem_free(mem)
@@ -962,6 +962,22 @@
 #define LWIP_NETBUF_RECVINFO            0
 #endif
 
+/**
+ * LWIP_UDP_PCB_HASH==1: Index bound UDP PCBs by local port so udp_input()
+ * only looks at PCBs bound to the destination port instead of walking
+ * udp_pcbs. Costs one pointer per PCB plus UDP_PCB_HASH_SIZE pointers.
+ */
+#ifndef LWIP_UDP_PCB_HASH
+#define LWIP_UDP_PCB_HASH               0
+#endif
+
+/**
+ * UDP_PCB_HASH_SIZE: Number of buckets in the UDP port table (power of 2).
+ */
+#ifndef UDP_PCB_HASH_SIZE
+#define UDP_PCB_HASH_SIZE               32
+#endif
+
 /*
    ---------------------------------
    ---------- TCP options ----------
@@ -1092,6 +1108,30 @@
 #define TCP_LISTEN_BACKLOG              0
 #endif
 
+/**
+ * LWIP_TCP_PCB_HASH==1: Index active and TIME-WAIT PCBs by connection
+ * (remote ip, remote port, local port) and listening PCBs by local port, so
+ * tcp_input() does not have to walk the PCB lists for every segment.
+ * Costs one pointer per PCB plus the bucket arrays below.
+ */
+#ifndef LWIP_TCP_PCB_HASH
+#define LWIP_TCP_PCB_HASH               0
+#endif
+
+/**
+ * TCP_PCB_HASH_SIZE: Number of buckets in the TCP connection table (power of 2).
+ */
+#ifndef TCP_PCB_HASH_SIZE
+#define TCP_PCB_HASH_SIZE               64
+#endif
+
+/**
+ * TCP_LISTEN_PCB_HASH_SIZE: Number of buckets in the TCP listen table (power of 2).
+ */
+#ifndef TCP_LISTEN_PCB_HASH_SIZE
+#define TCP_LISTEN_PCB_HASH_SIZE        16
+#endif
+
 /**
  * The maximum allowed backlog for TCP listen netconns.
  * This backlog is used unless another is explicitly specified.
@@ -1162,6 +1202,40 @@
 #define TCP_RCV_SCALE                   0
 #endif
 
+/**
+ * TCP_WND_LIMIT: The largest receive window a pcb may use when windows are
+ * sized per socket (ESP_PER_SOC_TCP_WND), either with tcp_set_window() or
+ * by LWIP_TCP_WND_AUTOTUNE. It must be representable with TCP_RCV_SCALE,
+ * i.e. at most 0xFFFF << TCP_RCV_SCALE.
+ */
+#ifndef TCP_WND_LIMIT
+#define TCP_WND_LIMIT                   (0xFFFFUL << TCP_RCV_SCALE)
+#endif
+
+/**
+ * LWIP_TCP_WND_AUTOTUNE==1: Grow the receive window of a pcb (up to
+ * TCP_WND_LIMIT) when the sender keeps running into the right window edge
+ * while the application reads about a window each time, i.e. when the
+ * window and not the reader limits the throughput. Requires
+ * ESP_PER_SOC_TCP_WND.
+ */
+#ifndef LWIP_TCP_WND_AUTOTUNE
+#define LWIP_TCP_WND_AUTOTUNE           0
+#endif
+
+/**
+ * TCP_WND_AUTOTUNE_HEAP_RESERVE: Autotuning does not grow a window if less
+ * than this many bytes of heap would be left for data the bigger window lets
+ * in. The free heap is read with TCP_WND_AUTOTUNE_FREE_HEAP(), which the
+ * port should define; the default does not bound the growth.
+ */
+#ifndef TCP_WND_AUTOTUNE_HEAP_RESERVE
+#define TCP_WND_AUTOTUNE_HEAP_RESERVE   32768
+#endif
+#ifndef TCP_WND_AUTOTUNE_FREE_HEAP
+#define TCP_WND_AUTOTUNE_FREE_HEAP()    (TCP_WND_AUTOTUNE_HEAP_RESERVE + TCP_WND_LIMIT)
+#endif
+
 
 /*
    ----------------------------------
@@ -1567,6 +1641,42 @@
 #define LWIP_SOCKET_OFFSET              0
 #endif
 
+/**
+ * LWIP_SOCKET_EPOLL==1: Enable lwip_epoll_create(), lwip_epoll_ctl() and
+ * lwip_epoll_wait(). Sockets registered with an epoll instance are put on
+ * its ready list by the event callback, so waiting costs O(ready sockets)
+ * instead of the O(sockets * waiting tasks) of select().
+ */
+#ifndef LWIP_SOCKET_EPOLL
+#define LWIP_SOCKET_EPOLL               0
+#endif
+
+/**
+ * LWIP_SOCKET_EPOLL_MAX: the number of epoll instances that can be open at
+ * the same time. Their descriptors follow the socket descriptors.
+ */
+#ifndef LWIP_SOCKET_EPOLL_MAX
+#define LWIP_SOCKET_EPOLL_MAX           2
+#endif
+
+/**
+ * LWIP_SOCKET_MMSG==1: Enable lwip_sendmmsg() and lwip_recvmmsg() to move
+ * several datagrams per call. lwip_sendmmsg() passes up to
+ * LWIP_SOCKET_MMSG_BATCH datagrams to the tcpip_thread in one message.
+ */
+#ifndef LWIP_SOCKET_MMSG
+#define LWIP_SOCKET_MMSG                0
+#endif
+
+/**
+ * LWIP_SOCKET_MMSG_BATCH: the number of datagrams lwip_sendmmsg() sends per
+ * call into the tcpip_thread. Each one costs a struct netbuf on the stack
+ * of the calling task.
+ */
+#ifndef LWIP_SOCKET_MMSG_BATCH
+#define LWIP_SOCKET_MMSG_BATCH          8
+#endif
+
 /**
  * LWIP_TCP_KEEPALIVE==1: Enable TCP_KEEPIDLE, TCP_KEEPINTVL and TCP_KEEPCNT
  * options processing. Note that TCP_KEEPIDLE and TCP_KEEPINTVL have to be set
@@ -3019,4 +3129,27 @@
 #define ESP_THREAD_SAFE_DEBUG               0
 #endif
 
+/**
+ * ESP_NETSTATS==1: Keep the small set of counters in struct stats_net
+ * (see stats.h): frames, pbuf allocation failures, full mailboxes, TCP
+ * retransmissions and out-of-sequence segments, and memp high-water marks.
+ * Unlike LWIP_STATS they are cheap enough to leave on: the event counters
+ * are plain increments of a per-core copy.
+ */
+#ifndef ESP_NETSTATS
+#define ESP_NETSTATS                        0
+#endif
+
+/**
+ * LWIP_NUM_CORES: Number of CPU cores the stack may run on, and
+ * LWIP_CORE_ID(): the core of the caller (0..LWIP_NUM_CORES-1). Used for
+ * per-core counters.
+ */
+#ifndef LWIP_NUM_CORES
+#define LWIP_NUM_CORES                      1
+#endif
+#ifndef LWIP_CORE_ID
+#define LWIP_CORE_ID()                      0
+#endif
+
 #endif /* LWIP_HDR_OPT_H */
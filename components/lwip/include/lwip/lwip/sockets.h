@@ -155,6 +155,14 @@ struct msghdr {
   int           msg_flags;
 };
 
+#if LWIP_SOCKET_MMSG
+/* Used by lwip_sendmmsg/lwip_recvmmsg: one message and its length */
+struct mmsghdr {
+  struct msghdr msg_hdr;
+  unsigned int  msg_len;
+};
+#endif /* LWIP_SOCKET_MMSG */
+
 /* Socket protocol types (TCP/UDP/RAW) */
 #define SOCK_STREAM     1
 #define SOCK_DGRAM      2
@@ -232,6 +240,9 @@ struct linger {
 #define MSG_OOB        0x04    /* Unimplemented: Requests out-of-band data. The significance and semantics of out-of-band data are protocol-specific */
 #define MSG_DONTWAIT   0x08    /* Nonblocking i/o for this operation only */
 #define MSG_MORE       0x10    /* Sender will send more */
+#if LWIP_SOCKET_MMSG
+#define MSG_WAITFORONE 0x40    /* recvmmsg: only wait for the first datagram (lwip_recvmmsg always does) */
+#endif /* LWIP_SOCKET_MMSG */
 
 
 /*
@@ -250,8 +261,11 @@ struct linger {
 #define TCP_KEEPINTVL  0x04    /* set pcb->keep_intvl - Use seconds for get/setsockopt */
 #define TCP_KEEPCNT    0x05    /* set pcb->keep_cnt   - Use number of probes sent for get/setsockopt */
 #if ESP_PER_SOC_TCP_WND
-#define TCP_WINDOW     0x06    /* set pcb->per_soc_tcp_wnd */
-#define TCP_SNDBUF     0x07    /* set pcb->per_soc_tcp_snd_buf */
+#define TCP_WINDOW     0x06    /* set pcb->per_soc_tcp_wnd - Use number of MSS for setsockopt, bytes for getsockopt */
+#define TCP_SNDBUF     0x07    /* set pcb->per_soc_tcp_snd_buf - Use number of MSS for setsockopt, bytes for getsockopt */
+#if LWIP_TCP_WND_AUTOTUNE
+#define TCP_WINDOW_AUTOTUNE 0x08 /* set pcb->wnd_autotune - cleared by setting TCP_WINDOW */
+#endif
 #endif
 
 #endif /* LWIP_TCP */
@@ -428,6 +442,31 @@ typedef struct fd_set
 #error LWIP_SOCKET_OFFSET does not work with external FD_SET!
 #endif /* FD_SET */
 
+#if LWIP_SOCKET_EPOLL
+/* Events for lwip_epoll_ctl/lwip_epoll_wait (values as on Linux) */
+#define EPOLLIN       0x001U
+#define EPOLLOUT      0x004U
+#define EPOLLERR      0x008U
+#define EPOLLONESHOT  (1U << 30)
+#define EPOLLET       (1U << 31)
+
+/* Operations for lwip_epoll_ctl */
+#define EPOLL_CTL_ADD 1
+#define EPOLL_CTL_DEL 2
+#define EPOLL_CTL_MOD 3
+
+typedef union epoll_data {
+  void  *ptr;
+  int    fd;
+  u32_t  u32;
+} epoll_data_t;
+
+struct epoll_event {
+  u32_t        events;  /* EPOLLIN/EPOLLOUT/EPOLLERR, plus EPOLLET/EPOLLONESHOT for ctl */
+  epoll_data_t data;    /* returned unchanged by lwip_epoll_wait */
+};
+#endif /* LWIP_SOCKET_EPOLL */
+
 /** LWIP_TIMEVAL_PRIVATE: if you want to use the struct timeval provided
  * by your system, set this to 0 and include <sys/time.h> in cc.h */
 #ifndef LWIP_TIMEVAL_PRIVATE
@@ -467,6 +506,15 @@ void lwip_socket_thread_cleanup(void); /* LWIP_NETCONN_SEM_PER_THREAD==1: destro
 #define lwip_socket       socket
 #define lwip_select       select
 #define lwip_ioctlsocket  ioctl
+#if LWIP_SOCKET_MMSG
+#define lwip_sendmmsg     sendmmsg
+#define lwip_recvmmsg     recvmmsg
+#endif /* LWIP_SOCKET_MMSG */
+#if LWIP_SOCKET_EPOLL
+#define lwip_epoll_create epoll_create
+#define lwip_epoll_ctl    epoll_ctl
+#define lwip_epoll_wait   epoll_wait
+#endif /* LWIP_SOCKET_EPOLL */
 
 #if LWIP_POSIX_SOCKETS_IO_NAMES
 #define lwip_read         read
@@ -505,6 +553,16 @@ int lwip_select(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptse
                 struct timeval *timeout);
 int lwip_ioctl(int s, long cmd, void *argp);
 int lwip_fcntl(int s, int cmd, int val);
+#if LWIP_SOCKET_MMSG
+int lwip_sendmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags);
+int lwip_recvmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags,
+                  struct timeval *timeout);
+#endif /* LWIP_SOCKET_MMSG */
+#if LWIP_SOCKET_EPOLL
+int lwip_epoll_create(int size);
+int lwip_epoll_ctl(int epfd, int op, int s, struct epoll_event *event);
+int lwip_epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout);
+#endif /* LWIP_SOCKET_EPOLL */
 
 #if LWIP_COMPAT_SOCKETS
 #if LWIP_COMPAT_SOCKETS != 2
@@ -536,6 +594,11 @@ int lwip_select(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptse
                 struct timeval *timeout);
 int lwip_ioctl_r(int s, long cmd, void *argp);
 int lwip_fcntl_r(int s, int cmd, int val);
+#if LWIP_SOCKET_MMSG
+int lwip_sendmmsg_r(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags);
+int lwip_recvmmsg_r(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags,
+                    struct timeval *timeout);
+#endif /* LWIP_SOCKET_MMSG */
 
 #define accept(s,addr,addrlen)                    lwip_accept_r(s,addr,addrlen)
 #define bind(s,name,namelen)                      lwip_bind_r(s,name,namelen)
@@ -555,6 +618,15 @@ int lwip_fcntl_r(int s, int cmd, int val);
 #define socket(domain,type,protocol)              lwip_socket(domain,type,protocol)
 #define select(maxfdp1,readset,writeset,exceptset,timeout)     lwip_select(maxfdp1,readset,writeset,exceptset,timeout)
 #define ioctlsocket(s,cmd,argp)                   lwip_ioctl_r(s,cmd,argp)
+#if LWIP_SOCKET_MMSG
+#define sendmmsg(s,msgvec,vlen,flags)             lwip_sendmmsg_r(s,msgvec,vlen,flags)
+#define recvmmsg(s,msgvec,vlen,flags,timeout)     lwip_recvmmsg_r(s,msgvec,vlen,flags,timeout)
+#endif /* LWIP_SOCKET_MMSG */
+#if LWIP_SOCKET_EPOLL
+#define epoll_create(size)                        lwip_epoll_create(size)
+#define epoll_ctl(epfd,op,s,event)                lwip_epoll_ctl(epfd,op,s,event)
+#define epoll_wait(epfd,events,maxevents,timeout) lwip_epoll_wait(epfd,events,maxevents,timeout)
+#endif /* LWIP_SOCKET_EPOLL */
 
 #if LWIP_POSIX_SOCKETS_IO_NAMES
 #define read(s,mem,len)                           lwip_read_r(s,mem,len)
@@ -585,6 +657,15 @@ int lwip_fcntl_r(int s, int cmd, int val);
 #define socket(domain,type,protocol)              lwip_socket(domain,type,protocol)
 #define select(maxfdp1,readset,writeset,exceptset,timeout)     lwip_select(maxfdp1,readset,writeset,exceptset,timeout)
 #define ioctlsocket(s,cmd,argp)                   lwip_ioctl(s,cmd,argp)
+#if LWIP_SOCKET_MMSG
+#define sendmmsg(s,msgvec,vlen,flags)             lwip_sendmmsg(s,msgvec,vlen,flags)
+#define recvmmsg(s,msgvec,vlen,flags,timeout)     lwip_recvmmsg(s,msgvec,vlen,flags,timeout)
+#endif /* LWIP_SOCKET_MMSG */
+#if LWIP_SOCKET_EPOLL
+#define epoll_create(size)                        lwip_epoll_create(size)
+#define epoll_ctl(epfd,op,s,event)                lwip_epoll_ctl(epfd,op,s,event)
+#define epoll_wait(epfd,events,maxevents,timeout) lwip_epoll_wait(epfd,events,maxevents,timeout)
+#endif /* LWIP_SOCKET_EPOLL */
 
 #if LWIP_POSIX_SOCKETS_IO_NAMES
 #define read(s,mem,len)                           lwip_read(s,mem,len)
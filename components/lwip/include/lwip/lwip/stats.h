@@ -466,6 +466,44 @@ void stats_init(void);
 #define ESP_STATS_DISPLAY()
 #endif
 
+#if ESP_NETSTATS
+/** Event counters of one core. Each core only increments its own copy, so
+ * no lock or atomic operation is needed; an increment interrupted by a task
+ * switch on the same core may get lost once in a while. */
+struct stats_netcore {
+  u32_t rx_frames;        /* frames handed to ethernet_input() */
+  u32_t tx_frames;        /* frames sent by ethernet_output() */
+  u32_t pbuf_alloc_fail;  /* pbuf_alloc() returned NULL */
+  u32_t mbox_post_fail;   /* sys_mbox_trypost() found the mailbox full */
+  u32_t tcp_rexmit_rto;   /* retransmission timeouts */
+  u32_t tcp_rexmit_fast;  /* fast retransmits */
+  u32_t tcp_ooseq;        /* out-of-sequence segments received */
+};
+
+/** Always-on counters, see ESP_NETSTATS. */
+struct stats_net {
+  struct stats_netcore core[LWIP_NUM_CORES];
+  u32_t tcp_ooseq_max;       /* longest out-of-sequence queue of a pcb */
+  u32_t memp_used[MEMP_MAX]; /* elements in use, updated atomically */
+  u32_t memp_max[MEMP_MAX];  /* high-water mark of memp_used */
+};
+
+extern struct stats_net netstats;
+
+#define NETSTATS_INC(x) (++netstats.core[LWIP_CORE_ID()].x)
+#define NETSTATS_MAX(x, val) do { if (netstats.x < (val)) { netstats.x = (val); } } while(0)
+#define NETSTATS_MEMP_ALLOC(type) do { \
+    u32_t used_ = __atomic_add_fetch(&netstats.memp_used[type], 1, __ATOMIC_RELAXED); \
+    NETSTATS_MAX(memp_max[type], used_); \
+  } while(0)
+#define NETSTATS_MEMP_FREE(type) __atomic_sub_fetch(&netstats.memp_used[type], 1, __ATOMIC_RELAXED)
+#else
+#define NETSTATS_INC(x)
+#define NETSTATS_MAX(x, val)
+#define NETSTATS_MEMP_ALLOC(type)
+#define NETSTATS_MEMP_FREE(type)
+#endif
+
 /* Display of statistics */
 #if LWIP_STATS_DISPLAY
 void stats_display(void);
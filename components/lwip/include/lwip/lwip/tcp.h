@@ -168,11 +168,18 @@ enum tcp_state {
 #define DEF_ACCEPT_CALLBACK
 #endif /* LWIP_CALLBACK_API */
 
+#if LWIP_TCP_PCB_HASH
+#define DEF_HASH_NEXT(type)  type *hash_next; /* for the demux hash chain */
+#else /* LWIP_TCP_PCB_HASH */
+#define DEF_HASH_NEXT(type)
+#endif /* LWIP_TCP_PCB_HASH */
+
 /**
  * members common to struct tcp_pcb and struct tcp_listen_pcb
  */
 #define TCP_PCB_COMMON(type) \
   type *next; /* for the linked list */ \
+  DEF_HASH_NEXT(type) \
   void *callback_arg; \
   /* the accept callback for listen- and normal pcbs, if LWIP_CALLBACK_API */ \
   DEF_ACCEPT_CALLBACK \
@@ -239,6 +246,11 @@ struct tcp_pcb {
 #if ESP_PER_SOC_TCP_WND
   tcpwnd_size_t per_soc_tcp_wnd; /* per tcp socket tcp window size */
   tcpwnd_size_t per_soc_tcp_snd_buf; /* per tcp socket tcp send buffer size */
+#if LWIP_TCP_WND_AUTOTUNE
+  u8_t wnd_autotune; /* per_soc_tcp_wnd is grown by tcp_wnd_autotune() */
+  u32_t rcv_copied; /* bytes passed to tcp_recved() in the current autotune round */
+  u32_t rcv_autotune_seq; /* the autotune round ends when rcv_nxt reaches this */
+#endif
 #endif
 
   /* congestion avoidance/control variables */
@@ -395,6 +407,15 @@ err_t            tcp_write   (struct tcp_pcb *pcb, const void *dataptr, u16_t le
 
 void             tcp_setprio (struct tcp_pcb *pcb, u8_t prio);
 
+#if ESP_PER_SOC_TCP_WND
+void             tcp_set_window(struct tcp_pcb *pcb, u32_t wnd);
+void             tcp_set_sndbuf(struct tcp_pcb *pcb, u32_t size);
+#if LWIP_TCP_WND_AUTOTUNE
+#define          tcp_set_wnd_autotune(pcb, on) ((pcb)->wnd_autotune = ((on) != 0))
+#define          tcp_get_wnd_autotune(pcb)     ((pcb)->wnd_autotune)
+#endif /* LWIP_TCP_WND_AUTOTUNE */
+#endif /* ESP_PER_SOC_TCP_WND */
+
 #define TCP_PRIO_MIN    1
 #define TCP_PRIO_NORMAL 64
 #define TCP_PRIO_MAX    127
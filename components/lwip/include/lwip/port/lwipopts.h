@@ -33,6 +33,7 @@
 #define __LWIPOPTS_H__
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <time.h>
 #include <sys/time.h>
 #include <sys/fcntl.h>
@@ -115,7 +116,7 @@
  * MEMP_NUM_TCP_PCB: the number of simulatenously active TCP connections.
  * (requires the LWIP_TCP option)
  */
-#define MEMP_NUM_TCP_PCB                16
+#define MEMP_NUM_TCP_PCB                CONFIG_LWIP_MAX_ACTIVE_TCP
 
 /**
  * MEMP_NUM_TCP_PCB_LISTEN: the number of listening TCP connections.
@@ -260,6 +261,12 @@
    ---------- UDP options ----------
    ---------------------------------
 */
+/**
+ * LWIP_UDP_PCB_HASH==1: demultiplex incoming datagrams via a port hash
+ * table instead of walking udp_pcbs. This option is set via menuconfig.
+ */
+#define LWIP_UDP_PCB_HASH               CONFIG_LWIP_PCB_HASH
+
 /*
    ---------------------------------
    ---------- TCP options ----------
@@ -296,6 +303,41 @@
  */
 #define TCP_LISTEN_BACKLOG              1
 
+/**
+ * LWIP_TCP_PCB_HASH==1: demultiplex incoming segments via hash tables
+ * instead of walking the PCB lists. This option is set via menuconfig.
+ */
+#define LWIP_TCP_PCB_HASH               CONFIG_LWIP_PCB_HASH
+
+/**
+ * LWIP_WND_SCALE and TCP_RCV_SCALE: window scaling (RFC 7323), so that a
+ * socket can use a receive window above 64KB. This option is set via
+ * menuconfig.
+ */
+#if CONFIG_LWIP_WND_SCALE
+#define LWIP_WND_SCALE                  1
+#define TCP_RCV_SCALE                   CONFIG_LWIP_TCP_RCV_SCALE
+#endif
+
+/**
+ * TCP_WND_LIMIT: the largest receive window of a socket, whether set with
+ * setsockopt(TCP_WINDOW) or grown by autotuning. This option is set via
+ * menuconfig.
+ */
+#define TCP_WND_LIMIT                   CONFIG_LWIP_TCP_WND_MAX
+
+/**
+ * LWIP_TCP_WND_AUTOTUNE==1: grow receive windows up to TCP_WND_LIMIT while
+ * at least TCP_WND_AUTOTUNE_HEAP_RESERVE bytes of heap stay free. This
+ * option is set via menuconfig.
+ */
+#define LWIP_TCP_WND_AUTOTUNE           CONFIG_LWIP_TCP_WND_AUTOTUNE
+#if CONFIG_LWIP_TCP_WND_AUTOTUNE
+uint32_t esp_get_free_heap_size(void);
+#define TCP_WND_AUTOTUNE_HEAP_RESERVE   CONFIG_LWIP_TCP_WND_AUTOTUNE_HEAP_RESERVE
+#define TCP_WND_AUTOTUNE_FREE_HEAP()    esp_get_free_heap_size()
+#endif
+
 /*
    ----------------------------------
    ---------- Pbuf options ----------
@@ -392,8 +434,11 @@
  * DEFAULT_TCP_RECVMBOX_SIZE: The mailbox size for the incoming packets on a
  * NETCONN_TCP. The queue size value itself is platform-dependent, but is passed
  * to sys_mbox_new() when the recvmbox is created.
+ * Every received segment takes one entry, so the mailbox is sized for the
+ * largest window a socket may open (TCP_WND_LIMIT): segments that do not fit
+ * are dropped and have to be retransmitted.
  */
-#define DEFAULT_TCP_RECVMBOX_SIZE       6
+#define DEFAULT_TCP_RECVMBOX_SIZE       ((TCP_WND_LIMIT / TCP_MSS + 2) > 6 ? (TCP_WND_LIMIT / TCP_MSS + 2) : 6)
 
 /**
  * DEFAULT_ACCEPTMBOX_SIZE: The mailbox size for the incoming connections.
@@ -448,6 +493,20 @@
  */
 #define SO_REUSE                        CONFIG_LWIP_SO_REUSE
 
+/**
+ * LWIP_SOCKET_MMSG==1: Enable lwip_sendmmsg() and lwip_recvmmsg().
+ */
+#define LWIP_SOCKET_MMSG                1
+
+/**
+ * LWIP_SOCKET_EPOLL==1: Enable lwip_epoll_create/ctl/wait.
+ * This option is set via menuconfig.
+ */
+#define LWIP_SOCKET_EPOLL               CONFIG_LWIP_SOCKET_EPOLL
+#if CONFIG_LWIP_SOCKET_EPOLL
+#define LWIP_SOCKET_EPOLL_MAX           CONFIG_LWIP_SOCKET_EPOLL_MAX
+#endif
+
 #if CONFIG_MDNS
 /**
  * SO_REUSE_RXTOALL==1: Pass a copy of incoming broadcast/multicast packets
@@ -478,6 +537,24 @@
    ---------- Checksum options ----------
    --------------------------------------
 */
+/**
+ * LWIP_CHKSUM_ALGORITHM==4: checksum 32 bytes per loop iteration with
+ * branch-free carry handling (see inet_chksum.c).
+ */
+#define LWIP_CHKSUM_ALGORITHM           4
+
+/**
+ * LWIP_CHECKSUM_ON_COPY==1: Calculate checksum when copying data from
+ * application buffers to pbufs, so tcp_write/udp_send don't need to walk
+ * the data a second time.
+ */
+#define LWIP_CHECKSUM_ON_COPY           1
+
+/**
+ * LWIP_CHKSUM_COPY_ALGORITHM==2: fused word-wise copy and checksum
+ * (see lwip_chksum_copy in inet_chksum.c).
+ */
+#define LWIP_CHKSUM_COPY_ALGORITHM      2
 
 /*
    ---------------------------------------
@@ -573,9 +650,17 @@
 #define ESP_L2_TO_L3_COPY               CONFIG_L2_TO_L3_COPY
 #define ESP_CNT_DEBUG                   0
 #define ESP_DUAL_CORE                   0
+#define ESP_NETSTATS                    CONFIG_LWIP_NETSTATS
+
+#if CONFIG_FREERTOS_UNICORE
+#define LWIP_NUM_CORES                  1
+#else
+#define LWIP_NUM_CORES                  2
+#endif
+#define LWIP_CORE_ID()                  xPortGetCoreID()
 
-#define TCP_WND_DEFAULT                      (4*TCP_MSS)
-#define TCP_SND_BUF_DEFAULT                  (2*TCP_MSS)
+#define TCP_WND_DEFAULT                      CONFIG_LWIP_TCP_WND_DEFAULT
+#define TCP_SND_BUF_DEFAULT                  CONFIG_LWIP_TCP_SND_BUF_DEFAULT
 
 #if ESP_PER_SOC_TCP_WND
 #define TCP_WND(pcb)                         (pcb->per_soc_tcp_wnd)
@@ -432,6 +432,7 @@ etharp_send_ip(struct netif *netif, struct pbuf *p, struct eth_addr *src, const
   ETHADDR16_COPY(&ethhdr->src, src);
   LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_send_ip: sending packet %p\n", (void *)p));
   /* send the packet */
+  NETSTATS_INC(tx_frames);
   return netif->linkoutput(netif, p);
 }
 
@@ -839,6 +840,7 @@ etharp_arp_input(struct netif *netif, struct eth_addr *ethaddr, struct pbuf *p)
          are already correct, we tested that before */
 
       /* return ARP reply */
+      NETSTATS_INC(tx_frames);
       netif->linkoutput(netif, p);
     /* we are not configured? */
     } else if (ip4_addr_isany_val(*netif_ip4_addr(netif))) {
@@ -1348,6 +1350,7 @@ etharp_raw(struct netif *netif, const struct eth_addr *ethsrc_addr,
   ETHADDR16_COPY(&ethhdr->src, ethsrc_addr);
 
   /* send ARP query */
+  NETSTATS_INC(tx_frames);
   result = netif->linkoutput(netif, p);
   ETHARP_STATS_INC(etharp.xmit);
   /* free ARP query packet */
@@ -250,6 +250,7 @@ sys_mbox_trypost(sys_mbox_t *mbox, void *msg)
     xReturn = ERR_OK;
   } else {
     LWIP_DEBUGF(ESP_THREAD_SAFE_DEBUG, ("trypost mbox=%p fail\n", (*mbox)->os_mbox));
+    NETSTATS_INC(mbox_post_fail);
     xReturn = ERR_MEM;
   }
 
@@ -0,0 +1,57 @@
+/*
+ * Host (Linux) variant of lwip/port/arch/cc.h, used to build parts of
+ * the stack into test_lwip_host.
+ */
+#ifndef __ARCH_CC_H__
+#define __ARCH_CC_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arch/sys_arch.h"
+
+/* glibc already defines BYTE_ORDER through <endian.h> */
+#ifndef BYTE_ORDER
+#define BYTE_ORDER LITTLE_ENDIAN
+#endif
+
+typedef uint8_t  u8_t;
+typedef int8_t   s8_t;
+typedef uint16_t u16_t;
+typedef int16_t  s16_t;
+typedef uint32_t u32_t;
+typedef int32_t  s32_t;
+
+typedef uintptr_t mem_ptr_t;
+typedef int sys_prot_t;
+
+#define S16_F "d"
+#define U16_F "d"
+#define X16_F "x"
+
+#define S32_F "d"
+#define U32_F "u"
+#define X32_F "x"
+#define SZT_F "zu"
+
+#define PACK_STRUCT_FIELD(x) x
+#define PACK_STRUCT_STRUCT __attribute__((packed))
+#define PACK_STRUCT_BEGIN
+#define PACK_STRUCT_END
+
+/* with NETSIM_ROUTE_SRC, packets leave through the netsim netif owning
+   their source address (see netsim.h) */
+#if NETSIM_ROUTE_SRC
+struct netif;
+struct ip4_addr;
+struct netif *netsim_route_src(const struct ip4_addr *dest, const struct ip4_addr *src);
+#define LWIP_HOOK_IP4_ROUTE_SRC(dest, src) netsim_route_src(dest, src)
+#endif
+
+#define LWIP_PLATFORM_DIAG(x)   do {printf x;} while(0)
+#define LWIP_PLATFORM_ASSERT(x) do {printf("%s\n", x); sys_arch_assert(__FILE__, __LINE__);} while(0)
+
+#endif /* __ARCH_CC_H__ */
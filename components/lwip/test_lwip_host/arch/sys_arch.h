@@ -0,0 +1,43 @@
+/*
+ * Host (Linux) variant of lwip/port/arch/sys_arch.h.
+ */
+#ifndef __SYS_ARCH_H__
+#define __SYS_ARCH_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct sys_sem_s*   sys_sem_t;
+typedef struct sys_mutex_s* sys_mutex_t;
+typedef struct sys_mbox_s*  sys_mbox_t;
+typedef unsigned long       sys_thread_t;
+
+#define LWIP_COMPAT_MUTEX 0
+
+#define sys_mutex_valid( x ) ( ( ( *x ) == NULL) ? 0 : 1 )
+#define sys_mutex_set_invalid( x ) ( ( *x ) = NULL )
+
+#define sys_mbox_valid( x ) ( ( ( *x ) == NULL) ? 0 : 1 )
+#define sys_mbox_set_invalid( x ) ( ( *x ) = NULL )
+
+#define sys_sem_valid( x ) ( ( ( *x ) == NULL) ? 0 : 1 )
+#define sys_sem_set_invalid( x ) ( ( *x ) = NULL )
+
+/* the host build counts everything on one core */
+#define xPortGetCoreID() 0
+
+void sys_arch_assert(const char *file, int line);
+uint32_t system_get_time(void);
+void sys_delay_ms(uint32_t ms);
+sys_sem_t* sys_thread_sem_init(void);
+void sys_thread_sem_deinit(void);
+sys_sem_t* sys_thread_sem_get(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SYS_ARCH_H__ */
@@ -0,0 +1,257 @@
+/*
+ * Host benchmark for TCP/UDP PCB demultiplexing.
+ *
+ * Builds N established TCP connections (plus a few listeners and TIME-WAIT
+ * PCBs) and N bound UDP PCBs, then feeds a stream of synthetic IPv4
+ * segments to each of them in random order through ip4_input(). The same
+ * source is built twice by the Makefile, once with CONFIG_LWIP_PCB_HASH
+ * and once without, so the two lines of output can be compared directly.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lwip/init.h"
+#include "lwip/mem.h"
+#include "lwip/memp.h"
+#include "lwip/netif.h"
+#include "lwip/ip4.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+#include "lwip/tcpip.h"
+#include "lwip/priv/tcp_priv.h"
+
+#define SEGMENTS_PER_RUN   400000
+#define TW_PCBS            16
+#define LISTEN_PCBS        4
+#define TCP_PORT_BASE      10000
+#define UDP_PORT_BASE      20000
+
+static struct netif bench_netif;
+static unsigned long tx_count;
+static unsigned long udp_rx_count;
+
+void esp_wifi_internal_free_rx_buffer(void *buffer)
+{
+}
+
+err_t tcpip_callback_with_block(tcpip_callback_fn function, void *ctx, u8_t block)
+{
+    return ERR_MEM;
+}
+
+static err_t bench_netif_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+    /* the only segments expected here are RSTs for unmatched input */
+    tx_count++;
+    return ERR_OK;
+}
+
+static err_t bench_netif_init(struct netif *netif)
+{
+    netif->output = bench_netif_output;
+    netif->mtu = 1500;
+    netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_LINK_UP;
+    return ERR_OK;
+}
+
+static void udp_recv_cb(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+    udp_rx_count++;
+    pbuf_free(p);
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static ip4_addr_t local_addr;
+
+static void peer_addr(int i, ip4_addr_t *addr)
+{
+    IP4_ADDR(addr, 10, 0, (u8_t)(1 + i / 250), (u8_t)(1 + i % 250));
+}
+
+static struct tcp_pcb *make_tcp_pcb(int i, enum tcp_state state)
+{
+    ip4_addr_t peer;
+    struct tcp_pcb *pcb = tcp_new();
+    if (pcb == NULL) {
+        abort();
+    }
+    peer_addr(i, &peer);
+    ip_addr_copy_from_ip4(pcb->local_ip, local_addr);
+    ip_addr_copy_from_ip4(pcb->remote_ip, peer);
+    pcb->local_port = (u16_t)(TCP_PORT_BASE + i % 8);
+    pcb->remote_port = (u16_t)(40000 + i);
+    pcb->state = state;
+    pcb->rcv_nxt = 1000;
+    pcb->snd_nxt = pcb->lastack = pcb->snd_lbb = 5000;
+    pcb->snd_wl1 = 999;
+    pcb->snd_wl2 = 5000;
+    pcb->snd_wnd = pcb->snd_wnd_max = TCP_WND_DEFAULT;
+    pcb->tmr = tcp_ticks;
+    if (state == TIME_WAIT) {
+        TCP_REG(&tcp_tw_pcbs, pcb);
+    } else {
+        TCP_REG_ACTIVE(pcb);
+    }
+    return pcb;
+}
+
+static struct pbuf *make_tcp_segment(int i)
+{
+    ip4_addr_t peer;
+    struct pbuf *p = pbuf_alloc(PBUF_RAW, IP_HLEN + TCP_HLEN, PBUF_RAM);
+    struct ip_hdr *iphdr = (struct ip_hdr *)p->payload;
+    struct tcp_hdr *tcphdr = (struct tcp_hdr *)((u8_t *)p->payload + IP_HLEN);
+
+    peer_addr(i, &peer);
+    memset(p->payload, 0, IP_HLEN + TCP_HLEN);
+    IPH_VHL_SET(iphdr, 4, IP_HLEN / 4);
+    IPH_LEN_SET(iphdr, htons(IP_HLEN + TCP_HLEN));
+    IPH_TTL_SET(iphdr, 64);
+    IPH_PROTO_SET(iphdr, IP_PROTO_TCP);
+    ip4_addr_copy(iphdr->src, peer);
+    ip4_addr_copy(iphdr->dest, local_addr);
+    IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
+
+    tcphdr->src = htons((u16_t)(40000 + i));
+    tcphdr->dest = htons((u16_t)(TCP_PORT_BASE + i % 8));
+    tcphdr->seqno = htonl(1000);
+    tcphdr->ackno = htonl(5000);
+    TCPH_HDRLEN_FLAGS_SET(tcphdr, TCP_HLEN / 4, TCP_ACK);
+    tcphdr->wnd = htons(TCP_WND_DEFAULT);
+
+    pbuf_header(p, -IP_HLEN);
+    tcphdr->chksum = inet_chksum_pseudo(p, IP_PROTO_TCP, TCP_HLEN, &peer, &local_addr);
+    pbuf_header(p, IP_HLEN);
+    return p;
+}
+
+static struct pbuf *make_udp_datagram(int i)
+{
+    ip4_addr_t peer;
+    struct pbuf *p = pbuf_alloc(PBUF_RAW, IP_HLEN + UDP_HLEN + 16, PBUF_RAM);
+    struct ip_hdr *iphdr = (struct ip_hdr *)p->payload;
+    struct udp_hdr *udphdr = (struct udp_hdr *)((u8_t *)p->payload + IP_HLEN);
+
+    peer_addr(i, &peer);
+    memset(p->payload, 0, p->len);
+    IPH_VHL_SET(iphdr, 4, IP_HLEN / 4);
+    IPH_LEN_SET(iphdr, htons(p->len));
+    IPH_TTL_SET(iphdr, 64);
+    IPH_PROTO_SET(iphdr, IP_PROTO_UDP);
+    ip4_addr_copy(iphdr->src, peer);
+    ip4_addr_copy(iphdr->dest, local_addr);
+    IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
+
+    udphdr->src = htons(5000);
+    udphdr->dest = htons((u16_t)(UDP_PORT_BASE + i));
+    udphdr->len = htons(UDP_HLEN + 16);
+    udphdr->chksum = 0;
+    return p;
+}
+
+static void run_tcp(int n_conn)
+{
+    struct tcp_pcb **pcbs = calloc(n_conn + TW_PCBS, sizeof(*pcbs));
+    int i;
+    double start, elapsed;
+    unsigned seed = 1;
+
+    for (i = 0; i < LISTEN_PCBS; i++) {
+        struct tcp_pcb *lpcb = tcp_new();
+        tcp_bind(lpcb, IP_ADDR_ANY, (u16_t)(TCP_PORT_BASE + 100 + i));
+        lpcb = tcp_listen(lpcb);
+    }
+    for (i = 0; i < n_conn; i++) {
+        pcbs[i] = make_tcp_pcb(i, ESTABLISHED);
+    }
+    for (i = 0; i < TW_PCBS; i++) {
+        pcbs[n_conn + i] = make_tcp_pcb(n_conn + i, TIME_WAIT);
+    }
+
+    tx_count = 0;
+    start = now_sec();
+    for (i = 0; i < SEGMENTS_PER_RUN; i++) {
+        int conn = rand_r(&seed) % n_conn;
+        ip4_input(make_tcp_segment(conn), &bench_netif);
+    }
+    elapsed = now_sec() - start;
+
+    printf("tcp  %-6s %6d conns  %8.1f ns/segment  %6lu unmatched\n",
+           LWIP_TCP_PCB_HASH ? "hash" : "list", n_conn,
+           elapsed * 1e9 / SEGMENTS_PER_RUN, tx_count);
+
+    for (i = 0; i < n_conn + TW_PCBS; i++) {
+        tcp_abort(pcbs[i]);
+    }
+    while (tcp_listen_pcbs.listen_pcbs != NULL) {
+        tcp_close((struct tcp_pcb *)tcp_listen_pcbs.listen_pcbs);
+    }
+    free(pcbs);
+}
+
+static void run_udp(int n_pcbs)
+{
+    struct udp_pcb **pcbs = calloc(n_pcbs, sizeof(*pcbs));
+    int i;
+    double start, elapsed;
+    unsigned seed = 2;
+
+    for (i = 0; i < n_pcbs; i++) {
+        pcbs[i] = udp_new();
+        udp_bind(pcbs[i], IP_ADDR_ANY, (u16_t)(UDP_PORT_BASE + i));
+        udp_recv(pcbs[i], udp_recv_cb, NULL);
+    }
+
+    udp_rx_count = 0;
+    start = now_sec();
+    for (i = 0; i < SEGMENTS_PER_RUN; i++) {
+        ip4_input(make_udp_datagram(rand_r(&seed) % n_pcbs), &bench_netif);
+    }
+    elapsed = now_sec() - start;
+
+    printf("udp  %-6s %6d pcbs   %8.1f ns/datagram %6lu unmatched\n",
+           LWIP_UDP_PCB_HASH ? "hash" : "list", n_pcbs,
+           elapsed * 1e9 / SEGMENTS_PER_RUN, SEGMENTS_PER_RUN - udp_rx_count);
+
+    for (i = 0; i < n_pcbs; i++) {
+        udp_remove(pcbs[i]);
+    }
+    free(pcbs);
+}
+
+int main(void)
+{
+    static const int sizes[] = { 16, 64, 256, 1024 };
+    ip4_addr_t mask, gw;
+    size_t i;
+
+    mem_init();
+    memp_init();
+    netif_init();
+    tcp_init();
+    udp_init();
+
+    IP4_ADDR(&local_addr, 10, 0, 0, 1);
+    IP4_ADDR(&mask, 255, 0, 0, 0);
+    IP4_ADDR(&gw, 10, 0, 0, 254);
+    netif_add(&bench_netif, &local_addr, &mask, &gw, NULL, bench_netif_init, ip4_input);
+    netif_set_default(&bench_netif);
+    netif_set_up(&bench_netif);
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        run_tcp(sizes[i]);
+    }
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        run_udp(sizes[i]);
+    }
+    return 0;
+}
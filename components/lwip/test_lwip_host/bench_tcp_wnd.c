@@ -0,0 +1,195 @@
+/*
+ * Host benchmark for TCP receive windows on a long round trip.
+ *
+ * One stack talks to itself over a netsim loopback link that delays every
+ * packet by DELAY_MS, so a connection has a round trip time of twice that.
+ * A client streams data to a server socket for RUN_MS; the server counts
+ * what it reads. The run is repeated with different receive windows on
+ * the server socket: the default window, the largest unscaled window, a
+ * scaled window and autotuning (once with plenty of heap and once with
+ * the heap bound kicking in).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "lwip/init.h"
+#include "lwip/netif.h"
+#include "lwip/sockets.h"
+#include "lwip/tcpip.h"
+#include "netsim.h"
+
+#define DELAY_MS         10
+#define RUN_MS           2000
+#define SERVER_PORT      5001
+#define CHUNK            8192
+
+static struct netif bench_netif;
+static struct netsim_link bench_link;
+static u32_t free_heap;
+
+void esp_wifi_internal_free_rx_buffer(void *buffer)
+{
+}
+
+void dhcps_coarse_tmr(void)
+{
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return free_heap;
+}
+
+static err_t bench_netif_init(struct netif *netif)
+{
+    netif->output = netsim_output;
+    netif->state = &bench_link;
+    netif->mtu = 1500;
+    netif->flags = NETIF_FLAG_LINK_UP;
+    return ERR_OK;
+}
+
+static void tcpip_init_done(void *arg)
+{
+    ip4_addr_t addr, mask, gw;
+    IP4_ADDR(&addr, 10, 0, 0, 1);
+    IP4_ADDR(&mask, 255, 0, 0, 0);
+    IP4_ADDR(&gw, 10, 0, 0, 254);
+    netif_add(&bench_netif, &addr, &mask, &gw, NULL, bench_netif_init, tcpip_input);
+    netif_set_default(&bench_netif);
+    netif_set_up(&bench_netif);
+    sys_sem_signal((sys_sem_t *) arg);
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void make_addr(struct sockaddr_in *sa, u32_t addr, int port)
+{
+    memset(sa, 0, sizeof(*sa));
+    sa->sin_len = sizeof(*sa);
+    sa->sin_family = AF_INET;
+    sa->sin_port = PP_HTONS(port);
+    sa->sin_addr.s_addr = PP_HTONL(addr);
+}
+
+static void *client_thread(void *arg)
+{
+    static char buf[CHUNK];
+    struct sockaddr_in to;
+    int size = TCP_WND_LIMIT / TCP_MSS;
+    double end;
+    int s;
+
+    (void) arg;
+    s = lwip_socket(AF_INET, SOCK_STREAM, 0);
+    lwip_setsockopt_r(s, IPPROTO_TCP, TCP_SNDBUF, &size, sizeof(size));
+    make_addr(&to, 0x0a000001, SERVER_PORT);
+    if (lwip_connect_r(s, (struct sockaddr *) &to, sizeof(to)) != 0) {
+        printf("connect failed\n");
+        exit(1);
+    }
+    end = now_sec() + RUN_MS / 1000.0;
+    while (now_sec() < end) {
+        if (lwip_send_r(s, buf, sizeof(buf), 0) < 0) {
+            printf("send failed\n");
+            exit(1);
+        }
+    }
+    lwip_close_r(s);
+    return NULL;
+}
+
+enum wnd_mode { WND_DEFAULT, WND_SET, WND_AUTOTUNE };
+
+/* Run one transfer and return the received throughput in bytes/s. */
+static double run(int listener, enum wnd_mode mode, int wnd_mss, int *final_wnd)
+{
+    static char buf[CHUNK];
+    struct sockaddr_in from;
+    socklen_t fromlen = sizeof(from);
+    socklen_t optlen = sizeof(*final_wnd);
+    unsigned long total = 0;
+    pthread_t client;
+    double t0;
+    int s, n, on;
+
+    pthread_create(&client, NULL, client_thread, NULL);
+    s = lwip_accept_r(listener, (struct sockaddr *) &from, &fromlen);
+    if (s < 0) {
+        printf("accept failed\n");
+        exit(1);
+    }
+    on = (mode == WND_AUTOTUNE);
+    lwip_setsockopt_r(s, IPPROTO_TCP, TCP_WINDOW_AUTOTUNE, &on, sizeof(on));
+    if (mode == WND_SET) {
+        lwip_setsockopt_r(s, IPPROTO_TCP, TCP_WINDOW, &wnd_mss, sizeof(wnd_mss));
+    }
+    t0 = now_sec();
+    while ((n = lwip_recv_r(s, buf, sizeof(buf), 0)) > 0) {
+        total += n;
+    }
+    t0 = now_sec() - t0;
+    lwip_getsockopt_r(s, IPPROTO_TCP, TCP_WINDOW, final_wnd, &optlen);
+    lwip_close_r(s);
+    pthread_join(client, NULL);
+    return total / t0;
+}
+
+static double report(const char *what, double rate, int wnd, double base)
+{
+    printf("%-36s wnd %7d  %8.0f KB/s", what, wnd, rate / 1024);
+    if (base > 0) {
+        printf("  (x%.1f)", rate / base);
+    }
+    printf("\n");
+    return rate;
+}
+
+int main(void)
+{
+    sys_sem_t sem;
+    struct netsim_params params = { .delay_ms = DELAY_MS };
+    struct sockaddr_in addr;
+    double rate, base, scaled, autotuned;
+    int listener, wnd;
+
+    free_heap = 4 * 1024 * 1024;
+    netsim_link_start(&bench_link, &bench_netif, &params);
+    sys_sem_new(&sem, 0);
+    tcpip_init(tcpip_init_done, &sem);
+    sys_arch_sem_wait(&sem, 0);
+
+    listener = lwip_socket(AF_INET, SOCK_STREAM, 0);
+    make_addr(&addr, 0, SERVER_PORT);
+    if (lwip_bind_r(listener, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+        lwip_listen_r(listener, 1) != 0) {
+        printf("listen failed\n");
+        return 1;
+    }
+
+    printf("TCP over a %d ms RTT loopback, %d ms per run, window scale %d, limit %d\n",
+           2 * DELAY_MS, RUN_MS, TCP_RCV_SCALE, (int) TCP_WND_LIMIT);
+    rate = run(listener, WND_DEFAULT, 0, &wnd);
+    base = report("default window", rate, wnd, 0);
+    rate = run(listener, WND_SET, 44, &wnd);
+    report("TCP_WINDOW 44 MSS (unscaled max)", rate, wnd, base);
+    rate = run(listener, WND_SET, 256 * 1024 / TCP_MSS, &wnd);
+    scaled = report("TCP_WINDOW 256 KB (scaled)", rate, wnd, base);
+    rate = run(listener, WND_AUTOTUNE, 0, &wnd);
+    autotuned = report("autotune", rate, wnd, base);
+    free_heap = 128 * 1024;
+    rate = run(listener, WND_AUTOTUNE, 0, &wnd);
+    report("autotune, 128 KB free heap", rate, wnd, base);
+
+    lwip_close_r(listener);
+    /* scaled windows have to beat the default one by far */
+    return (scaled > 10 * base && autotuned > 10 * base) ? 0 : 1;
+}
@@ -0,0 +1,251 @@
+/*
+ * Host benchmark for batched UDP socket calls.
+ *
+ * Runs the stack with a real tcpip thread (see sys_arch.c) and compares
+ * datagrams per second for
+ *  - lwip_sendto_r in a loop against lwip_sendmmsg_r, sending to a netif
+ *    that counts and drops the packets;
+ *  - lwip_recvfrom_r in a loop against lwip_recvmmsg_r, receiving bursts
+ *    looped back through the stack to a bound socket.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lwip/init.h"
+#include "lwip/netif.h"
+#include "lwip/sockets.h"
+#include "lwip/tcpip.h"
+
+#define PAYLOAD_LEN      64
+#define TX_DATAGRAMS     200000
+#define RX_ROUNDS        40000
+#define RX_BURST         DEFAULT_UDP_RECVMBOX_SIZE
+#define MAX_VLEN         32
+#define RX_PORT          5001
+
+static struct netif bench_netif;
+static volatile unsigned long tx_count;
+
+void esp_wifi_internal_free_rx_buffer(void *buffer)
+{
+}
+
+void dhcps_coarse_tmr(void)
+{
+}
+
+static err_t bench_netif_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+    tx_count++;
+    return ERR_OK;
+}
+
+static err_t bench_netif_init(struct netif *netif)
+{
+    netif->output = bench_netif_output;
+    netif->mtu = 1500;
+    netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_LINK_UP;
+    return ERR_OK;
+}
+
+static void signal_sem(void *arg)
+{
+    sys_sem_signal((sys_sem_t *) arg);
+}
+
+static void tcpip_init_done(void *arg)
+{
+    ip4_addr_t addr, mask, gw;
+    IP4_ADDR(&addr, 10, 0, 0, 1);
+    IP4_ADDR(&mask, 255, 0, 0, 0);
+    IP4_ADDR(&gw, 10, 0, 0, 254);
+    netif_add(&bench_netif, &addr, &mask, &gw, NULL, bench_netif_init, tcpip_input);
+    netif_set_default(&bench_netif);
+    netif_set_up(&bench_netif);
+    signal_sem(arg);
+}
+
+/* Wait until the tcpip thread has processed everything posted so far. */
+static void tcpip_barrier(sys_sem_t *sem)
+{
+    tcpip_callback(signal_sem, sem);
+    sys_arch_sem_wait(sem, 0);
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static char payload[MAX_VLEN][PAYLOAD_LEN];
+static struct iovec iov[MAX_VLEN];
+static struct mmsghdr msgs[MAX_VLEN];
+static char rx_payload[MAX_VLEN][PAYLOAD_LEN];
+static struct iovec rx_iov[MAX_VLEN];
+static struct sockaddr_in rx_from[MAX_VLEN];
+static struct mmsghdr rx_msgs[MAX_VLEN];
+
+static void setup_msgs(struct sockaddr_in *to)
+{
+    for (int i = 0; i < MAX_VLEN; i++) {
+        iov[i].iov_base = payload[i];
+        iov[i].iov_len = PAYLOAD_LEN;
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        if (to) {
+            msgs[i].msg_hdr.msg_name = to;
+            msgs[i].msg_hdr.msg_namelen = sizeof(*to);
+        }
+    }
+}
+
+static void make_addr(struct sockaddr_in *sa, int a, int b, int c, int d, int port)
+{
+    memset(sa, 0, sizeof(*sa));
+    sa->sin_len = sizeof(*sa);
+    sa->sin_family = AF_INET;
+    sa->sin_port = PP_HTONS(port);
+    sa->sin_addr.s_addr = PP_HTONL(((u32_t) a << 24) | ((u32_t) b << 16) | ((u32_t) c << 8) | (u32_t) d);
+}
+
+static void report(const char *what, unsigned long n, double t, double base)
+{
+    printf("%-28s %9.0f pps", what, n / t);
+    if (base > 0) {
+        printf("  (x%.2f)", (n / t) / base);
+    }
+    printf("\n");
+}
+
+static void bench_tx(int s)
+{
+    struct sockaddr_in to;
+    unsigned long before;
+    double t, base;
+    int i, vlen;
+
+    make_addr(&to, 10, 0, 0, 2, 9);
+    setup_msgs(&to);
+
+    before = tx_count;
+    t = now_sec();
+    for (i = 0; i < TX_DATAGRAMS; i++) {
+        if (lwip_sendto_r(s, payload[0], PAYLOAD_LEN, 0, (struct sockaddr *) &to, sizeof(to)) != PAYLOAD_LEN) {
+            printf("sendto failed\n");
+            exit(1);
+        }
+    }
+    t = now_sec() - t;
+    base = (tx_count - before) / t;
+    report("tx sendto", tx_count - before, t, 0);
+
+    for (vlen = 8; vlen <= MAX_VLEN; vlen *= 4) {
+        before = tx_count;
+        t = now_sec();
+        for (i = 0; i < TX_DATAGRAMS; i += vlen) {
+            if (lwip_sendmmsg_r(s, msgs, vlen, 0) != vlen) {
+                printf("sendmmsg failed\n");
+                exit(1);
+            }
+        }
+        t = now_sec() - t;
+        char name[40];
+        snprintf(name, sizeof(name), "tx sendmmsg vlen=%d", vlen);
+        report(name, tx_count - before, t, base);
+    }
+}
+
+/* Queue one burst of RX_BURST datagrams on the receiving socket. */
+static void fill_rx(int tx, sys_sem_t *sem)
+{
+    if (lwip_sendmmsg_r(tx, msgs, RX_BURST, 0) != RX_BURST) {
+        printf("loopback sendmmsg failed\n");
+        exit(1);
+    }
+    /* the looped back datagrams are input by a tcpip_callback posted
+       while sending: once this barrier passes, they are all queued */
+    tcpip_barrier(sem);
+}
+
+static void bench_rx(int tx, int rx, sys_sem_t *sem)
+{
+    struct sockaddr_in to, from;
+    socklen_t fromlen;
+    char buf[PAYLOAD_LEN];
+    unsigned long n = 0;
+    double t = 0, t0, base;
+    int i, j, ret;
+
+    make_addr(&to, 10, 0, 0, 1, RX_PORT);
+    setup_msgs(&to);
+
+    for (i = 0; i < RX_ROUNDS; i++) {
+        fill_rx(tx, sem);
+        t0 = now_sec();
+        for (j = 0; j < RX_BURST; j++) {
+            fromlen = sizeof(from);
+            ret = lwip_recvfrom_r(rx, buf, sizeof(buf), MSG_DONTWAIT, (struct sockaddr *) &from, &fromlen);
+            if (ret != PAYLOAD_LEN) {
+                break;
+            }
+            n++;
+        }
+        t += now_sec() - t0;
+    }
+    base = n / t;
+    report("rx recvfrom", n, t, 0);
+
+    n = 0;
+    t = 0;
+    for (i = 0; i < RX_ROUNDS; i++) {
+        fill_rx(tx, sem);
+        for (j = 0; j < RX_BURST; j++) {
+            rx_iov[j].iov_base = rx_payload[j];
+            rx_iov[j].iov_len = PAYLOAD_LEN;
+            memset(&rx_msgs[j], 0, sizeof(rx_msgs[j]));
+            rx_msgs[j].msg_hdr.msg_iov = &rx_iov[j];
+            rx_msgs[j].msg_hdr.msg_iovlen = 1;
+            rx_msgs[j].msg_hdr.msg_name = &rx_from[j];
+            rx_msgs[j].msg_hdr.msg_namelen = sizeof(rx_from[j]);
+        }
+        t0 = now_sec();
+        ret = lwip_recvmmsg_r(rx, rx_msgs, RX_BURST, MSG_DONTWAIT, NULL);
+        t += now_sec() - t0;
+        if (ret > 0) {
+            n += ret;
+        }
+    }
+    report("rx recvmmsg", n, t, base);
+}
+
+int main(void)
+{
+    sys_sem_t sem;
+    struct sockaddr_in addr;
+    int tx, rx;
+
+    sys_sem_new(&sem, 0);
+    tcpip_init(tcpip_init_done, &sem);
+    sys_arch_sem_wait(&sem, 0);
+
+    tx = lwip_socket(AF_INET, SOCK_DGRAM, 0);
+    rx = lwip_socket(AF_INET, SOCK_DGRAM, 0);
+    make_addr(&addr, 0, 0, 0, 0, RX_PORT);
+    if (tx < 0 || rx < 0 || lwip_bind_r(rx, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        printf("socket setup failed\n");
+        return 1;
+    }
+
+    printf("UDP, %d byte payload, batches of %d per tcpip call\n", PAYLOAD_LEN, LWIP_SOCKET_MMSG_BATCH);
+    bench_tx(tx);
+    bench_rx(tx, rx, &sem);
+
+    lwip_close_r(tx);
+    lwip_close_r(rx);
+    return 0;
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+/* Host stand-in for components/esp32/include/esp_task.h */
+#define ESP_TASK_TCPIP_STACK    (4 * 1024)
+#define ESP_TASK_TCPIP_PRIO     0
@@ -0,0 +1,4 @@
+#pragma once
+
+/* Host stand-in for components/esp32/include/esp_wifi_internal.h */
+void esp_wifi_internal_free_rx_buffer(void *buffer);
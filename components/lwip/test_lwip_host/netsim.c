@@ -0,0 +1,233 @@
+/*
+ * In-memory links for running the stack on the host, see netsim.h.
+ */
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "lwip/pbuf.h"
+#include "lwip/tcpip.h"
+#include "netsim.h"
+
+struct netsim_packet {
+    struct netsim_packet *next;
+    struct pbuf *p;
+    struct timespec due;
+};
+
+static void timespec_add_us(struct timespec *ts, u32_t us)
+{
+    ts->tv_sec += us / 1000000;
+    ts->tv_nsec += (long) (us % 1000000) * 1000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static void *netsim_thread(void *arg)
+{
+    struct netsim_link *link = (struct netsim_link *) arg;
+    struct netsim_packet *pkt;
+
+    pthread_mutex_lock(&link->lock);
+    while (link->running) {
+        if (link->head == NULL) {
+            pthread_cond_wait(&link->cond, &link->lock);
+            continue;
+        }
+        /* packets all have the same delay, so the head is due first */
+        if (pthread_cond_timedwait(&link->cond, &link->lock, &link->head->due) != ETIMEDOUT) {
+            continue;
+        }
+        pkt = link->head;
+        link->head = pkt->next;
+        if (link->head == NULL) {
+            link->tail = NULL;
+        }
+        link->queued--;
+        pthread_mutex_unlock(&link->lock);
+
+        /* a full tcpip mailbox pushes back on the link instead of dropping
+           the packet: loss on a link is never a side effect of bursts */
+        while (link->peer->input(pkt->p, link->peer) == ERR_MEM) {
+            sched_yield();
+        }
+        free(pkt);
+
+        pthread_mutex_lock(&link->lock);
+    }
+    pthread_mutex_unlock(&link->lock);
+    return NULL;
+}
+
+/* xorshift32: cheap, and the same sequence for the same seed */
+static u32_t netsim_rand(struct netsim_link *link)
+{
+    u32_t x = link->rand_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    link->rand_state = x;
+    return x;
+}
+
+int netsim_link_start(struct netsim_link *link, struct netif *peer, const struct netsim_params *params)
+{
+    pthread_condattr_t attr;
+
+    link->peer = peer;
+    link->delay_us = params->delay_ms * 1000;
+    link->loss_ppm = params->loss_ppm;
+    link->mtu = params->mtu ? params->mtu : 1500;
+    link->queue_len = params->queue_len ? params->queue_len : 1024;
+    link->queued = 0;
+    link->rand_state = params->seed ? params->seed : 1;
+    link->head = link->tail = NULL;
+    link->running = true;
+    link->packets = link->bytes = link->lost = link->oversize = link->dropped = 0;
+    pthread_mutex_init(&link->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&link->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    return pthread_create(&link->thread, NULL, netsim_thread, link);
+}
+
+void netsim_link_stop(struct netsim_link *link)
+{
+    struct netsim_packet *pkt;
+
+    pthread_mutex_lock(&link->lock);
+    link->running = false;
+    pthread_cond_signal(&link->cond);
+    pthread_mutex_unlock(&link->lock);
+    pthread_join(link->thread, NULL);
+
+    while ((pkt = link->head) != NULL) {
+        link->head = pkt->next;
+        pbuf_free(pkt->p);
+        free(pkt);
+    }
+    link->tail = NULL;
+    link->queued = 0;
+    pthread_cond_destroy(&link->cond);
+    pthread_mutex_destroy(&link->lock);
+}
+
+err_t netsim_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+    struct netsim_link *link = (struct netsim_link *) netif->state;
+    struct netsim_packet *pkt;
+    struct pbuf *q;
+
+    (void) ipaddr;
+    if (p->tot_len > link->mtu) {
+        link->oversize++;
+        return ERR_OK;
+    }
+    if (link->loss_ppm != 0 && netsim_rand(link) % 1000000 < link->loss_ppm) {
+        link->lost++;
+        return ERR_OK;
+    }
+    /* the caller keeps p, so the link carries a flat copy */
+    q = pbuf_alloc(PBUF_RAW, p->tot_len, PBUF_RAM);
+    if (q == NULL) {
+        return ERR_MEM;
+    }
+    pkt = malloc(sizeof(*pkt));
+    if (pkt == NULL) {
+        pbuf_free(q);
+        return ERR_MEM;
+    }
+    pbuf_copy(q, p);
+    pkt->p = q;
+    pkt->next = NULL;
+    clock_gettime(CLOCK_MONOTONIC, &pkt->due);
+    timespec_add_us(&pkt->due, link->delay_us);
+
+    pthread_mutex_lock(&link->lock);
+    if (link->queued >= link->queue_len) {
+        link->dropped++;
+        pthread_mutex_unlock(&link->lock);
+        pbuf_free(q);
+        free(pkt);
+        return ERR_OK;
+    }
+    if (link->tail != NULL) {
+        link->tail->next = pkt;
+    } else {
+        link->head = pkt;
+        pthread_cond_signal(&link->cond);
+    }
+    link->tail = pkt;
+    link->queued++;
+    link->packets++;
+    link->bytes += p->tot_len;
+    pthread_mutex_unlock(&link->lock);
+    return ERR_OK;
+}
+
+struct netif *netsim_route_src(const ip4_addr_t *dest, const ip4_addr_t *src)
+{
+    struct netif *netif;
+
+    (void) dest;
+    if (src == NULL || ip4_addr_isany(src)) {
+        return NULL;
+    }
+    for (netif = netif_list; netif != NULL; netif = netif->next) {
+        if (netif->output == netsim_output && netif_is_up(netif) &&
+            ip4_addr_cmp(src, netif_ip4_addr(netif))) {
+            return netif;
+        }
+    }
+    return NULL;
+}
+
+static err_t netsim_netif_init(struct netif *netif)
+{
+    struct netsim_link *link = (struct netsim_link *) netif->state;
+
+    netif->output = netsim_output;
+    netif->mtu = link->mtu;
+    netif->flags = NETIF_FLAG_LINK_UP;
+    return ERR_OK;
+}
+
+int netsim_pair_add(struct netsim_pair *pair, const ip4_addr_t *addr0, const ip4_addr_t *addr1,
+                    const struct netsim_params *params)
+{
+    const ip4_addr_t *addr[2] = { addr0, addr1 };
+    ip4_addr_t mask;
+    int i;
+
+    IP4_ADDR(&mask, 255, 255, 255, 255);
+    for (i = 0; i < 2; i++) {
+        if (netsim_link_start(&pair->link[i], &pair->netif[1 - i], params) != 0) {
+            if (i == 1) {
+                netsim_link_stop(&pair->link[0]);
+            }
+            return -1;
+        }
+    }
+    for (i = 0; i < 2; i++) {
+        netif_add(&pair->netif[i], addr[i], &mask, IP4_ADDR_ANY, &pair->link[i],
+                  netsim_netif_init, tcpip_input);
+        netif_set_up(&pair->netif[i]);
+    }
+    return 0;
+}
+
+void netsim_pair_remove(struct netsim_pair *pair)
+{
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        netif_remove(&pair->netif[i]);
+    }
+    for (i = 0; i < 2; i++) {
+        netsim_link_stop(&pair->link[i]);
+    }
+}
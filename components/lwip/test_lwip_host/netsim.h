@@ -0,0 +1,87 @@
+/*
+ * In-memory links for running the stack on the host (see sys_arch.c).
+ *
+ * A netif using netsim_output() hands every packet it sends to a
+ * netsim_link, which delivers a copy to the input function of the link's
+ * peer netif after a fixed delay. The peer may be the sending netif itself,
+ * which gives a loopback interface with a configurable round trip time.
+ * When the input queue of the stack is full, the link waits rather than
+ * dropping the packet; packets are only lost on purpose (loss_ppm), when
+ * they exceed the MTU of the link or when queue_len packets are already
+ * in flight on it (tail drop, like the buffer of a router).
+ *
+ * A netsim_pair is two such netifs with a link each, so that traffic
+ * between their addresses crosses a link in both directions. This needs
+ * the stack built with NETSIM_ROUTE_SRC=1, which routes packets through
+ * the netif owning their source address (see arch/cc.h): sockets on either
+ * end of a pair have to be bound to its address.
+ */
+#pragma once
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "lwip/netif.h"
+
+struct netsim_packet;
+
+struct netsim_params {
+    u32_t delay_ms;     /* one-way delay */
+    u32_t loss_ppm;     /* random loss, in packets per million */
+    u16_t mtu;          /* largest IP packet the link carries, 0 for 1500 */
+    u32_t queue_len;    /* packets in flight before tail drop, 0 for 1024 */
+    u32_t seed;         /* seed of the loss generator, runs are repeatable */
+};
+
+struct netsim_link {
+    struct netif *peer;
+    u32_t delay_us;
+    u32_t loss_ppm;
+    u16_t mtu;
+    u32_t queue_len;
+    u32_t rand_state;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct netsim_packet *head;
+    struct netsim_packet *tail;
+    u32_t queued;
+    bool running;
+
+    unsigned long packets;
+    unsigned long bytes;
+    unsigned long lost;
+    unsigned long oversize;
+    unsigned long dropped;
+};
+
+struct netsim_pair {
+    struct netif netif[2];
+    struct netsim_link link[2];
+};
+
+/* Start a link delivering to peer with the given parameters. */
+int netsim_link_start(struct netsim_link *link, struct netif *peer, const struct netsim_params *params);
+
+/* Stop the delivery thread and drop the packets still in flight. */
+void netsim_link_stop(struct netsim_link *link);
+
+/* netif->output for an interface whose netif->state is a netsim_link. */
+err_t netsim_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr);
+
+/*
+ * Add two netifs with the addresses addr0 and addr1, each with a /32
+ * netmask, and bring them up. Packets sent from the address of netif[i]
+ * cross link[i] to the other netif. Call from the tcpip thread (e.g. the
+ * tcpip_init() callback).
+ */
+int netsim_pair_add(struct netsim_pair *pair, const ip4_addr_t *addr0, const ip4_addr_t *addr1,
+                    const struct netsim_params *params);
+
+/* Remove both netifs and stop their links. Call from the tcpip thread. */
+void netsim_pair_remove(struct netsim_pair *pair);
+
+/* LWIP_HOOK_IP4_ROUTE_SRC: the netsim netif owning src, or NULL to route
+   by destination. */
+struct netif *netsim_route_src(const ip4_addr_t *dest, const ip4_addr_t *src);
@@ -0,0 +1,410 @@
+/*
+ * Host performance harness for the stack.
+ *
+ * Two netifs of one stack are connected by a netsim_pair (see netsim.h),
+ * so every packet crosses an in-memory link with configurable delay, loss
+ * and MTU. Clients are bound to CLIENT_ADDR and servers to SERVER_ADDR,
+ * and the following netperf-style tests run over the pair, each for a
+ * fixed time:
+ *  - tcp_stream: bulk transfer over one connection, in Mbit/s;
+ *  - tcp_rr:     request/response transactions of RR_SIZE bytes over one
+ *                connection, in transactions/s and mean latency;
+ *  - udp_stream: UDP_SIZE byte datagrams, sent and received per second;
+ *  - tcp_crr:    connect, one transaction and close, in connections/s.
+ *
+ * Usage: perf_lwip [-t seconds] [-d delay_ms] [-l loss_percent] [-m mtu]
+ *                  [-w window_mss]
+ *
+ * The results are printed one test per line and the program fails if a
+ * test made no progress at all.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "lwip/init.h"
+#include "lwip/netif.h"
+#include "lwip/sockets.h"
+#include "lwip/stats.h"
+#include "lwip/tcpip.h"
+#include "netsim.h"
+
+#define CLIENT_ADDR      0x0a000101     /* 10.0.1.1 */
+#define SERVER_ADDR      0x0a000201     /* 10.0.2.1 */
+#define SERVER_PORT      5001        /* + test number: pcbs of the previous
+                                          test may still be closing */
+#define CHUNK            8192
+#define RR_SIZE          1
+#define UDP_SIZE         64
+
+static struct netsim_pair pair;
+static struct netsim_params params;
+static double run_sec = 2;
+static int window_mss;
+static int server_port;
+
+void esp_wifi_internal_free_rx_buffer(void *buffer)
+{
+}
+
+void dhcps_coarse_tmr(void)
+{
+}
+
+static void tcpip_init_done(void *arg)
+{
+    ip4_addr_t client, server;
+    ip4_addr_set_u32(&client, PP_HTONL(CLIENT_ADDR));
+    ip4_addr_set_u32(&server, PP_HTONL(SERVER_ADDR));
+    if (netsim_pair_add(&pair, &client, &server, &params) != 0) {
+        printf("netsim_pair_add failed\n");
+        exit(1);
+    }
+    sys_sem_signal((sys_sem_t *) arg);
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void make_addr(struct sockaddr_in *sa, u32_t addr, int port)
+{
+    memset(sa, 0, sizeof(*sa));
+    sa->sin_len = sizeof(*sa);
+    sa->sin_family = AF_INET;
+    sa->sin_port = PP_HTONS(port);
+    sa->sin_addr.s_addr = PP_HTONL(addr);
+}
+
+static void fail(const char *what)
+{
+    printf("%s failed, errno %d\n", what, errno);
+    exit(1);
+}
+
+/* Socket bound to the given address, which selects the netif of the pair
+   that its packets leave through. */
+static int bound_socket(int type, u32_t addr, int port)
+{
+    struct sockaddr_in sa;
+    int one = 1;
+    int s;
+
+    s = lwip_socket(AF_INET, type, 0);
+    if (s < 0) {
+        fail("socket");
+    }
+    lwip_setsockopt_r(s, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    make_addr(&sa, addr, port);
+    if (lwip_bind_r(s, (struct sockaddr *) &sa, sizeof(sa)) != 0) {
+        fail("bind");
+    }
+    return s;
+}
+
+static void tune_tcp(int s, bool nodelay)
+{
+    int one = 1;
+
+    if (window_mss > 0) {
+        lwip_setsockopt_r(s, IPPROTO_TCP, TCP_WINDOW, &window_mss, sizeof(window_mss));
+        lwip_setsockopt_r(s, IPPROTO_TCP, TCP_SNDBUF, &window_mss, sizeof(window_mss));
+    }
+    if (nodelay) {
+        lwip_setsockopt_r(s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+}
+
+static int tcp_listener(void)
+{
+    int s = bound_socket(SOCK_STREAM, SERVER_ADDR, server_port);
+
+    if (lwip_listen_r(s, 4) != 0) {
+        fail("listen");
+    }
+    return s;
+}
+
+static int tcp_connect(bool nodelay)
+{
+    struct sockaddr_in to;
+    int s = bound_socket(SOCK_STREAM, CLIENT_ADDR, 0);
+
+    tune_tcp(s, nodelay);
+    make_addr(&to, SERVER_ADDR, server_port);
+    if (lwip_connect_r(s, (struct sockaddr *) &to, sizeof(to)) != 0) {
+        fail("connect");
+    }
+    return s;
+}
+
+static int tcp_accept(int listener, bool nodelay)
+{
+    int s = lwip_accept_r(listener, NULL, NULL);
+
+    if (s < 0) {
+        fail("accept");
+    }
+    tune_tcp(s, nodelay);
+    return s;
+}
+
+/* Read exactly len bytes, 0 on EOF. */
+static int read_full(int s, char *buf, int len)
+{
+    int done = 0, n;
+
+    while (done < len) {
+        n = lwip_recv_r(s, buf + done, len - done, 0);
+        if (n <= 0) {
+            return 0;
+        }
+        done += n;
+    }
+    return 1;
+}
+
+/* Server side threads, one per test; arg is the listening socket. */
+
+static void *stream_server(void *arg)
+{
+    static char buf[CHUNK];
+    int s = tcp_accept(*(int *) arg, false);
+
+    while (lwip_recv_r(s, buf, sizeof(buf), 0) > 0) {
+    }
+    lwip_close_r(s);
+    return NULL;
+}
+
+static void *rr_server(void *arg)
+{
+    char buf[RR_SIZE];
+    int s = tcp_accept(*(int *) arg, true);
+
+    while (read_full(s, buf, sizeof(buf))) {
+        if (lwip_send_r(s, buf, sizeof(buf), 0) != sizeof(buf)) {
+            break;
+        }
+    }
+    lwip_close_r(s);
+    return NULL;
+}
+
+#define CRR_QUIT         'q'         /* request that ends crr_server */
+
+static void *crr_server(void *arg)
+{
+    char buf[RR_SIZE];
+    char eof[1];
+    int s;
+
+    do {
+        s = tcp_accept(*(int *) arg, true);
+        buf[0] = 0;
+        if (read_full(s, buf, sizeof(buf))) {
+            lwip_send_r(s, buf, sizeof(buf), 0);
+        }
+        /* the client closes first and keeps the TIME_WAIT pcb: its ports
+           are then never reused while an old incarnation is around */
+        read_full(s, eof, sizeof(eof));
+        lwip_close_r(s);
+    } while (buf[0] != CRR_QUIT);
+    return NULL;
+}
+
+static unsigned long udp_received;
+
+static void *udp_server(void *arg)
+{
+    char buf[UDP_SIZE];
+    int s = *(int *) arg;
+
+    while (lwip_recv_r(s, buf, sizeof(buf), 0) > 0) {
+        udp_received++;
+    }
+    return NULL;
+}
+
+static double test_tcp_stream(void)
+{
+    static char buf[CHUNK];
+    unsigned long total = 0;
+    pthread_t server;
+    double t0, t;
+    int listener, s, n;
+
+    listener = tcp_listener();
+    pthread_create(&server, NULL, stream_server, &listener);
+    s = tcp_connect(false);
+    t0 = now_sec();
+    while ((t = now_sec() - t0) < run_sec) {
+        n = lwip_send_r(s, buf, sizeof(buf), 0);
+        if (n < 0) {
+            fail("send");
+        }
+        total += n;
+    }
+    lwip_close_r(s);
+    pthread_join(server, NULL);
+    lwip_close_r(listener);
+    return total * 8 / t / 1e6;
+}
+
+static double test_tcp_rr(double *latency_us)
+{
+    char buf[RR_SIZE] = { 0 };
+    unsigned long trans = 0;
+    pthread_t server;
+    double t0, t;
+    int listener, s;
+
+    listener = tcp_listener();
+    pthread_create(&server, NULL, rr_server, &listener);
+    s = tcp_connect(true);
+    t0 = now_sec();
+    while ((t = now_sec() - t0) < run_sec) {
+        if (lwip_send_r(s, buf, sizeof(buf), 0) != sizeof(buf) ||
+            !read_full(s, buf, sizeof(buf))) {
+            fail("transaction");
+        }
+        trans++;
+    }
+    lwip_close_r(s);
+    pthread_join(server, NULL);
+    lwip_close_r(listener);
+    *latency_us = trans ? t / trans * 1e6 : 0;
+    return trans / t;
+}
+
+static double test_udp_stream(double *rx_pps)
+{
+    char buf[UDP_SIZE] = { 0 };
+    struct sockaddr_in to;
+    struct timeval tv = { .tv_sec = 0, .tv_usec = 200000 };
+    unsigned long sent = 0;
+    pthread_t server;
+    double t0, t;
+    int rx, tx;
+
+    rx = bound_socket(SOCK_DGRAM, SERVER_ADDR, server_port);
+    lwip_setsockopt_r(rx, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    udp_received = 0;
+    pthread_create(&server, NULL, udp_server, &rx);
+    tx = bound_socket(SOCK_DGRAM, CLIENT_ADDR, 0);
+    make_addr(&to, SERVER_ADDR, server_port);
+    t0 = now_sec();
+    while ((t = now_sec() - t0) < run_sec) {
+        if (lwip_sendto_r(tx, buf, sizeof(buf), 0, (struct sockaddr *) &to, sizeof(to)) == sizeof(buf)) {
+            sent++;
+        }
+    }
+    /* the receiver stops once nothing arrived for the receive timeout */
+    pthread_join(server, NULL);
+    lwip_close_r(tx);
+    lwip_close_r(rx);
+    *rx_pps = udp_received / t;
+    return sent / t;
+}
+
+static double test_tcp_crr(void)
+{
+    char buf[RR_SIZE] = { 0 };
+    unsigned long conns = 0;
+    pthread_t server;
+    double t0, t;
+    int listener, s;
+
+    listener = tcp_listener();
+    pthread_create(&server, NULL, crr_server, &listener);
+    t0 = now_sec();
+    while ((t = now_sec() - t0) < run_sec) {
+        s = tcp_connect(true);
+        if (lwip_send_r(s, buf, sizeof(buf), 0) != sizeof(buf) ||
+            !read_full(s, buf, sizeof(buf))) {
+            fail("transaction");
+        }
+        lwip_close_r(s);
+        conns++;
+    }
+    s = tcp_connect(true);
+    buf[0] = CRR_QUIT;
+    lwip_send_r(s, buf, sizeof(buf), 0);
+    read_full(s, buf, sizeof(buf));
+    lwip_close_r(s);
+    pthread_join(server, NULL);
+    lwip_close_r(listener);
+    return conns / t;
+}
+
+static void usage(void)
+{
+    printf("usage: perf_lwip [-t seconds] [-d delay_ms] [-l loss_percent] [-m mtu] [-w window_mss]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    double stream, rr, latency, udp_tx, udp_rx, crr;
+    sys_sem_t sem;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (argv[i][0] != '-' || argv[i][1] == 0 || argv[i][2] != 0 || i + 1 == argc) {
+            usage();
+        }
+        switch (argv[i++][1]) {
+        case 't': run_sec = atof(argv[i]); break;
+        case 'd': params.delay_ms = atoi(argv[i]); break;
+        case 'l': params.loss_ppm = (u32_t) (atof(argv[i]) * 10000); break;
+        case 'm': params.mtu = atoi(argv[i]); break;
+        case 'w': window_mss = atoi(argv[i]); break;
+        default: usage();
+        }
+    }
+    params.seed = 1;
+    /* results show up as the tests finish, also when piped */
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    sys_sem_new(&sem, 0);
+    tcpip_init(tcpip_init_done, &sem);
+    sys_arch_sem_wait(&sem, 0);
+
+    printf("netsim pair: delay %u ms each way, loss %.2f%%, mtu %u, %.1f s per test\n",
+           (unsigned) params.delay_ms, params.loss_ppm / 10000.0,
+           (unsigned) pair.link[0].mtu, run_sec);
+    server_port = SERVER_PORT + 0;
+    stream = test_tcp_stream();
+    printf("tcp_stream  %10.1f Mbit/s\n", stream);
+    server_port = SERVER_PORT + 1;
+    rr = test_tcp_rr(&latency);
+    printf("tcp_rr      %10.0f trans/s  %8.1f us/trans\n", rr, latency);
+    server_port = SERVER_PORT + 2;
+    udp_tx = test_udp_stream(&udp_rx);
+    printf("udp_stream  %10.0f pps sent %10.0f pps received\n", udp_tx, udp_rx);
+    server_port = SERVER_PORT + 3;
+    crr = test_tcp_crr();
+    printf("tcp_crr     %10.0f conn/s\n", crr);
+    printf("link drops: %lu lost, %lu tail dropped, %lu over mtu\n",
+           pair.link[0].lost + pair.link[1].lost,
+           pair.link[0].dropped + pair.link[1].dropped,
+           pair.link[0].oversize + pair.link[1].oversize);
+#if ESP_NETSTATS
+    /* netsim links carry IP packets, so the frame counters stay at zero */
+    printf("stack: %u rto, %u fast rexmit, %u ooseq (max queue %u), %u mbox full, %u pbuf alloc fail\n",
+           (unsigned) netstats.core[0].tcp_rexmit_rto, (unsigned) netstats.core[0].tcp_rexmit_fast,
+           (unsigned) netstats.core[0].tcp_ooseq, (unsigned) netstats.tcp_ooseq_max,
+           (unsigned) netstats.core[0].mbox_post_fail, (unsigned) netstats.core[0].pbuf_alloc_fail);
+    printf("memp high-water: %u tcp_pcb, %u tcp_seg, %u netconn, %u tcpip_msg\n",
+           (unsigned) netstats.memp_max[MEMP_TCP_PCB], (unsigned) netstats.memp_max[MEMP_TCP_SEG],
+           (unsigned) netstats.memp_max[MEMP_NETCONN],
+           (unsigned) (netstats.memp_max[MEMP_TCPIP_MSG_API] + netstats.memp_max[MEMP_TCPIP_MSG_INPKT]));
+#endif
+
+    return (stream > 0 && rr > 0 && udp_rx > 0 && crr > 0) ? 0 : 1;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#define CONFIG_LWIP_MAX_SOCKETS 10
+#ifndef CONFIG_LWIP_MAX_ACTIVE_TCP
+#define CONFIG_LWIP_MAX_ACTIVE_TCP 16
+#endif
+#define CONFIG_LWIP_THREAD_LOCAL_STORAGE_INDEX 0
+#ifndef CONFIG_LWIP_SO_REUSE
+#define CONFIG_LWIP_SO_REUSE 0
+#endif
+#define CONFIG_LWIP_DHCP_MAX_NTP_SERVERS 1
+#define CONFIG_L2_TO_L3_COPY 0
+#ifndef CONFIG_LWIP_PCB_HASH
+#define CONFIG_LWIP_PCB_HASH 0
+#endif
+#ifndef CONFIG_LWIP_TCP_WND_DEFAULT
+#define CONFIG_LWIP_TCP_WND_DEFAULT 5840
+#endif
+#ifndef CONFIG_LWIP_TCP_SND_BUF_DEFAULT
+#define CONFIG_LWIP_TCP_SND_BUF_DEFAULT 2920
+#endif
+#ifndef CONFIG_LWIP_TCP_WND_MAX
+#define CONFIG_LWIP_TCP_WND_MAX 65535
+#endif
+#define CONFIG_FREERTOS_UNICORE 1
+#ifndef CONFIG_LWIP_NETSTATS
+#define CONFIG_LWIP_NETSTATS 1
+#endif
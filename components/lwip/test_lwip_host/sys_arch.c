@@ -0,0 +1,400 @@
+/*
+ * Host (Linux) implementation of the lwIP sys_arch layer used by
+ * test_lwip_host. Semaphores, mutexes, mailboxes and threads follow the
+ * semantics of port/freertos/sys_arch.c (binary semaphores, fixed size
+ * mailboxes, timeouts in milliseconds with 0 meaning forever) so that the
+ * stack runs with a real tcpip thread.
+ */
+#define _GNU_SOURCE /* PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "lwip/sys.h"
+#include "lwip/stats.h"
+
+struct sys_sem_s {
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    bool            given;
+};
+
+struct sys_mutex_s {
+    pthread_mutex_t lock;
+};
+
+struct sys_mbox_s {
+    pthread_mutex_t lock;
+    pthread_cond_t  not_empty;
+    pthread_cond_t  not_full;
+    int             size;
+    int             head;
+    int             count;
+    int             waiters;
+    bool            alive;
+    void          **msgs;
+};
+
+static pthread_mutex_t s_protect_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static __thread sys_sem_t *s_thread_sem;
+
+static void deadline_after(struct timespec *ts, u32_t timeout_ms)
+{
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec += timeout_ms / 1000;
+    ts->tv_nsec += (long) (timeout_ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static void cond_init_monotonic(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static u32_t elapsed_ms(u32_t start)
+{
+    u32_t elapsed = sys_now() - start;
+    /* 0 would read as "did not wait" */
+    return elapsed == 0 ? 1 : elapsed;
+}
+
+err_t sys_mutex_new(sys_mutex_t *mutex)
+{
+    *mutex = malloc(sizeof(struct sys_mutex_s));
+    if (*mutex == NULL) {
+        return ERR_MEM;
+    }
+    pthread_mutex_init(&(*mutex)->lock, NULL);
+    return ERR_OK;
+}
+
+void sys_mutex_lock(sys_mutex_t *mutex)
+{
+    pthread_mutex_lock(&(*mutex)->lock);
+}
+
+void sys_mutex_unlock(sys_mutex_t *mutex)
+{
+    pthread_mutex_unlock(&(*mutex)->lock);
+}
+
+void sys_mutex_free(sys_mutex_t *mutex)
+{
+    pthread_mutex_destroy(&(*mutex)->lock);
+    free(*mutex);
+    *mutex = NULL;
+}
+
+err_t sys_sem_new(sys_sem_t *sem, u8_t count)
+{
+    *sem = malloc(sizeof(struct sys_sem_s));
+    if (*sem == NULL) {
+        return ERR_MEM;
+    }
+    pthread_mutex_init(&(*sem)->lock, NULL);
+    cond_init_monotonic(&(*sem)->cond);
+    (*sem)->given = (count != 0);
+    return ERR_OK;
+}
+
+void sys_sem_signal(sys_sem_t *sem)
+{
+    pthread_mutex_lock(&(*sem)->lock);
+    (*sem)->given = true;
+    pthread_cond_signal(&(*sem)->cond);
+    pthread_mutex_unlock(&(*sem)->lock);
+}
+
+u32_t sys_arch_sem_wait(sys_sem_t *sem, u32_t timeout)
+{
+    struct timespec deadline;
+    u32_t start = sys_now();
+    int rc = 0;
+
+    if (timeout != 0) {
+        deadline_after(&deadline, timeout);
+    }
+    pthread_mutex_lock(&(*sem)->lock);
+    while (!(*sem)->given && rc != ETIMEDOUT) {
+        if (timeout != 0) {
+            rc = pthread_cond_timedwait(&(*sem)->cond, &(*sem)->lock, &deadline);
+        } else {
+            pthread_cond_wait(&(*sem)->cond, &(*sem)->lock);
+        }
+    }
+    if (!(*sem)->given) {
+        pthread_mutex_unlock(&(*sem)->lock);
+        return SYS_ARCH_TIMEOUT;
+    }
+    (*sem)->given = false;
+    pthread_mutex_unlock(&(*sem)->lock);
+    return elapsed_ms(start);
+}
+
+void sys_sem_free(sys_sem_t *sem)
+{
+    pthread_cond_destroy(&(*sem)->cond);
+    pthread_mutex_destroy(&(*sem)->lock);
+    free(*sem);
+    *sem = NULL;
+}
+
+err_t sys_mbox_new(sys_mbox_t *mbox, int size)
+{
+    *mbox = malloc(sizeof(struct sys_mbox_s));
+    if (*mbox == NULL) {
+        return ERR_MEM;
+    }
+    (*mbox)->msgs = calloc(size, sizeof(void *));
+    if ((*mbox)->msgs == NULL) {
+        free(*mbox);
+        *mbox = NULL;
+        return ERR_MEM;
+    }
+    pthread_mutex_init(&(*mbox)->lock, NULL);
+    cond_init_monotonic(&(*mbox)->not_empty);
+    cond_init_monotonic(&(*mbox)->not_full);
+    (*mbox)->size = size;
+    (*mbox)->head = 0;
+    (*mbox)->count = 0;
+    (*mbox)->waiters = 0;
+    (*mbox)->alive = true;
+    return ERR_OK;
+}
+
+static void mbox_put_locked(struct sys_mbox_s *mb, void *msg)
+{
+    mb->msgs[(mb->head + mb->count) % mb->size] = msg;
+    mb->count++;
+    pthread_cond_signal(&mb->not_empty);
+}
+
+static void *mbox_get_locked(struct sys_mbox_s *mb)
+{
+    void *msg = mb->msgs[mb->head];
+    mb->head = (mb->head + 1) % mb->size;
+    mb->count--;
+    pthread_cond_signal(&mb->not_full);
+    return msg;
+}
+
+void sys_mbox_post(sys_mbox_t *mbox, void *msg)
+{
+    struct sys_mbox_s *mb = *mbox;
+    pthread_mutex_lock(&mb->lock);
+    while (mb->count == mb->size) {
+        pthread_cond_wait(&mb->not_full, &mb->lock);
+    }
+    mbox_put_locked(mb, msg);
+    pthread_mutex_unlock(&mb->lock);
+}
+
+err_t sys_mbox_trypost(sys_mbox_t *mbox, void *msg)
+{
+    struct sys_mbox_s *mb = *mbox;
+    err_t err = ERR_MEM;
+    pthread_mutex_lock(&mb->lock);
+    if (mb->count < mb->size) {
+        mbox_put_locked(mb, msg);
+        err = ERR_OK;
+    } else {
+        NETSTATS_INC(mbox_post_fail);
+    }
+    pthread_mutex_unlock(&mb->lock);
+    return err;
+}
+
+u32_t sys_arch_mbox_fetch(sys_mbox_t *mbox, void **msg, u32_t timeout)
+{
+    struct sys_mbox_s *mb = *mbox;
+    struct timespec deadline;
+    void *dummy;
+    u32_t start = sys_now();
+    int rc = 0;
+
+    if (msg == NULL) {
+        msg = &dummy;
+    }
+    if (timeout != 0) {
+        deadline_after(&deadline, timeout);
+    }
+    pthread_mutex_lock(&mb->lock);
+    mb->waiters++;
+    while (mb->count == 0 && mb->alive && rc != ETIMEDOUT) {
+        if (timeout != 0) {
+            rc = pthread_cond_timedwait(&mb->not_empty, &mb->lock, &deadline);
+        } else {
+            pthread_cond_wait(&mb->not_empty, &mb->lock);
+        }
+    }
+    mb->waiters--;
+    if (mb->count == 0) {
+        /* timed out, or the mailbox is being freed (see sys_mbox_free) */
+        bool alive = mb->alive;
+        *msg = NULL;
+        if (!alive) {
+            pthread_cond_broadcast(&mb->not_full);
+        }
+        pthread_mutex_unlock(&mb->lock);
+        return alive ? SYS_ARCH_TIMEOUT : elapsed_ms(start);
+    }
+    *msg = mbox_get_locked(mb);
+    pthread_mutex_unlock(&mb->lock);
+    return elapsed_ms(start);
+}
+
+u32_t sys_arch_mbox_tryfetch(sys_mbox_t *mbox, void **msg)
+{
+    struct sys_mbox_s *mb = *mbox;
+    void *dummy;
+    u32_t ret = SYS_MBOX_EMPTY;
+
+    if (msg == NULL) {
+        msg = &dummy;
+    }
+    pthread_mutex_lock(&mb->lock);
+    if (mb->count > 0) {
+        *msg = mbox_get_locked(mb);
+        ret = 0;
+    }
+    pthread_mutex_unlock(&mb->lock);
+    return ret;
+}
+
+void sys_mbox_free(sys_mbox_t *mbox)
+{
+    struct sys_mbox_s *mb = *mbox;
+
+    /* like the FreeRTOS port, wake up a consumer that is still blocked
+       (it gets a NULL message) before the mailbox goes away */
+    pthread_mutex_lock(&mb->lock);
+    mb->alive = false;
+    pthread_cond_broadcast(&mb->not_empty);
+    while (mb->waiters > 0) {
+        pthread_cond_wait(&mb->not_full, &mb->lock);
+    }
+    pthread_mutex_unlock(&mb->lock);
+    pthread_cond_destroy(&mb->not_empty);
+    pthread_cond_destroy(&mb->not_full);
+    pthread_mutex_destroy(&mb->lock);
+    free(mb->msgs);
+    free(mb);
+    *mbox = NULL;
+}
+
+struct thread_start {
+    lwip_thread_fn fn;
+    void *arg;
+};
+
+static void *thread_trampoline(void *p)
+{
+    struct thread_start start = *(struct thread_start *) p;
+    free(p);
+    start.fn(start.arg);
+    return NULL;
+}
+
+sys_thread_t sys_thread_new(const char *name, lwip_thread_fn thread, void *arg, int stacksize, int prio)
+{
+    pthread_t tid;
+    struct thread_start *start = malloc(sizeof(*start));
+
+    (void) name;
+    (void) stacksize;
+    (void) prio;
+    if (start == NULL) {
+        return 0;
+    }
+    start->fn = thread;
+    start->arg = arg;
+    if (pthread_create(&tid, NULL, thread_trampoline, start) != 0) {
+        free(start);
+        return 0;
+    }
+    pthread_detach(tid);
+    return (sys_thread_t) tid;
+}
+
+void sys_init(void)
+{
+}
+
+u32_t sys_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u32_t) (ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000);
+}
+
+sys_prot_t sys_arch_protect(void)
+{
+    pthread_mutex_lock(&s_protect_lock);
+    return 0;
+}
+
+void sys_arch_unprotect(sys_prot_t pval)
+{
+    (void) pval;
+    pthread_mutex_unlock(&s_protect_lock);
+}
+
+uint32_t system_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) (ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+void sys_arch_assert(const char *file, int line)
+{
+    fprintf(stderr, "lwip assertion failed at %s:%d\n", file, line);
+    abort();
+}
+
+sys_sem_t *sys_thread_sem_get(void)
+{
+    if (s_thread_sem == NULL) {
+        s_thread_sem = sys_thread_sem_init();
+    }
+    return s_thread_sem;
+}
+
+sys_sem_t *sys_thread_sem_init(void)
+{
+    sys_sem_t *sem = malloc(sizeof(sys_sem_t));
+    if (sem == NULL) {
+        return NULL;
+    }
+    if (sys_sem_new(sem, 0) != ERR_OK) {
+        free(sem);
+        return NULL;
+    }
+    s_thread_sem = sem;
+    return sem;
+}
+
+void sys_thread_sem_deinit(void)
+{
+    if (s_thread_sem != NULL) {
+        sys_sem_free(s_thread_sem);
+        free(s_thread_sem);
+        s_thread_sem = NULL;
+    }
+}
+
+void sys_delay_ms(uint32_t ms)
+{
+    usleep(ms * 1000);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+/* Host stand-in for components/tcpip_adapter/include/tcpip_adapter.h, as
+   far as apps/dhcpserver.c uses it */
+#include "lwip/ip_addr.h"
+
+typedef enum {
+    ESP_IF_WIFI_STA = 0,
+    ESP_IF_WIFI_AP,
+    ESP_IF_ETH,
+} tcpip_adapter_if_t;
+
+typedef struct {
+    ip4_addr_t ip;
+    ip4_addr_t netmask;
+    ip4_addr_t gw;
+} tcpip_adapter_ip_info_t;
+
+int tcpip_adapter_get_ip_info(tcpip_adapter_if_t tcpip_if, tcpip_adapter_ip_info_t *ip_info);
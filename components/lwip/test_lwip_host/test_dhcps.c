@@ -0,0 +1,317 @@
+/*
+ * Host test for the DHCP server lease table.
+ *
+ * Replays an association storm against apps/dhcpserver.c: a full pool of
+ * stations sends DISCOVER and then REQUEST through ip4_input(), and the
+ * replies are picked up from the netif output. The test checks that every
+ * station gets its own address and keeps it, that released addresses are
+ * reused, that the lease ending first is evicted when the pool is used up
+ * and that leases end on the minute. It then times a long storm of new
+ * stations, which keeps the pool full and evicting.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lwip/init.h"
+#include "lwip/mem.h"
+#include "lwip/memp.h"
+#include "lwip/netif.h"
+#include "lwip/ip4.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/udp.h"
+#include "lwip/tcpip.h"
+#include "apps/dhcpserver.h"
+#include "tcpip_adapter.h"
+
+#define POOL_SIZE       DHCPS_MAX_LEASE
+#define STORM_ROUNDS    2000
+
+#define DHCPDISCOVER    1
+#define DHCPOFFER       2
+#define DHCPREQUEST     3
+#define DHCPACK         5
+#define DHCPNAK         6
+#define DHCPRELEASE     7
+
+static struct netif test_netif;
+static ip4_addr_t server_addr;
+static struct dhcps_msg reply;
+static int reply_type;
+static int failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+void esp_wifi_internal_free_rx_buffer(void *buffer)
+{
+}
+
+err_t tcpip_callback_with_block(tcpip_callback_fn function, void *ctx, u8_t block)
+{
+    return ERR_MEM;
+}
+
+int tcpip_adapter_get_ip_info(tcpip_adapter_if_t tcpip_if, tcpip_adapter_ip_info_t *ip_info)
+{
+    ip_info->ip = server_addr;
+    ip_info->gw = server_addr;
+    IP4_ADDR(&ip_info->netmask, 255, 255, 255, 0);
+    return 0;
+}
+
+static err_t test_netif_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+    memset(&reply, 0, sizeof(reply));
+    pbuf_copy_partial(p, &reply, sizeof(reply), IP_HLEN + UDP_HLEN);
+    /* the server puts the message type right after the magic cookie */
+    reply_type = (reply.options[4] == 53) ? reply.options[6] : -1;
+    return ERR_OK;
+}
+
+static err_t test_netif_init(struct netif *netif)
+{
+    netif->output = test_netif_output;
+    netif->mtu = 1500;
+    netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_LINK_UP;
+    return ERR_OK;
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void station_mac(u32_t n, u8_t *mac)
+{
+    mac[0] = 0x02;
+    mac[1] = 0x00;
+    mac[2] = (u8_t)(n >> 24);
+    mac[3] = (u8_t)(n >> 16);
+    mac[4] = (u8_t)(n >> 8);
+    mac[5] = (u8_t)n;
+}
+
+/* Send a DHCP message from a station and return the type of the reply,
+   or 0 if there was none. */
+static int send_dhcp(u32_t station, int type, const ip4_addr_t *ciaddr, const ip4_addr_t *requested)
+{
+    const u16_t len = IP_HLEN + UDP_HLEN + sizeof(struct dhcps_msg);
+    struct pbuf *p = pbuf_alloc(PBUF_RAW, len, PBUF_RAM);
+    struct ip_hdr *iphdr = (struct ip_hdr *)p->payload;
+    struct udp_hdr *udphdr = (struct udp_hdr *)((u8_t *)p->payload + IP_HLEN);
+    struct dhcps_msg *m = (struct dhcps_msg *)((u8_t *)udphdr + UDP_HLEN);
+    u8_t *opt = m->options;
+
+    memset(p->payload, 0, len);
+    IPH_VHL_SET(iphdr, 4, IP_HLEN / 4);
+    IPH_LEN_SET(iphdr, htons(len));
+    IPH_TTL_SET(iphdr, 64);
+    IPH_PROTO_SET(iphdr, IP_PROTO_UDP);
+    ip4_addr_set_any(&iphdr->src);
+    ip4_addr_set_u32(&iphdr->dest, IPADDR_BROADCAST);
+    IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
+    udphdr->src = htons(68);
+    udphdr->dest = htons(67);
+    udphdr->len = htons(len - IP_HLEN);
+
+    m->op = 1;
+    m->htype = 1;
+    m->hlen = 6;
+    memcpy(m->xid, &station, sizeof(m->xid));
+    station_mac(station, m->chaddr);
+    if (ciaddr != NULL) {
+        memcpy(m->ciaddr, &ciaddr->addr, sizeof(m->ciaddr));
+    }
+    *opt++ = 0x63;
+    *opt++ = 0x82;
+    *opt++ = 0x53;
+    *opt++ = 0x63;
+    *opt++ = 53;
+    *opt++ = 1;
+    *opt++ = type;
+    if (requested != NULL) {
+        *opt++ = 50;
+        *opt++ = 4;
+        memcpy(opt, &requested->addr, 4);
+        opt += 4;
+    }
+    *opt++ = 255;
+
+    reply_type = 0;
+    ip4_input(p, &test_netif);
+    return reply_type;
+}
+
+static void reply_addr(ip4_addr_t *addr)
+{
+    memcpy(&addr->addr, reply.yiaddr, sizeof(addr->addr));
+}
+
+/* DISCOVER and REQUEST, returns the address acknowledged or 0 */
+static u32_t join(u32_t station)
+{
+    ip4_addr_t offered, acked;
+
+    if (send_dhcp(station, DHCPDISCOVER, NULL, NULL) != DHCPOFFER) {
+        return 0;
+    }
+    reply_addr(&offered);
+    if (send_dhcp(station, DHCPREQUEST, NULL, &offered) != DHCPACK) {
+        return 0;
+    }
+    reply_addr(&acked);
+    return ip4_addr_cmp(&offered, &acked) ? acked.addr : 0;
+}
+
+static u32_t lease_of(u32_t station)
+{
+    u8_t mac[6];
+    ip4_addr_t addr;
+
+    station_mac(station, mac);
+    return dhcp_search_ip_on_mac(mac, &addr) ? addr.addr : 0;
+}
+
+static void test_storm(void)
+{
+    static u32_t addr[POOL_SIZE + 2];
+    ip4_addr_t offered, ip;
+    u32_t i, j, first, last;
+    int type;
+
+    first = ntohl(server_addr.addr) + 1;
+    last = first + POOL_SIZE - 1;
+
+    /* every station of a full pool discovers before any of them requests */
+    for (i = 0; i < POOL_SIZE; i++) {
+        CHECK(send_dhcp(i, DHCPDISCOVER, NULL, NULL) == DHCPOFFER);
+        reply_addr(&offered);
+        addr[i] = offered.addr;
+        CHECK(ntohl(addr[i]) >= first && ntohl(addr[i]) <= last);
+        for (j = 0; j < i; j++) {
+            CHECK(addr[j] != addr[i]);
+        }
+    }
+    for (i = 0; i < POOL_SIZE; i++) {
+        ip.addr = addr[i];
+        CHECK(send_dhcp(i, DHCPREQUEST, NULL, &ip) == DHCPACK);
+        reply_addr(&offered);
+        CHECK(offered.addr == addr[i]);
+        CHECK(lease_of(i) == addr[i]);
+    }
+
+    /* known stations keep their address, also when renewing */
+    CHECK(join(7) == addr[7]);
+    ip.addr = addr[8];
+    CHECK(send_dhcp(8, DHCPREQUEST, &ip, NULL) == DHCPACK);
+    /* requesting an address which is not the lease fails */
+    CHECK(send_dhcp(9, DHCPREQUEST, NULL, &ip) == DHCPNAK);
+
+    /* a released address goes to the next new station */
+    ip.addr = addr[0];
+    send_dhcp(0, DHCPRELEASE, &ip, NULL);
+    CHECK(lease_of(0) == 0);
+    addr[POOL_SIZE] = join(POOL_SIZE);
+    CHECK(addr[POOL_SIZE] == addr[0]);
+
+    /* a minute later everybody renews except station 5, whose lease then
+       ends first and makes room for a new station in the minute after */
+    dhcps_coarse_tmr();
+    for (i = 1; i <= POOL_SIZE; i++) {
+        if (i != 5) {
+            ip.addr = addr[i];
+            CHECK(send_dhcp(i, DHCPREQUEST, &ip, NULL) == DHCPACK);
+        }
+    }
+    dhcps_coarse_tmr();
+    addr[POOL_SIZE + 1] = join(POOL_SIZE + 1);
+    CHECK(addr[POOL_SIZE + 1] == addr[5]);
+    CHECK(lease_of(5) == 0);
+    CHECK(lease_of(POOL_SIZE + 1) == addr[5]);
+
+    /* the renewed leases end DHCPS_LEASE_TIME_DEF minutes after the renewal,
+       the last one one minute after that; the wheel has fewer slots than
+       that, so the leases are passed over once before they end */
+    for (i = 3; i <= DHCPS_LEASE_TIME_DEF; i++) {
+        dhcps_coarse_tmr();
+    }
+    CHECK(lease_of(1) == addr[1]);
+    CHECK(lease_of(POOL_SIZE + 1) == addr[5]);
+    dhcps_coarse_tmr();
+    CHECK(lease_of(1) == 0);
+    CHECK(lease_of(POOL_SIZE) == 0);
+    CHECK(lease_of(POOL_SIZE + 1) == addr[5]);
+    dhcps_coarse_tmr();
+    CHECK(lease_of(POOL_SIZE + 1) == 0);
+
+    /* with the pool empty again, the next station does not need eviction */
+    type = send_dhcp(POOL_SIZE + 2, DHCPDISCOVER, NULL, NULL);
+    CHECK(type == DHCPOFFER);
+}
+
+static void bench_storm(void)
+{
+    u32_t station = 1000;
+    u32_t packets = 0;
+    double t0, t;
+    int i, j;
+
+    t0 = now_sec();
+    for (i = 0; i < STORM_ROUNDS; i++) {
+        /* each round a pool's worth of new stations joins and renews once,
+           pushing out the stations of the previous round */
+        for (j = 0; j < POOL_SIZE; j++) {
+            CHECK(join(station + j) != 0);
+        }
+        for (j = 0; j < POOL_SIZE; j++) {
+            ip4_addr_t ip;
+            ip.addr = lease_of(station + j);
+            CHECK(send_dhcp(station + j, DHCPREQUEST, &ip, NULL) == DHCPACK);
+        }
+        packets += 3 * POOL_SIZE;
+        station += POOL_SIZE;
+        if (i % 10 == 0) {
+            dhcps_coarse_tmr();
+        }
+    }
+    t = now_sec() - t0;
+    printf("dhcps storm: %u stations, %u packets in %.3f s, %.2f us/packet\n",
+           (unsigned)(station - 1000), (unsigned)packets, t, t * 1e6 / packets);
+}
+
+int main(void)
+{
+    ip4_addr_t mask, gw;
+
+    mem_init();
+    memp_init();
+    netif_init();
+    udp_init();
+
+    IP4_ADDR(&server_addr, 192, 168, 4, 1);
+    IP4_ADDR(&mask, 255, 255, 255, 0);
+    IP4_ADDR(&gw, 192, 168, 4, 1);
+    netif_add(&test_netif, &server_addr, &mask, &gw, NULL, test_netif_init, ip4_input);
+    netif_set_default(&test_netif);
+    netif_set_up(&test_netif);
+
+    dhcps_start(&test_netif, server_addr);
+    test_storm();
+    bench_storm();
+    dhcps_stop(&test_netif);
+
+    if (failures != 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("dhcps lease table tests passed\n");
+    return 0;
+}
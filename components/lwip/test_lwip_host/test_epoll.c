@@ -0,0 +1,390 @@
+/*
+ * Host test for lwip_epoll_create/lwip_epoll_ctl/lwip_epoll_wait.
+ *
+ * Runs the stack with a real tcpip thread (see sys_arch.c). Sockets are
+ * made readable by sending them datagrams that are looped back through the
+ * netif, and the test checks what lwip_epoll_wait reports for them:
+ * level-triggered, EPOLLET and EPOLLONESHOT registrations, EPOLL_CTL_DEL,
+ * closing sockets that are registered (also while another thread waits)
+ * and timeouts of 0, > 0 and -1.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "lwip/init.h"
+#include "lwip/netif.h"
+#include "lwip/sockets.h"
+#include "lwip/tcpip.h"
+
+#define PORT_BASE       6000
+#define WAIT_MS         100
+
+static struct netif test_netif;
+static sys_sem_t barrier_sem;
+static int tx;
+static int failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+void esp_wifi_internal_free_rx_buffer(void *buffer)
+{
+}
+
+void dhcps_coarse_tmr(void)
+{
+}
+
+static err_t test_netif_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+    return ERR_OK;
+}
+
+static err_t test_netif_init(struct netif *netif)
+{
+    netif->output = test_netif_output;
+    netif->mtu = 1500;
+    netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_LINK_UP;
+    return ERR_OK;
+}
+
+static void signal_sem(void *arg)
+{
+    sys_sem_signal((sys_sem_t *) arg);
+}
+
+static void tcpip_init_done(void *arg)
+{
+    ip4_addr_t addr, mask, gw;
+    IP4_ADDR(&addr, 10, 0, 0, 1);
+    IP4_ADDR(&mask, 255, 0, 0, 0);
+    IP4_ADDR(&gw, 10, 0, 0, 254);
+    netif_add(&test_netif, &addr, &mask, &gw, NULL, test_netif_init, tcpip_input);
+    netif_set_default(&test_netif);
+    netif_set_up(&test_netif);
+    signal_sem(arg);
+}
+
+static void make_addr(struct sockaddr_in *sa, u32_t addr, int port)
+{
+    memset(sa, 0, sizeof(*sa));
+    sa->sin_len = sizeof(*sa);
+    sa->sin_family = AF_INET;
+    sa->sin_port = htons(port);
+    sa->sin_addr.s_addr = htonl(addr);
+}
+
+/* a UDP socket bound to PORT_BASE + n */
+static int open_socket(int n)
+{
+    struct sockaddr_in addr;
+    int s = lwip_socket(AF_INET, SOCK_DGRAM, 0);
+
+    make_addr(&addr, 0, PORT_BASE + n);
+    if (s < 0 || lwip_bind_r(s, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        printf("socket setup failed\n");
+        exit(1);
+    }
+    return s;
+}
+
+/* Make the socket bound to PORT_BASE + n readable, and wait until the
+   datagram has been looped back to it */
+static void send_to(int n)
+{
+    struct sockaddr_in to;
+
+    make_addr(&to, 0x0a000001, PORT_BASE + n);
+    CHECK(lwip_sendto_r(tx, "x", 1, 0, (struct sockaddr *) &to, sizeof(to)) == 1);
+    tcpip_callback(signal_sem, &barrier_sem);
+    sys_arch_sem_wait(&barrier_sem, 0);
+}
+
+static int drain(int s)
+{
+    char buf[16];
+    int n = 0;
+
+    while (lwip_recvfrom_r(s, buf, sizeof(buf), MSG_DONTWAIT, NULL, NULL) > 0) {
+        n++;
+    }
+    return n;
+}
+
+static int add(int ep, int op, int s, u32_t events)
+{
+    struct epoll_event ev;
+
+    ev.events = events;
+    ev.data.fd = s;
+    return lwip_epoll_ctl(ep, op, s, &ev);
+}
+
+/* lwip_epoll_wait with a timeout of 0, returns the number of events and
+   the socket of the first one */
+static int poll_ep(int ep, int *s)
+{
+    struct epoll_event ev[4];
+    int n = lwip_epoll_wait(ep, ev, 4, 0);
+
+    if (n > 0 && s != NULL) {
+        *s = ev[0].data.fd;
+    }
+    return n;
+}
+
+struct waiter {
+    pthread_t thread;
+    int ep;
+    int timeout;
+    int n;
+    struct epoll_event ev[4];
+    u32_t elapsed;
+    volatile int done;
+};
+
+static void *waiter_main(void *arg)
+{
+    struct waiter *w = (struct waiter *) arg;
+    u32_t start = sys_now();
+
+    w->n = lwip_epoll_wait(w->ep, w->ev, 4, w->timeout);
+    w->elapsed = sys_now() - start;
+    w->done = 1;
+    return NULL;
+}
+
+static void waiter_start(struct waiter *w, int ep, int timeout)
+{
+    memset(w, 0, sizeof(*w));
+    w->ep = ep;
+    w->timeout = timeout;
+    pthread_create(&w->thread, NULL, waiter_main, w);
+}
+
+static void test_triggers(int ep, int *s)
+{
+    int fd, i;
+
+    /* level-triggered: reported until read */
+    CHECK(add(ep, EPOLL_CTL_ADD, s[0], EPOLLIN) == 0);
+    CHECK(poll_ep(ep, NULL) == 0);
+    send_to(0);
+    for (i = 0; i < 3; i++) {
+        fd = -1;
+        CHECK(poll_ep(ep, &fd) == 1 && fd == s[0]);
+    }
+    CHECK(drain(s[0]) == 1);
+    CHECK(poll_ep(ep, NULL) == 0);
+
+    /* EPOLLET: reported once for each new datagram */
+    CHECK(add(ep, EPOLL_CTL_ADD, s[1], EPOLLIN | EPOLLET) == 0);
+    send_to(1);
+    CHECK(poll_ep(ep, &fd) == 1 && fd == s[1]);
+    CHECK(poll_ep(ep, NULL) == 0);
+    send_to(1);
+    CHECK(poll_ep(ep, &fd) == 1 && fd == s[1]);
+    CHECK(poll_ep(ep, NULL) == 0);
+    CHECK(drain(s[1]) == 2);
+
+    /* EPOLLONESHOT: reported once, then nothing until EPOLL_CTL_MOD */
+    CHECK(add(ep, EPOLL_CTL_ADD, s[2], EPOLLIN | EPOLLONESHOT) == 0);
+    send_to(2);
+    CHECK(poll_ep(ep, &fd) == 1 && fd == s[2]);
+    CHECK(poll_ep(ep, NULL) == 0);
+    send_to(2);
+    CHECK(poll_ep(ep, NULL) == 0);
+    CHECK(add(ep, EPOLL_CTL_MOD, s[2], EPOLLIN | EPOLLONESHOT) == 0);
+    CHECK(poll_ep(ep, &fd) == 1 && fd == s[2]);
+    CHECK(poll_ep(ep, NULL) == 0);
+    CHECK(drain(s[2]) == 2);
+    CHECK(add(ep, EPOLL_CTL_MOD, s[2], EPOLLIN | EPOLLONESHOT) == 0);
+    CHECK(poll_ep(ep, NULL) == 0);
+    send_to(2);
+    CHECK(poll_ep(ep, &fd) == 1 && fd == s[2]);
+    CHECK(drain(s[2]) == 1);
+
+    /* EPOLLOUT: a UDP socket can always be written */
+    CHECK(add(ep, EPOLL_CTL_MOD, s[2], EPOLLOUT) == 0);
+    CHECK(poll_ep(ep, &fd) == 1 && fd == s[2]);
+
+    /* EPOLL_CTL_DEL: a ready socket is not reported any more */
+    CHECK(add(ep, EPOLL_CTL_DEL, s[2], 0) == 0);
+    CHECK(poll_ep(ep, NULL) == 0);
+    CHECK(add(ep, EPOLL_CTL_MOD, s[2], EPOLLIN) == -1 && errno == ENOENT);
+    CHECK(lwip_epoll_ctl(ep, EPOLL_CTL_DEL, s[2], NULL) == -1 && errno == ENOENT);
+    send_to(0);
+    CHECK(add(ep, EPOLL_CTL_DEL, s[0], 0) == 0);
+    CHECK(poll_ep(ep, NULL) == 0);
+    CHECK(add(ep, EPOLL_CTL_ADD, s[0], EPOLLIN) == 0);
+    CHECK(poll_ep(ep, &fd) == 1 && fd == s[0]);
+    CHECK(drain(s[0]) == 1);
+    CHECK(add(ep, EPOLL_CTL_DEL, s[0], 0) == 0);
+    CHECK(add(ep, EPOLL_CTL_DEL, s[1], 0) == 0);
+}
+
+static void test_round_robin(int ep, int *s)
+{
+    struct epoll_event ev[2];
+    int i;
+
+    /* level-triggered sockets take turns when maxevents is short */
+    for (i = 0; i < 3; i++) {
+        CHECK(add(ep, EPOLL_CTL_ADD, s[i], EPOLLIN) == 0);
+        send_to(i);
+    }
+    CHECK(lwip_epoll_wait(ep, ev, 2, 0) == 2);
+    CHECK(ev[0].data.fd == s[0] && ev[1].data.fd == s[1]);
+    CHECK(lwip_epoll_wait(ep, ev, 2, 0) == 2);
+    CHECK(ev[0].data.fd == s[2] && ev[1].data.fd == s[0]);
+    for (i = 0; i < 3; i++) {
+        CHECK(drain(s[i]) == 1);
+    }
+    CHECK(lwip_epoll_wait(ep, ev, 2, 0) == 0);
+    for (i = 0; i < 3; i++) {
+        CHECK(add(ep, EPOLL_CTL_DEL, s[i], 0) == 0);
+    }
+}
+
+static void test_timeouts(int ep, int *s)
+{
+    struct waiter w;
+    struct epoll_event ev;
+    u32_t start;
+
+    CHECK(add(ep, EPOLL_CTL_ADD, s[0], EPOLLIN) == 0);
+
+    /* 0 returns at once */
+    start = sys_now();
+    CHECK(lwip_epoll_wait(ep, &ev, 1, 0) == 0);
+    CHECK(sys_now() - start < WAIT_MS / 2);
+
+    /* > 0 returns after the timeout, or with the event */
+    start = sys_now();
+    CHECK(lwip_epoll_wait(ep, &ev, 1, WAIT_MS) == 0);
+    CHECK(sys_now() - start >= WAIT_MS && sys_now() - start < 10 * WAIT_MS);
+    waiter_start(&w, ep, 20 * WAIT_MS);
+    sys_delay_ms(WAIT_MS);
+    CHECK(!w.done);
+    send_to(0);
+    pthread_join(w.thread, NULL);
+    CHECK(w.n == 1 && w.ev[0].data.fd == s[0] && w.ev[0].events == EPOLLIN);
+    CHECK(w.elapsed < 10 * WAIT_MS);
+    CHECK(drain(s[0]) == 1);
+
+    /* -1 waits for the event */
+    waiter_start(&w, ep, -1);
+    sys_delay_ms(2 * WAIT_MS);
+    CHECK(!w.done);
+    /* an instance can't be closed while a task waits on it */
+    CHECK(lwip_close_r(ep) == -1 && errno == EBUSY);
+    send_to(0);
+    pthread_join(w.thread, NULL);
+    CHECK(w.n == 1 && w.ev[0].data.fd == s[0]);
+    CHECK(drain(s[0]) == 1);
+    CHECK(add(ep, EPOLL_CTL_DEL, s[0], 0) == 0);
+}
+
+static void test_close(int ep, int *s)
+{
+    struct waiter w;
+    int fd;
+
+    /* a ready socket that is closed is not reported, nor is a new socket
+       that gets its descriptor */
+    CHECK(add(ep, EPOLL_CTL_ADD, s[0], EPOLLIN) == 0);
+    send_to(0);
+    CHECK(lwip_close_r(s[0]) == 0);
+    CHECK(poll_ep(ep, NULL) == 0);
+    s[0] = open_socket(0);
+    send_to(0);
+    CHECK(poll_ep(ep, NULL) == 0);
+    CHECK(add(ep, EPOLL_CTL_ADD, s[0], EPOLLIN) == 0);
+    CHECK(poll_ep(ep, &fd) == 1 && fd == s[0]);
+    CHECK(drain(s[0]) == 1);
+
+    /* closing a socket while a thread waits for it leaves the thread
+       waiting for the others */
+    CHECK(add(ep, EPOLL_CTL_ADD, s[1], EPOLLIN) == 0);
+    waiter_start(&w, ep, -1);
+    sys_delay_ms(WAIT_MS);
+    CHECK(lwip_close_r(s[0]) == 0);
+    sys_delay_ms(WAIT_MS);
+    CHECK(!w.done);
+    send_to(1);
+    pthread_join(w.thread, NULL);
+    CHECK(w.n == 1 && w.ev[0].data.fd == s[1]);
+    CHECK(drain(s[1]) == 1);
+    s[0] = open_socket(0);
+}
+
+static void test_errors(int ep, int *s)
+{
+    struct epoll_event ev;
+    int ep2, ep3;
+
+    CHECK(lwip_epoll_create(0) == -1 && errno == EINVAL);
+    CHECK(add(ep, EPOLL_CTL_ADD, s[1], EPOLLIN) == -1 && errno == EEXIST);
+    CHECK(add(ep, EPOLL_CTL_ADD, -1, EPOLLIN) == -1 && errno == EBADF);
+    CHECK(add(s[0], EPOLL_CTL_ADD, s[1], EPOLLIN) == -1 && errno == EBADF);
+    CHECK(lwip_epoll_ctl(ep, EPOLL_CTL_MOD, s[1], NULL) == -1 && errno == EINVAL);
+    CHECK(lwip_epoll_wait(ep, &ev, 0, 0) == -1 && errno == EINVAL);
+
+    /* a socket is registered with one instance at a time */
+    ep2 = lwip_epoll_create(1);
+    CHECK(ep2 >= 0);
+    CHECK(add(ep2, EPOLL_CTL_ADD, s[1], EPOLLIN) == -1 && errno == EEXIST);
+    CHECK(add(ep2, EPOLL_CTL_DEL, s[1], 0) == -1 && errno == ENOENT);
+    CHECK(add(ep2, EPOLL_CTL_ADD, s[2], EPOLLIN) == 0);
+    ep3 = lwip_epoll_create(1);
+    CHECK(ep3 == -1 && errno == EMFILE);
+
+    /* closing an instance unregisters its sockets */
+    CHECK(lwip_close_r(ep2) == 0);
+    CHECK(lwip_epoll_wait(ep2, &ev, 1, 0) == -1 && errno == EBADF);
+    CHECK(add(ep, EPOLL_CTL_ADD, s[2], EPOLLIN) == 0);
+    CHECK(add(ep, EPOLL_CTL_DEL, s[2], 0) == 0);
+    CHECK(add(ep, EPOLL_CTL_DEL, s[1], 0) == 0);
+}
+
+int main(void)
+{
+    int s[3];
+    int ep, i;
+
+    sys_sem_new(&barrier_sem, 0);
+    tcpip_init(tcpip_init_done, &barrier_sem);
+    sys_arch_sem_wait(&barrier_sem, 0);
+
+    tx = lwip_socket(AF_INET, SOCK_DGRAM, 0);
+    for (i = 0; i < 3; i++) {
+        s[i] = open_socket(i);
+    }
+    ep = lwip_epoll_create(1);
+    CHECK(ep >= 0);
+
+    test_triggers(ep, s);
+    test_round_robin(ep, s);
+    test_timeouts(ep, s);
+    test_close(ep, s);
+    test_errors(ep, s);
+
+    CHECK(lwip_close_r(ep) == 0);
+    for (i = 0; i < 3; i++) {
+        lwip_close_r(s[i]);
+    }
+    lwip_close_r(tx);
+
+    if (failures != 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("epoll tests passed\n");
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include "catch.hpp"
+#include "lwip/inet_chksum.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+extern "C" u16_t lwip_standard_chksum(const void *dataptr, int len);
+
+/* LWIP_CHKSUM_ALGORITHM 1 from inet_chksum.c: byte-wise, trivially correct */
+static uint16_t reference_chksum(const void *dataptr, int len)
+{
+    const uint8_t *octetptr = static_cast<const uint8_t *>(dataptr);
+    uint32_t acc = 0;
+    while (len > 1) {
+        acc += (octetptr[0] << 8) | octetptr[1];
+        octetptr += 2;
+        len -= 2;
+    }
+    if (len > 0) {
+        acc += octetptr[0] << 8;
+    }
+    acc = (acc >> 16) + (acc & 0xffff);
+    acc = (acc >> 16) + (acc & 0xffff);
+    return htons((uint16_t) acc);
+}
+
+/* LWIP_CHKSUM_ALGORITHM 2, the previous default, used as benchmark baseline */
+static uint16_t baseline_chksum(const void *dataptr, int len)
+{
+    const uint8_t *pb = static_cast<const uint8_t *>(dataptr);
+    uint16_t t = 0;
+    uint32_t sum = 0;
+    int odd = ((uintptr_t) pb & 1);
+    if (odd && len > 0) {
+        ((uint8_t *) &t)[1] = *pb++;
+        len--;
+    }
+    const uint16_t *ps = reinterpret_cast<const uint16_t *>(pb);
+    while (len > 1) {
+        sum += *ps++;
+        len -= 2;
+    }
+    if (len > 0) {
+        ((uint8_t *) &t)[0] = *(const uint8_t *) ps;
+    }
+    sum += t;
+    sum = FOLD_U32T(sum);
+    sum = FOLD_U32T(sum);
+    if (odd) {
+        sum = SWAP_BYTES_IN_WORD(sum);
+    }
+    return (uint16_t) sum;
+}
+
+static std::vector<uint8_t> make_buffer(size_t size, uint32_t seed)
+{
+    std::mt19937 gen(seed);
+    std::vector<uint8_t> buf(size);
+    for (auto& b : buf) {
+        b = static_cast<uint8_t>(gen());
+    }
+    return buf;
+}
+
+TEST_CASE("lwip_standard_chksum matches reference for all lengths and alignments", "[chksum]")
+{
+    auto buf = make_buffer(2048 + 8, 1);
+    for (size_t align = 0; align < 8; ++align) {
+        for (int len = 0; len <= 2048; ++len) {
+            const uint8_t *p = buf.data() + align;
+            CAPTURE(align);
+            CAPTURE(len);
+            REQUIRE(lwip_standard_chksum(p, len) == reference_chksum(p, len));
+        }
+    }
+}
+
+TEST_CASE("lwip_standard_chksum handles carries on large all-ones buffers", "[chksum]")
+{
+    std::vector<uint8_t> buf(0x10000 + 8, 0xff);
+    for (size_t align = 0; align < 4; ++align) {
+        for (int len : {31, 32, 33, 1460, 1461, 0x7fff, 0xfffe, 0xffff, 0x10000}) {
+            CAPTURE(align);
+            CAPTURE(len);
+            REQUIRE(lwip_standard_chksum(buf.data() + align, len) == reference_chksum(buf.data() + align, len));
+        }
+    }
+}
+
+TEST_CASE("lwip_chksum_copy copies and checksums for all alignment pairs", "[chksum]")
+{
+    const size_t guard = 8;
+    auto src = make_buffer(1600 + guard, 2);
+    std::vector<uint8_t> dst(1600 + 2 * guard);
+    for (size_t src_align = 0; src_align < 4; ++src_align) {
+        for (size_t dst_align = 0; dst_align < 4; ++dst_align) {
+            for (u16_t len = 0; len <= 1536; ++len) {
+                std::fill(dst.begin(), dst.end(), 0xa5);
+                uint8_t *d = dst.data() + guard + dst_align;
+                const uint8_t *s = src.data() + src_align;
+                CAPTURE(src_align);
+                CAPTURE(dst_align);
+                CAPTURE(len);
+                REQUIRE(lwip_chksum_copy(d, s, len) == reference_chksum(s, len));
+                REQUIRE(memcmp(d, s, len) == 0);
+                REQUIRE(std::all_of(dst.begin(), dst.begin() + guard + dst_align,
+                                    [](uint8_t b) { return b == 0xa5; }));
+                REQUIRE(std::all_of(dst.begin() + guard + dst_align + len, dst.end(),
+                                    [](uint8_t b) { return b == 0xa5; }));
+            }
+        }
+    }
+}
+
+template<typename F>
+static double bench_mbps(F fn, size_t len, size_t iterations)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn(iterations);
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    return (double) len * iterations / seconds / 1e6;
+}
+
+TEST_CASE("checksum throughput", "[.][bench]")
+{
+    const size_t iterations = 200000;
+    auto src = make_buffer(1460 + 4, 3);
+    std::vector<uint8_t> dst(1460 + 4);
+    volatile uint32_t sink = 0;
+
+    printf("%-8s %6s %12s %12s %12s\n", "align", "len", "alg2 MB/s", "alg4 MB/s", "speedup");
+    for (size_t align : {0, 1, 2}) {
+        for (int len : {64, 576, 1460}) {
+            const uint8_t *p = src.data() + align;
+            double base = bench_mbps([&](size_t n) {
+                for (size_t i = 0; i < n; ++i) sink += baseline_chksum(p, len);
+            }, len, iterations);
+            double opt = bench_mbps([&](size_t n) {
+                for (size_t i = 0; i < n; ++i) sink += lwip_standard_chksum(p, len);
+            }, len, iterations);
+            printf("%-8zu %6d %12.1f %12.1f %11.2fx\n", align, len, base, opt, opt / base);
+        }
+    }
+
+    printf("\n%-8s %6s %12s %12s %12s\n", "align", "len", "copy+alg2", "fused", "speedup");
+    for (size_t align : {0, 2}) {
+        for (u16_t len : {64, 576, 1460}) {
+            const uint8_t *s = src.data() + align;
+            uint8_t *d = dst.data() + align;
+            double base = bench_mbps([&](size_t n) {
+                for (size_t i = 0; i < n; ++i) {
+                    memcpy(d, s, len);
+                    sink += baseline_chksum(d, len);
+                }
+            }, len, iterations);
+            double opt = bench_mbps([&](size_t n) {
+                for (size_t i = 0; i < n; ++i) sink += lwip_chksum_copy(d, s, len);
+            }, len, iterations);
+            printf("%-8zu %6d %12.1f %12.1f %11.2fx\n", align, len, base, opt, opt / base);
+        }
+    }
+}
@@ -0,0 +1,602 @@
+/*
+ * Host test for TCP/UDP PCB demultiplexing.
+ *
+ * Plays the peers of a set of TCP connections and UDP PCBs by feeding
+ * segments through ip4_input(), and checks from the callbacks and from the
+ * segments sent back which PCB each one went to. Connections come and go
+ * through listen, bind, connect, close, abort, TIME-WAIT and the killing of
+ * TIME-WAIT PCBs for new ones. The Makefile builds this once with
+ * CONFIG_LWIP_PCB_HASH and once without; both must pass. SO_REUSE is on so
+ * that wildcard and specific-address listeners can share a port.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lwip/init.h"
+#include "lwip/mem.h"
+#include "lwip/memp.h"
+#include "lwip/netif.h"
+#include "lwip/ip4.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+#include "lwip/tcpip.h"
+#include "lwip/priv/tcp_priv.h"
+
+#define PEER_ISS        1000
+#define TW_TICKS        (2 * TCP_MSL / TCP_SLOW_INTERVAL + 1)
+
+/* one end of a TCP connection, played by the test */
+struct conn {
+    ip4_addr_t peer;
+    u16_t peer_port;
+    ip4_addr_t local;
+    u16_t local_port;
+    u32_t snd_nxt;              /* next sequence number of the peer */
+    u32_t rcv_nxt;              /* next sequence number of the stack */
+    struct tcp_pcb *pcb;
+    int connected;
+    int aborted;
+    int fin;
+};
+
+/* the last TCP segment the stack sent */
+static struct {
+    int count;
+    u8_t flags;
+    u32_t seqno;
+    u32_t ackno;
+} sent;
+
+static struct netif netif_a, netif_b;
+static ip4_addr_t addr_a, addr_b;
+
+static struct conn *pending_conn;
+static void *accepted_by;
+static struct conn *recv_conn;
+static u16_t recv_len;
+static void *udp_recv_arg;
+static int failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+void esp_wifi_internal_free_rx_buffer(void *buffer)
+{
+}
+
+err_t tcpip_callback_with_block(tcpip_callback_fn function, void *ctx, u8_t block)
+{
+    return ERR_MEM;
+}
+
+static err_t test_netif_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+    struct ip_hdr iphdr;
+    struct tcp_hdr tcphdr;
+
+    pbuf_copy_partial(p, &iphdr, IP_HLEN, 0);
+    if (IPH_PROTO(&iphdr) == IP_PROTO_TCP) {
+        pbuf_copy_partial(p, &tcphdr, TCP_HLEN, IPH_HL(&iphdr) * 4);
+        sent.count++;
+        sent.flags = TCPH_FLAGS(&tcphdr);
+        sent.seqno = ntohl(tcphdr.seqno);
+        sent.ackno = ntohl(tcphdr.ackno);
+    }
+    return ERR_OK;
+}
+
+static err_t test_netif_init(struct netif *netif)
+{
+    netif->output = test_netif_output;
+    netif->mtu = 1500;
+    netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_LINK_UP;
+    return ERR_OK;
+}
+
+static int pcb_total(void)
+{
+    struct tcp_pcb_listen *lpcb;
+    struct tcp_pcb *pcb;
+    int n = 0;
+
+    for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+        n++;
+    }
+    for (pcb = tcp_tw_pcbs; pcb != NULL; pcb = pcb->next) {
+        n++;
+    }
+    for (pcb = tcp_bound_pcbs; pcb != NULL; pcb = pcb->next) {
+        n++;
+    }
+    for (lpcb = tcp_listen_pcbs.listen_pcbs; lpcb != NULL; lpcb = lpcb->next) {
+        n++;
+    }
+    return n;
+}
+
+/* TCP callbacks, with the struct conn as their argument */
+
+static err_t conn_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+    struct conn *c = (struct conn *)arg;
+
+    CHECK(c->pcb == pcb);
+    if (p == NULL) {
+        c->fin = 1;
+        return ERR_OK;
+    }
+    recv_conn = c;
+    recv_len = p->tot_len;
+    tcp_recved(pcb, p->tot_len);
+    pbuf_free(p);
+    return ERR_OK;
+}
+
+static void conn_err(void *arg, err_t err)
+{
+    struct conn *c = (struct conn *)arg;
+    c->pcb = NULL;
+    c->aborted = 1;
+}
+
+static err_t conn_connected(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+    struct conn *c = (struct conn *)arg;
+    CHECK(c->pcb == pcb);
+    c->connected = 1;
+    return ERR_OK;
+}
+
+static err_t listener_accept(void *arg, struct tcp_pcb *newpcb, err_t err)
+{
+    struct conn *c = pending_conn;
+
+    accepted_by = arg;
+    c->pcb = newpcb;
+    c->connected = 1;
+    tcp_arg(newpcb, c);
+    tcp_recv(newpcb, conn_recv);
+    tcp_err(newpcb, conn_err);
+    return ERR_OK;
+}
+
+/* Send a segment from the peer of c, return the number of segments sent
+   back by the stack */
+static int send_tcp(const struct conn *c, u8_t flags, u32_t seqno, u32_t ackno, u16_t len)
+{
+    const u16_t tot_len = IP_HLEN + TCP_HLEN + len;
+    struct pbuf *p = pbuf_alloc(PBUF_RAW, tot_len, PBUF_RAM);
+    struct ip_hdr *iphdr = (struct ip_hdr *)p->payload;
+    struct tcp_hdr *tcphdr = (struct tcp_hdr *)((u8_t *)p->payload + IP_HLEN);
+
+    memset(p->payload, 'x', tot_len);
+    memset(p->payload, 0, IP_HLEN + TCP_HLEN);
+    IPH_VHL_SET(iphdr, 4, IP_HLEN / 4);
+    IPH_LEN_SET(iphdr, htons(tot_len));
+    IPH_TTL_SET(iphdr, 64);
+    IPH_PROTO_SET(iphdr, IP_PROTO_TCP);
+    ip4_addr_copy(iphdr->src, c->peer);
+    ip4_addr_copy(iphdr->dest, c->local);
+    IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
+
+    tcphdr->src = htons(c->peer_port);
+    tcphdr->dest = htons(c->local_port);
+    tcphdr->seqno = htonl(seqno);
+    tcphdr->ackno = htonl(ackno);
+    TCPH_HDRLEN_FLAGS_SET(tcphdr, TCP_HLEN / 4, flags);
+    tcphdr->wnd = htons(8192);
+
+    pbuf_header(p, -IP_HLEN);
+    tcphdr->chksum = inet_chksum_pseudo(p, IP_PROTO_TCP, p->tot_len, &c->peer, &c->local);
+    pbuf_header(p, IP_HLEN);
+
+    sent.count = 0;
+    ip4_input(p, &netif_a);
+    return sent.count;
+}
+
+static void conn_init(struct conn *c, const char *peer, u16_t peer_port,
+                      const ip4_addr_t *local, u16_t local_port)
+{
+    memset(c, 0, sizeof(*c));
+    ip4addr_aton(peer, &c->peer);
+    c->peer_port = peer_port;
+    if (local != NULL) {
+        c->local = *local;
+    }
+    c->local_port = local_port;
+}
+
+/* Open c towards a listener, return the argument of the listener that
+   accepted it, or NULL */
+static void *handshake(struct conn *c)
+{
+    c->snd_nxt = PEER_ISS;
+    send_tcp(c, TCP_SYN, c->snd_nxt, 0, 0);
+    if (sent.flags != (TCP_SYN | TCP_ACK) || sent.ackno != PEER_ISS + 1) {
+        return NULL;
+    }
+    c->snd_nxt++;
+    c->rcv_nxt = sent.seqno + 1;
+    pending_conn = c;
+    accepted_by = NULL;
+    send_tcp(c, TCP_ACK, c->snd_nxt, c->rcv_nxt, 0);
+    pending_conn = NULL;
+    return accepted_by;
+}
+
+/* Open c from the stack with tcp_connect, return 0 on success */
+static int connect_to(struct conn *c, struct tcp_pcb *pcb)
+{
+    ip_addr_t peer;
+
+    ip_addr_copy_from_ip4(peer, c->peer);
+    c->pcb = pcb;
+    tcp_arg(pcb, c);
+    tcp_recv(pcb, conn_recv);
+    tcp_err(pcb, conn_err);
+    sent.count = 0;
+    if (tcp_connect(pcb, &peer, c->peer_port, conn_connected) != ERR_OK || sent.flags != TCP_SYN) {
+        return -1;
+    }
+    c->local = *ip_2_ip4(&pcb->local_ip);
+    c->local_port = pcb->local_port;
+    c->rcv_nxt = sent.seqno + 1;
+    c->snd_nxt = PEER_ISS;
+    send_tcp(c, TCP_SYN | TCP_ACK, c->snd_nxt, c->rcv_nxt, 0);
+    c->snd_nxt++;
+    return c->connected ? 0 : -1;
+}
+
+/* Send len bytes from the peer of c, return the connection they were
+   delivered to */
+static struct conn *send_data(struct conn *c, u16_t len)
+{
+    recv_conn = NULL;
+    recv_len = 0;
+    send_tcp(c, TCP_ACK | TCP_PSH, c->snd_nxt, c->rcv_nxt, len);
+    if (recv_conn == c && recv_len == len) {
+        c->snd_nxt += len;
+    }
+    return recv_conn;
+}
+
+/* Close c from the stack, with the peer answering the FIN with its own */
+static void active_close(struct conn *c)
+{
+    sent.count = 0;
+    CHECK(tcp_close(c->pcb) == ERR_OK);
+    CHECK(sent.count == 1 && (sent.flags & TCP_FIN) && sent.seqno == c->rcv_nxt);
+    c->rcv_nxt++;
+    send_tcp(c, TCP_FIN | TCP_ACK, c->snd_nxt, c->rcv_nxt, 0);
+    c->snd_nxt++;
+    CHECK(sent.count == 1 && sent.flags == TCP_ACK && sent.ackno == c->snd_nxt);
+    CHECK(c->pcb->state == TIME_WAIT);
+    c->pcb = NULL;
+}
+
+/* Close c from the peer, with the stack closing its side on the FIN */
+static void passive_close(struct conn *c)
+{
+    struct tcp_pcb *pcb = c->pcb;
+
+    send_tcp(c, TCP_FIN | TCP_ACK, c->snd_nxt, c->rcv_nxt, 0);
+    c->snd_nxt++;
+    CHECK(c->fin);
+    sent.count = 0;
+    CHECK(tcp_close(pcb) == ERR_OK);
+    CHECK(sent.count == 1 && (sent.flags & TCP_FIN) && sent.seqno == c->rcv_nxt);
+    c->rcv_nxt++;
+    c->pcb = NULL;
+    CHECK(send_tcp(c, TCP_ACK, c->snd_nxt, c->rcv_nxt, 0) == 0);
+}
+
+/* Whether a segment for c makes the stack answer with a reset, that is,
+   whether it was matched to no PCB */
+static int is_reset(struct conn *c)
+{
+    recv_conn = NULL;
+    return send_tcp(c, TCP_ACK | TCP_PSH, c->snd_nxt, c->rcv_nxt, 10) == 1 &&
+           (sent.flags & TCP_RST) && recv_conn == NULL;
+}
+
+/* Whether a connection in TIME-WAIT answers a repeated FIN for c */
+static int is_time_wait(struct conn *c)
+{
+    return send_tcp(c, TCP_FIN | TCP_ACK, c->snd_nxt - 1, c->rcv_nxt, 0) == 1 &&
+           sent.flags == TCP_ACK && sent.ackno == c->snd_nxt;
+}
+
+static struct tcp_pcb *listen_on(const ip4_addr_t *addr, u16_t port, void *arg)
+{
+    struct tcp_pcb *pcb = tcp_new();
+    ip_addr_t ip;
+
+    if (addr != NULL) {
+        ip_addr_copy_from_ip4(ip, *addr);
+    } else {
+        ip_addr_set_zero_ip4(&ip);
+    }
+    ip_set_option(pcb, SOF_REUSEADDR);
+    CHECK(tcp_bind(pcb, &ip, port) == ERR_OK);
+    pcb = tcp_listen(pcb);
+    tcp_arg(pcb, arg);
+    tcp_accept(pcb, listener_accept);
+    return pcb;
+}
+
+static void test_tcp(void)
+{
+    static struct conn c1, c2, c3, c4, c5, c6, c7, c8, c9, c10, c11, x;
+    struct tcp_pcb *l_any, *l_a, *l_b, *l_bound, *pcb;
+    ip_addr_t ip;
+    int i;
+
+    CHECK(MEMP_NUM_TCP_PCB == 10);
+
+    /* a wildcard and a specific listener on port 80, and a listener on
+       port 81 of address b only */
+    l_any = listen_on(NULL, 80, &l_any);
+    l_a = listen_on(&addr_a, 80, &l_a);
+    l_b = listen_on(&addr_b, 81, &l_b);
+
+    conn_init(&c1, "10.0.5.1", 5000, &addr_a, 80);
+    CHECK(handshake(&c1) == &l_a);
+    conn_init(&c2, "10.1.5.1", 5000, &addr_b, 80);
+    CHECK(handshake(&c2) == &l_any);
+    conn_init(&c3, "10.1.5.2", 5000, &addr_b, 81);
+    CHECK(handshake(&c3) == &l_b);
+    /* same peer and ports as c1, another local address */
+    conn_init(&c4, "10.0.5.1", 5000, &addr_b, 80);
+    CHECK(handshake(&c4) == &l_any);
+    conn_init(&x, "10.0.5.9", 5000, &addr_a, 81);
+    CHECK(handshake(&x) == NULL && (sent.flags & TCP_RST));
+    CHECK(pcb_total() == 7);
+
+    /* a connection opened with tcp_connect */
+    conn_init(&c5, "10.0.6.1", 443, NULL, 0);
+    pcb = tcp_new();
+    ip_set_option(pcb, SOF_REUSEADDR);
+    CHECK(connect_to(&c5, pcb) == 0);
+
+    /* a bound PCB gets nothing until it listens */
+    l_bound = tcp_new();
+    ip_addr_copy_from_ip4(ip, addr_a);
+    CHECK(tcp_bind(l_bound, &ip, 7000) == ERR_OK);
+    conn_init(&c6, "10.0.7.1", 6000, &addr_a, 7000);
+    CHECK(handshake(&c6) == NULL && (sent.flags & TCP_RST));
+    l_bound = tcp_listen(l_bound);
+    tcp_arg(l_bound, &l_bound);
+    tcp_accept(l_bound, listener_accept);
+    CHECK(handshake(&c6) == &l_bound);
+    CHECK(pcb_total() == 10);
+
+    CHECK(send_data(&c1, 100) == &c1);
+    CHECK(send_data(&c2, 200) == &c2);
+    CHECK(send_data(&c3, 300) == &c3);
+    CHECK(send_data(&c4, 400) == &c4);
+    CHECK(send_data(&c5, 500) == &c5);
+    CHECK(send_data(&c6, 600) == &c6);
+    CHECK(send_data(&c1, 700) == &c1);
+
+    /* with the specific listener gone, the wildcard one takes port 80 */
+    tcp_close(l_a);
+    conn_init(&c7, "10.0.5.2", 5001, &addr_a, 80);
+    CHECK(handshake(&c7) == &l_any);
+    CHECK(send_data(&c7, 100) == &c7);
+    CHECK(send_data(&c1, 100) == &c1);
+
+    /* closed and aborted connections are gone, their tuple can be used
+       again */
+    passive_close(&c2);
+    CHECK(is_reset(&c2));
+    tcp_abort(c3.pcb);
+    CHECK(is_reset(&c3));
+    CHECK(handshake(&c3) == &l_b);
+    CHECK(send_data(&c3, 100) == &c3);
+    tcp_close(l_bound);
+    CHECK(send_data(&c6, 100) == &c6);
+    conn_init(&x, "10.0.7.2", 6000, &addr_a, 7000);
+    CHECK(handshake(&x) == NULL && (sent.flags & TCP_RST));
+    CHECK(pcb_total() == 8);
+
+    /* TIME-WAIT gets segments for its tuple, c4 still its own */
+    active_close(&c1);
+    CHECK(is_time_wait(&c1));
+    CHECK(send_data(&c4, 100) == &c4);
+    for (i = 0; i < 4; i++) {
+        tcp_slowtmr();
+    }
+    active_close(&c5);
+    CHECK(is_time_wait(&c5));
+
+    /* SO_REUSEADDR: a new connection from the port of c5, in TIME-WAIT */
+    pcb = tcp_new();
+    ip_set_option(pcb, SOF_REUSEADDR);
+    ip_addr_copy_from_ip4(ip, c5.local);
+    CHECK(tcp_bind(pcb, &ip, c5.local_port) == ERR_OK);
+    conn_init(&c8, "10.0.6.2", 443, NULL, 0);
+    CHECK(connect_to(&c8, pcb) == 0);
+    CHECK(c8.local_port == c5.local_port);
+    CHECK(send_data(&c8, 100) == &c8);
+    CHECK(is_time_wait(&c5));
+    CHECK(pcb_total() == 9);
+
+    /* with all PCBs in use, new connections take the place of the
+       oldest TIME-WAIT ones, which must not be found any more */
+    conn_init(&c9, "10.0.9.1", 7001, &addr_a, 80);
+    CHECK(handshake(&c9) == &l_any);
+    CHECK(pcb_total() == 10);
+    conn_init(&c10, "10.0.9.2", 7002, &addr_a, 80);
+    CHECK(handshake(&c10) == &l_any);
+    CHECK(pcb_total() == 10);
+    CHECK(is_reset(&c1));
+    CHECK(is_time_wait(&c5));
+    conn_init(&c11, "10.0.5.1", 5000, &addr_a, 80);
+    CHECK(handshake(&c11) == &l_any);
+    CHECK(is_reset(&c5));
+    CHECK(send_data(&c11, 100) == &c11);
+    CHECK(send_data(&c8, 100) == &c8);
+    CHECK(send_data(&c9, 100) == &c9);
+    CHECK(send_data(&c10, 100) == &c10);
+    CHECK(send_data(&c4, 100) == &c4);
+    CHECK(!c4.aborted && !c6.aborted && !c7.aborted);
+
+    /* TIME-WAIT runs out in tcp_slowtmr */
+    active_close(&c4);
+    CHECK(is_time_wait(&c4));
+    for (i = 0; i < TW_TICKS; i++) {
+        tcp_slowtmr();
+    }
+    CHECK(tcp_tw_pcbs == NULL);
+    CHECK(is_reset(&c4));
+    CHECK(send_data(&c11, 100) == &c11);
+    CHECK(send_data(&c3, 100) == &c3);
+
+    tcp_abort(c3.pcb);
+    tcp_abort(c6.pcb);
+    tcp_abort(c7.pcb);
+    tcp_abort(c8.pcb);
+    tcp_abort(c9.pcb);
+    tcp_abort(c10.pcb);
+    tcp_abort(c11.pcb);
+    tcp_close(l_any);
+    tcp_close(l_b);
+    CHECK(pcb_total() == 0);
+}
+
+static void udp_recv_cb(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+    udp_recv_arg = arg;
+    pbuf_free(p);
+}
+
+/* Send a datagram, return the argument of the PCB that received it */
+static void *send_udp(const char *src, u16_t src_port, const ip4_addr_t *dest, u16_t dest_port)
+{
+    const u16_t len = IP_HLEN + UDP_HLEN + 16;
+    struct pbuf *p = pbuf_alloc(PBUF_RAW, len, PBUF_RAM);
+    struct ip_hdr *iphdr = (struct ip_hdr *)p->payload;
+    struct udp_hdr *udphdr = (struct udp_hdr *)((u8_t *)p->payload + IP_HLEN);
+    ip4_addr_t peer;
+
+    ip4addr_aton(src, &peer);
+    memset(p->payload, 0, len);
+    IPH_VHL_SET(iphdr, 4, IP_HLEN / 4);
+    IPH_LEN_SET(iphdr, htons(len));
+    IPH_TTL_SET(iphdr, 64);
+    IPH_PROTO_SET(iphdr, IP_PROTO_UDP);
+    ip4_addr_copy(iphdr->src, peer);
+    ip4_addr_copy(iphdr->dest, *dest);
+    IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
+    udphdr->src = htons(src_port);
+    udphdr->dest = htons(dest_port);
+    udphdr->len = htons(UDP_HLEN + 16);
+
+    udp_recv_arg = NULL;
+    ip4_input(p, &netif_a);
+    return udp_recv_arg;
+}
+
+static struct udp_pcb *udp_open(const ip4_addr_t *addr, u16_t port, void *arg)
+{
+    struct udp_pcb *pcb = udp_new();
+    ip_addr_t ip;
+
+    if (addr != NULL) {
+        ip_addr_copy_from_ip4(ip, *addr);
+    } else {
+        ip_addr_set_zero_ip4(&ip);
+    }
+    ip_set_option(pcb, SOF_REUSEADDR);
+    udp_recv(pcb, udp_recv_cb, arg);
+    if (port != 0) {
+        CHECK(udp_bind(pcb, &ip, port) == ERR_OK);
+    }
+    return pcb;
+}
+
+static void test_udp(void)
+{
+    struct udp_pcb *u_any, *u_b, *u_uncon, *u_con, *u_auto;
+    ip_addr_t ip;
+
+    u_any = udp_open(NULL, 5353, &u_any);
+    u_b = udp_open(&addr_b, 5354, &u_b);
+    CHECK(send_udp("10.0.8.1", 1000, &addr_a, 5353) == &u_any);
+    CHECK(send_udp("10.0.8.1", 1000, &addr_b, 5353) == &u_any);
+    CHECK(send_udp("10.0.8.1", 1000, &addr_b, 5354) == &u_b);
+    CHECK(send_udp("10.0.8.1", 1000, &addr_a, 5354) == NULL);
+
+    /* a connected PCB only gets datagrams from its peer, the unconnected
+       one on the same port the others */
+    u_uncon = udp_open(NULL, 6000, &u_uncon);
+    u_con = udp_open(NULL, 6000, &u_con);
+    ip4addr_aton("10.0.8.2", ip_2_ip4(&ip));
+    IP_SET_TYPE_VAL(ip, IPADDR_TYPE_V4);
+    CHECK(udp_connect(u_con, &ip, 2000) == ERR_OK);
+    CHECK(send_udp("10.0.8.2", 2000, &addr_a, 6000) == &u_con);
+    CHECK(send_udp("10.0.8.2", 2001, &addr_a, 6000) == &u_uncon);
+    CHECK(send_udp("10.0.8.3", 2000, &addr_a, 6000) == &u_uncon);
+    udp_remove(u_uncon);
+    CHECK(send_udp("10.0.8.3", 2000, &addr_a, 6000) == NULL);
+    CHECK(send_udp("10.0.8.2", 2000, &addr_a, 6000) == &u_con);
+
+    /* connecting an unbound PCB binds it to a new port */
+    u_auto = udp_open(NULL, 0, &u_auto);
+    CHECK(udp_connect(u_auto, &ip, 3000) == ERR_OK);
+    CHECK(u_auto->local_port != 0);
+    CHECK(send_udp("10.0.8.2", 3000, &addr_a, u_auto->local_port) == &u_auto);
+
+    /* rebinding moves a PCB to its new port */
+    ip_addr_set_zero_ip4(&ip);
+    CHECK(udp_bind(u_any, &ip, 5355) == ERR_OK);
+    CHECK(send_udp("10.0.8.1", 1000, &addr_a, 5353) == NULL);
+    CHECK(send_udp("10.0.8.1", 1000, &addr_a, 5355) == &u_any);
+
+    udp_remove(u_any);
+    udp_remove(u_b);
+    udp_remove(u_con);
+    udp_remove(u_auto);
+    CHECK(send_udp("10.0.8.1", 1000, &addr_a, 5355) == NULL);
+    CHECK(send_udp("10.0.8.1", 1000, &addr_b, 5354) == NULL);
+    CHECK(udp_pcbs == NULL);
+}
+
+int main(void)
+{
+    ip4_addr_t mask, gw;
+
+    mem_init();
+    memp_init();
+    netif_init();
+    tcp_init();
+    udp_init();
+
+    IP4_ADDR(&addr_a, 10, 0, 0, 1);
+    IP4_ADDR(&addr_b, 10, 1, 0, 1);
+    IP4_ADDR(&mask, 255, 255, 0, 0);
+    IP4_ADDR(&gw, 10, 0, 0, 254);
+    netif_add(&netif_a, &addr_a, &mask, &gw, NULL, test_netif_init, ip4_input);
+    IP4_ADDR(&gw, 10, 1, 0, 254);
+    netif_add(&netif_b, &addr_b, &mask, &gw, NULL, test_netif_init, ip4_input);
+    netif_set_default(&netif_a);
+    netif_set_up(&netif_a);
+    netif_set_up(&netif_b);
+
+    test_tcp();
+    test_udp();
+
+    if (failures != 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("pcb demux tests passed (%s)\n", LWIP_TCP_PCB_HASH ? "hash" : "list");
+    return 0;
+}
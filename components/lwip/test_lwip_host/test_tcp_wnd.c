@@ -0,0 +1,156 @@
+/*
+ * Host test for the per-socket TCP_WINDOW and TCP_SNDBUF options.
+ *
+ * Built with the default configuration: windows set with setsockopt()
+ * (in MSS) above the default window are applied up to TCP_WND_LIMIT, on
+ * new sockets and on connections looped back through the netif.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lwip/init.h"
+#include "lwip/netif.h"
+#include "lwip/sockets.h"
+#include "lwip/tcpip.h"
+
+#define PORT            7000
+
+static struct netif test_netif;
+static int failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+void esp_wifi_internal_free_rx_buffer(void *buffer)
+{
+}
+
+void dhcps_coarse_tmr(void)
+{
+}
+
+static err_t test_netif_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+    return ERR_OK;
+}
+
+static err_t test_netif_init(struct netif *netif)
+{
+    netif->output = test_netif_output;
+    netif->mtu = 1500;
+    netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_LINK_UP;
+    return ERR_OK;
+}
+
+static void tcpip_init_done(void *arg)
+{
+    ip4_addr_t addr, mask, gw;
+    IP4_ADDR(&addr, 10, 0, 0, 1);
+    IP4_ADDR(&mask, 255, 0, 0, 0);
+    IP4_ADDR(&gw, 10, 0, 0, 254);
+    netif_add(&test_netif, &addr, &mask, &gw, NULL, test_netif_init, tcpip_input);
+    netif_set_default(&test_netif);
+    netif_set_up(&test_netif);
+    sys_sem_signal((sys_sem_t *) arg);
+}
+
+static int get_opt(int s, int optname)
+{
+    int val = -1;
+    socklen_t len = sizeof(val);
+
+    if (lwip_getsockopt_r(s, IPPROTO_TCP, optname, &val, &len) != 0) {
+        return -1;
+    }
+    return val;
+}
+
+static int set_opt(int s, int optname, int mss)
+{
+    return lwip_setsockopt_r(s, IPPROTO_TCP, optname, &mss, sizeof(mss));
+}
+
+/* Windows of a socket that is not connected */
+static void test_unconnected(void)
+{
+    int s = lwip_socket(AF_INET, SOCK_STREAM, 0);
+
+    /* the default configuration allows windows up to 64KB */
+    CHECK(TCP_WND_LIMIT == 0xffff);
+    CHECK(get_opt(s, TCP_WINDOW) == TCP_WND_DEFAULT);
+    CHECK(get_opt(s, TCP_SNDBUF) == TCP_SND_BUF_DEFAULT);
+
+    CHECK(set_opt(s, TCP_WINDOW, 16) == 0);
+    CHECK(get_opt(s, TCP_WINDOW) == 16 * TCP_MSS);
+    CHECK(16 * TCP_MSS > TCP_WND_DEFAULT);
+    CHECK(set_opt(s, TCP_WINDOW, TCP_WND_LIMIT / TCP_MSS) == 0);
+    CHECK(get_opt(s, TCP_WINDOW) == TCP_WND_LIMIT / TCP_MSS * TCP_MSS);
+    CHECK(set_opt(s, TCP_WINDOW, 1000) == 0);
+    CHECK(get_opt(s, TCP_WINDOW) == TCP_WND_LIMIT);
+    CHECK(set_opt(s, TCP_WINDOW, 0) == -1 && errno == EINVAL);
+    CHECK(get_opt(s, TCP_WINDOW) == TCP_WND_LIMIT);
+
+    CHECK(set_opt(s, TCP_SNDBUF, 16) == 0);
+    CHECK(get_opt(s, TCP_SNDBUF) == 16 * TCP_MSS);
+    CHECK(set_opt(s, TCP_SNDBUF, 1000) == 0);
+    CHECK(get_opt(s, TCP_SNDBUF) == TCP_WND_LIMIT);
+    lwip_close_r(s);
+}
+
+/* Windows set before and after connecting */
+static void test_connected(void)
+{
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof(addr);
+    int listener, client, server;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_len = sizeof(addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PORT);
+    addr.sin_addr.s_addr = PP_HTONL(0x0a000001);
+
+    listener = lwip_socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(lwip_bind_r(listener, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+    CHECK(lwip_listen_r(listener, 1) == 0);
+    client = lwip_socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(set_opt(client, TCP_WINDOW, 20) == 0);
+    CHECK(lwip_connect_r(client, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+    server = lwip_accept_r(listener, (struct sockaddr *) &addr, &addrlen);
+    CHECK(server >= 0);
+
+    CHECK(get_opt(client, TCP_WINDOW) == 20 * TCP_MSS);
+    CHECK(get_opt(server, TCP_WINDOW) == TCP_WND_DEFAULT);
+    CHECK(set_opt(server, TCP_WINDOW, 30) == 0);
+    CHECK(get_opt(server, TCP_WINDOW) == 30 * TCP_MSS);
+    CHECK(set_opt(server, TCP_SNDBUF, 30) == 0);
+    CHECK(get_opt(server, TCP_SNDBUF) == 30 * TCP_MSS);
+
+    lwip_close_r(server);
+    lwip_close_r(client);
+    lwip_close_r(listener);
+}
+
+int main(void)
+{
+    sys_sem_t init_sem;
+
+    sys_sem_new(&init_sem, 0);
+    tcpip_init(tcpip_init_done, &init_sem);
+    sys_arch_sem_wait(&init_sem, 0);
+
+    test_unconnected();
+    test_connected();
+
+    if (failures != 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("tcp window tests passed\n");
+    return 0;
+}
@@ -0,0 +1,303 @@
+/*
+ * Host test for lwip_sendmmsg/lwip_recvmmsg.
+ *
+ * Runs the stack with a real tcpip thread (see sys_arch.c). Datagrams to
+ * the netif address are looped back to a receiving socket, others are
+ * counted and dropped by the netif. Checks full and partial batches,
+ * batches longer than LWIP_SOCKET_MMSG_BATCH, a bad message partway
+ * through a batch, vlen 0, MSG_DONTWAIT and MSG_WAITFORONE, and truncation
+ * and source addresses on receive.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "lwip/init.h"
+#include "lwip/netif.h"
+#include "lwip/sockets.h"
+#include "lwip/tcpip.h"
+
+#define RX_PORT         5001
+#define MAX_VLEN        16
+#define WAIT_MS         100
+
+static struct netif test_netif;
+static sys_sem_t barrier_sem;
+static int tx, rx;
+static struct sockaddr_in rx_addr, drop_addr;
+static unsigned long drop_count;
+
+static char tx_data[MAX_VLEN][2][8];
+static struct iovec tx_iov[MAX_VLEN][2];
+static struct mmsghdr tx_msgs[MAX_VLEN];
+static char rx_data[MAX_VLEN][16];
+static struct iovec rx_iov[MAX_VLEN];
+static struct sockaddr_in rx_from[MAX_VLEN];
+static struct mmsghdr rx_msgs[MAX_VLEN];
+static int failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+void esp_wifi_internal_free_rx_buffer(void *buffer)
+{
+}
+
+void dhcps_coarse_tmr(void)
+{
+}
+
+static err_t test_netif_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+    drop_count++;
+    return ERR_OK;
+}
+
+static err_t test_netif_init(struct netif *netif)
+{
+    netif->output = test_netif_output;
+    netif->mtu = 1500;
+    netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_LINK_UP;
+    return ERR_OK;
+}
+
+static void signal_sem(void *arg)
+{
+    sys_sem_signal((sys_sem_t *) arg);
+}
+
+static void tcpip_init_done(void *arg)
+{
+    ip4_addr_t addr, mask, gw;
+    IP4_ADDR(&addr, 10, 0, 0, 1);
+    IP4_ADDR(&mask, 255, 0, 0, 0);
+    IP4_ADDR(&gw, 10, 0, 0, 254);
+    netif_add(&test_netif, &addr, &mask, &gw, NULL, test_netif_init, tcpip_input);
+    netif_set_default(&test_netif);
+    netif_set_up(&test_netif);
+    signal_sem(arg);
+}
+
+/* Wait until the datagrams looped back so far are queued on rx */
+static void tcpip_barrier(void)
+{
+    tcpip_callback(signal_sem, &barrier_sem);
+    sys_arch_sem_wait(&barrier_sem, 0);
+}
+
+static void make_addr(struct sockaddr_in *sa, u32_t addr, int port)
+{
+    memset(sa, 0, sizeof(*sa));
+    sa->sin_len = sizeof(*sa);
+    sa->sin_family = AF_INET;
+    sa->sin_port = htons(port);
+    sa->sin_addr.s_addr = htonl(addr);
+}
+
+/* Messages to dest, message i made of two 4 byte pieces "i:ab" and "i:cd" */
+static void setup_tx(struct sockaddr_in *dest)
+{
+    for (int i = 0; i < MAX_VLEN; i++) {
+        snprintf(tx_data[i][0], sizeof(tx_data[i][0]), "%c:ab", 'A' + i);
+        snprintf(tx_data[i][1], sizeof(tx_data[i][1]), "%c:cd", 'A' + i);
+        tx_iov[i][0].iov_base = tx_data[i][0];
+        tx_iov[i][0].iov_len = 4;
+        tx_iov[i][1].iov_base = tx_data[i][1];
+        tx_iov[i][1].iov_len = 4;
+        memset(&tx_msgs[i], 0, sizeof(tx_msgs[i]));
+        tx_msgs[i].msg_hdr.msg_iov = tx_iov[i];
+        tx_msgs[i].msg_hdr.msg_iovlen = 2;
+        tx_msgs[i].msg_hdr.msg_name = dest;
+        tx_msgs[i].msg_hdr.msg_namelen = sizeof(*dest);
+        tx_msgs[i].msg_len = 12345;
+    }
+}
+
+static void setup_rx(size_t len)
+{
+    for (int i = 0; i < MAX_VLEN; i++) {
+        memset(rx_data[i], 0, sizeof(rx_data[i]));
+        rx_iov[i].iov_base = rx_data[i];
+        rx_iov[i].iov_len = len;
+        memset(&rx_from[i], 0, sizeof(rx_from[i]));
+        memset(&rx_msgs[i], 0, sizeof(rx_msgs[i]));
+        rx_msgs[i].msg_hdr.msg_iov = &rx_iov[i];
+        rx_msgs[i].msg_hdr.msg_iovlen = 1;
+        rx_msgs[i].msg_hdr.msg_name = &rx_from[i];
+        rx_msgs[i].msg_hdr.msg_namelen = sizeof(rx_from[i]);
+    }
+}
+
+/* Receive what is queued on rx, check that it is messages first..first+n-1 */
+static int receive_all(int first, int n)
+{
+    int got = 0, ret;
+
+    setup_rx(sizeof(rx_data[0]));
+    while ((ret = lwip_recvmmsg_r(rx, rx_msgs, MAX_VLEN, MSG_DONTWAIT, NULL)) > 0) {
+        for (int i = 0; i < ret; i++, got++) {
+            char expect[16];
+            snprintf(expect, sizeof(expect), "%c:ab%c:cd", 'A' + first + got, 'A' + first + got);
+            CHECK(rx_msgs[i].msg_len == 8 && memcmp(rx_data[i], expect, 8) == 0);
+        }
+        setup_rx(sizeof(rx_data[0]));
+    }
+    CHECK(ret == -1 && errno == EWOULDBLOCK);
+    return got == n;
+}
+
+static void test_send(void)
+{
+    unsigned long count;
+
+    /* a batch delivered to rx (whose mailbox holds only a few datagrams) */
+    setup_tx(&rx_addr);
+    CHECK(lwip_sendmmsg_r(tx, tx_msgs, 4, 0) == 4);
+    CHECK(tx_msgs[0].msg_len == 8 && tx_msgs[3].msg_len == 8);
+    CHECK(tx_msgs[4].msg_len == 12345);
+    tcpip_barrier();
+    CHECK(receive_all(0, 4));
+
+    /* more than LWIP_SOCKET_MMSG_BATCH messages */
+    CHECK(LWIP_SOCKET_MMSG_BATCH < MAX_VLEN);
+    setup_tx(&drop_addr);
+    count = drop_count;
+    CHECK(lwip_sendmmsg_r(tx, tx_msgs, MAX_VLEN, 0) == MAX_VLEN);
+    CHECK(drop_count - count == MAX_VLEN);
+    CHECK(tx_msgs[MAX_VLEN - 1].msg_len == 8);
+
+    /* a bad message in the first batch: the ones before it are sent */
+    setup_tx(&rx_addr);
+    tx_msgs[2].msg_hdr.msg_iovlen = 0;
+    CHECK(lwip_sendmmsg_r(tx, tx_msgs, MAX_VLEN, 0) == 2);
+    CHECK(tx_msgs[1].msg_len == 8 && tx_msgs[2].msg_len == 12345);
+    tcpip_barrier();
+    CHECK(receive_all(0, 2));
+    /* ... and it fails when it comes first */
+    CHECK(lwip_sendmmsg_r(tx, &tx_msgs[2], MAX_VLEN - 2, 0) == -1 && errno == EIO);
+
+    /* a bad message in a later batch */
+    setup_tx(&drop_addr);
+    tx_iov[LWIP_SOCKET_MMSG_BATCH + 1][1].iov_len = 0x10000;
+    count = drop_count;
+    CHECK(lwip_sendmmsg_r(tx, tx_msgs, MAX_VLEN, 0) == LWIP_SOCKET_MMSG_BATCH + 1);
+    CHECK(drop_count - count == LWIP_SOCKET_MMSG_BATCH + 1);
+    CHECK(tx_msgs[LWIP_SOCKET_MMSG_BATCH].msg_len == 8);
+    CHECK(tx_msgs[LWIP_SOCKET_MMSG_BATCH + 1].msg_len == 12345);
+
+    /* vlen 0 */
+    count = drop_count;
+    CHECK(lwip_sendmmsg_r(tx, NULL, 0, 0) == 0);
+    CHECK(lwip_sendmmsg_r(tx, tx_msgs, 0, 0) == 0);
+    CHECK(lwip_sendmmsg_r(tx, NULL, 1, 0) == -1);
+    CHECK(drop_count == count);
+}
+
+struct delayed_send {
+    pthread_t thread;
+    int count;
+};
+
+static void *delayed_send_main(void *arg)
+{
+    struct delayed_send *d = (struct delayed_send *) arg;
+
+    sys_delay_ms(WAIT_MS);
+    lwip_sendmmsg_r(tx, tx_msgs, d->count, 0);
+    return NULL;
+}
+
+static void test_receive(void)
+{
+    struct delayed_send d;
+    u32_t start;
+    int ret;
+
+    /* vlen 0, and nothing queued */
+    CHECK(lwip_recvmmsg_r(rx, NULL, 0, 0, NULL) == 0);
+    CHECK(lwip_recvmmsg_r(rx, NULL, 1, 0, NULL) == -1);
+    setup_rx(sizeof(rx_data[0]));
+    start = sys_now();
+    CHECK(lwip_recvmmsg_r(rx, rx_msgs, MAX_VLEN, MSG_DONTWAIT, NULL) == -1 && errno == EWOULDBLOCK);
+    CHECK(lwip_recvmmsg_r(rx, rx_msgs, MAX_VLEN, MSG_DONTWAIT | MSG_WAITFORONE, NULL) == -1 &&
+          errno == EWOULDBLOCK);
+    CHECK(sys_now() - start < WAIT_MS / 2);
+
+    /* a partial batch: what is queued, without waiting for the rest */
+    setup_tx(&rx_addr);
+    CHECK(lwip_sendmmsg_r(tx, tx_msgs, 3, 0) == 3);
+    tcpip_barrier();
+    setup_rx(sizeof(rx_data[0]));
+    start = sys_now();
+    CHECK(lwip_recvmmsg_r(rx, rx_msgs, MAX_VLEN, 0, NULL) == 3);
+    CHECK(sys_now() - start < WAIT_MS / 2);
+    CHECK(rx_msgs[2].msg_len == 8 && memcmp(rx_data[2], "C:abC:cd", 8) == 0);
+    CHECK(rx_msgs[0].msg_hdr.msg_namelen == sizeof(struct sockaddr_in));
+    CHECK(rx_from[0].sin_family == AF_INET && rx_from[0].sin_addr.s_addr == htonl(0x0a000001));
+    CHECK(rx_msgs[3].msg_len == 0);
+
+    /* datagrams longer than the iovecs are truncated */
+    CHECK(lwip_sendmmsg_r(tx, tx_msgs, 2, 0) == 2);
+    tcpip_barrier();
+    setup_rx(5);
+    CHECK(lwip_recvmmsg_r(rx, rx_msgs, 1, MSG_DONTWAIT, NULL) == 1);
+    CHECK(rx_msgs[0].msg_len == 5 && memcmp(rx_data[0], "A:abA", 5) == 0 && rx_data[0][5] == 0);
+    CHECK(receive_all(1, 1));
+
+    /* a blocking call waits for the first datagram only */
+    for (int flags = 0; flags <= MSG_WAITFORONE; flags += MSG_WAITFORONE) {
+        d.count = 2;
+        pthread_create(&d.thread, NULL, delayed_send_main, &d);
+        setup_rx(sizeof(rx_data[0]));
+        start = sys_now();
+        ret = lwip_recvmmsg_r(rx, rx_msgs, MAX_VLEN, flags, NULL);
+        CHECK(ret >= 1 && ret <= 2);
+        CHECK(sys_now() - start >= WAIT_MS / 2 && sys_now() - start < 10 * WAIT_MS);
+        CHECK(memcmp(rx_data[0], "A:abA:cd", 8) == 0);
+        pthread_join(d.thread, NULL);
+        tcpip_barrier();
+        CHECK(receive_all(ret, 2 - ret));
+    }
+
+    /* not on TCP sockets */
+    int s = lwip_socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(lwip_recvmmsg_r(s, rx_msgs, 1, MSG_DONTWAIT, NULL) == -1 && errno == EOPNOTSUPP);
+    lwip_close_r(s);
+}
+
+int main(void)
+{
+    struct sockaddr_in addr;
+
+    sys_sem_new(&barrier_sem, 0);
+    tcpip_init(tcpip_init_done, &barrier_sem);
+    sys_arch_sem_wait(&barrier_sem, 0);
+
+    tx = lwip_socket(AF_INET, SOCK_DGRAM, 0);
+    rx = lwip_socket(AF_INET, SOCK_DGRAM, 0);
+    make_addr(&addr, 0, RX_PORT);
+    make_addr(&rx_addr, 0x0a000001, RX_PORT);
+    make_addr(&drop_addr, 0x0a000002, RX_PORT);
+    if (tx < 0 || rx < 0 || lwip_bind_r(rx, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        printf("socket setup failed\n");
+        return 1;
+    }
+
+    test_send();
+    test_receive();
+
+    lwip_close_r(tx);
+    lwip_close_r(rx);
+
+    if (failures != 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("mmsg tests passed\n");
+    return 0;
+}
@@ -512,6 +512,10 @@
 #error "MBEDTLS_SSL_TICKET_C defined, but not all prerequisites"
 #endif
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS) && defined(MBEDTLS_ZLIB_SUPPORT)
+#error "MBEDTLS_SSL_DYNAMIC_BUFFERS defined, but not compatible with MBEDTLS_ZLIB_SUPPORT"
+#endif
+
 #if defined(MBEDTLS_SSL_CBC_RECORD_SPLITTING) && \
     !defined(MBEDTLS_SSL_PROTO_SSL3) && !defined(MBEDTLS_SSL_PROTO_TLS1)
 #error "MBEDTLS_SSL_CBC_RECORD_SPLITTING defined, but not all prerequisites"
@@ -1095,6 +1095,24 @@
  */
 #define MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
 
+/**
+ * \def MBEDTLS_SSL_DYNAMIC_BUFFERS
+ *
+ * Allocate the input and output buffers of TLS connections when they are
+ * needed rather than in mbedtls_ssl_setup(). They are allocated full size
+ * (MBEDTLS_SSL_IN_CONTENT_LEN / MBEDTLS_SSL_OUT_CONTENT_LEN) for the
+ * handshake, released by mbedtls_ssl_read() and mbedtls_ssl_write() once
+ * they hold no data and allocated again no larger than the negotiated
+ * maximum fragment length. An idle connection then costs no buffer at all,
+ * at the price of an allocation per read and write. DTLS connections keep
+ * full size buffers.
+ *
+ * Incompatible with MBEDTLS_ZLIB_SUPPORT.
+ *
+ * Uncomment this macro to allocate the buffers on demand
+ */
+//#define MBEDTLS_SSL_DYNAMIC_BUFFERS
+
 /**
  * \def MBEDTLS_SSL_PROTO_SSL3
  *
@@ -492,6 +492,40 @@ int mbedtls_ecp_tls_read_group( mbedtls_ecp_group *grp, const unsigned char **bu
 int mbedtls_ecp_tls_write_group( const mbedtls_ecp_group *grp, size_t *olen,
                          unsigned char *buf, size_t blen );
 
+#if defined(MBEDTLS_ECP_MUL_MOD_ALT)
+/**
+ * \brief           Field multiplication X = A * B mod grp->P, provided by
+ *                  the platform (MBEDTLS_ECP_MUL_MOD_ALT)
+ *
+ * \note            A and B are in the 0..P range. The result has to be
+ *                  bit-exact with mbedtls_mpi_mul_mpi() followed by a
+ *                  reduction mod P.
+ *
+ * \return          0 if successful,
+ *                  MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE to have the library
+ *                  do this multiplication in software,
+ *                  or another error code
+ */
+int mbedtls_ecp_mul_mod_alt( const mbedtls_ecp_group *grp, mbedtls_mpi *X,
+                             const mbedtls_mpi *A, const mbedtls_mpi *B );
+
+/**
+ * \brief           Called by the library before a scalar multiplication
+ *                  on grp (MBEDTLS_ECP_MUL_MOD_ALT), to prepare for a
+ *                  series of mbedtls_ecp_mul_mod_alt() calls
+ *
+ * \note            Calls may be nested. Each one is paired with a call
+ *                  to mbedtls_ecp_mul_mod_end().
+ */
+void mbedtls_ecp_mul_mod_start( mbedtls_ecp_group *grp );
+
+/**
+ * \brief           Called by the library after a scalar multiplication
+ *                  on grp (MBEDTLS_ECP_MUL_MOD_ALT)
+ */
+void mbedtls_ecp_mul_mod_end( mbedtls_ecp_group *grp );
+#endif /* MBEDTLS_ECP_MUL_MOD_ALT */
+
 /**
  * \brief           Multiplication by an integer: R = m * P
  *                  (Not thread-safe to use same group in multiple threads)
@@ -217,6 +217,24 @@
 #define MBEDTLS_SSL_MAX_CONTENT_LEN         16384   /**< Size of the input / output buffer */
 #endif
 
+/*
+ * Maximum length of the records received and of the records sent, which
+ * determine the size of the input and of the output buffer respectively.
+ *
+ * A client that only receives large records, for example one that downloads
+ * a lot more than it uploads, can do with a smaller output buffer. The input
+ * buffer has to hold the largest record the peer sends: reduce it only
+ * together with the Max Fragment Length extension, or if you control the
+ * peer.
+ */
+#if !defined(MBEDTLS_SSL_IN_CONTENT_LEN)
+#define MBEDTLS_SSL_IN_CONTENT_LEN          MBEDTLS_SSL_MAX_CONTENT_LEN
+#endif
+
+#if !defined(MBEDTLS_SSL_OUT_CONTENT_LEN)
+#define MBEDTLS_SSL_OUT_CONTENT_LEN         MBEDTLS_SSL_MAX_CONTENT_LEN
+#endif
+
 /* \} name SECTION: Module settings */
 
 /*
@@ -837,6 +855,13 @@ struct mbedtls_ssl_context
     int nb_zero;                /*!< # of 0-length encrypted messages */
     int record_read;            /*!< record is already present        */
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    size_t in_buf_len;          /*!< size of in_buf, 0 while released */
+    size_t in_buf_offsets[5];   /*!< in_ctr/hdr/len/iv/msg - in_buf,
+                                     kept while in_buf is released    */
+    unsigned char in_ctr_saved[8];  /*!< in_ctr while released        */
+#endif
+
     /*
      * Record layer (outgoing data)
      */
@@ -851,6 +876,13 @@ struct mbedtls_ssl_context
     size_t out_msglen;          /*!< record header: message length    */
     size_t out_left;            /*!< amount of data not yet written   */
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    size_t out_buf_len;         /*!< size of out_buf, 0 while released */
+    size_t out_buf_offsets[5];  /*!< out_ctr/hdr/len/iv/msg - out_buf,
+                                     kept while out_buf is released   */
+    unsigned char out_ctr_saved[8]; /*!< out_ctr while released       */
+#endif
+
 #if defined(MBEDTLS_ZLIB_SUPPORT)
     unsigned char *compress_buf;        /*!<  zlib data buffer        */
 #endif
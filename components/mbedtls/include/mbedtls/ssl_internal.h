@@ -138,13 +138,17 @@
 #define MBEDTLS_SSL_PADDING_ADD              0
 #endif
 
-#define MBEDTLS_SSL_BUFFER_LEN  ( MBEDTLS_SSL_MAX_CONTENT_LEN               \
-                        + MBEDTLS_SSL_COMPRESSION_ADD               \
+/* What a record buffer needs on top of the record contents */
+#define MBEDTLS_SSL_BUFFER_OVERHEAD ( MBEDTLS_SSL_COMPRESSION_ADD           \
                         + 29 /* counter + header + IV */    \
                         + MBEDTLS_SSL_MAC_ADD                       \
                         + MBEDTLS_SSL_PADDING_ADD                   \
                         )
 
+#define MBEDTLS_SSL_BUFFER_LEN      ( MBEDTLS_SSL_MAX_CONTENT_LEN + MBEDTLS_SSL_BUFFER_OVERHEAD )
+#define MBEDTLS_SSL_IN_BUFFER_LEN   ( MBEDTLS_SSL_IN_CONTENT_LEN + MBEDTLS_SSL_BUFFER_OVERHEAD )
+#define MBEDTLS_SSL_OUT_BUFFER_LEN  ( MBEDTLS_SSL_OUT_CONTENT_LEN + MBEDTLS_SSL_BUFFER_OVERHEAD )
+
 /*
  * TLS extension flags (for extensions with outgoing ServerHello content
  * that need it (e.g. for RENEGOTIATION_INFO the server already knows because
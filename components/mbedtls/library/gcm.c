@@ -45,6 +45,14 @@
 #include "mbedtls/aesni.h"
 #endif
 
+#if defined(MBEDTLS_AES_C)
+#include "mbedtls/aes.h"
+#endif
+
+#if defined(MBEDTLS_AES_BLOCK_PIPELINE_ALT)
+#include "mbedtls/cipher_internal.h"
+#endif
+
 #if defined(MBEDTLS_SELF_TEST) && defined(MBEDTLS_AES_C)
 #if defined(MBEDTLS_PLATFORM_C)
 #include "mbedtls/platform.h"
@@ -85,6 +93,13 @@ static void mbedtls_zeroize( void *v, size_t n ) {
 /*
  * Initialize a context
  */
+/* index of H itself in the tables of multiples of H */
+#if defined(MBEDTLS_GCM_TABLE_8BIT)
+#define GCM_TABLE_ONE   128
+#else
+#define GCM_TABLE_ONE   8
+#endif
+
 void mbedtls_gcm_init( mbedtls_gcm_context *ctx )
 {
     memset( ctx, 0, sizeof( mbedtls_gcm_context ) );
@@ -93,6 +108,7 @@ void mbedtls_gcm_init( mbedtls_gcm_context *ctx )
 /*
  * Precompute small multiples of H, that is set
  *      HH[i] || HL[i] = H times i,
+ * for all 4-bit i (or 8-bit i with MBEDTLS_GCM_TABLE_8BIT),
  * where i is seen as a field element as in [MGV], ie high-order bits
  * correspond to low powers of P. The result is stored in the same way, that
  * is the high-order bit of HH corresponds to P^0 and the low-order bit of HL
@@ -119,9 +135,9 @@ static int gcm_gen_table( mbedtls_gcm_context *ctx )
     GET_UINT32_BE( lo, h,  12 );
     vl = (uint64_t) hi << 32 | lo;
 
-    /* 8 = 1000 corresponds to 1 in GF(2^128) */
-    ctx->HL[8] = vl;
-    ctx->HH[8] = vh;
+    /* 8 = 1000 (or 128 = 10000000) corresponds to 1 in GF(2^128) */
+    ctx->HL[GCM_TABLE_ONE] = vl;
+    ctx->HH[GCM_TABLE_ONE] = vh;
 
 #if defined(MBEDTLS_AESNI_C) && defined(MBEDTLS_HAVE_X86_64)
     /* With CLMUL support, we need only h, not the rest of the table */
@@ -133,7 +149,7 @@ static int gcm_gen_table( mbedtls_gcm_context *ctx )
     ctx->HH[0] = 0;
     ctx->HL[0] = 0;
 
-    for( i = 4; i > 0; i >>= 1 )
+    for( i = GCM_TABLE_ONE / 2; i > 0; i >>= 1 )
     {
         uint32_t T = ( vl & 1 ) * 0xe1000000U;
         vl  = ( vh << 63 ) | ( vl >> 1 );
@@ -143,7 +159,7 @@ static int gcm_gen_table( mbedtls_gcm_context *ctx )
         ctx->HH[i] = vh;
     }
 
-    for( i = 2; i <= 8; i *= 2 )
+    for( i = 2; i <= GCM_TABLE_ONE; i *= 2 )
     {
         uint64_t *HiL = ctx->HL + i, *HiH = ctx->HH + i;
         vh = *HiH;
@@ -190,6 +206,48 @@ int mbedtls_gcm_setkey( mbedtls_gcm_context *ctx,
     return( 0 );
 }
 
+#if defined(MBEDTLS_GCM_TABLE_8BIT)
+/*
+ * Shoup's method for multiplication, a byte at a time, uses this table with
+ *      last8[x] = x times P^128
+ * where x and last8[x] are seen as elements of GF(2^128) as in [MGV]
+ */
+static const uint16_t last8[256] =
+{
+    0x0000, 0x01c2, 0x0384, 0x0246, 0x0708, 0x06ca, 0x048c, 0x054e,
+    0x0e10, 0x0fd2, 0x0d94, 0x0c56, 0x0918, 0x08da, 0x0a9c, 0x0b5e,
+    0x1c20, 0x1de2, 0x1fa4, 0x1e66, 0x1b28, 0x1aea, 0x18ac, 0x196e,
+    0x1230, 0x13f2, 0x11b4, 0x1076, 0x1538, 0x14fa, 0x16bc, 0x177e,
+    0x3840, 0x3982, 0x3bc4, 0x3a06, 0x3f48, 0x3e8a, 0x3ccc, 0x3d0e,
+    0x3650, 0x3792, 0x35d4, 0x3416, 0x3158, 0x309a, 0x32dc, 0x331e,
+    0x2460, 0x25a2, 0x27e4, 0x2626, 0x2368, 0x22aa, 0x20ec, 0x212e,
+    0x2a70, 0x2bb2, 0x29f4, 0x2836, 0x2d78, 0x2cba, 0x2efc, 0x2f3e,
+    0x7080, 0x7142, 0x7304, 0x72c6, 0x7788, 0x764a, 0x740c, 0x75ce,
+    0x7e90, 0x7f52, 0x7d14, 0x7cd6, 0x7998, 0x785a, 0x7a1c, 0x7bde,
+    0x6ca0, 0x6d62, 0x6f24, 0x6ee6, 0x6ba8, 0x6a6a, 0x682c, 0x69ee,
+    0x62b0, 0x6372, 0x6134, 0x60f6, 0x65b8, 0x647a, 0x663c, 0x67fe,
+    0x48c0, 0x4902, 0x4b44, 0x4a86, 0x4fc8, 0x4e0a, 0x4c4c, 0x4d8e,
+    0x46d0, 0x4712, 0x4554, 0x4496, 0x41d8, 0x401a, 0x425c, 0x439e,
+    0x54e0, 0x5522, 0x5764, 0x56a6, 0x53e8, 0x522a, 0x506c, 0x51ae,
+    0x5af0, 0x5b32, 0x5974, 0x58b6, 0x5df8, 0x5c3a, 0x5e7c, 0x5fbe,
+    0xe100, 0xe0c2, 0xe284, 0xe346, 0xe608, 0xe7ca, 0xe58c, 0xe44e,
+    0xef10, 0xeed2, 0xec94, 0xed56, 0xe818, 0xe9da, 0xeb9c, 0xea5e,
+    0xfd20, 0xfce2, 0xfea4, 0xff66, 0xfa28, 0xfbea, 0xf9ac, 0xf86e,
+    0xf330, 0xf2f2, 0xf0b4, 0xf176, 0xf438, 0xf5fa, 0xf7bc, 0xf67e,
+    0xd940, 0xd882, 0xdac4, 0xdb06, 0xde48, 0xdf8a, 0xddcc, 0xdc0e,
+    0xd750, 0xd692, 0xd4d4, 0xd516, 0xd058, 0xd19a, 0xd3dc, 0xd21e,
+    0xc560, 0xc4a2, 0xc6e4, 0xc726, 0xc268, 0xc3aa, 0xc1ec, 0xc02e,
+    0xcb70, 0xcab2, 0xc8f4, 0xc936, 0xcc78, 0xcdba, 0xcffc, 0xce3e,
+    0x9180, 0x9042, 0x9204, 0x93c6, 0x9688, 0x974a, 0x950c, 0x94ce,
+    0x9f90, 0x9e52, 0x9c14, 0x9dd6, 0x9898, 0x995a, 0x9b1c, 0x9ade,
+    0x8da0, 0x8c62, 0x8e24, 0x8fe6, 0x8aa8, 0x8b6a, 0x892c, 0x88ee,
+    0x83b0, 0x8272, 0x8034, 0x81f6, 0x84b8, 0x857a, 0x873c, 0x86fe,
+    0xa9c0, 0xa802, 0xaa44, 0xab86, 0xaec8, 0xaf0a, 0xad4c, 0xac8e,
+    0xa7d0, 0xa612, 0xa454, 0xa596, 0xa0d8, 0xa11a, 0xa35c, 0xa29e,
+    0xb5e0, 0xb422, 0xb664, 0xb7a6, 0xb2e8, 0xb32a, 0xb16c, 0xb0ae,
+    0xbbf0, 0xba32, 0xb874, 0xb9b6, 0xbcf8, 0xbd3a, 0xbf7c, 0xbebe
+};
+#else
 /*
  * Shoup's method for multiplication use this table with
  *      last4[x] = x times P^128
@@ -202,6 +260,7 @@ static const uint64_t last4[16] =
     0xe100, 0xfd20, 0xd940, 0xc560,
     0x9180, 0x8da0, 0xa9c0, 0xb5e0
 };
+#endif /* MBEDTLS_GCM_TABLE_8BIT */
 
 /*
  * Sets output to x times H using the precomputed tables.
@@ -211,23 +270,40 @@ static void gcm_mult( mbedtls_gcm_context *ctx, const unsigned char x[16],
                       unsigned char output[16] )
 {
     int i = 0;
-    unsigned char lo, hi, rem;
+#if !defined(MBEDTLS_GCM_TABLE_8BIT)
+    unsigned char lo, hi;
+#endif
+    unsigned char rem;
     uint64_t zh, zl;
 
 #if defined(MBEDTLS_AESNI_C) && defined(MBEDTLS_HAVE_X86_64)
     if( mbedtls_aesni_has_support( MBEDTLS_AESNI_CLMUL ) ) {
         unsigned char h[16];
 
-        PUT_UINT32_BE( ctx->HH[8] >> 32, h,  0 );
-        PUT_UINT32_BE( ctx->HH[8],       h,  4 );
-        PUT_UINT32_BE( ctx->HL[8] >> 32, h,  8 );
-        PUT_UINT32_BE( ctx->HL[8],       h, 12 );
+        PUT_UINT32_BE( ctx->HH[GCM_TABLE_ONE] >> 32, h,  0 );
+        PUT_UINT32_BE( ctx->HH[GCM_TABLE_ONE],       h,  4 );
+        PUT_UINT32_BE( ctx->HL[GCM_TABLE_ONE] >> 32, h,  8 );
+        PUT_UINT32_BE( ctx->HL[GCM_TABLE_ONE],       h, 12 );
 
         mbedtls_aesni_gcm_mult( output, x, h );
         return;
     }
 #endif /* MBEDTLS_AESNI_C && MBEDTLS_HAVE_X86_64 */
 
+#if defined(MBEDTLS_GCM_TABLE_8BIT)
+    zh = ctx->HH[x[15]];
+    zl = ctx->HL[x[15]];
+
+    for( i = 14; i >= 0; i-- )
+    {
+        rem = (unsigned char) zl;
+        zl = ( zh << 56 ) | ( zl >> 8 );
+        zh = ( zh >> 8 );
+        zh ^= (uint64_t) last8[rem] << 48;
+        zh ^= ctx->HH[x[i]];
+        zl ^= ctx->HL[x[i]];
+    }
+#else
     lo = x[15] & 0xf;
 
     zh = ctx->HH[lo];
@@ -256,6 +332,7 @@ static void gcm_mult( mbedtls_gcm_context *ctx, const unsigned char x[16],
         zh ^= ctx->HH[hi];
         zl ^= ctx->HL[hi];
     }
+#endif /* MBEDTLS_GCM_TABLE_8BIT */
 
     PUT_UINT32_BE( zh >> 32, output, 0 );
     PUT_UINT32_BE( zh, output, 4 );
@@ -344,6 +421,82 @@ int mbedtls_gcm_starts( mbedtls_gcm_context *ctx,
     return( 0 );
 }
 
+/*
+ * Encrypt or decrypt (up to) one block with the key stream block ectr and
+ * fold the ciphertext into the GHASH value.
+ */
+static void gcm_crypt_block( mbedtls_gcm_context *ctx, const unsigned char ectr[16],
+                             size_t use_len, const unsigned char *p,
+                             unsigned char *out_p )
+{
+    size_t i;
+
+    for( i = 0; i < use_len; i++ )
+    {
+        if( ctx->mode == MBEDTLS_GCM_DECRYPT )
+            ctx->buf[i] ^= p[i];
+        out_p[i] = ectr[i] ^ p[i];
+        if( ctx->mode == MBEDTLS_GCM_ENCRYPT )
+            ctx->buf[i] ^= out_p[i];
+    }
+
+    gcm_mult( ctx, ctx->buf, ctx->buf );
+}
+
+static void gcm_incr( unsigned char y[16] )
+{
+    size_t i;
+
+    for( i = 16; i > 12; i-- )
+        if( ++y[i - 1] != 0 )
+            break;
+}
+
+#if defined(MBEDTLS_AES_BLOCK_PIPELINE_ALT)
+/*
+ * Run the counter blocks of a whole update through an alternative AES
+ * implementation that can work on one block in the background (see
+ * MBEDTLS_AES_BLOCK_PIPELINE_ALT in aes_alt.h), acquired once: the next
+ * counter block is encrypted while the CPU applies the current one and
+ * does its GHASH multiplication.
+ */
+static void gcm_update_aes_hardware( mbedtls_gcm_context *ctx,
+                                     size_t length,
+                                     const unsigned char *input,
+                                     unsigned char *output )
+{
+    unsigned char ectr[16];
+    size_t use_len;
+
+    mbedtls_aes_acquire_hardware();
+    mbedtls_aes_setkey_hardware( ctx->cipher_ctx.cipher_ctx, MBEDTLS_AES_ENCRYPT );
+
+    gcm_incr( ctx->y );
+    mbedtls_aes_block_start( ctx->y );
+
+    while( length > 0 )
+    {
+        use_len = ( length < 16 ) ? length : 16;
+
+        mbedtls_aes_block_finish( ectr );
+        if( length > 16 )
+        {
+            gcm_incr( ctx->y );
+            mbedtls_aes_block_start( ctx->y );
+        }
+
+        gcm_crypt_block( ctx, ectr, use_len, input, output );
+
+        length -= use_len;
+        input += use_len;
+        output += use_len;
+    }
+
+    mbedtls_aes_release_hardware();
+    mbedtls_zeroize( ectr, sizeof( ectr ) );
+}
+#endif /* MBEDTLS_AES_BLOCK_PIPELINE_ALT */
+
 int mbedtls_gcm_update( mbedtls_gcm_context *ctx,
                 size_t length,
                 const unsigned char *input,
@@ -351,7 +504,6 @@ int mbedtls_gcm_update( mbedtls_gcm_context *ctx,
 {
     int ret;
     unsigned char ectr[16];
-    size_t i;
     const unsigned char *p;
     unsigned char *out_p = output;
     size_t use_len, olen = 0;
@@ -369,14 +521,20 @@ int mbedtls_gcm_update( mbedtls_gcm_context *ctx,
 
     ctx->len += length;
 
+#if defined(MBEDTLS_AES_BLOCK_PIPELINE_ALT)
+    if( length > 0 && ctx->cipher_ctx.cipher_info->base->cipher == MBEDTLS_CIPHER_ID_AES )
+    {
+        gcm_update_aes_hardware( ctx, length, input, output );
+        return( 0 );
+    }
+#endif
+
     p = input;
     while( length > 0 )
     {
         use_len = ( length < 16 ) ? length : 16;
 
-        for( i = 16; i > 12; i-- )
-            if( ++ctx->y[i - 1] != 0 )
-                break;
+        gcm_incr( ctx->y );
 
         if( ( ret = mbedtls_cipher_update( &ctx->cipher_ctx, ctx->y, 16, ectr,
                                    &olen ) ) != 0 )
@@ -384,16 +542,7 @@ int mbedtls_gcm_update( mbedtls_gcm_context *ctx,
             return( ret );
         }
 
-        for( i = 0; i < use_len; i++ )
-        {
-            if( ctx->mode == MBEDTLS_GCM_DECRYPT )
-                ctx->buf[i] ^= p[i];
-            out_p[i] = ectr[i] ^ p[i];
-            if( ctx->mode == MBEDTLS_GCM_ENCRYPT )
-                ctx->buf[i] ^= out_p[i];
-        }
-
-        gcm_mult( ctx, ctx->buf, ctx->buf );
+        gcm_crypt_block( ctx, ectr, use_len, p, out_p );
 
         length -= use_len;
         p += use_len;
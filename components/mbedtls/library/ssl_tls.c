@@ -157,6 +157,15 @@ static unsigned int mfl_code_to_length[MBEDTLS_SSL_MAX_FRAG_LEN_INVALID] =
 };
 #endif /* MBEDTLS_SSL_MAX_FRAGMENT_LENGTH */
 
+/* Current size of the input / output buffer */
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+#define SSL_IN_BUF_LEN( ssl )   ( (ssl)->in_buf_len )
+#define SSL_OUT_BUF_LEN( ssl )  ( (ssl)->out_buf_len )
+#else
+#define SSL_IN_BUF_LEN( ssl )   ( (size_t) MBEDTLS_SSL_IN_BUFFER_LEN )
+#define SSL_OUT_BUF_LEN( ssl )  ( (size_t) MBEDTLS_SSL_OUT_BUFFER_LEN )
+#endif
+
 #if defined(MBEDTLS_SSL_CLI_C)
 static int ssl_session_copy( mbedtls_ssl_session *dst, const mbedtls_ssl_session *src )
 {
@@ -1877,14 +1886,14 @@ static int ssl_decrypt_buf( mbedtls_ssl_context *ssl )
              * Padding is guaranteed to be incorrect if:
              *   1. padlen >= ssl->in_msglen
              *
-             *   2. padding_idx >= MBEDTLS_SSL_MAX_CONTENT_LEN +
+             *   2. padding_idx >= MBEDTLS_SSL_IN_CONTENT_LEN +
              *                     ssl->transform_in->maclen
              *
              * In both cases we reset padding_idx to a safe value (0) to
              * prevent out-of-buffer reads.
              */
             correct &= ( ssl->in_msglen >= padlen + 1 );
-            correct &= ( padding_idx < MBEDTLS_SSL_MAX_CONTENT_LEN +
+            correct &= ( padding_idx < MBEDTLS_SSL_IN_CONTENT_LEN +
                                        ssl->transform_in->maclen );
 
             padding_idx *= correct;
@@ -2098,7 +2107,7 @@ static int ssl_compress_buf( mbedtls_ssl_context *ssl )
     ssl->transform_out->ctx_deflate.next_in = msg_pre;
     ssl->transform_out->ctx_deflate.avail_in = len_pre;
     ssl->transform_out->ctx_deflate.next_out = msg_post;
-    ssl->transform_out->ctx_deflate.avail_out = MBEDTLS_SSL_BUFFER_LEN;
+    ssl->transform_out->ctx_deflate.avail_out = MBEDTLS_SSL_OUT_BUFFER_LEN;
 
     ret = deflate( &ssl->transform_out->ctx_deflate, Z_SYNC_FLUSH );
     if( ret != Z_OK )
@@ -2107,7 +2116,7 @@ static int ssl_compress_buf( mbedtls_ssl_context *ssl )
         return( MBEDTLS_ERR_SSL_COMPRESSION_FAILED );
     }
 
-    ssl->out_msglen = MBEDTLS_SSL_BUFFER_LEN -
+    ssl->out_msglen = MBEDTLS_SSL_OUT_BUFFER_LEN -
                       ssl->transform_out->ctx_deflate.avail_out;
 
     MBEDTLS_SSL_DEBUG_MSG( 3, ( "after compression: msglen = %d, ",
@@ -2144,7 +2153,7 @@ static int ssl_decompress_buf( mbedtls_ssl_context *ssl )
     ssl->transform_in->ctx_inflate.next_in = msg_pre;
     ssl->transform_in->ctx_inflate.avail_in = len_pre;
     ssl->transform_in->ctx_inflate.next_out = msg_post;
-    ssl->transform_in->ctx_inflate.avail_out = MBEDTLS_SSL_MAX_CONTENT_LEN;
+    ssl->transform_in->ctx_inflate.avail_out = MBEDTLS_SSL_IN_CONTENT_LEN;
 
     ret = inflate( &ssl->transform_in->ctx_inflate, Z_SYNC_FLUSH );
     if( ret != Z_OK )
@@ -2153,7 +2162,7 @@ static int ssl_decompress_buf( mbedtls_ssl_context *ssl )
         return( MBEDTLS_ERR_SSL_COMPRESSION_FAILED );
     }
 
-    ssl->in_msglen = MBEDTLS_SSL_MAX_CONTENT_LEN -
+    ssl->in_msglen = MBEDTLS_SSL_IN_CONTENT_LEN -
                      ssl->transform_in->ctx_inflate.avail_out;
 
     MBEDTLS_SSL_DEBUG_MSG( 3, ( "after decompression: msglen = %d, ",
@@ -2228,7 +2237,7 @@ int mbedtls_ssl_fetch_input( mbedtls_ssl_context *ssl, size_t nb_want )
         return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
     }
 
-    if( nb_want > MBEDTLS_SSL_BUFFER_LEN - (size_t)( ssl->in_hdr - ssl->in_buf ) )
+    if( nb_want > SSL_IN_BUF_LEN( ssl ) - (size_t)( ssl->in_hdr - ssl->in_buf ) )
     {
         MBEDTLS_SSL_DEBUG_MSG( 1, ( "requesting more data than fits" ) );
         return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
@@ -2311,7 +2320,7 @@ int mbedtls_ssl_fetch_input( mbedtls_ssl_context *ssl, size_t nb_want )
             ret = MBEDTLS_ERR_SSL_TIMEOUT;
         else
         {
-            len = MBEDTLS_SSL_BUFFER_LEN - ( ssl->in_hdr - ssl->in_buf );
+            len = SSL_IN_BUF_LEN( ssl ) - ( ssl->in_hdr - ssl->in_buf );
 
             if( ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER )
                 timeout = ssl->handshake->retransmit_timeout;
@@ -2958,7 +2967,7 @@ static int ssl_reassemble_dtls_handshake( mbedtls_ssl_context *ssl )
         MBEDTLS_SSL_DEBUG_MSG( 2, ( "initialize reassembly, total length = %d",
                             msg_len ) );
 
-        if( ssl->in_hslen > MBEDTLS_SSL_MAX_CONTENT_LEN )
+        if( ssl->in_hslen > MBEDTLS_SSL_IN_CONTENT_LEN )
         {
             MBEDTLS_SSL_DEBUG_MSG( 1, ( "handshake message too large" ) );
             return( MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE );
@@ -3062,7 +3071,7 @@ static int ssl_reassemble_dtls_handshake( mbedtls_ssl_context *ssl )
         ssl->next_record_offset = new_remain - ssl->in_hdr;
         ssl->in_left = ssl->next_record_offset + remain_len;
 
-        if( ssl->in_left > MBEDTLS_SSL_BUFFER_LEN -
+        if( ssl->in_left > SSL_IN_BUF_LEN( ssl ) -
                            (size_t)( ssl->in_hdr - ssl->in_buf ) )
         {
             MBEDTLS_SSL_DEBUG_MSG( 1, ( "reassembled message too large for buffer" ) );
@@ -3432,7 +3441,7 @@ static int ssl_handle_possible_reconnect( mbedtls_ssl_context *ssl )
             ssl->conf->p_cookie,
             ssl->cli_id, ssl->cli_id_len,
             ssl->in_buf, ssl->in_left,
-            ssl->out_buf, MBEDTLS_SSL_MAX_CONTENT_LEN, &len );
+            ssl->out_buf, MBEDTLS_SSL_OUT_CONTENT_LEN, &len );
 
     MBEDTLS_SSL_DEBUG_RET( 2, "ssl_check_dtls_clihlo_cookie", ret );
 
@@ -3529,7 +3538,7 @@ static int ssl_parse_record_header( mbedtls_ssl_context *ssl )
     }
 
     /* Check length against the size of our buffer */
-    if( ssl->in_msglen > MBEDTLS_SSL_BUFFER_LEN
+    if( ssl->in_msglen > SSL_IN_BUF_LEN( ssl )
                          - (size_t)( ssl->in_msg - ssl->in_buf ) )
     {
         MBEDTLS_SSL_DEBUG_MSG( 1, ( "bad message length" ) );
@@ -3540,7 +3549,7 @@ static int ssl_parse_record_header( mbedtls_ssl_context *ssl )
     if( ssl->transform_in == NULL )
     {
         if( ssl->in_msglen < 1 ||
-            ssl->in_msglen > MBEDTLS_SSL_MAX_CONTENT_LEN )
+            ssl->in_msglen > MBEDTLS_SSL_IN_CONTENT_LEN )
         {
             MBEDTLS_SSL_DEBUG_MSG( 1, ( "bad message length" ) );
             return( MBEDTLS_ERR_SSL_INVALID_RECORD );
@@ -3556,7 +3565,7 @@ static int ssl_parse_record_header( mbedtls_ssl_context *ssl )
 
 #if defined(MBEDTLS_SSL_PROTO_SSL3)
         if( ssl->minor_ver == MBEDTLS_SSL_MINOR_VERSION_0 &&
-            ssl->in_msglen > ssl->transform_in->minlen + MBEDTLS_SSL_MAX_CONTENT_LEN )
+            ssl->in_msglen > ssl->transform_in->minlen + MBEDTLS_SSL_IN_CONTENT_LEN )
         {
             MBEDTLS_SSL_DEBUG_MSG( 1, ( "bad message length" ) );
             return( MBEDTLS_ERR_SSL_INVALID_RECORD );
@@ -3569,7 +3578,7 @@ static int ssl_parse_record_header( mbedtls_ssl_context *ssl )
          */
         if( ssl->minor_ver >= MBEDTLS_SSL_MINOR_VERSION_1 &&
             ssl->in_msglen > ssl->transform_in->minlen +
-                             MBEDTLS_SSL_MAX_CONTENT_LEN + 256 )
+                             MBEDTLS_SSL_IN_CONTENT_LEN + 256 )
         {
             MBEDTLS_SSL_DEBUG_MSG( 1, ( "bad message length" ) );
             return( MBEDTLS_ERR_SSL_INVALID_RECORD );
@@ -3693,7 +3702,7 @@ static int ssl_prepare_record_content( mbedtls_ssl_context *ssl )
         MBEDTLS_SSL_DEBUG_BUF( 4, "input payload after decrypt",
                        ssl->in_msg, ssl->in_msglen );
 
-        if( ssl->in_msglen > MBEDTLS_SSL_MAX_CONTENT_LEN )
+        if( ssl->in_msglen > MBEDTLS_SSL_IN_CONTENT_LEN )
         {
             MBEDTLS_SSL_DEBUG_MSG( 1, ( "bad message length" ) );
             return( MBEDTLS_ERR_SSL_INVALID_RECORD );
@@ -3991,6 +4000,173 @@ int mbedtls_ssl_send_fatal_handshake_failure( mbedtls_ssl_context *ssl )
     return( 0 );
 }
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+/*
+ * Record buffers allocated on demand
+ *
+ * TLS only: DTLS connections keep the buffers mbedtls_ssl_setup() gives
+ * them. A buffer is released while it holds nothing the connection needs
+ * but the record counter, which is kept aside together with the offsets
+ * of the record pointers.
+ */
+
+/* Content length the input buffer has to take in the current state */
+static size_t ssl_dynamic_in_content_len( const mbedtls_ssl_context *ssl )
+{
+    size_t len = MBEDTLS_SSL_IN_CONTENT_LEN;
+
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    if( ssl->state == MBEDTLS_SSL_HANDSHAKE_OVER && ssl->session != NULL &&
+        mfl_code_to_length[ssl->session->mfl_code] < len )
+    {
+        len = mfl_code_to_length[ssl->session->mfl_code];
+    }
+#endif
+
+    return( len );
+}
+
+/* Content length the output buffer has to take in the current state */
+static size_t ssl_dynamic_out_content_len( const mbedtls_ssl_context *ssl )
+{
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    if( ssl->state == MBEDTLS_SSL_HANDSHAKE_OVER )
+        return( mbedtls_ssl_get_max_frag_len( ssl ) );
+#endif
+
+    return( MBEDTLS_SSL_OUT_CONTENT_LEN );
+}
+
+/*
+ * Give a record buffer len bytes, or release it if len is 0, keeping
+ * the contents that fit and moving the record pointers along.
+ * ptrs[0] is the record counter.
+ */
+static int ssl_resize_buf( unsigned char **buf, size_t *buf_len, size_t len,
+                           unsigned char **ptrs[5], size_t offsets[5],
+                           unsigned char ctr_saved[8] )
+{
+    unsigned char *new_buf = NULL;
+    size_t i;
+
+    if( len != 0 && ( new_buf = mbedtls_calloc( 1, len ) ) == NULL )
+    {
+        MBEDTLS_SSL_DEBUG_MSG( 1, ( "alloc(%d bytes) failed", len ) );
+        return( MBEDTLS_ERR_SSL_ALLOC_FAILED );
+    }
+
+    if( *buf != NULL )
+    {
+        for( i = 0; i < 5; i++ )
+            offsets[i] = *ptrs[i] - *buf;
+
+        if( new_buf != NULL )
+            memcpy( new_buf, *buf, len < *buf_len ? len : *buf_len );
+        else
+            memcpy( ctr_saved, *ptrs[0], 8 );
+
+        mbedtls_zeroize( *buf, *buf_len );
+        mbedtls_free( *buf );
+    }
+    else if( new_buf != NULL )
+        memcpy( new_buf + offsets[0], ctr_saved, 8 );
+
+    *buf = new_buf;
+    *buf_len = len;
+
+    for( i = 0; i < 5; i++ )
+        *ptrs[i] = ( new_buf != NULL ) ? new_buf + offsets[i] : NULL;
+
+    return( 0 );
+}
+
+static int ssl_resize_in_buf( mbedtls_ssl_context *ssl, size_t len )
+{
+    unsigned char **ptrs[5] = { &ssl->in_ctr, &ssl->in_hdr, &ssl->in_len,
+                                &ssl->in_iv, &ssl->in_msg };
+    size_t offt = 0;
+    int ret;
+
+    if( ssl->in_offt != NULL )
+        offt = ssl->in_offt - ssl->in_buf;
+
+    if( ( ret = ssl_resize_buf( &ssl->in_buf, &ssl->in_buf_len, len, ptrs,
+                                ssl->in_buf_offsets, ssl->in_ctr_saved ) ) != 0 )
+        return( ret );
+
+    if( ssl->in_offt != NULL )
+        ssl->in_offt = ssl->in_buf + offt;
+
+    return( 0 );
+}
+
+static int ssl_resize_out_buf( mbedtls_ssl_context *ssl, size_t len )
+{
+    unsigned char **ptrs[5] = { &ssl->out_ctr, &ssl->out_hdr, &ssl->out_len,
+                                &ssl->out_iv, &ssl->out_msg };
+
+    return( ssl_resize_buf( &ssl->out_buf, &ssl->out_buf_len, len, ptrs,
+                            ssl->out_buf_offsets, ssl->out_ctr_saved ) );
+}
+
+/*
+ * Allocate the buffers, or grow them, to what the current state needs:
+ * full size during a handshake, the maximum fragment length after it.
+ */
+static int ssl_buffers_prepare( mbedtls_ssl_context *ssl )
+{
+    int ret;
+    size_t len;
+
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+    if( ssl->conf->transport == MBEDTLS_SSL_TRANSPORT_DATAGRAM )
+        return( 0 );
+#endif
+
+    len = ssl_dynamic_in_content_len( ssl ) + MBEDTLS_SSL_BUFFER_OVERHEAD;
+    if( ssl->in_buf_len < len &&
+        ( ret = ssl_resize_in_buf( ssl, len ) ) != 0 )
+    {
+        return( ret );
+    }
+
+    len = ssl_dynamic_out_content_len( ssl ) + MBEDTLS_SSL_BUFFER_OVERHEAD;
+    if( ssl->out_buf_len < len &&
+        ( ret = ssl_resize_out_buf( ssl, len ) ) != 0 )
+    {
+        return( ret );
+    }
+
+    return( 0 );
+}
+
+/*
+ * Release the buffers that hold no data, once the handshake is over:
+ * the input buffer with no record partly read, no application data left
+ * and no further handshake message in the last record, the output buffer
+ * with everything written.
+ */
+static void ssl_buffers_idle( mbedtls_ssl_context *ssl )
+{
+    if( ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER )
+        return;
+
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+    if( ssl->conf->transport == MBEDTLS_SSL_TRANSPORT_DATAGRAM )
+        return;
+#endif
+
+    if( ssl->in_buf != NULL && ssl->in_left == 0 && ssl->in_offt == NULL &&
+        ( ssl->in_hslen == 0 || ssl->in_hslen >= ssl->in_msglen ) )
+    {
+        (void) ssl_resize_in_buf( ssl, 0 );
+    }
+
+    if( ssl->out_buf != NULL && ssl->out_left == 0 )
+        (void) ssl_resize_out_buf( ssl, 0 );
+}
+#endif /* MBEDTLS_SSL_DYNAMIC_BUFFERS */
+
 int mbedtls_ssl_send_alert_message( mbedtls_ssl_context *ssl,
                             unsigned char level,
                             unsigned char message )
@@ -4000,6 +4176,11 @@ int mbedtls_ssl_send_alert_message( mbedtls_ssl_context *ssl,
     if( ssl == NULL || ssl->conf == NULL )
         return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    if( ( ret = ssl_buffers_prepare( ssl ) ) != 0 )
+        return( ret );
+#endif
+
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "=> send alert message" ) );
 
     ssl->out_msgtype = MBEDTLS_SSL_MSG_ALERT;
@@ -4144,10 +4325,10 @@ int mbedtls_ssl_write_certificate( mbedtls_ssl_context *ssl )
     while( crt != NULL )
     {
         n = crt->raw.len;
-        if( n > MBEDTLS_SSL_MAX_CONTENT_LEN - 3 - i )
+        if( n > MBEDTLS_SSL_OUT_CONTENT_LEN - 3 - i )
         {
             MBEDTLS_SSL_DEBUG_MSG( 1, ( "certificate too large, %d > %d",
-                           i + 3 + n, MBEDTLS_SSL_MAX_CONTENT_LEN ) );
+                           i + 3 + n, MBEDTLS_SSL_OUT_CONTENT_LEN ) );
             return( MBEDTLS_ERR_SSL_CERTIFICATE_TOO_LARGE );
         }
 
@@ -5365,22 +5546,45 @@ int mbedtls_ssl_setup( mbedtls_ssl_context *ssl,
                        const mbedtls_ssl_config *conf )
 {
     int ret;
-    const size_t len = MBEDTLS_SSL_BUFFER_LEN;
+    const size_t in_len = MBEDTLS_SSL_IN_BUFFER_LEN;
+    const size_t out_len = MBEDTLS_SSL_OUT_BUFFER_LEN;
 
     ssl->conf = conf;
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    /*
+     * TLS buffers are allocated by the first handshake step, with the
+     * record pointers where they would be in a fresh buffer
+     */
+    if( conf->transport == MBEDTLS_SSL_TRANSPORT_STREAM )
+    {
+        const size_t offsets[5] = { 0, 8, 11, 13, 13 };
+
+        memcpy( ssl->in_buf_offsets, offsets, sizeof( offsets ) );
+        memcpy( ssl->out_buf_offsets, offsets, sizeof( offsets ) );
+
+        return( ssl_handshake_init( ssl ) );
+    }
+#endif
+
     /*
      * Prepare base structures
      */
-    if( ( ssl-> in_buf = mbedtls_calloc( 1, len ) ) == NULL ||
-        ( ssl->out_buf = mbedtls_calloc( 1, len ) ) == NULL )
+    if( ( ssl-> in_buf = mbedtls_calloc( 1, in_len ) ) == NULL ||
+        ( ssl->out_buf = mbedtls_calloc( 1, out_len ) ) == NULL )
     {
-        MBEDTLS_SSL_DEBUG_MSG( 1, ( "alloc(%d bytes) failed", len ) );
+        MBEDTLS_SSL_DEBUG_MSG( 1, ( "alloc(%d bytes) failed",
+                                    ssl->in_buf == NULL ? in_len : out_len ) );
         mbedtls_free( ssl->in_buf );
         ssl->in_buf = NULL;
         return( MBEDTLS_ERR_SSL_ALLOC_FAILED );
     }
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    ssl->in_buf_len = in_len;
+    ssl->out_buf_len = out_len;
+#endif
+
 #if defined(MBEDTLS_SSL_PROTO_DTLS)
     if( conf->transport == MBEDTLS_SSL_TRANSPORT_DATAGRAM )
     {
@@ -5475,9 +5679,21 @@ static int ssl_session_reset_int( mbedtls_ssl_context *ssl, int partial )
     ssl->transform_in = NULL;
     ssl->transform_out = NULL;
 
-    memset( ssl->out_buf, 0, MBEDTLS_SSL_BUFFER_LEN );
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    /* Released buffers come back as after mbedtls_ssl_setup() */
+    memset( ssl->out_ctr_saved, 0, 8 );
+    ssl->out_buf_offsets[3] = ssl->out_buf_offsets[4] = 13;
     if( partial == 0 )
-        memset( ssl->in_buf, 0, MBEDTLS_SSL_BUFFER_LEN );
+    {
+        memset( ssl->in_ctr_saved, 0, 8 );
+        ssl->in_buf_offsets[3] = ssl->in_buf_offsets[4] = 13;
+    }
+#endif
+
+    if( ssl->out_buf != NULL )
+        memset( ssl->out_buf, 0, SSL_OUT_BUF_LEN( ssl ) );
+    if( partial == 0 && ssl->in_buf != NULL )
+        memset( ssl->in_buf, 0, SSL_IN_BUF_LEN( ssl ) );
 
 #if defined(MBEDTLS_SSL_HW_RECORD_ACCEL)
     if( mbedtls_ssl_hw_record_reset != NULL )
@@ -5802,7 +6018,7 @@ int mbedtls_ssl_conf_psk( mbedtls_ssl_config *conf,
 
     /* Identity len will be encoded on two bytes */
     if( ( psk_identity_len >> 16 ) != 0 ||
-        psk_identity_len > MBEDTLS_SSL_MAX_CONTENT_LEN )
+        psk_identity_len > MBEDTLS_SSL_OUT_CONTENT_LEN )
     {
         return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
     }
@@ -6242,6 +6458,12 @@ size_t mbedtls_ssl_get_max_frag_len( const mbedtls_ssl_context *ssl )
         max_len = mfl_code_to_length[ssl->session_out->mfl_code];
     }
 
+    /*
+     * And what the output buffer takes
+     */
+    if( max_len > MBEDTLS_SSL_OUT_CONTENT_LEN )
+        max_len = MBEDTLS_SSL_OUT_CONTENT_LEN;
+
     return max_len;
 }
 #endif /* MBEDTLS_SSL_MAX_FRAGMENT_LENGTH */
@@ -6281,6 +6503,11 @@ int mbedtls_ssl_handshake_step( mbedtls_ssl_context *ssl )
     if( ssl == NULL || ssl->conf == NULL )
         return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    if( ( ret = ssl_buffers_prepare( ssl ) ) != 0 )
+        return( ret );
+#endif
+
 #if defined(MBEDTLS_SSL_CLI_C)
     if( ssl->conf->endpoint == MBEDTLS_SSL_IS_CLIENT )
         ret = mbedtls_ssl_handshake_client_step( ssl );
@@ -6313,6 +6540,10 @@ int mbedtls_ssl_handshake( mbedtls_ssl_context *ssl )
             break;
     }
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    ssl_buffers_idle( ssl );
+#endif
+
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "<= handshake" ) );
 
     return( ret );
@@ -6401,6 +6632,12 @@ int mbedtls_ssl_renegotiate( mbedtls_ssl_context *ssl )
     if( ssl == NULL || ssl->conf == NULL )
         return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    if( ( ret = ssl_buffers_prepare( ssl ) ) != 0 )
+        return( ret );
+    ret = MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+#endif
+
 #if defined(MBEDTLS_SSL_SRV_C)
     /* On server, just send the request */
     if( ssl->conf->endpoint == MBEDTLS_SSL_IS_SERVER )
@@ -6473,16 +6710,18 @@ static int ssl_check_ctr_renegotiate( mbedtls_ssl_context *ssl )
 /*
  * Receive application data decrypted from the SSL layer
  */
-int mbedtls_ssl_read( mbedtls_ssl_context *ssl, unsigned char *buf, size_t len )
+static int ssl_read_real( mbedtls_ssl_context *ssl, unsigned char *buf, size_t len )
 {
     int ret, record_read = 0;
     size_t n;
 
-    if( ssl == NULL || ssl->conf == NULL )
-        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
-
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "=> read" ) );
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    if( ( ret = ssl_buffers_prepare( ssl ) ) != 0 )
+        return( ret );
+#endif
+
 #if defined(MBEDTLS_SSL_PROTO_DTLS)
     if( ssl->conf->transport == MBEDTLS_SSL_TRANSPORT_DATAGRAM )
     {
@@ -6520,6 +6759,12 @@ int mbedtls_ssl_read( mbedtls_ssl_context *ssl, unsigned char *buf, size_t len )
         }
     }
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    /* The handshake, or a renegotiation, may have released them */
+    if( ( ret = ssl_buffers_prepare( ssl ) ) != 0 )
+        return( ret );
+#endif
+
     if( ssl->in_offt == NULL )
     {
         /* Start timer if not already running */
@@ -6726,6 +6971,22 @@ int mbedtls_ssl_read( mbedtls_ssl_context *ssl, unsigned char *buf, size_t len )
     return( (int) n );
 }
 
+int mbedtls_ssl_read( mbedtls_ssl_context *ssl, unsigned char *buf, size_t len )
+{
+    int ret;
+
+    if( ssl == NULL || ssl->conf == NULL )
+        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
+
+    ret = ssl_read_real( ssl, buf, len );
+
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    ssl_buffers_idle( ssl );
+#endif
+
+    return( ret );
+}
+
 /*
  * Send application data to be encrypted by the SSL layer,
  * taking care of max fragment length and buffer size
@@ -6736,6 +6997,9 @@ static int ssl_write_real( mbedtls_ssl_context *ssl,
     int ret;
 #if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
     size_t max_len = mbedtls_ssl_get_max_frag_len( ssl );
+#else
+    size_t max_len = MBEDTLS_SSL_OUT_CONTENT_LEN;
+#endif
 
     if( len > max_len )
     {
@@ -6751,7 +7015,6 @@ static int ssl_write_real( mbedtls_ssl_context *ssl,
 #endif
             len = max_len;
     }
-#endif /* MBEDTLS_SSL_MAX_FRAGMENT_LENGTH */
 
     if( ssl->out_left != 0 )
     {
@@ -6827,6 +7090,11 @@ int mbedtls_ssl_write( mbedtls_ssl_context *ssl, const unsigned char *buf, size_
     if( ssl == NULL || ssl->conf == NULL )
         return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    if( ( ret = ssl_buffers_prepare( ssl ) ) != 0 )
+        return( ret );
+#endif
+
 #if defined(MBEDTLS_SSL_RENEGOTIATION)
     if( ( ret = ssl_check_ctr_renegotiate( ssl ) ) != 0 )
     {
@@ -6844,12 +7112,22 @@ int mbedtls_ssl_write( mbedtls_ssl_context *ssl, const unsigned char *buf, size_
         }
     }
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    /* The handshake, or a renegotiation, may have released them */
+    if( ( ret = ssl_buffers_prepare( ssl ) ) != 0 )
+        return( ret );
+#endif
+
 #if defined(MBEDTLS_SSL_CBC_RECORD_SPLITTING)
     ret = ssl_write_split( ssl, buf, len );
 #else
     ret = ssl_write_real( ssl, buf, len );
 #endif
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    ssl_buffers_idle( ssl );
+#endif
+
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "<= write" ) );
 
     return( ret );
@@ -7027,13 +7305,13 @@ void mbedtls_ssl_free( mbedtls_ssl_context *ssl )
 
     if( ssl->out_buf != NULL )
     {
-        mbedtls_zeroize( ssl->out_buf, MBEDTLS_SSL_BUFFER_LEN );
+        mbedtls_zeroize( ssl->out_buf, SSL_OUT_BUF_LEN( ssl ) );
         mbedtls_free( ssl->out_buf );
     }
 
     if( ssl->in_buf != NULL )
     {
-        mbedtls_zeroize( ssl->in_buf, MBEDTLS_SSL_BUFFER_LEN );
+        mbedtls_zeroize( ssl->in_buf, SSL_IN_BUF_LEN( ssl ) );
         mbedtls_free( ssl->in_buf );
     }
 
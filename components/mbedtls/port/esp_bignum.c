@@ -68,10 +68,22 @@ static void rsa_isr_initialise()
 
 static _lock_t mpi_lock;
 
-void esp_mpi_acquire_hardware( void )
+/* Nesting depth of esp_mpi_acquire_hardware() calls by the holder of mpi_lock */
+static int mpi_lock_depth;
+
+/* Modulus loaded in the hardware by esp_mpi_mul_mod(), if still there */
+static const esp_mpi_modulus_t *loaded_modulus;
+
+static void mpi_acquire_hardware( void )
 {
     /* newlib locks lazy initialize on ESP-IDF */
-    _lock_acquire(&mpi_lock);
+    _lock_acquire_recursive(&mpi_lock);
+
+    if (mpi_lock_depth++ > 0) {
+        /* held around the current operation already */
+        return;
+    }
+
     REG_SET_BIT(DPORT_PERI_CLK_EN_REG, DPORT_PERI_EN_RSA);
     /* also clear reset on digital signature, otherwise RSA is held in reset */
     REG_CLR_BIT(DPORT_PERI_RST_EN_REG,
@@ -87,15 +99,26 @@ void esp_mpi_acquire_hardware( void )
 #endif
 }
 
+void esp_mpi_acquire_hardware( void )
+{
+    mpi_acquire_hardware();
+    /* any operation other than esp_mpi_mul_mod() overwrites the modulus */
+    loaded_modulus = NULL;
+}
+
 void esp_mpi_release_hardware( void )
 {
-    REG_SET_BIT(DPORT_RSA_PD_CTRL_REG, DPORT_RSA_PD);
+    if (--mpi_lock_depth == 0) {
+        loaded_modulus = NULL;
 
-    /* don't reset digital signature unit, as this resets AES also */
-    REG_SET_BIT(DPORT_PERI_RST_EN_REG, DPORT_PERI_EN_RSA);
-    REG_CLR_BIT(DPORT_PERI_CLK_EN_REG, DPORT_PERI_EN_RSA);
+        REG_SET_BIT(DPORT_RSA_PD_CTRL_REG, DPORT_RSA_PD);
+
+        /* don't reset digital signature unit, as this resets AES also */
+        REG_SET_BIT(DPORT_PERI_RST_EN_REG, DPORT_PERI_EN_RSA);
+        REG_CLR_BIT(DPORT_PERI_CLK_EN_REG, DPORT_PERI_EN_RSA);
+    }
 
-    _lock_release(&mpi_lock);
+    _lock_release_recursive(&mpi_lock);
 }
 
 /* Number of words used to hold 'mpi', rounded up to nearest
@@ -212,8 +235,6 @@ static mbedtls_mpi_uint modular_inverse(const mbedtls_mpi *M)
  * This calculation is computationally expensive (mbedtls_mpi_mod_mpi)
  * so caller should cache the result where possible.
  *
- * DO NOT call this function while holding esp_mpi_acquire_hardware().
- *
  */
 static int calculate_rinv(mbedtls_mpi *Rinv, const mbedtls_mpi *M, int num_words)
 {
@@ -261,43 +282,93 @@ static inline void execute_op(uint32_t op_reg)
 /* Sub-stages of modulo multiplication/exponentiation operations */
 inline static int modular_multiply_finish(mbedtls_mpi *Z, const mbedtls_mpi *X, const mbedtls_mpi *Y, size_t num_words);
 
-/* Z = (X * Y) mod M
+int esp_mpi_modulus_init(esp_mpi_modulus_t *mod, const mbedtls_mpi *M)
+{
+    int ret;
 
-   Not an mbedTLS function
+    mbedtls_mpi_init(&mod->M);
+    mbedtls_mpi_init(&mod->Rinv);
+    mod->num_words = hardware_words_needed(M);
+    if (mod->num_words * 32 > 4096) {
+        return MBEDTLS_ERR_MPI_NOT_ACCEPTABLE;
+    }
+    mod->result_words = (mbedtls_mpi_bitlen(M) + 31) / 32;
+
+    MBEDTLS_MPI_CHK(mbedtls_mpi_copy(&mod->M, M));
+    MBEDTLS_MPI_CHK(calculate_rinv(&mod->Rinv, M, mod->num_words));
+    mod->Mprime = modular_inverse(M);
+
+ cleanup:
+    if (ret != 0) {
+        esp_mpi_modulus_free(mod);
+    }
+    return ret;
+}
+
+void esp_mpi_modulus_free(esp_mpi_modulus_t *mod)
+{
+    /* the memory may hold another modulus next */
+    _lock_acquire_recursive(&mpi_lock);
+    if (loaded_modulus == mod) {
+        loaded_modulus = NULL;
+    }
+    _lock_release_recursive(&mpi_lock);
+
+    mbedtls_mpi_free(&mod->M);
+    mbedtls_mpi_free(&mod->Rinv);
+}
+
+/* Z = (X * Y) mod M, X and Y in [0, M)
+
+   Loads the modulus only if the hardware doesn't hold it from the last
+   call, so a caller holding esp_mpi_acquire_hardware() around a series of
+   these only pays for loading X and Y.
 */
-int esp_mpi_mul_mpi_mod(mbedtls_mpi *Z, const mbedtls_mpi *X, const mbedtls_mpi *Y, const mbedtls_mpi *M)
+int esp_mpi_mul_mod(const esp_mpi_modulus_t *mod, mbedtls_mpi *Z, const mbedtls_mpi *X, const mbedtls_mpi *Y)
 {
     int ret;
-    size_t num_words = hardware_words_needed(M);
-    mbedtls_mpi Rinv;
-    mbedtls_mpi_uint Mprime;
+    size_t num_words = mod->num_words;
 
-    /* Calculate and load the first stage montgomery multiplication */
-    mbedtls_mpi_init(&Rinv);
-    MBEDTLS_MPI_CHK(calculate_rinv(&Rinv, M, num_words));
-    Mprime = modular_inverse(M);
+    mpi_acquire_hardware();
 
-    esp_mpi_acquire_hardware();
+    if (loaded_modulus != mod) {
+        mpi_to_mem_block(RSA_MEM_M_BLOCK_BASE, &mod->M, num_words);
+        REG_WRITE(RSA_M_DASH_REG, (uint32_t)mod->Mprime);
+        /* "mode" register loaded with number of 512-bit blocks, minus 1 */
+        REG_WRITE(RSA_MULT_MODE_REG, (num_words / 16) - 1);
+    }
 
-    /* Load M, X, Rinv, Mprime (Mprime is mod 2^32) */
-    mpi_to_mem_block(RSA_MEM_M_BLOCK_BASE, M, num_words);
+    /* First stage montgomery multiplication, Z = X * R mod M */
     mpi_to_mem_block(RSA_MEM_X_BLOCK_BASE, X, num_words);
-    mpi_to_mem_block(RSA_MEM_RB_BLOCK_BASE, &Rinv, num_words);
-    REG_WRITE(RSA_M_DASH_REG, (uint32_t)Mprime);
-
-    /* "mode" register loaded with number of 512-bit blocks, minus 1 */
-    REG_WRITE(RSA_MULT_MODE_REG, (num_words / 16) - 1);
-
-    /* Execute first stage montgomery multiplication */
+    mpi_to_mem_block(RSA_MEM_RB_BLOCK_BASE, &mod->Rinv, num_words);
     execute_op(RSA_MULT_START_REG);
 
-    /* execute second stage */
-    MBEDTLS_MPI_CHK( modular_multiply_finish(Z, X, Y, num_words) );
+    /* execute second stage, Z = Y * Z * R^-1 mod M = X * Y mod M,
+       reading back only the words the modulus has */
+    mpi_to_mem_block(RSA_MEM_X_BLOCK_BASE, Y, num_words);
+    execute_op(RSA_MULT_START_REG);
+    ret = mem_block_to_mpi(Z, RSA_MEM_Z_BLOCK_BASE, mod->result_words);
+    Z->s = X->s * Y->s;
 
+    loaded_modulus = mod;
     esp_mpi_release_hardware();
+    return ret;
+}
+
+/* Z = (X * Y) mod M
+
+   Not an mbedTLS function
+*/
+int esp_mpi_mul_mpi_mod(mbedtls_mpi *Z, const mbedtls_mpi *X, const mbedtls_mpi *Y, const mbedtls_mpi *M)
+{
+    int ret;
+    esp_mpi_modulus_t mod;
+
+    MBEDTLS_MPI_CHK(esp_mpi_modulus_init(&mod, M));
+    ret = esp_mpi_mul_mod(&mod, Z, X, Y);
+    esp_mpi_modulus_free(&mod);
 
  cleanup:
-    mbedtls_mpi_free(&Rinv);
     return ret;
 }
 
@@ -484,9 +555,11 @@ int mbedtls_mpi_mul_mpi( mbedtls_mpi *Z, const mbedtls_mpi *X, const mbedtls_mpi
     /* Copy X (right-extended) & Y (left-extended) to memory block */
     mpi_to_mem_block(RSA_MEM_X_BLOCK_BASE, X, words_mult);
     mpi_to_mem_block(RSA_MEM_Z_BLOCK_BASE + words_mult * 4, Y, words_mult);
-    /* NB: as Y is left-extended, we don't zero the bottom words_mult words of Y block.
-       This is OK for now because zeroing is done by hardware when we do esp_mpi_acquire_hardware().
+    /* As Y is left-extended, zero the bottom words_mult words of Y block:
+       the hardware only clears it when it is first acquired, not when this
+       runs nested in an esp_mpi_acquire_hardware() of the caller.
     */
+    bzero((uint32_t *)RSA_MEM_Z_BLOCK_BASE, words_mult * 4);
 
     REG_WRITE(RSA_M_DASH_REG, 0);
 
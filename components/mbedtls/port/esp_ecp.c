@@ -0,0 +1,138 @@
+/**
+ * \brief  Elliptic curve field arithmetic, ESP32 hardware accelerated parts
+ *
+ *  Copyright (C) 2016, Espressif Systems (Shanghai) PTE Ltd
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+/*
+ * P-256 and P-384 field multiplications run as modular multiplications on
+ * the RSA accelerator (esp_mpi_mul_mod()). Around a scalar multiplication
+ * the accelerator stays acquired, so that the modulus stays loaded and
+ * every field multiplication only loads its two operands.
+ *
+ * The comb table of the generator (see ecp_mul_comb() in ecp.c) is kept
+ * per curve across groups: TLS loads a new group for every handshake, so
+ * the table cached in the group would be computed for every handshake.
+ * The table is lent to a group for the duration of a scalar multiplication
+ * only, and all access to it happens with the accelerator acquired, which
+ * serialises it.
+ */
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_ECP_C) && defined(MBEDTLS_ECP_MUL_MOD_ALT)
+
+#include <stdbool.h>
+#include "mbedtls/ecp.h"
+#include "mbedtls/bignum.h"
+
+typedef struct {
+    mbedtls_ecp_group_id id;
+    bool modulus_ready;
+    esp_mpi_modulus_t modulus;
+    /* comb table of the generator, when not lent to a group */
+    mbedtls_ecp_point *T;
+    size_t T_size;
+} ecp_hw_curve;
+
+static ecp_hw_curve hw_curves[] = {
+    { .id = MBEDTLS_ECP_DP_SECP256R1 },
+    { .id = MBEDTLS_ECP_DP_SECP384R1 },
+};
+
+/* Scalar multiplication in progress, only touched with the accelerator
+   acquired */
+static int session_depth;
+static bool session_lent;           /* grp->T is the table of the curve */
+static bool session_had_table;      /* grp->T was set at the start */
+
+static ecp_hw_curve *hw_curve(const mbedtls_ecp_group *grp)
+{
+    for (int i = 0; i < sizeof(hw_curves) / sizeof(hw_curves[0]); i++) {
+        if (hw_curves[i].id == grp->id) {
+            return &hw_curves[i];
+        }
+    }
+    return NULL;
+}
+
+void mbedtls_ecp_mul_mod_start(mbedtls_ecp_group *grp)
+{
+    ecp_hw_curve *curve = hw_curve(grp);
+
+    if (curve == NULL) {
+        return;
+    }
+
+    esp_mpi_acquire_hardware();
+    if (session_depth++ > 0) {
+        return;
+    }
+
+    if (!curve->modulus_ready) {
+        curve->modulus_ready = (esp_mpi_modulus_init(&curve->modulus, &grp->P) == 0);
+    }
+
+    session_had_table = (grp->T != NULL);
+    session_lent = false;
+    if (grp->T == NULL && curve->T != NULL) {
+        grp->T = curve->T;
+        grp->T_size = curve->T_size;
+        session_lent = true;
+    }
+}
+
+void mbedtls_ecp_mul_mod_end(mbedtls_ecp_group *grp)
+{
+    ecp_hw_curve *curve = hw_curve(grp);
+
+    if (curve == NULL) {
+        return;
+    }
+
+    if (--session_depth == 0) {
+        if (session_lent) {
+            grp->T = NULL;
+            grp->T_size = 0;
+        } else if (!session_had_table && grp->T != NULL && curve->T == NULL) {
+            /* computed the comb table of the generator: keep it */
+            curve->T = grp->T;
+            curve->T_size = grp->T_size;
+            grp->T = NULL;
+            grp->T_size = 0;
+        }
+    }
+    esp_mpi_release_hardware();
+}
+
+int mbedtls_ecp_mul_mod_alt(const mbedtls_ecp_group *grp, mbedtls_mpi *X,
+                            const mbedtls_mpi *A, const mbedtls_mpi *B)
+{
+    ecp_hw_curve *curve = hw_curve(grp);
+
+    if (curve == NULL || !curve->modulus_ready ||
+        mbedtls_mpi_cmp_int(A, 0) < 0 || mbedtls_mpi_cmp_mpi(A, &grp->P) >= 0 ||
+        mbedtls_mpi_cmp_int(B, 0) < 0 || mbedtls_mpi_cmp_mpi(B, &grp->P) >= 0) {
+        return MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE;
+    }
+
+    return esp_mpi_mul_mod(&curve->modulus, X, A, B);
+}
+
+#endif /* MBEDTLS_ECP_C && MBEDTLS_ECP_MUL_MOD_ALT */
@@ -0,0 +1,216 @@
+/**
+ * \brief  TLS transport on an lwIP netconn, see esp_netconn_bio.h
+ *
+ *  Copyright (C) 2016, Espressif Systems (Shanghai) PTE Ltd
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if !defined(MBEDTLS_NET_C)
+
+#if defined(MBEDTLS_PLATFORM_C)
+#include "mbedtls/platform.h"
+#else
+#include <time.h>
+#define mbedtls_time_t    time_t
+#endif
+
+#include <string.h>
+#include "mbedtls/net.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/esp_netconn_bio.h"
+
+#include "lwip/api.h"
+#include "lwip/tcp.h"
+
+void esp_netconn_bio_init(esp_netconn_bio_t *bio)
+{
+    memset(bio, 0, sizeof(*bio));
+}
+
+void esp_netconn_bio_attach(esp_netconn_bio_t *bio, struct netconn *conn)
+{
+    esp_netconn_bio_init(bio);
+    bio->conn = conn;
+    /* the window is given back by netconn_bio_update_window(), not for
+       every pbuf received */
+    netconn_set_noautorecved(conn, 1);
+    bio->rx_update = conn->pcb.tcp != NULL ? TCP_WND_UPDATE_THRESHOLD(conn->pcb.tcp) : TCP_MSS;
+}
+
+int esp_netconn_bio_connect(esp_netconn_bio_t *bio, const char *host, uint16_t port)
+{
+    struct netconn *conn;
+    ip_addr_t addr;
+
+    if (netconn_gethostbyname(host, &addr) != ERR_OK) {
+        return MBEDTLS_ERR_NET_UNKNOWN_HOST;
+    }
+
+    conn = netconn_new(NETCONN_TCP);
+    if (conn == NULL) {
+        return MBEDTLS_ERR_NET_SOCKET_FAILED;
+    }
+    if (netconn_connect(conn, &addr, port) != ERR_OK) {
+        netconn_delete(conn);
+        return MBEDTLS_ERR_NET_CONNECT_FAILED;
+    }
+
+    esp_netconn_bio_attach(bio, conn);
+    return 0;
+}
+
+/* Give what was read back to the receive window */
+static void netconn_bio_update_window(esp_netconn_bio_t *bio)
+{
+    if (bio->rx_unacked != 0) {
+        netconn_recved(bio->conn, bio->rx_unacked);
+        bio->rx_unacked = 0;
+    }
+}
+
+static int netconn_bio_error(err_t err, int would_block, int failed)
+{
+    switch (err) {
+    case ERR_WOULDBLOCK:
+        return would_block;
+    case ERR_ABRT:
+    case ERR_RST:
+    case ERR_CLSD:
+    case ERR_CONN:
+        return MBEDTLS_ERR_NET_CONN_RESET;
+    default:
+        return failed;
+    }
+}
+
+/* Read at most len bytes, returns on_timeout if the receive timeout expired */
+static int netconn_bio_recv(esp_netconn_bio_t *bio, unsigned char *buf, size_t len, int on_timeout)
+{
+    size_t done = 0;
+    err_t err;
+
+    if (bio->conn == NULL) {
+        return MBEDTLS_ERR_NET_INVALID_CONTEXT;
+    }
+
+    if (bio->rx == NULL) {
+        err = netconn_recv_tcp_pbuf(bio->conn, &bio->rx);
+        if (err == ERR_CLSD) {
+            bio->rx = NULL;
+            return 0;
+        }
+        if (err == ERR_TIMEOUT) {
+            bio->rx = NULL;
+            return on_timeout;
+        }
+        if (err != ERR_OK) {
+            bio->rx = NULL;
+            return netconn_bio_error(err, MBEDTLS_ERR_SSL_WANT_READ, MBEDTLS_ERR_NET_RECV_FAILED);
+        }
+        bio->rx_offset = 0;
+    }
+
+    while (done < len && bio->rx != NULL) {
+        struct pbuf *p = bio->rx;
+        size_t n = p->len - bio->rx_offset;
+
+        if (n > len - done) {
+            n = len - done;
+        }
+        memcpy(buf + done, (const u8_t *) p->payload + bio->rx_offset, n);
+        done += n;
+        bio->rx_offset += n;
+
+        if (bio->rx_offset == p->len) {
+            /* free the first pbuf of the chain only */
+            bio->rx = p->next;
+            if (bio->rx != NULL) {
+                pbuf_ref(bio->rx);
+            }
+            pbuf_free(p);
+            bio->rx_offset = 0;
+        }
+    }
+
+    /* TCP sends no window update for less than rx_update, which is at
+       most a quarter of the window: the peer never waits for the rest */
+    bio->rx_unacked += done;
+    if (bio->rx_unacked >= bio->rx_update) {
+        netconn_bio_update_window(bio);
+    }
+    return (int) done;
+}
+
+int esp_netconn_bio_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    return netconn_bio_recv((esp_netconn_bio_t *) ctx, buf, len, MBEDTLS_ERR_SSL_WANT_READ);
+}
+
+int esp_netconn_bio_recv_timeout(void *ctx, unsigned char *buf, size_t len, uint32_t timeout)
+{
+    esp_netconn_bio_t *bio = (esp_netconn_bio_t *) ctx;
+    int ret;
+
+    if (bio->conn == NULL) {
+        return MBEDTLS_ERR_NET_INVALID_CONTEXT;
+    }
+
+    netconn_set_recvtimeout(bio->conn, timeout);
+    ret = netconn_bio_recv(bio, buf, len, MBEDTLS_ERR_SSL_TIMEOUT);
+    netconn_set_recvtimeout(bio->conn, 0);
+    return ret;
+}
+
+int esp_netconn_bio_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    esp_netconn_bio_t *bio = (esp_netconn_bio_t *) ctx;
+    size_t written = 0;
+    err_t err;
+
+    if (bio->conn == NULL) {
+        return MBEDTLS_ERR_NET_INVALID_CONTEXT;
+    }
+
+    err = netconn_write_partly(bio->conn, buf, len, NETCONN_COPY, &written);
+    if (err != ERR_OK && written == 0) {
+        return netconn_bio_error(err, MBEDTLS_ERR_SSL_WANT_WRITE, MBEDTLS_ERR_NET_SEND_FAILED);
+    }
+    return (int) written;
+}
+
+void esp_netconn_bio_free(esp_netconn_bio_t *bio)
+{
+    if (bio->conn == NULL) {
+        return;
+    }
+    if (bio->rx != NULL) {
+        bio->rx_unacked += bio->rx->tot_len - bio->rx_offset;
+        pbuf_free(bio->rx);
+    }
+    /* TCP resets a connection closed with data the application did not
+       take, which may drop what was sent last */
+    netconn_bio_update_window(bio);
+    netconn_close(bio->conn);
+    netconn_delete(bio->conn);
+    esp_netconn_bio_init(bio);
+}
+
+#endif /* !MBEDTLS_NET_C */
@@ -0,0 +1,406 @@
+/**
+ * \brief  Client side TLS session cache, see esp_session_cache.h
+ *
+ *  Copyright (C) 2016, Espressif Systems (Shanghai) PTE Ltd
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(CONFIG_MBEDTLS_CLIENT_SESSION_CACHE) && defined(MBEDTLS_SSL_CLI_C)
+
+#if defined(MBEDTLS_PLATFORM_C)
+#include "mbedtls/platform.h"
+#else
+#include <time.h>
+#define mbedtls_time      time
+#define mbedtls_time_t    time_t
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <sys/lock.h>
+#include "mbedtls/esp_session_cache.h"
+
+/* Bump when cache_entry_t changes, so that esp_session_cache_load()
+   doesn't take sessions saved by another firmware for its own */
+#define CACHE_FORMAT_VERSION    1
+
+#define NVS_KEY_FORMAT          "tls_cache_fmt"
+#define NVS_KEY_ENTRY           "tls_cache%d"     /* one blob per entry */
+
+/* NVS keeps a blob within one page: 126 entries of 32 bytes, one of which
+   holds the key */
+#define NVS_BLOB_MAX            ((126 - 1) * 32)
+
+#define CACHE_ENTRIES           CONFIG_MBEDTLS_CLIENT_SESSION_CACHE_ENTRIES
+#define CACHE_ALL_DIRTY         ((uint32_t) (((uint64_t) 1 << CACHE_ENTRIES) - 1))
+
+/* The parts of an mbedtls_ssl_session needed to resume it, flat so that
+   an entry can be saved as one blob */
+typedef struct {
+    uint32_t last_used;         /* LRU stamp, 0 if the entry is free */
+    uint16_t port;
+    char host[ESP_SESSION_CACHE_HOST_MAX + 1];
+    int64_t start;
+    int32_t ciphersuite;
+    int32_t compression;
+    uint32_t verify_result;
+    uint8_t id_len;
+    uint8_t id[32];
+    uint8_t master[48];
+    uint8_t mfl_code;
+    uint8_t trunc_hmac;
+    uint8_t encrypt_then_mac;
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    uint32_t ticket_lifetime;
+    uint16_t ticket_len;
+    uint8_t ticket[CONFIG_MBEDTLS_CLIENT_SESSION_TICKET_MAX_LEN];
+#endif
+} cache_entry_t;
+
+_Static_assert(sizeof(cache_entry_t) <= NVS_BLOB_MAX,
+               "a cache entry must fit in one NVS page, lower the maximum ticket length");
+_Static_assert(CACHE_ENTRIES <= 32, "one dirty bit per entry");
+
+static cache_entry_t entries[CACHE_ENTRIES];
+static uint32_t lru_clock;
+static uint32_t dirty;              /* entries that differ from what was saved */
+static esp_session_cache_stats_t stats;
+static _lock_t cache_lock;
+
+/* Implementation that should never be optimized out by the compiler */
+static void cache_zeroize(void *v, size_t n)
+{
+    volatile unsigned char *p = v;
+    while (n--) {
+        *p++ = 0;
+    }
+}
+
+static cache_entry_t *cache_find(const char *host, uint16_t port)
+{
+    for (int i = 0; i < CACHE_ENTRIES; i++) {
+        if (entries[i].last_used != 0 && entries[i].port == port &&
+            strcmp(entries[i].host, host) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+static void cache_entry_free(cache_entry_t *entry)
+{
+    cache_zeroize(entry, sizeof(*entry));
+    dirty |= 1u << (entry - entries);
+}
+
+/* Sessions live as long as the server's ticket lifetime hint says, and
+   not longer than the configured timeout. A clock that went backwards
+   (no time kept across a reset) can't tell the age, then the server
+   decides. */
+static bool cache_entry_expired(const cache_entry_t *entry)
+{
+#if defined(MBEDTLS_HAVE_TIME)
+    int64_t now = (int64_t) mbedtls_time(NULL);
+    uint32_t lifetime = CONFIG_MBEDTLS_CLIENT_SESSION_CACHE_TIMEOUT;
+
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    if (entry->ticket_len != 0 && entry->ticket_lifetime != 0 &&
+        entry->ticket_lifetime < lifetime) {
+        lifetime = entry->ticket_lifetime;
+    }
+#endif
+    return now >= entry->start && now - entry->start > lifetime;
+#else
+    return false;
+#endif
+}
+
+int esp_session_cache_get(const char *host, uint16_t port, mbedtls_ssl_context *ssl)
+{
+    mbedtls_ssl_session session;
+    cache_entry_t *entry;
+    int ret = 1;
+
+    _lock_acquire(&cache_lock);
+    entry = cache_find(host, port);
+    if (entry != NULL && cache_entry_expired(entry)) {
+        cache_entry_free(entry);
+        entry = NULL;
+    }
+    if (entry == NULL) {
+        stats.misses++;
+        goto out;
+    }
+
+    mbedtls_ssl_session_init(&session);
+#if defined(MBEDTLS_HAVE_TIME)
+    session.start = (mbedtls_time_t) entry->start;
+#endif
+    session.ciphersuite = entry->ciphersuite;
+    session.compression = entry->compression;
+    session.verify_result = entry->verify_result;
+    session.id_len = entry->id_len;
+    memcpy(session.id, entry->id, sizeof(session.id));
+    memcpy(session.master, entry->master, sizeof(session.master));
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    session.mfl_code = entry->mfl_code;
+#endif
+#if defined(MBEDTLS_SSL_TRUNCATED_HMAC)
+    session.trunc_hmac = entry->trunc_hmac;
+#endif
+#if defined(MBEDTLS_SSL_ENCRYPT_THEN_MAC)
+    session.encrypt_then_mac = entry->encrypt_then_mac;
+#endif
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    /* mbedtls_ssl_set_session() copies the ticket */
+    if (entry->ticket_len != 0) {
+        session.ticket = entry->ticket;
+        session.ticket_len = entry->ticket_len;
+        session.ticket_lifetime = entry->ticket_lifetime;
+    }
+#endif
+
+    ret = mbedtls_ssl_set_session(ssl, &session);
+    if (ret == 0) {
+        entry->last_used = ++lru_clock;
+        stats.hits++;
+    }
+    cache_zeroize(&session, sizeof(session));
+
+ out:
+    _lock_release(&cache_lock);
+    return ret;
+}
+
+int esp_session_cache_put(const char *host, uint16_t port, const mbedtls_ssl_context *ssl)
+{
+    /* ssl->session rather than mbedtls_ssl_get_session(), which would
+       parse a copy of the server certificate that the cache doesn't keep */
+    const mbedtls_ssl_session *session = ssl->session;
+    cache_entry_t new_entry, *entry;
+
+    if (strlen(host) > ESP_SESSION_CACHE_HOST_MAX || session == NULL ||
+        ssl->conf->endpoint != MBEDTLS_SSL_IS_CLIENT) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    memset(&new_entry, 0, sizeof(new_entry));
+    new_entry.port = port;
+    strcpy(new_entry.host, host);
+#if defined(MBEDTLS_HAVE_TIME)
+    new_entry.start = session->start;
+#endif
+    new_entry.ciphersuite = session->ciphersuite;
+    new_entry.compression = session->compression;
+    new_entry.verify_result = session->verify_result;
+    new_entry.id_len = session->id_len;
+    memcpy(new_entry.id, session->id, sizeof(new_entry.id));
+    memcpy(new_entry.master, session->master, sizeof(new_entry.master));
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    new_entry.mfl_code = session->mfl_code;
+#endif
+#if defined(MBEDTLS_SSL_TRUNCATED_HMAC)
+    new_entry.trunc_hmac = session->trunc_hmac;
+#endif
+#if defined(MBEDTLS_SSL_ENCRYPT_THEN_MAC)
+    new_entry.encrypt_then_mac = session->encrypt_then_mac;
+#endif
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    if (session->ticket != NULL && session->ticket_len <= sizeof(new_entry.ticket)) {
+        new_entry.ticket_len = session->ticket_len;
+        new_entry.ticket_lifetime = session->ticket_lifetime;
+        memcpy(new_entry.ticket, session->ticket, session->ticket_len);
+    }
+    if (new_entry.id_len == 0 && new_entry.ticket_len == 0) {
+#else
+    if (new_entry.id_len == 0) {
+#endif
+        esp_session_cache_remove(host, port);
+        return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+    }
+
+    _lock_acquire(&cache_lock);
+    entry = cache_find(host, port);
+    if (entry != NULL) {
+        /* same master secret: the handshake resumed the cached session */
+        if (memcmp(entry->master, new_entry.master, sizeof(new_entry.master)) == 0) {
+            stats.resumed++;
+        }
+    } else {
+        entry = &entries[0];
+        for (int i = 0; i < CACHE_ENTRIES; i++) {
+            if (entries[i].last_used < entry->last_used) {
+                entry = &entries[i];
+            }
+        }
+        if (entry->last_used != 0) {
+            stats.evictions++;
+        }
+    }
+
+    /* a resumed session with the same ticket is what the cache has
+       already: don't make esp_session_cache_save() write it again */
+    new_entry.last_used = entry->last_used;
+    if (memcmp(entry, &new_entry, sizeof(new_entry)) != 0) {
+        memcpy(entry, &new_entry, sizeof(new_entry));
+        dirty |= 1u << (entry - entries);
+    }
+    entry->last_used = ++lru_clock;
+    _lock_release(&cache_lock);
+
+    cache_zeroize(&new_entry, sizeof(new_entry));
+    return 0;
+}
+
+void esp_session_cache_remove(const char *host, uint16_t port)
+{
+    cache_entry_t *entry;
+
+    _lock_acquire(&cache_lock);
+    entry = cache_find(host, port);
+    if (entry != NULL) {
+        cache_entry_free(entry);
+    }
+    _lock_release(&cache_lock);
+}
+
+void esp_session_cache_clear(void)
+{
+    _lock_acquire(&cache_lock);
+    cache_zeroize(entries, sizeof(entries));
+    lru_clock = 0;
+    dirty = CACHE_ALL_DIRTY;
+    _lock_release(&cache_lock);
+}
+
+/* Format and size of the saved entries, so that a firmware with another
+   configuration ignores them */
+static uint32_t cache_format(void)
+{
+    return (CACHE_FORMAT_VERSION << 24) | (CACHE_ENTRIES << 16) | sizeof(cache_entry_t);
+}
+
+static void cache_entry_key(char *key, size_t size, int i)
+{
+    snprintf(key, size, NVS_KEY_ENTRY, i);
+}
+
+esp_err_t esp_session_cache_save(nvs_handle handle)
+{
+    esp_err_t err = ESP_OK;
+    char key[16];
+
+    _lock_acquire(&cache_lock);
+    if (dirty == 0) {
+        goto out;
+    }
+    err = nvs_set_u32(handle, NVS_KEY_FORMAT, cache_format());
+    if (err != ESP_OK) {
+        goto out;
+    }
+    /* only the entries that changed, free ones are erased */
+    for (int i = 0; i < CACHE_ENTRIES; i++) {
+        if ((dirty & (1u << i)) == 0) {
+            continue;
+        }
+        cache_entry_key(key, sizeof(key), i);
+        if (entries[i].last_used == 0) {
+            err = nvs_erase_key(handle, key);
+            if (err == ESP_ERR_NVS_NOT_FOUND) {
+                err = ESP_OK;
+            }
+        } else {
+            err = nvs_set_blob(handle, key, &entries[i], sizeof(entries[i]));
+        }
+        if (err != ESP_OK) {
+            goto out;
+        }
+    }
+    err = nvs_commit(handle);
+    if (err == ESP_OK) {
+        dirty = 0;
+    }
+
+ out:
+    _lock_release(&cache_lock);
+    return err;
+}
+
+esp_err_t esp_session_cache_load(nvs_handle handle)
+{
+    esp_err_t err;
+    uint32_t format;
+    size_t length;
+    char key[16];
+
+    _lock_acquire(&cache_lock);
+    cache_zeroize(entries, sizeof(entries));
+    lru_clock = 0;
+    dirty = 0;
+
+    err = nvs_get_u32(handle, NVS_KEY_FORMAT, &format);
+    if (err != ESP_OK) {
+        goto out;
+    }
+    if (format != cache_format()) {
+        err = ESP_ERR_INVALID_SIZE;
+        goto fail;
+    }
+    for (int i = 0; i < CACHE_ENTRIES; i++) {
+        cache_entry_key(key, sizeof(key), i);
+        length = sizeof(entries[i]);
+        err = nvs_get_blob(handle, key, &entries[i], &length);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            /* a free entry */
+            err = ESP_OK;
+            continue;
+        }
+        if (err == ESP_OK && length != sizeof(entries[i])) {
+            err = ESP_ERR_INVALID_SIZE;
+        }
+        if (err != ESP_OK) {
+            goto fail;
+        }
+        if (entries[i].last_used > lru_clock) {
+            lru_clock = entries[i].last_used;
+        }
+    }
+    goto out;
+
+ fail:
+    /* start over with an empty cache, which the next save writes out */
+    cache_zeroize(entries, sizeof(entries));
+    lru_clock = 0;
+    dirty = CACHE_ALL_DIRTY;
+ out:
+    _lock_release(&cache_lock);
+    return err;
+}
+
+void esp_session_cache_get_stats(esp_session_cache_stats_t *out)
+{
+    _lock_acquire(&cache_lock);
+    *out = stats;
+    _lock_release(&cache_lock);
+}
+
+#endif /* CONFIG_MBEDTLS_CLIENT_SESSION_CACHE && MBEDTLS_SSL_CLI_C */
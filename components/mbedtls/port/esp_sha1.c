@@ -88,7 +88,7 @@ void mbedtls_sha1_free( mbedtls_sha1_context *ctx )
         return;
 
     if (ctx->mode == ESP_MBEDTLS_SHA1_HARDWARE) {
-        esp_sha_unlock_engine(SHA1);
+        esp_sha_release_digest(SHA1, ctx->state);
     }
     mbedtls_zeroize( ctx, sizeof( mbedtls_sha1_context ) );
 }
@@ -102,7 +102,7 @@ void mbedtls_sha1_clone( mbedtls_sha1_context *dst,
         /* Copy hardware digest state out to cloned state,
            which will be a software digest.
         */
-        esp_sha_read_digest_state(SHA1, dst->state);
+        esp_sha_digest_read_state(SHA1, src->state, dst->state);
         dst->mode = ESP_MBEDTLS_SHA1_SOFTWARE;
     }
 }
@@ -113,6 +113,11 @@ void mbedtls_sha1_clone( mbedtls_sha1_context *dst,
  */
 void mbedtls_sha1_starts( mbedtls_sha1_context *ctx )
 {
+    /* release the engine first, it may write ctx->state until then */
+    if (ctx->mode == ESP_MBEDTLS_SHA1_HARDWARE) {
+        esp_sha_release_digest(SHA1, ctx->state);
+    }
+
     ctx->total[0] = 0;
     ctx->total[1] = 0;
 
@@ -122,9 +127,6 @@ void mbedtls_sha1_starts( mbedtls_sha1_context *ctx )
     ctx->state[3] = 0x10325476;
     ctx->state[4] = 0xC3D2E1F0;
 
-    if (ctx->mode == ESP_MBEDTLS_SHA1_HARDWARE) {
-        esp_sha_unlock_engine(SHA1);
-    }
     ctx->mode = ESP_MBEDTLS_SHA1_UNUSED;
 }
 
@@ -133,21 +135,24 @@ static void mbedtls_sha1_software_process( mbedtls_sha1_context *ctx, const unsi
 void mbedtls_sha1_process( mbedtls_sha1_context *ctx, const unsigned char data[64] )
 {
     bool first_block = false;
+
     if (ctx->mode == ESP_MBEDTLS_SHA1_UNUSED) {
         /* try to use hardware for this digest */
-        if (esp_sha_try_lock_engine(SHA1)) {
-            ctx->mode = ESP_MBEDTLS_SHA1_HARDWARE;
-            first_block = true;
-        } else {
-            ctx->mode = ESP_MBEDTLS_SHA1_SOFTWARE;
-        }
+        ctx->mode = ESP_MBEDTLS_SHA1_HARDWARE;
+        first_block = true;
     }
 
     if (ctx->mode == ESP_MBEDTLS_SHA1_HARDWARE) {
-        esp_sha_block(SHA1, data, first_block);
-    } else {
-        mbedtls_sha1_software_process(ctx, data);
+        if (esp_sha_digest_block(SHA1, ctx->state, data, first_block)) {
+            return;
+        }
+        /* the engine is busy with another digest, or has been given to
+           one: carry on in software from the interim state in ctx->state */
+        ctx->mode = ESP_MBEDTLS_SHA1_SOFTWARE;
     }
+
+    esp_sha_count_software_block(SHA1);
+    mbedtls_sha1_software_process(ctx, data);
 }
 
 
@@ -379,8 +384,8 @@ void mbedtls_sha1_finish( mbedtls_sha1_context *ctx, unsigned char output[20] )
 
     /* if state is in hardware, read it out */
     if (ctx->mode == ESP_MBEDTLS_SHA1_HARDWARE) {
-        esp_sha_read_digest_state(SHA1, ctx->state);
-        esp_sha_unlock_engine(SHA1);
+        esp_sha_digest_read_state(SHA1, ctx->state, ctx->state);
+        esp_sha_release_digest(SHA1, ctx->state);
         ctx->mode = ESP_MBEDTLS_SHA1_SOFTWARE;
     }
 
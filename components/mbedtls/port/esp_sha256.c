@@ -89,7 +89,7 @@ void mbedtls_sha256_free( mbedtls_sha256_context *ctx )
         return;
 
     if (ctx->mode == ESP_MBEDTLS_SHA256_HARDWARE) {
-        esp_sha_unlock_engine(SHA2_256);
+        esp_sha_release_digest(SHA2_256, ctx->state);
     }
     mbedtls_zeroize( ctx, sizeof( mbedtls_sha256_context ) );
 }
@@ -103,7 +103,7 @@ void mbedtls_sha256_clone( mbedtls_sha256_context *dst,
         /* Copy hardware digest state out to cloned state,
            which will become a software digest.
         */
-        esp_sha_read_digest_state(SHA2_256, dst->state);
+        esp_sha_digest_read_state(SHA2_256, src->state, dst->state);
         dst->mode = ESP_MBEDTLS_SHA256_SOFTWARE;
     }
 }
@@ -113,6 +113,11 @@ void mbedtls_sha256_clone( mbedtls_sha256_context *dst,
  */
 void mbedtls_sha256_starts( mbedtls_sha256_context *ctx, int is224 )
 {
+    /* release the engine first, it may write ctx->state until then */
+    if (ctx->mode == ESP_MBEDTLS_SHA256_HARDWARE) {
+        esp_sha_release_digest(SHA2_256, ctx->state);
+    }
+
     ctx->total[0] = 0;
     ctx->total[1] = 0;
 
@@ -142,9 +147,6 @@ void mbedtls_sha256_starts( mbedtls_sha256_context *ctx, int is224 )
     }
 
     ctx->is224 = is224;
-    if (ctx->mode == ESP_MBEDTLS_SHA256_HARDWARE) {
-        esp_sha_unlock_engine(SHA2_256);
-    }
     ctx->mode = ESP_MBEDTLS_SHA256_UNUSED;
 }
 
@@ -202,19 +204,21 @@ void mbedtls_sha256_process( mbedtls_sha256_context *ctx, const unsigned char da
 
     if (ctx->mode == ESP_MBEDTLS_SHA256_UNUSED) {
         /* try to use hardware for this digest */
-        if (!ctx->is224 && esp_sha_try_lock_engine(SHA2_256)) {
-            ctx->mode = ESP_MBEDTLS_SHA256_HARDWARE;
-            first_block = true;
-        } else {
-            ctx->mode = ESP_MBEDTLS_SHA256_SOFTWARE;
-        }
+        ctx->mode = ctx->is224 ? ESP_MBEDTLS_SHA256_SOFTWARE : ESP_MBEDTLS_SHA256_HARDWARE;
+        first_block = true;
     }
 
     if (ctx->mode == ESP_MBEDTLS_SHA256_HARDWARE) {
-        esp_sha_block(SHA2_256, data, first_block);
-    } else {
-        mbedtls_sha256_software_process(ctx, data);
+        if (esp_sha_digest_block(SHA2_256, ctx->state, data, first_block)) {
+            return;
+        }
+        /* the engine is busy with another digest, or has been given to
+           one: carry on in software from the interim state in ctx->state */
+        ctx->mode = ESP_MBEDTLS_SHA256_SOFTWARE;
     }
+
+    esp_sha_count_software_block(SHA2_256);
+    mbedtls_sha256_software_process(ctx, data);
 }
 
 
@@ -347,8 +351,8 @@ void mbedtls_sha256_finish( mbedtls_sha256_context *ctx, unsigned char output[32
 
     /* if state is in hardware, read it out */
     if (ctx->mode == ESP_MBEDTLS_SHA256_HARDWARE) {
-        esp_sha_read_digest_state(SHA2_256, ctx->state);
-        esp_sha_unlock_engine(SHA2_256);
+        esp_sha_digest_read_state(SHA2_256, ctx->state, ctx->state);
+        esp_sha_release_digest(SHA2_256, ctx->state);
         ctx->mode = ESP_MBEDTLS_SHA256_SOFTWARE;
     }
 
@@ -108,7 +108,7 @@ void mbedtls_sha512_free( mbedtls_sha512_context *ctx )
         return;
 
     if (ctx->mode == ESP_MBEDTLS_SHA512_HARDWARE) {
-        esp_sha_unlock_engine(sha_type(ctx));
+        esp_sha_release_digest(sha_type(ctx), ctx->state);
     }
     mbedtls_zeroize( ctx, sizeof( mbedtls_sha512_context ) );
 }
@@ -126,7 +126,7 @@ void mbedtls_sha512_clone( mbedtls_sha512_context *dst,
            (SHA-384 state is identical to SHA-512, only
            digest is truncated.)
         */
-        esp_sha_read_digest_state(SHA2_512, dst->state);
+        esp_sha_digest_read_state(SHA2_512, src->state, dst->state);
         dst->mode = ESP_MBEDTLS_SHA512_SOFTWARE;
     }
 }
@@ -137,6 +137,11 @@ void mbedtls_sha512_clone( mbedtls_sha512_context *dst,
  */
 void mbedtls_sha512_starts( mbedtls_sha512_context *ctx, int is384 )
 {
+    /* release the engine first, it may write ctx->state until then */
+    if (ctx->mode == ESP_MBEDTLS_SHA512_HARDWARE) {
+        esp_sha_release_digest(sha_type(ctx), ctx->state);
+    }
+
     ctx->total[0] = 0;
     ctx->total[1] = 0;
 
@@ -166,9 +171,6 @@ void mbedtls_sha512_starts( mbedtls_sha512_context *ctx, int is384 )
     }
 
     ctx->is384 = is384;
-    if (ctx->mode == ESP_MBEDTLS_SHA512_HARDWARE) {
-        esp_sha_unlock_engine(sha_type(ctx));
-    }
     ctx->mode = ESP_MBEDTLS_SHA512_UNUSED;
 }
 
@@ -228,19 +230,21 @@ void mbedtls_sha512_process( mbedtls_sha512_context *ctx, const unsigned char da
 
     if (ctx->mode == ESP_MBEDTLS_SHA512_UNUSED) {
         /* try to use hardware for this digest */
-        if (esp_sha_try_lock_engine(sha_type(ctx))) {
-            ctx->mode = ESP_MBEDTLS_SHA512_HARDWARE;
-            first_block = true;
-        } else {
-            ctx->mode = ESP_MBEDTLS_SHA512_SOFTWARE;
-        }
+        ctx->mode = ESP_MBEDTLS_SHA512_HARDWARE;
+        first_block = true;
     }
 
     if (ctx->mode == ESP_MBEDTLS_SHA512_HARDWARE) {
-        esp_sha_block(sha_type(ctx), data, first_block);
-    } else {
-        mbedtls_sha512_software_process(ctx, data);
+        if (esp_sha_digest_block(sha_type(ctx), ctx->state, data, first_block)) {
+            return;
+        }
+        /* the engine is busy with another digest, or has been given to
+           one: carry on in software from the interim state in ctx->state */
+        ctx->mode = ESP_MBEDTLS_SHA512_SOFTWARE;
     }
+
+    esp_sha_count_software_block(sha_type(ctx));
+    mbedtls_sha512_software_process(ctx, data);
 }
 
 
@@ -390,8 +394,8 @@ void mbedtls_sha512_finish( mbedtls_sha512_context *ctx, unsigned char output[64
 
     /* if state is in hardware, read it out */
     if (ctx->mode == ESP_MBEDTLS_SHA512_HARDWARE) {
-        esp_sha_read_digest_state(sha_type(ctx), ctx->state);
-        esp_sha_unlock_engine(sha_type(ctx));
+        esp_sha_digest_read_state(sha_type(ctx), ctx->state, ctx->state);
+        esp_sha_release_digest(sha_type(ctx), ctx->state);
         ctx->mode = ESP_MBEDTLS_SHA512_SOFTWARE;
     }
 
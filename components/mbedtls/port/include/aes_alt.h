@@ -49,6 +49,19 @@ typedef esp_aes_context mbedtls_aes_context;
 #endif
 #define mbedtls_aes_encrypt         esp_aes_encrypt
 #define mbedtls_aes_decrypt         esp_aes_decrypt
+
+/*
+ * Block pipeline of the AES unit: with the unit acquired and a key loaded,
+ * a block can be started and collected later, so that GCM works on the
+ * previous block meanwhile. Defining MBEDTLS_AES_BLOCK_PIPELINE_ALT makes
+ * mbedtls_gcm_update() use these.
+ */
+#define MBEDTLS_AES_BLOCK_PIPELINE_ALT
+#define mbedtls_aes_acquire_hardware    esp_aes_acquire_hardware
+#define mbedtls_aes_release_hardware    esp_aes_release_hardware
+#define mbedtls_aes_setkey_hardware     esp_aes_setkey_hardware
+#define mbedtls_aes_block_start         esp_aes_block_start
+#define mbedtls_aes_block_finish        esp_aes_block_finish
 #endif /* MBEDTLS_AES_ALT */
 
 #ifdef __cplusplus
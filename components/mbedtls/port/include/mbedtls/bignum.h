@@ -37,8 +37,9 @@
  * RSA Accelerator hardware unit can only be used by one
  * consumer at a time.
  *
- * @note This function is non-recursive (do not call it twice from the
- * same task.)
+ * Calls may be nested: holding the lock around a series of esp_mpi_xxx or
+ * accelerated mbedTLS bignum operations keeps the unit powered up and
+ * reserved for them.
  *
  * @note You do not need to call this if you are using the mbedTLS bignum.h
  * API or esp_mpi_xxx functions. This function is only needed if you
@@ -75,4 +76,43 @@ void esp_mpi_release_hardware(void);
  */
 int esp_mpi_mul_mpi_mod(mbedtls_mpi *Z, const mbedtls_mpi *X, const mbedtls_mpi *Y, const mbedtls_mpi *M);
 
+/**
+ * @brief Modulus prepared for a series of esp_mpi_mul_mod() calls
+ */
+typedef struct {
+    mbedtls_mpi M;              /*!< modulus */
+    mbedtls_mpi Rinv;           /*!< R^2 mod M, R = 2^(32 * num_words) */
+    mbedtls_mpi_uint Mprime;    /*!< -M^-1 mod 2^32 */
+    size_t num_words;           /*!< operand size in the hardware, in words */
+    size_t result_words;        /*!< words of M */
+} esp_mpi_modulus_t;
+
+/* @brief Prepare a modulus for esp_mpi_mul_mod()
+ *
+ * Does the expensive part of esp_mpi_mul_mpi_mod() once, so cache the
+ * result when multiplying with the same modulus repeatedly.
+ *
+ * @param mod Modulus to initialise, free with esp_mpi_modulus_free().
+ * @param M Modulus value, up to 4096 bits.
+ *
+ * @return 0 on success, mbedTLS MPI error codes on failure.
+ */
+int esp_mpi_modulus_init(esp_mpi_modulus_t *mod, const mbedtls_mpi *M);
+
+/* @brief Free a modulus initialised by esp_mpi_modulus_init() */
+void esp_mpi_modulus_free(esp_mpi_modulus_t *mod);
+
+/* @brief MPI modular multiplication with a prepared modulus
+ *
+ * Calculates Z = (X * Y) mod M using MPI hardware acceleration, for X
+ * and Y in [0, M).
+ *
+ * Consecutive calls with the same modulus, with the caller holding
+ * esp_mpi_acquire_hardware() around them, keep the modulus loaded in the
+ * hardware between calls.
+ *
+ * @return 0 on success, mbedTLS MPI error codes on failure.
+ */
+int esp_mpi_mul_mod(const esp_mpi_modulus_t *mod, mbedtls_mpi *Z, const mbedtls_mpi *X, const mbedtls_mpi *Y);
+
 #endif
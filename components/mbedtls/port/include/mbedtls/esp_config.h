@@ -265,6 +265,12 @@
 #define MBEDTLS_MPI_MUL_MPI_ALT
 #endif
 
+/* Field multiplication of P-256 and P-384 on the MPI hardware, see
+   mbedtls_ecp_mul_mod_alt() in ecp.h */
+#ifdef CONFIG_MBEDTLS_HARDWARE_ECP
+#define MBEDTLS_ECP_MUL_MOD_ALT
+#endif
+
 /**
  * \def MBEDTLS_MD2_PROCESS_ALT
  *
@@ -1074,6 +1080,19 @@
  */
 #define MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
 
+/**
+ * \def MBEDTLS_SSL_DYNAMIC_BUFFERS
+ *
+ * Allocate the input and output buffers of TLS connections when they are
+ * needed rather than in mbedtls_ssl_setup(), and release them while they
+ * hold no data.
+ *
+ * Incompatible with MBEDTLS_ZLIB_SUPPORT.
+ */
+#ifdef CONFIG_MBEDTLS_DYNAMIC_BUFFER
+#define MBEDTLS_SSL_DYNAMIC_BUFFERS
+#endif
+
 /**
  * \def MBEDTLS_SSL_PROTO_SSL3
  *
@@ -1218,7 +1237,9 @@
  *
  * Comment this macro to disable support for SSL session tickets
  */
+#ifdef CONFIG_MBEDTLS_SSL_SESSION_TICKETS
 #define MBEDTLS_SSL_SESSION_TICKETS
+#endif
 
 /**
  * \def MBEDTLS_SSL_EXPORT_KEYS
@@ -1818,6 +1839,16 @@
  */
 #define MBEDTLS_GCM_C
 
+/**
+ * \def MBEDTLS_GCM_TABLE_8BIT
+ *
+ * Multiply by the GCM hash key a byte at a time, with a 4 KB table per
+ * context, instead of a nibble at a time with a 256 byte table.
+ */
+#ifdef CONFIG_MBEDTLS_GCM_GHASH_8BIT
+#define MBEDTLS_GCM_TABLE_8BIT
+#endif
+
 /**
  * \def MBEDTLS_HAVEGE_C
  *
@@ -2222,7 +2253,9 @@
  *
  * Requires: MBEDTLS_CIPHER_C
  */
+#ifdef CONFIG_MBEDTLS_SSL_SESSION_TICKETS
 #define MBEDTLS_SSL_TICKET_C
+#endif
 
 /**
  * \def MBEDTLS_SSL_CLI_C
@@ -2495,6 +2528,10 @@
 /* SSL options */
 
 #define MBEDTLS_SSL_MAX_CONTENT_LEN             CONFIG_MBEDTLS_SSL_MAX_CONTENT_LEN /**< Maxium fragment length in bytes, determines the size of each of the two internal I/O buffers */
+#ifdef CONFIG_MBEDTLS_ASYMMETRIC_CONTENT_LEN
+#define MBEDTLS_SSL_IN_CONTENT_LEN              CONFIG_MBEDTLS_SSL_IN_CONTENT_LEN /**< Maximum length of the records received, determines the size of the input buffer */
+#define MBEDTLS_SSL_OUT_CONTENT_LEN             CONFIG_MBEDTLS_SSL_OUT_CONTENT_LEN /**< Maximum length of the records sent, determines the size of the output buffer */
+#endif
 //#define MBEDTLS_SSL_DEFAULT_TICKET_LIFETIME     86400 /**< Lifetime of session tickets (if enabled) */
 //#define MBEDTLS_PSK_MAX_LEN               32 /**< Max size of TLS pre-shared keys, in bytes (default 256 bits) */
 //#define MBEDTLS_SSL_COOKIE_TIMEOUT        60 /**< Default expiration delay of DTLS cookies, in seconds if HAVE_TIME, or in number of cookies issued */
@@ -0,0 +1,109 @@
+// Copyright 2015-2016 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef __ESP_NETCONN_BIO_H__
+#define __ESP_NETCONN_BIO_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "lwip/api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * TLS transport on an lwIP netconn.
+ *
+ * An alternative to mbedtls_net_send() / mbedtls_net_recv(), which go
+ * through the BSD socket layer: the socket lock, select() emulation and
+ * an errno lookup for every call, and a window update sent to the tcpip
+ * thread for every read. mbedTLS reads each record in two calls or more
+ * (header, then body), so a download costs at least two such round trips
+ * per record.
+ *
+ * esp_netconn_bio_recv() keeps the pbufs the connection received and
+ * copies from them straight into the record buffer of mbedTLS, dropping
+ * each pbuf as soon as it is read. The receive window is given back to
+ * the stack in steps of TCP_WND_UPDATE_THRESHOLD, the smallest step that
+ * makes TCP send a window update, rather than after every read.
+ *
+ * esp_netconn_bio_send() writes each record with one netconn_write.
+ * The data is copied into the TCP segments (NETCONN_COPY): mbedTLS reuses
+ * or frees its output buffer as soon as the send callback returns, while
+ * NETCONN_NOCOPY needs the data untouched until the peer acknowledged it.
+ *
+ * Typical use:
+ *
+ *     esp_netconn_bio_t bio;
+ *     esp_netconn_bio_init(&bio);
+ *     ret = esp_netconn_bio_connect(&bio, host, 443);
+ *     ...
+ *     mbedtls_ssl_set_bio(&ssl, &bio, esp_netconn_bio_send, esp_netconn_bio_recv, NULL);
+ *     ...
+ *     esp_netconn_bio_free(&bio);
+ *
+ * The calls block; a read timeout is set with mbedtls_ssl_conf_read_timeout()
+ * when esp_netconn_bio_recv_timeout() is the receive callback.
+ */
+
+typedef struct {
+    struct netconn *conn;   /*!< TCP connection, NULL if none */
+    struct pbuf *rx;        /*!< received data not read yet, from rx_offset on */
+    u16_t rx_offset;        /*!< bytes of rx read already */
+    u32_t rx_unacked;       /*!< bytes read but not given back to the receive window */
+    u32_t rx_update;        /*!< give the window back in steps of this */
+} esp_netconn_bio_t;
+
+/** @brief Initialize a context with no connection */
+void esp_netconn_bio_init(esp_netconn_bio_t *bio);
+
+/**
+ * @brief Open a TCP connection to host:port
+ *
+ * @return 0 on success, MBEDTLS_ERR_NET_UNKNOWN_HOST if the name does not
+ *         resolve, MBEDTLS_ERR_NET_SOCKET_FAILED if no netconn could be
+ *         allocated, MBEDTLS_ERR_NET_CONNECT_FAILED if the connection failed.
+ */
+int esp_netconn_bio_connect(esp_netconn_bio_t *bio, const char *host, uint16_t port);
+
+/**
+ * @brief Use a TCP connection opened (or accepted) elsewhere
+ *
+ * The context owns the connection from then on: esp_netconn_bio_free()
+ * closes and deletes it.
+ */
+void esp_netconn_bio_attach(esp_netconn_bio_t *bio, struct netconn *conn);
+
+/** @brief Send callback for mbedtls_ssl_set_bio() */
+int esp_netconn_bio_send(void *ctx, const unsigned char *buf, size_t len);
+
+/** @brief Receive callback for mbedtls_ssl_set_bio() */
+int esp_netconn_bio_recv(void *ctx, unsigned char *buf, size_t len);
+
+/**
+ * @brief Receive callback with a timeout for mbedtls_ssl_set_bio()
+ *
+ * @return as esp_netconn_bio_recv(), or MBEDTLS_ERR_SSL_TIMEOUT if no data
+ *         arrived within timeout ms (0 waits forever).
+ */
+int esp_netconn_bio_recv_timeout(void *ctx, unsigned char *buf, size_t len, uint32_t timeout);
+
+/** @brief Drop the data not read yet, close and delete the connection */
+void esp_netconn_bio_free(esp_netconn_bio_t *bio);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ESP_NETCONN_BIO_H__ */
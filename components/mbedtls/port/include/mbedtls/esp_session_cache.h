@@ -0,0 +1,134 @@
+// Copyright 2015-2016 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef __ESP_SESSION_CACHE_H__
+#define __ESP_SESSION_CACHE_H__
+
+#include <stdint.h>
+#include "mbedtls/platform.h"   /* mbedtls_time_t, for ssl.h */
+#include "mbedtls/ssl.h"
+#include "nvs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Client side TLS session cache.
+ *
+ * Keeps the sessions of the last few servers a device connected to, so
+ * that reconnecting to one of them is an abbreviated handshake: no key
+ * exchange, no signature and no certificate to parse and verify. The
+ * cache has a fixed number of entries (CONFIG_MBEDTLS_CLIENT_SESSION_CACHE_ENTRIES),
+ * keyed by host name and port, and evicts the least recently used one.
+ *
+ * A session resumes with the session ticket the server sent (RFC 5077,
+ * CONFIG_MBEDTLS_SSL_SESSION_TICKETS) or, if there is none, with its
+ * session ID.
+ *
+ * Typical use:
+ *
+ *     mbedtls_ssl_setup(&ssl, &conf);
+ *     mbedtls_ssl_set_hostname(&ssl, host);
+ *     esp_session_cache_get(host, port, &ssl);
+ *     ret = mbedtls_ssl_handshake(&ssl);
+ *     if (ret == 0) {
+ *         esp_session_cache_put(host, port, &ssl);
+ *     }
+ *
+ * The cache does not keep the certificate of the server: after a
+ * resumed handshake mbedtls_ssl_get_peer_cert() returns NULL, while
+ * mbedtls_ssl_get_verify_result() returns the result of the full
+ * handshake the session was established with.
+ */
+
+/** Longest host name the cache takes */
+#define ESP_SESSION_CACHE_HOST_MAX  64
+
+typedef struct {
+    uint32_t hits;          /*!< esp_session_cache_get() found a session */
+    uint32_t misses;        /*!< esp_session_cache_get() found none, or an expired one */
+    uint32_t resumed;       /*!< handshakes that resumed the cached session */
+    uint32_t evictions;     /*!< sessions dropped to make room for another host */
+} esp_session_cache_stats_t;
+
+/**
+ * @brief Offer the cached session for host:port to a client handshake
+ *
+ * Call after mbedtls_ssl_setup() and before mbedtls_ssl_handshake(). If
+ * the server does not accept the session, the handshake is a full one.
+ *
+ * @return 0 if a session was set, 1 if none is cached for host:port, or
+ *         an mbedTLS error code from mbedtls_ssl_set_session().
+ */
+int esp_session_cache_get(const char *host, uint16_t port, mbedtls_ssl_context *ssl);
+
+/**
+ * @brief Store the session of a completed client handshake
+ *
+ * Call after mbedtls_ssl_handshake() succeeded. Replaces the session
+ * cached for host:port, if any.
+ *
+ * @return 0 on success, MBEDTLS_ERR_SSL_BAD_INPUT_DATA if the host name
+ *         is longer than ESP_SESSION_CACHE_HOST_MAX or ssl is not a
+ *         client, MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE if the session can't
+ *         be resumed (no session ID, and no ticket or one that is longer
+ *         than CONFIG_MBEDTLS_CLIENT_SESSION_TICKET_MAX_LEN).
+ */
+int esp_session_cache_put(const char *host, uint16_t port, const mbedtls_ssl_context *ssl);
+
+/**
+ * @brief Forget the session cached for host:port
+ *
+ * For example after the server failed an application level check.
+ */
+void esp_session_cache_remove(const char *host, uint16_t port);
+
+/** @brief Forget all cached sessions */
+void esp_session_cache_clear(void);
+
+/**
+ * @brief Write the cached sessions to NVS
+ *
+ * Each session is one blob, keyed by its slot in the cache. Only the
+ * sessions that changed since the last esp_session_cache_save() or
+ * esp_session_cache_load() are written, so that calling it before every
+ * deep sleep doesn't wear the flash. Commits the handle.
+ *
+ * @note The sessions include their master secrets, and NVS is not
+ *       encrypted: use a namespace nothing else reads.
+ *
+ * @param handle NVS handle opened for writing
+ * @return ESP_OK on success, or an error from nvs_set_blob() /
+ *         nvs_erase_key() / nvs_commit()
+ */
+esp_err_t esp_session_cache_save(nvs_handle handle);
+
+/**
+ * @brief Replace the cached sessions by the ones saved to NVS
+ *
+ * @param handle NVS handle
+ * @return ESP_OK on success, ESP_ERR_NVS_NOT_FOUND if nothing was saved,
+ *         ESP_ERR_INVALID_SIZE if the sessions were saved with a different
+ *         configuration (then the cache is left empty).
+ */
+esp_err_t esp_session_cache_load(nvs_handle handle);
+
+/** @brief Read the counters of the cache */
+void esp_session_cache_get_stats(esp_session_cache_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ESP_SESSION_CACHE_H__ */
@@ -0,0 +1,349 @@
+/* Crypto primitive benchmarks, see crypto_bench.h
+
+   Which implementation is timed depends on the build: the unit test app
+   uses the hardware AES, SHA and MPI (the _ALT macros in esp_config.h)
+   when they are enabled in menuconfig, the host build uses the software
+   of the library.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "mbedtls/aes.h"
+#include "mbedtls/gcm.h"
+#include "mbedtls/sha1.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/sha512.h"
+#include "mbedtls/md.h"
+#include "mbedtls/pkcs5.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/certs.h"
+#include "mbedtls/ecdh.h"
+#include "mbedtls/ecdsa.h"
+#ifndef CRYPTO_BENCH_NO_UECC
+#include "uECC.h"
+#endif
+
+#include "crypto_bench.h"
+
+#define MAX_LEN 4096
+
+/* WPA2 passphrase to PMK */
+#define PBKDF2_ITERATIONS 4096
+#define PBKDF2_KEY_LEN    32
+
+static const size_t bulk_lengths[] = { 64, 1024, MAX_LEN };
+
+static const crypto_bench_config_t *config;
+
+static unsigned char input[MAX_LEN];
+static unsigned char output[MAX_LEN];
+static unsigned char key[32];
+static unsigned char hash[32];
+static size_t len;
+
+static mbedtls_aes_context aes;
+static mbedtls_gcm_context gcm;
+static mbedtls_md_context_t md;
+static mbedtls_pk_context rsa;
+static unsigned char rsa_sig[MBEDTLS_MPI_MAX_SIZE];
+static size_t rsa_sig_len;
+static mbedtls_ecp_group grp;
+static mbedtls_mpi d_a, d_b, z, r, s;
+static mbedtls_ecp_point q_a, q_b;
+#ifndef CRYPTO_BENCH_NO_UECC
+static uint8_t uecc_key[64];
+static uint8_t uecc_sig[64];
+#endif
+
+/* Not random at all, only for the blinding and the ECDSA nonces of the
+   benchmark */
+static int bench_rng(void *ctx, unsigned char *buf, size_t buf_len)
+{
+    static uint32_t x = 2463534242u;
+    for (size_t i = 0; i < buf_len; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        buf[i] = (unsigned char) x;
+    }
+    return 0;
+}
+
+/* Run op() until config->min_us have passed, in growing batches so that
+   the clock isn't read for every operation of the fast ones */
+static int bench(const char *op, size_t bytes, int (*fn)(void))
+{
+    uint32_t ops = 0, batch = 1;
+    uint64_t t0, t;
+
+    len = bytes;
+    t0 = config->now_us();
+    do {
+        for (uint32_t i = 0; i < batch; i++) {
+            if (fn() != 0) {
+                printf("crypto_bench: %s (%u bytes) failed\n", op, (unsigned) bytes);
+                return -1;
+            }
+        }
+        ops += batch;
+        t = config->now_us() - t0;
+        if (t < config->min_us / 8) {
+            batch *= 2;
+        }
+    } while (t < config->min_us);
+
+    printf("crypto_bench,%s,%s,%u,%u,%u,%u\n", config->impl, op,
+           (unsigned) bytes, ops, (unsigned) t, config->cpu_mhz);
+    return 0;
+}
+
+static int aes_ecb(void)
+{
+    for (size_t off = 0; off < len; off += 16) {
+        if (mbedtls_aes_crypt_ecb(&aes, MBEDTLS_AES_ENCRYPT, input + off, output + off) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int aes_cbc(void)
+{
+    unsigned char iv[16] = { 0 };
+    return mbedtls_aes_crypt_cbc(&aes, MBEDTLS_AES_ENCRYPT, len, iv, input, output);
+}
+
+static int aes_ctr(void)
+{
+    unsigned char nonce_counter[16] = { 0 }, stream_block[16];
+    size_t nc_off = 0;
+    return mbedtls_aes_crypt_ctr(&aes, len, &nc_off, nonce_counter, stream_block, input, output);
+}
+
+static int aes_gcm(void)
+{
+    unsigned char iv[12] = { 0 }, tag[16];
+    /* 13 bytes of additional data, like a TLS record */
+    return mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_GCM_ENCRYPT, len, iv, sizeof(iv),
+                                     key, 13, input, output, sizeof(tag), tag);
+}
+
+static int sha1(void)
+{
+    mbedtls_sha1(input, len, output);
+    return 0;
+}
+
+static int sha256(void)
+{
+    mbedtls_sha256(input, len, output, 0);
+    return 0;
+}
+
+static int sha512(void)
+{
+    mbedtls_sha512(input, len, output, 0);
+    return 0;
+}
+
+static int hmac_sha256(void)
+{
+    return mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+                           key, sizeof(key), input, len, output);
+}
+
+static int pbkdf2_sha1(void)
+{
+    static const unsigned char passphrase[] = "benchmark passphrase";
+    static const unsigned char ssid[] = "benchmark";
+    return mbedtls_pkcs5_pbkdf2_hmac(&md, passphrase, sizeof(passphrase) - 1,
+                                     ssid, sizeof(ssid) - 1, PBKDF2_ITERATIONS,
+                                     PBKDF2_KEY_LEN, output);
+}
+
+static int rsa_sign(void)
+{
+    return mbedtls_pk_sign(&rsa, MBEDTLS_MD_SHA256, hash, sizeof(hash),
+                           rsa_sig, &rsa_sig_len, bench_rng, NULL);
+}
+
+static int rsa_verify(void)
+{
+    return mbedtls_pk_verify(&rsa, MBEDTLS_MD_SHA256, hash, sizeof(hash), rsa_sig, rsa_sig_len);
+}
+
+static int ecdh(void)
+{
+    return mbedtls_ecdh_compute_shared(&grp, &z, &q_b, &d_a, bench_rng, NULL);
+}
+
+static int ecdsa_sign(void)
+{
+    return mbedtls_ecdsa_sign(&grp, &r, &s, &d_a, hash, sizeof(hash), bench_rng, NULL);
+}
+
+static int ecdsa_verify(void)
+{
+    return mbedtls_ecdsa_verify(&grp, hash, sizeof(hash), &q_a, &r, &s);
+}
+
+#ifndef CRYPTO_BENCH_NO_UECC
+static int uecc_verify(void)
+{
+    return uECC_verify(uecc_key, hash, sizeof(hash), uecc_sig, uECC_secp256r1()) ? 0 : -1;
+}
+#endif
+
+static int bench_symmetric(void)
+{
+    static const struct {
+        const char *name;
+        int (*fn)(void);
+    } bulk[] = {
+        { "aes-128-ecb", aes_ecb },
+        { "aes-128-cbc", aes_cbc },
+        { "aes-128-ctr", aes_ctr },
+        { "aes-128-gcm", aes_gcm },
+        { "sha1", sha1 },
+        { "sha256", sha256 },
+        { "sha512", sha512 },
+        { "hmac-sha256", hmac_sha256 },
+    };
+    int ret = 0;
+
+    for (int i = 0; i < sizeof(bulk) / sizeof(bulk[0]) && ret == 0; i++) {
+        for (int j = 0; j < sizeof(bulk_lengths) / sizeof(bulk_lengths[0]) && ret == 0; j++) {
+            ret = bench(bulk[i].name, bulk_lengths[j], bulk[i].fn);
+        }
+    }
+    if (ret == 0) {
+        ret = bench("pbkdf2-hmac-sha1-4096", 0, pbkdf2_sha1);
+    }
+    return ret;
+}
+
+static int bench_rsa(void)
+{
+    int ret;
+
+    ret = mbedtls_pk_parse_key(&rsa, (const unsigned char *) mbedtls_test_srv_key_rsa,
+                               mbedtls_test_srv_key_rsa_len, NULL, 0);
+    if (ret != 0 || mbedtls_pk_get_bitlen(&rsa) != 2048) {
+        printf("crypto_bench: parsing the RSA 2048 key failed\n");
+        return -1;
+    }
+    /* rsa_sign() leaves the signature for rsa_verify() */
+    ret = bench("rsa-2048-sign", 0, rsa_sign);
+    if (ret == 0) {
+        ret = bench("rsa-2048-verify", 0, rsa_verify);
+    }
+    return ret;
+}
+
+static int bench_ecc(void)
+{
+    mbedtls_mpi z_b;
+    int ret;
+
+    mbedtls_mpi_init(&z_b);
+    ret = mbedtls_ecp_group_load(&grp, MBEDTLS_ECP_DP_SECP256R1);
+    if (ret == 0) {
+        ret = mbedtls_ecp_gen_keypair(&grp, &d_a, &q_a, bench_rng, NULL);
+    }
+    if (ret == 0) {
+        ret = mbedtls_ecp_gen_keypair(&grp, &d_b, &q_b, bench_rng, NULL);
+    }
+    if (ret == 0) {
+        ret = bench("ecdh-p256", 0, ecdh);
+    }
+    if (ret == 0) {
+        ret = mbedtls_ecdh_compute_shared(&grp, &z_b, &q_a, &d_b, bench_rng, NULL);
+        if (ret == 0 && mbedtls_mpi_cmp_mpi(&z, &z_b) != 0) {
+            printf("crypto_bench: ECDH shared secrets differ\n");
+            ret = -1;
+        }
+    }
+    mbedtls_mpi_free(&z_b);
+    /* ecdsa_sign() leaves r, s for ecdsa_verify() and uECC_verify() */
+    if (ret == 0) {
+        ret = bench("ecdsa-p256-sign", 0, ecdsa_sign);
+    }
+    if (ret == 0) {
+        ret = bench("ecdsa-p256-verify", 0, ecdsa_verify);
+    }
+#ifndef CRYPTO_BENCH_NO_UECC
+    if (ret == 0) {
+        /* uECC takes the point and the signature as big endian X || Y and r || s */
+        ret = mbedtls_mpi_write_binary(&q_a.X, uecc_key, 32);
+        ret |= mbedtls_mpi_write_binary(&q_a.Y, uecc_key + 32, 32);
+        ret |= mbedtls_mpi_write_binary(&r, uecc_sig, 32);
+        ret |= mbedtls_mpi_write_binary(&s, uecc_sig + 32, 32);
+    }
+    if (ret == 0) {
+        ret = bench("uecc-p256-verify", 0, uecc_verify);
+    }
+#endif
+    return ret;
+}
+
+int crypto_bench_run(const crypto_bench_config_t *bench_config)
+{
+    int ret;
+
+    config = bench_config;
+
+    for (int i = 0; i < sizeof(input); i++) {
+        input[i] = (unsigned char) (i * 7);
+    }
+    for (int i = 0; i < sizeof(key); i++) {
+        key[i] = (unsigned char) i;
+    }
+    mbedtls_sha256(input, sizeof(input), hash, 0);
+
+    mbedtls_aes_init(&aes);
+    mbedtls_gcm_init(&gcm);
+    mbedtls_md_init(&md);
+    mbedtls_pk_init(&rsa);
+    mbedtls_ecp_group_init(&grp);
+    mbedtls_mpi_init(&d_a);
+    mbedtls_mpi_init(&d_b);
+    mbedtls_mpi_init(&z);
+    mbedtls_mpi_init(&r);
+    mbedtls_mpi_init(&s);
+    mbedtls_ecp_point_init(&q_a);
+    mbedtls_ecp_point_init(&q_b);
+
+    printf("crypto_bench,impl,op,bytes,ops,usec,cpu_mhz\n");
+
+    ret = mbedtls_aes_setkey_enc(&aes, key, 128);
+    ret |= mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, key, 128);
+    ret |= mbedtls_md_setup(&md, mbedtls_md_info_from_type(MBEDTLS_MD_SHA1), 1);
+    if (ret != 0) {
+        printf("crypto_bench: setting up AES, GCM or HMAC failed\n");
+        ret = -1;
+    }
+    if (ret == 0) {
+        ret = bench_symmetric();
+    }
+    if (ret == 0) {
+        ret = bench_rsa();
+    }
+    if (ret == 0) {
+        ret = bench_ecc();
+    }
+
+    mbedtls_aes_free(&aes);
+    mbedtls_gcm_free(&gcm);
+    mbedtls_md_free(&md);
+    mbedtls_pk_free(&rsa);
+    mbedtls_ecp_group_free(&grp);
+    mbedtls_mpi_free(&d_a);
+    mbedtls_mpi_free(&d_b);
+    mbedtls_mpi_free(&z);
+    mbedtls_mpi_free(&r);
+    mbedtls_mpi_free(&s);
+    mbedtls_ecp_point_free(&q_a);
+    mbedtls_ecp_point_free(&q_b);
+
+    return ret == 0 ? 0 : -1;
+}
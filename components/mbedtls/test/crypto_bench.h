@@ -0,0 +1,32 @@
+/* Crypto primitive benchmarks, shared by the unit test app
+   (test_mbedtls_bench.c) and the host build in ../test_mbedtls_host.
+ */
+#pragma once
+
+#include <stdint.h>
+
+typedef struct {
+    const char *impl;          /* printed with each result, ie "hw" or "sw" */
+    uint64_t (*now_us)(void);  /* monotonic clock */
+    uint32_t min_us;           /* time each operation for at least this long,
+                                  0 to run every operation only once */
+    uint32_t cpu_mhz;          /* CPU clock for cycle counts, 0 if unknown */
+} crypto_bench_config_t;
+
+/**
+ * @brief Time AES, SHA, HMAC, PBKDF2, RSA, ECDH/ECDSA and uECC operations
+ *
+ * Prints a CSV header and then one line per operation:
+ *
+ *     crypto_bench,<impl>,<op>,<bytes>,<ops>,<usec>,<cpu_mhz>
+ *
+ * where <bytes> is the input length of one operation (0 for public key
+ * operations) and <usec> is the time for all <ops> operations. Cycles per
+ * byte or per operation are usec * cpu_mhz / (ops * bytes) or / ops.
+ *
+ * The results of the operations are checked as well (signatures verify,
+ * both ECDH sides agree, ...).
+ *
+ * @return 0 on success, -1 if any operation failed.
+ */
+int crypto_bench_run(const crypto_bench_config_t *config);
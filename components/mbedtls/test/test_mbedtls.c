@@ -13,8 +13,10 @@
 #include "mbedtls/sha256.h"
 #include "mbedtls/sha512.h"
 #include "mbedtls/aes.h"
+#include "mbedtls/gcm.h"
 #include "mbedtls/bignum.h"
 #include "mbedtls/rsa.h"
+#include "mbedtls/ecp.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
@@ -26,6 +28,11 @@ TEST_CASE("mbedtls AES self-tests", "[aes]")
     TEST_ASSERT_FALSE_MESSAGE(mbedtls_aes_self_test(1), "AES self-tests should pass.");
 }
 
+TEST_CASE("mbedtls GCM self-tests", "[aes]")
+{
+    TEST_ASSERT_FALSE_MESSAGE(mbedtls_gcm_self_test(1), "GCM self-tests should pass.");
+}
+
 TEST_CASE("mbedtls MPI self-tests", "[bignum]")
 {
     TEST_ASSERT_FALSE_MESSAGE(mbedtls_mpi_self_test(1), "MPI self-tests should pass.");
@@ -36,3 +43,7 @@ TEST_CASE("mbedtls RSA self-tests", "[bignum]")
     TEST_ASSERT_FALSE_MESSAGE(mbedtls_rsa_self_test(1), "RSA self-tests should pass.");
 }
 
+TEST_CASE("mbedtls ECP self-tests", "[bignum]")
+{
+    TEST_ASSERT_FALSE_MESSAGE(mbedtls_ecp_self_test(1), "ECP self-tests should pass.");
+}
@@ -0,0 +1,34 @@
+/* mbedTLS crypto benchmark, see crypto_bench.c
+
+   Times the implementations selected in menuconfig: hardware AES, SHA and
+   MPI by default. The software numbers come from the same code built on
+   the host, see ../test_mbedtls_host.
+ */
+#include <stdio.h>
+#include <sys/time.h>
+#include "unity.h"
+#include "sdkconfig.h"
+#include "crypto_bench.h"
+
+static uint64_t now_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+TEST_CASE("mbedtls crypto benchmark", "[mbedtls][bench]")
+{
+    const crypto_bench_config_t config = {
+#if defined(CONFIG_MBEDTLS_HARDWARE_AES) || defined(CONFIG_MBEDTLS_HARDWARE_SHA) || defined(CONFIG_MBEDTLS_HARDWARE_MPI)
+        .impl = "hw",
+#else
+        .impl = "sw",
+#endif
+        .now_us = now_us,
+        .min_us = 200000,
+        .cpu_mhz = CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ,
+    };
+
+    TEST_ASSERT_EQUAL(0, crypto_bench_run(&config));
+}
@@ -8,6 +8,7 @@
 #include "mbedtls/sha1.h"
 #include "mbedtls/sha256.h"
 #include "mbedtls/sha512.h"
+#include "hwcrypto/sha.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
@@ -78,6 +79,45 @@ TEST_CASE("mbedtls SHA interleaving", "[mbedtls]")
     TEST_ASSERT_EQUAL_MEMORY_MESSAGE(sha1_thousand_as, sha1, 20, "SHA1 calculation");
 }
 
+TEST_CASE("mbedtls SHA engine handover", "[mbedtls]")
+{
+    mbedtls_sha256_context ctx[3];
+    const unsigned char *input[3] = { one_hundred_as, one_hundred_bs, one_hundred_as };
+    const uint8_t *expected[3] = { sha256_thousand_as, sha256_thousand_bs, sha256_thousand_as };
+    unsigned char sha256[32];
+    esp_sha_stats_t stats;
+
+    esp_sha_reset_stats(SHA2_256);
+    for (int i = 0; i < 3; i++) {
+        mbedtls_sha256_init(&ctx[i]);
+        mbedtls_sha256_starts(&ctx[i], false);
+    }
+
+    /* ctx[0] takes the engine and ctx[1] is turned away, as ctx[0] is
+       running. ctx[0] then sits idle, so ctx[2] takes the engine over. */
+    for (int i = 0; i < 3; i++) {
+        mbedtls_sha256_update(&ctx[i], input[i], 100);
+    }
+    for (int j = 1; j < 10; j++) {
+        for (int i = 0; i < 3; i++) {
+            mbedtls_sha256_update(&ctx[i], input[i], 100);
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        mbedtls_sha256_finish(&ctx[i], sha256);
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(expected[i], sha256, 32, "SHA256 calculation");
+        mbedtls_sha256_free(&ctx[i]);
+    }
+
+    esp_sha_get_stats(SHA2_256, &stats);
+    printf("SHA256 blocks: %u hardware, %u software, %u preemptions\n",
+           stats.hardware_blocks, stats.software_blocks, stats.preemptions);
+    TEST_ASSERT_EQUAL(1, stats.preemptions);
+    /* 16 blocks per digest: ctx[0] ran its first one in hardware */
+    TEST_ASSERT_EQUAL(16 + 1, stats.hardware_blocks);
+    TEST_ASSERT_EQUAL(16 + 15, stats.software_blocks);
+}
+
 static xSemaphoreHandle done_sem;
 static void tskRunSHA1Test(void *pvParameters)
 {
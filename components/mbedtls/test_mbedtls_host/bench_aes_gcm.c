@@ -0,0 +1,146 @@
+/*
+ * Host test and benchmark for AES-GCM and AES-CTR.
+ *
+ * Runs the GCM self-test of the library (the vectors of the GCM spec) and
+ * checks that a record encrypted in pieces of different sizes comes out
+ * the same as in one go. Then times GCM (with 13 bytes of additional data,
+ * like a TLS record) and CTR on records of 16 bytes to 16 KB. Which GHASH table
+ * the build uses depends on MBEDTLS_GCM_TABLE_8BIT, see the Makefile.
+ *
+ * This is the software path; on the ESP32 the AES blocks of both modes
+ * run on the hardware unit (MBEDTLS_AES_ALT).
+ *
+ * With -q only the checks are run.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "mbedtls/aes.h"
+#include "mbedtls/gcm.h"
+
+#define MAX_RECORD      16384
+
+static unsigned char key[32];
+static unsigned char iv[12];
+static unsigned char aad[13];
+static unsigned char input[MAX_RECORD];
+static unsigned char output[MAX_RECORD];
+static unsigned char pieces[MAX_RECORD];
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Encrypt MAX_RECORD bytes in updates of 16, 32, 48... bytes and compare
+   with a single update. */
+static int check_pieces(void)
+{
+    mbedtls_gcm_context gcm;
+    unsigned char tag[16], tag_pieces[16];
+    size_t off, len;
+    int ret = 0;
+
+    mbedtls_gcm_init(&gcm);
+    mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, key, 128);
+    mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_GCM_ENCRYPT, sizeof(input), iv, sizeof(iv),
+                              aad, sizeof(aad), input, output, sizeof(tag), tag);
+
+    /* mbedtls_gcm_update() takes partial blocks only at the end of a
+       message, so the pieces are whole blocks but for the last one */
+    mbedtls_gcm_starts(&gcm, MBEDTLS_GCM_ENCRYPT, iv, sizeof(iv), aad, sizeof(aad));
+    for (off = 0, len = 16; off < sizeof(input); off += len, len += 16) {
+        if (len > sizeof(input) - off) {
+            len = sizeof(input) - off;
+        }
+        mbedtls_gcm_update(&gcm, len, input + off, pieces + off);
+    }
+    mbedtls_gcm_finish(&gcm, tag_pieces, sizeof(tag_pieces));
+
+    if (memcmp(output, pieces, sizeof(output)) != 0 || memcmp(tag, tag_pieces, sizeof(tag)) != 0) {
+        printf("GCM in pieces differs from GCM in one go\n");
+        ret = 1;
+    }
+    mbedtls_gcm_free(&gcm);
+    return ret;
+}
+
+static double bench_gcm(size_t len)
+{
+    mbedtls_gcm_context gcm;
+    unsigned char tag[16];
+    unsigned long n, count = 0;
+    double t0, t;
+
+    mbedtls_gcm_init(&gcm);
+    mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, key, 128);
+    t0 = now_sec();
+    do {
+        for (n = 0; n < 64; n++) {
+            mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_GCM_ENCRYPT, len, iv, sizeof(iv),
+                                      aad, sizeof(aad), input, output, sizeof(tag), tag);
+        }
+        count += n;
+        t = now_sec() - t0;
+    } while (t < 0.2);
+    mbedtls_gcm_free(&gcm);
+    return count * len / t;
+}
+
+static double bench_ctr(size_t len)
+{
+    mbedtls_aes_context aes;
+    unsigned char nonce_counter[16] = { 0 }, stream_block[16];
+    unsigned long n, count = 0;
+    size_t nc_off;
+    double t0, t;
+
+    mbedtls_aes_init(&aes);
+    mbedtls_aes_setkey_enc(&aes, key, 128);
+    t0 = now_sec();
+    do {
+        for (n = 0; n < 64; n++) {
+            nc_off = 0;
+            mbedtls_aes_crypt_ctr(&aes, len, &nc_off, nonce_counter, stream_block, input, output);
+        }
+        count += n;
+        t = now_sec() - t0;
+    } while (t < 0.2);
+    mbedtls_aes_free(&aes);
+    return count * len / t;
+}
+
+int main(int argc, char **argv)
+{
+    size_t len;
+    int i;
+
+    for (i = 0; i < sizeof(input); i++) {
+        input[i] = (unsigned char) (i * 7);
+    }
+    for (i = 0; i < sizeof(key); i++) {
+        key[i] = (unsigned char) i;
+    }
+
+    if (mbedtls_gcm_self_test(0) != 0) {
+        printf("GCM self-test failed\n");
+        return 1;
+    }
+    if (check_pieces() != 0) {
+        return 1;
+    }
+    if (argc > 1 && strcmp(argv[1], "-q") == 0) {
+        return 0;
+    }
+
+    printf("AES-128, %d-bit GHASH table (%d bytes per context)\n",
+           MBEDTLS_GCM_TABLE_SIZE == 256 ? 8 : 4, (int) (2 * MBEDTLS_GCM_TABLE_SIZE * sizeof(uint64_t)));
+    printf("%8s %12s %12s\n", "record", "GCM KB/s", "CTR KB/s");
+    for (len = 16; len <= MAX_RECORD; len *= 4) {
+        printf("%8zu %12.0f %12.0f\n", len, bench_gcm(len) / 1024, bench_ctr(len) / 1024);
+    }
+    return 0;
+}
@@ -0,0 +1,43 @@
+/*
+ * Host build of the crypto benchmark of the unit tests (../test/crypto_bench.c),
+ * on the software implementations of the library.
+ *
+ * Prints one CSV line per operation, see crypto_bench.h. With -q every
+ * operation runs only once, as a check.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "crypto_bench.h"
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int main(int argc, char **argv)
+{
+    crypto_bench_config_t config = {
+        .impl = "sw",
+        .now_us = now_us,
+        .min_us = 200000,
+        .cpu_mhz = 0,
+    };
+    int quiet = argc > 1 && strcmp(argv[1], "-q") == 0;
+
+    if (quiet) {
+        config.min_us = 0;
+        /* the results go nowhere, only failures are reported on stderr */
+        if (freopen("/dev/null", "w", stdout) == NULL) {
+            return 1;
+        }
+    }
+    if (crypto_bench_run(&config) != 0) {
+        fprintf(stderr, "crypto benchmark failed\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+/*
+ * Host emulation of the modular multiplication of the RSA accelerator, for
+ * running port/esp_ecp.c on the host.
+ *
+ * esp_mpi_mul_mod() does what the hardware does: two Montgomery
+ * multiplications, first of X by Rinv = R^2 mod M, then of the result by
+ * Y, with R = 2^(32 * num_words) and num_words rounded up to 512 bits.
+ * The accelerator's memory is a single "loaded modulus", which powering
+ * up the unit and any other operation clear as on the chip, so that the
+ * counters show how often the modulus would really be loaded.
+ */
+#include <assert.h>
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#include "mbedtls/bignum.h"
+#include "esp_mpi_host.h"
+
+esp_mpi_host_stats_t esp_mpi_host_stats;
+
+static int lock_depth;
+static const esp_mpi_modulus_t *loaded_modulus;
+
+int esp_mpi_host_held(void)
+{
+    return lock_depth > 0;
+}
+
+static void mpi_acquire_hardware(void)
+{
+    if (lock_depth++ == 0) {
+        esp_mpi_host_stats.power_ups++;
+    }
+}
+
+void esp_mpi_acquire_hardware(void)
+{
+    mpi_acquire_hardware();
+    loaded_modulus = NULL;
+}
+
+void esp_mpi_release_hardware(void)
+{
+    assert(lock_depth > 0);
+    if (--lock_depth == 0) {
+        loaded_modulus = NULL;
+    }
+}
+
+int esp_mpi_modulus_init(esp_mpi_modulus_t *mod, const mbedtls_mpi *M)
+{
+    int ret;
+    mbedtls_mpi RR;
+
+    mbedtls_mpi_init(&mod->M);
+    mbedtls_mpi_init(&mod->Rinv);
+    mbedtls_mpi_init(&RR);
+    mod->num_words = (mbedtls_mpi_bitlen(M) + 511) / 512 * 16;
+    if (mod->num_words * 32 > 4096) {
+        return MBEDTLS_ERR_MPI_NOT_ACCEPTABLE;
+    }
+    mod->result_words = (mbedtls_mpi_bitlen(M) + 31) / 32;
+
+    MBEDTLS_MPI_CHK(mbedtls_mpi_copy(&mod->M, M));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_set_bit(&RR, mod->num_words * 32 * 2, 1));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&mod->Rinv, &RR, M));
+    mod->Mprime = 0;        /* only the hardware needs it */
+
+ cleanup:
+    mbedtls_mpi_free(&RR);
+    if (ret != 0) {
+        esp_mpi_modulus_free(mod);
+    }
+    return ret;
+}
+
+void esp_mpi_modulus_free(esp_mpi_modulus_t *mod)
+{
+    if (loaded_modulus == mod) {
+        loaded_modulus = NULL;
+    }
+    mbedtls_mpi_free(&mod->M);
+    mbedtls_mpi_free(&mod->Rinv);
+}
+
+/* Z = A * B * R^-1 mod M, what one RSA_MULT_START does */
+static int montgomery_multiply(const esp_mpi_modulus_t *mod, mbedtls_mpi *Z,
+                               const mbedtls_mpi *A, const mbedtls_mpi *B)
+{
+    int ret;
+    mbedtls_mpi R, R_inv;
+
+    mbedtls_mpi_init(&R);
+    mbedtls_mpi_init(&R_inv);
+    MBEDTLS_MPI_CHK(mbedtls_mpi_set_bit(&R, mod->num_words * 32, 1));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_inv_mod(&R_inv, &R, &mod->M));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(Z, A, B));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(Z, Z, &mod->M));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(Z, Z, &R_inv));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(Z, Z, &mod->M));
+
+ cleanup:
+    mbedtls_mpi_free(&R);
+    mbedtls_mpi_free(&R_inv);
+    return ret;
+}
+
+int esp_mpi_mul_mod(const esp_mpi_modulus_t *mod, mbedtls_mpi *Z, const mbedtls_mpi *X, const mbedtls_mpi *Y)
+{
+    int ret;
+    mbedtls_mpi XR;
+
+    mbedtls_mpi_init(&XR);
+    mpi_acquire_hardware();
+    if (loaded_modulus != mod) {
+        esp_mpi_host_stats.modulus_loads++;
+    }
+    esp_mpi_host_stats.mul_mods++;
+
+    MBEDTLS_MPI_CHK(montgomery_multiply(mod, &XR, X, &mod->Rinv));
+    MBEDTLS_MPI_CHK(montgomery_multiply(mod, Z, &XR, Y));
+    Z->s = X->s * Y->s;
+
+ cleanup:
+    loaded_modulus = mod;
+    esp_mpi_release_hardware();
+    mbedtls_mpi_free(&XR);
+    return ret;
+}
@@ -0,0 +1,19 @@
+/*
+ * Host emulation of the esp_mpi_xxx functions of port/esp_bignum.c that
+ * port/esp_ecp.c uses, see esp_mpi_host.c.
+ */
+#ifndef ESP_MPI_HOST_H
+#define ESP_MPI_HOST_H
+
+typedef struct {
+    unsigned long power_ups;        /* acquisitions of the unpowered unit */
+    unsigned long modulus_loads;    /* modulus written to the unit */
+    unsigned long mul_mods;         /* esp_mpi_mul_mod() calls */
+} esp_mpi_host_stats_t;
+
+extern esp_mpi_host_stats_t esp_mpi_host_stats;
+
+/* Nonzero while the emulated unit is acquired */
+int esp_mpi_host_held(void);
+
+#endif /* ESP_MPI_HOST_H */
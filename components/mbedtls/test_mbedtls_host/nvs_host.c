@@ -0,0 +1,118 @@
+/*
+ * The NVS functions port/esp_session_cache.c uses, on a few keys in RAM.
+ * Like NVS, a blob has to fit in one page. nvs_host_commits counts the
+ * commits, which would be flash writes, and nvs_host_writes the keys that
+ * were set or erased.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "nvs.h"
+
+#define MAX_KEYS    40
+
+/* 126 entries of 32 bytes per page, one of them for the key */
+#define BLOB_MAX    ((126 - 1) * 32)
+
+static struct {
+    char key[16];
+    void *value;
+    size_t length;
+} keys[MAX_KEYS];
+
+unsigned nvs_host_commits;
+unsigned nvs_host_writes;
+
+static int find_key(const char *key, bool create)
+{
+    int i;
+
+    for (i = 0; i < MAX_KEYS; i++) {
+        if (keys[i].value != NULL && strcmp(keys[i].key, key) == 0) {
+            return i;
+        }
+    }
+    if (create) {
+        for (i = 0; i < MAX_KEYS; i++) {
+            if (keys[i].value == NULL) {
+                strncpy(keys[i].key, key, sizeof(keys[i].key) - 1);
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+esp_err_t nvs_set_blob(nvs_handle handle, const char *key, const void *value, size_t length)
+{
+    int i;
+    void *copy;
+
+    if (length > BLOB_MAX) {
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+    i = find_key(key, true);
+    copy = malloc(length ? length : 1);
+    if (i < 0 || copy == NULL) {
+        free(copy);
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+    memcpy(copy, value, length);
+    free(keys[i].value);
+    keys[i].value = copy;
+    keys[i].length = length;
+    nvs_host_writes++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle handle, const char *key)
+{
+    int i = find_key(key, false);
+
+    if (i < 0) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    free(keys[i].value);
+    keys[i].value = NULL;
+    nvs_host_writes++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle handle, const char *key, void *out_value, size_t *length)
+{
+    int i = find_key(key, false);
+
+    if (i < 0) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out_value != NULL) {
+        if (*length < keys[i].length) {
+            return ESP_ERR_NVS_INVALID_LENGTH;
+        }
+        memcpy(out_value, keys[i].value, keys[i].length);
+    }
+    *length = keys[i].length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_u32(nvs_handle handle, const char *key, uint32_t value)
+{
+    return nvs_set_blob(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u32(nvs_handle handle, const char *key, uint32_t *out_value)
+{
+    size_t length = sizeof(*out_value);
+    esp_err_t err = nvs_get_blob(handle, key, out_value, &length);
+
+    if (err == ESP_OK && length != sizeof(*out_value)) {
+        return ESP_ERR_NVS_TYPE_MISMATCH;
+    }
+    return err;
+}
+
+esp_err_t nvs_commit(nvs_handle handle)
+{
+    nvs_host_commits++;
+    return ESP_OK;
+}
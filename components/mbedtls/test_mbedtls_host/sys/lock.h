@@ -0,0 +1,15 @@
+/*
+ * newlib locks of ESP-IDF, for the single threaded host tests in this
+ * directory: nothing to lock.
+ */
+#ifndef HOST_SYS_LOCK_H
+#define HOST_SYS_LOCK_H
+
+typedef int _lock_t;
+
+static inline void _lock_acquire(_lock_t *lock) { (void) lock; }
+static inline void _lock_release(_lock_t *lock) { (void) lock; }
+static inline void _lock_acquire_recursive(_lock_t *lock) { (void) lock; }
+static inline void _lock_release_recursive(_lock_t *lock) { (void) lock; }
+
+#endif /* HOST_SYS_LOCK_H */
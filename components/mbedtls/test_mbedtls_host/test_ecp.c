@@ -0,0 +1,209 @@
+/*
+ * Host test for elliptic curve arithmetic with the field multiplication of
+ * port/esp_ecp.c.
+ *
+ * Built twice, see the Makefile: test_ecp_sw is the software ECP of the
+ * library, test_ecp_hw runs P-256 and P-384 field multiplications through
+ * port/esp_ecp.c and the emulated accelerator of esp_mpi_host.c. Both print
+ * the results of the same scalar multiplications, ECDH and ECDSA, with the
+ * same "random" numbers, and the outputs have to be identical.
+ *
+ * test_ecp_hw also checks how it uses the accelerator: once powered up per
+ * scalar multiplication, the modulus loaded once per scalar multiplication,
+ * and the table for the generator computed once per curve, not per group.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "mbedtls/ecp.h"
+#include "mbedtls/ecdh.h"
+#include "mbedtls/ecdsa.h"
+
+#if defined(MBEDTLS_ECP_MUL_MOD_ALT)
+#include "esp_mpi_host.h"
+#endif
+
+static const mbedtls_ecp_group_id curves[] = {
+    MBEDTLS_ECP_DP_SECP256R1,
+    MBEDTLS_ECP_DP_SECP384R1,
+};
+
+/* Not random at all: the same bytes in both builds */
+static int test_rng(void *p_rng, unsigned char *output, size_t len)
+{
+    unsigned int *state = (unsigned int *) p_rng;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        *state ^= *state << 13;
+        *state ^= *state >> 17;
+        *state ^= *state << 5;
+        output[i] = (unsigned char) *state;
+    }
+    return 0;
+}
+
+static void print_mpi(const char *name, const mbedtls_mpi *X)
+{
+    char buf[256];
+    size_t olen;
+
+    if (mbedtls_mpi_write_string(X, 16, buf, sizeof(buf), &olen) != 0) {
+        strcpy(buf, "?");
+    }
+    printf("  %s %s\n", name, buf);
+}
+
+static void print_point(const char *name, const mbedtls_ecp_point *P)
+{
+    printf(" %s\n", name);
+    print_mpi("X", &P->X);
+    print_mpi("Y", &P->Y);
+}
+
+static int failures;
+
+#define CHECK(cond) do { if (!(cond)) { \
+    fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+    failures++; } } while (0)
+
+/* d * G in a freshly loaded group, returns the field multiplications used */
+static unsigned long mul_generator(mbedtls_ecp_group_id id, const mbedtls_mpi *d,
+                                   unsigned int *rng_state, const char *name)
+{
+    mbedtls_ecp_group grp;
+    mbedtls_ecp_point R;
+    unsigned long muls = 0;
+
+    mbedtls_ecp_group_init(&grp);
+    mbedtls_ecp_point_init(&R);
+    CHECK(mbedtls_ecp_group_load(&grp, id) == 0);
+
+#if defined(MBEDTLS_ECP_MUL_MOD_ALT)
+    esp_mpi_host_stats_t before = esp_mpi_host_stats;
+#endif
+    CHECK(mbedtls_ecp_mul(&grp, &R, d, &grp.G, test_rng, rng_state) == 0);
+#if defined(MBEDTLS_ECP_MUL_MOD_ALT)
+    CHECK(esp_mpi_host_stats.power_ups - before.power_ups == 1);
+    CHECK(esp_mpi_host_stats.modulus_loads - before.modulus_loads == 1);
+    CHECK(!esp_mpi_host_held());
+    CHECK(grp.T == NULL);
+    muls = esp_mpi_host_stats.mul_mods - before.mul_mods;
+#endif
+    print_point(name, &R);
+
+    mbedtls_ecp_point_free(&R);
+    mbedtls_ecp_group_free(&grp);
+    return muls;
+}
+
+static void test_curve(mbedtls_ecp_group_id id)
+{
+    const mbedtls_ecp_curve_info *info = mbedtls_ecp_curve_info_from_grp_id(id);
+    unsigned int rng_state = 0x12345678 + id;
+    mbedtls_ecp_group grp;
+    mbedtls_ecp_point R, S;
+    mbedtls_mpi d, e, z1, z2, r, s;
+    mbedtls_ecp_point Q1, Q2;
+    unsigned char hash[48];
+    unsigned long first, second;
+    int i;
+
+    printf("%s\n", info->name);
+    mbedtls_mpi_init(&d);
+    mbedtls_mpi_init(&e);
+
+    /* the generator table is computed by the first group only */
+    CHECK(mbedtls_mpi_read_string(&d, 16, "1f2e3d4c5b6a79880123456789abcdeffedcba9876543210") == 0);
+    first = mul_generator(id, &d, &rng_state, "d*G");
+    second = mul_generator(id, &d, &rng_state, "d*G again");
+#if defined(MBEDTLS_ECP_MUL_MOD_ALT)
+    fprintf(stderr, "%s: %lu field multiplications for d*G, %lu with the cached table\n",
+            info->name, first, second);
+    CHECK(second > 0 && second < first / 2);
+#else
+    (void) first;
+    (void) second;
+#endif
+
+    mbedtls_ecp_group_init(&grp);
+    mbedtls_ecp_point_init(&R);
+    mbedtls_ecp_point_init(&S);
+    CHECK(mbedtls_ecp_group_load(&grp, id) == 0);
+
+    /* some other point, small and large scalars */
+    CHECK(mbedtls_ecp_mul(&grp, &R, &d, &grp.G, NULL, NULL) == 0);
+    for (i = 0; i < 4; i++) {
+        CHECK(mbedtls_mpi_sub_int(&e, &grp.N, 1 + i * 1000003) == 0);
+        CHECK(mbedtls_ecp_mul(&grp, &S, &e, &R, test_rng, &rng_state) == 0);
+        print_point("e*R", &S);
+        CHECK(mbedtls_mpi_lset(&e, 2 + i) == 0);
+        CHECK(mbedtls_ecp_mul(&grp, &S, &e, &R, test_rng, &rng_state) == 0);
+        print_point("small e*R", &S);
+    }
+
+    /* m*G + n*R */
+    CHECK(mbedtls_ecp_muladd(&grp, &S, &d, &grp.G, &e, &R) == 0);
+    print_point("d*G + e*R", &S);
+
+    /* ECDH */
+    mbedtls_mpi_init(&z1);
+    mbedtls_mpi_init(&z2);
+    mbedtls_ecp_point_init(&Q1);
+    mbedtls_ecp_point_init(&Q2);
+    CHECK(mbedtls_ecdh_gen_public(&grp, &d, &Q1, test_rng, &rng_state) == 0);
+    CHECK(mbedtls_ecdh_gen_public(&grp, &e, &Q2, test_rng, &rng_state) == 0);
+    CHECK(mbedtls_ecdh_compute_shared(&grp, &z1, &Q2, &d, test_rng, &rng_state) == 0);
+    CHECK(mbedtls_ecdh_compute_shared(&grp, &z2, &Q1, &e, test_rng, &rng_state) == 0);
+    CHECK(mbedtls_mpi_cmp_mpi(&z1, &z2) == 0);
+    print_mpi("ECDH", &z1);
+
+    /* ECDSA */
+    mbedtls_mpi_init(&r);
+    mbedtls_mpi_init(&s);
+    for (i = 0; i < sizeof(hash); i++) {
+        hash[i] = (unsigned char) (i * 13);
+    }
+    CHECK(mbedtls_ecdsa_sign(&grp, &r, &s, &d, hash, info->bit_size / 8, test_rng, &rng_state) == 0);
+    print_mpi("ECDSA r", &r);
+    print_mpi("ECDSA s", &s);
+    CHECK(mbedtls_ecdsa_verify(&grp, hash, info->bit_size / 8, &Q1, &r, &s) == 0);
+    hash[0] ^= 1;
+    CHECK(mbedtls_ecdsa_verify(&grp, hash, info->bit_size / 8, &Q1, &r, &s) == MBEDTLS_ERR_ECP_VERIFY_FAILED);
+
+#if defined(MBEDTLS_ECP_MUL_MOD_ALT)
+    CHECK(!esp_mpi_host_held());
+#endif
+
+    mbedtls_mpi_free(&r);
+    mbedtls_mpi_free(&s);
+    mbedtls_ecp_point_free(&Q1);
+    mbedtls_ecp_point_free(&Q2);
+    mbedtls_mpi_free(&z1);
+    mbedtls_mpi_free(&z2);
+    mbedtls_ecp_point_free(&R);
+    mbedtls_ecp_point_free(&S);
+    mbedtls_ecp_group_free(&grp);
+    mbedtls_mpi_free(&d);
+    mbedtls_mpi_free(&e);
+}
+
+int main(void)
+{
+    int i;
+
+    /* first, so that no generator table is cached yet */
+    for (i = 0; i < sizeof(curves) / sizeof(curves[0]); i++) {
+        test_curve(curves[i]);
+    }
+    if (mbedtls_ecp_self_test(0) != 0) {
+        fprintf(stderr, "ECP self-test failed\n");
+        failures++;
+    }
+#if defined(MBEDTLS_ECP_MUL_MOD_ALT)
+    fprintf(stderr, "%lu field multiplications on the accelerator, %lu power-ups, %lu modulus loads\n",
+            esp_mpi_host_stats.mul_mods, esp_mpi_host_stats.power_ups, esp_mpi_host_stats.modulus_loads);
+    CHECK(esp_mpi_host_stats.mul_mods > 0);
+#endif
+    return failures != 0;
+}
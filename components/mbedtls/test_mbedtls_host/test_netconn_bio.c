@@ -0,0 +1,371 @@
+/*
+ * Host test and benchmark for port/esp_netconn_bio.c.
+ *
+ * lwIP runs on the host as in its own host tests: a netsim_pair (see
+ * ../../lwip/test_lwip_host/netsim.h) connects a client and a server
+ * address of one stack. A TLS server on esp_netconn_bio waits for a
+ * request, then sends DOWNLOAD_LEN bytes in full records, like an HTTPS
+ * download. The client downloads them twice: through the BSD sockets, the
+ * way port/net.c does, and through esp_netconn_bio. Both check the data,
+ * and the netconn client checks its read timeout before it sends the
+ * request.
+ *
+ * Prints for both clients the throughput, the receive callbacks and the
+ * messages the client thread sent to the tcpip thread. With -q only the
+ * checks are run.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "mbedtls/platform.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/certs.h"
+#include "mbedtls/net.h"
+#include "mbedtls/esp_netconn_bio.h"
+
+#include "lwip/api.h"
+#include "lwip/sockets.h"
+#include "lwip/tcpip.h"
+#include "netsim.h"
+
+#define CLIENT_ADDR     0x0a000101     /* 10.0.1.1 */
+#define SERVER_ADDR     0x0a000201     /* 10.0.2.1 */
+#define SERVER_PORT     4433
+#define DOWNLOAD_LEN    (1024 * 1024)
+#define READ_TIMEOUT    1000
+#define REQUEST         "GET /"
+
+static struct netsim_pair pair;
+static mbedtls_ssl_config client_conf, server_conf;
+static mbedtls_x509_crt ca, server_crt;
+static mbedtls_pk_context server_key;
+
+static sys_sem_t listening;
+static int failures;
+static int quiet;
+
+#define CHECK(cond) do { if (!(cond)) { \
+    fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+    failures++; } } while (0)
+
+void esp_wifi_internal_free_rx_buffer(void *buffer)
+{
+}
+
+void dhcps_coarse_tmr(void)
+{
+}
+
+/* Messages to the tcpip thread, counted for the client thread only */
+static __thread int counting;
+static unsigned long tcpip_msgs, recv_calls;
+
+err_t __real_tcpip_send_api_msg(tcpip_callback_fn fn, void *apimsg, sys_sem_t *sem);
+
+err_t __wrap_tcpip_send_api_msg(tcpip_callback_fn fn, void *apimsg, sys_sem_t *sem)
+{
+    if (counting) {
+        tcpip_msgs++;
+    }
+    return __real_tcpip_send_api_msg(fn, apimsg, sem);
+}
+
+static int test_rng(void *p_rng, unsigned char *output, size_t len)
+{
+    static __thread unsigned int state = 0x2545f491;
+    size_t i;
+
+    (void) p_rng;
+    for (i = 0; i < len; i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        output[i] = (unsigned char) state;
+    }
+    return 0;
+}
+
+static unsigned char pattern(size_t i)
+{
+    return (unsigned char) (i % 251);
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void tcpip_init_done(void *arg)
+{
+    ip4_addr_t client, server;
+    struct netsim_params params;
+
+    memset(&params, 0, sizeof(params));
+    params.seed = 1;
+    ip4_addr_set_u32(&client, PP_HTONL(CLIENT_ADDR));
+    ip4_addr_set_u32(&server, PP_HTONL(SERVER_ADDR));
+    if (netsim_pair_add(&pair, &client, &server, &params) != 0) {
+        printf("netsim_pair_add failed\n");
+        exit(1);
+    }
+    sys_sem_signal((sys_sem_t *) arg);
+}
+
+/* Receive and send callbacks on a socket, as mbedtls_net_recv() and
+   mbedtls_net_send() of port/net.c */
+static int socket_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    int ret = lwip_recv_r(*(int *) ctx, buf, len, 0);
+
+    recv_calls++;
+    return ret < 0 ? MBEDTLS_ERR_NET_RECV_FAILED : ret;
+}
+
+static int socket_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    int ret = lwip_send_r(*(int *) ctx, buf, len, 0);
+
+    return ret < 0 ? MBEDTLS_ERR_NET_SEND_FAILED : ret;
+}
+
+static int counted_bio_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    recv_calls++;
+    return esp_netconn_bio_recv(ctx, buf, len);
+}
+
+static int counted_bio_recv_timeout(void *ctx, unsigned char *buf, size_t len, uint32_t timeout)
+{
+    recv_calls++;
+    return esp_netconn_bio_recv_timeout(ctx, buf, len, timeout);
+}
+
+static void *server_task(void *arg)
+{
+    static unsigned char buf[MBEDTLS_SSL_MAX_CONTENT_LEN];
+    int downloads = *(int *) arg;
+    struct netconn *listener, *conn;
+    ip_addr_t addr;
+    int i;
+
+    listener = netconn_new(NETCONN_TCP);
+    ip_addr_set_ip4_u32(&addr, PP_HTONL(SERVER_ADDR));
+    CHECK(netconn_bind(listener, &addr, SERVER_PORT) == ERR_OK);
+    CHECK(netconn_listen(listener) == ERR_OK);
+    sys_sem_signal(&listening);
+
+    for (i = 0; i < downloads; i++) {
+        esp_netconn_bio_t bio;
+        mbedtls_ssl_context ssl;
+        size_t sent = 0, n;
+        int ret;
+
+        if (netconn_accept(listener, &conn) != ERR_OK) {
+            CHECK(0);
+            break;
+        }
+        esp_netconn_bio_attach(&bio, conn);
+        mbedtls_ssl_init(&ssl);
+        CHECK(mbedtls_ssl_setup(&ssl, &server_conf) == 0);
+        mbedtls_ssl_set_bio(&ssl, &bio, esp_netconn_bio_send, esp_netconn_bio_recv, NULL);
+
+        CHECK(mbedtls_ssl_handshake(&ssl) == 0);
+        ret = mbedtls_ssl_read(&ssl, buf, sizeof(buf));
+        CHECK(ret == sizeof(REQUEST) - 1 && memcmp(buf, REQUEST, ret) == 0);
+
+        while (sent < DOWNLOAD_LEN) {
+            n = DOWNLOAD_LEN - sent < sizeof(buf) ? DOWNLOAD_LEN - sent : sizeof(buf);
+            for (size_t j = 0; j < n; j++) {
+                buf[j] = pattern(sent + j);
+            }
+            ret = mbedtls_ssl_write(&ssl, buf, n);
+            if (ret <= 0) {
+                CHECK(ret > 0);
+                break;
+            }
+            sent += ret;
+        }
+        CHECK(mbedtls_ssl_close_notify(&ssl) == 0);
+
+        mbedtls_ssl_free(&ssl);
+        esp_netconn_bio_free(&bio);
+    }
+
+    netconn_delete(listener);
+    return NULL;
+}
+
+/* Download through ssl, whose connection is set up; returns the tcpip
+   messages of the client */
+static unsigned long download(mbedtls_ssl_context *ssl, const char *name)
+{
+    static unsigned char buf[4096];
+    size_t received = 0;
+    double start;
+    int ret, i;
+
+    CHECK(mbedtls_ssl_handshake(ssl) == 0);
+    CHECK(mbedtls_ssl_write(ssl, (const unsigned char *) REQUEST, sizeof(REQUEST) - 1) ==
+          sizeof(REQUEST) - 1);
+
+    recv_calls = 0;
+    tcpip_msgs = 0;
+    start = now_sec();
+    while (1) {
+        ret = mbedtls_ssl_read(ssl, buf, sizeof(buf));
+        if (ret <= 0) {
+            break;
+        }
+        for (i = 0; i < ret; i++) {
+            if (buf[i] != pattern(received + i)) {
+                break;
+            }
+        }
+        CHECK(i == ret);
+        received += ret;
+    }
+    CHECK(ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY);
+    CHECK(received == DOWNLOAD_LEN);
+
+    if (!quiet) {
+        double t = now_sec() - start;
+        printf("%-8s %8.1f Mbit/s  %5.2f receive callbacks, %5.2f tcpip messages per 16 KB record\n",
+               name, received * 8 / t / 1e6,
+               recv_calls * (double) MBEDTLS_SSL_MAX_CONTENT_LEN / received,
+               tcpip_msgs * (double) MBEDTLS_SSL_MAX_CONTENT_LEN / received);
+    }
+    return tcpip_msgs;
+}
+
+static unsigned long socket_client(void)
+{
+    mbedtls_ssl_context ssl;
+    struct sockaddr_in sa;
+    unsigned long msgs;
+    int s;
+
+    s = lwip_socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(s >= 0);
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_len = sizeof(sa);
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = PP_HTONL(CLIENT_ADDR);
+    CHECK(lwip_bind_r(s, (struct sockaddr *) &sa, sizeof(sa)) == 0);
+    sa.sin_port = PP_HTONS(SERVER_PORT);
+    sa.sin_addr.s_addr = PP_HTONL(SERVER_ADDR);
+    CHECK(lwip_connect_r(s, (struct sockaddr *) &sa, sizeof(sa)) == 0);
+
+    mbedtls_ssl_init(&ssl);
+    CHECK(mbedtls_ssl_setup(&ssl, &client_conf) == 0);
+    mbedtls_ssl_set_bio(&ssl, &s, socket_send, socket_recv, NULL);
+    counting = 1;
+    msgs = download(&ssl, "sockets");
+    counting = 0;
+    mbedtls_ssl_free(&ssl);
+    lwip_close_r(s);
+    return msgs;
+}
+
+static unsigned long netconn_client(void)
+{
+    static unsigned char buf[16];
+    mbedtls_ssl_context ssl;
+    esp_netconn_bio_t bio;
+    struct netconn *conn;
+    unsigned long msgs;
+    ip_addr_t addr;
+
+    /* bound to the client address, see netsim.h */
+    conn = netconn_new(NETCONN_TCP);
+    ip_addr_set_ip4_u32(&addr, PP_HTONL(CLIENT_ADDR));
+    CHECK(netconn_bind(conn, &addr, 0) == ERR_OK);
+    ip_addr_set_ip4_u32(&addr, PP_HTONL(SERVER_ADDR));
+    CHECK(netconn_connect(conn, &addr, SERVER_PORT) == ERR_OK);
+    esp_netconn_bio_attach(&bio, conn);
+
+    mbedtls_ssl_init(&ssl);
+    CHECK(mbedtls_ssl_setup(&ssl, &client_conf) == 0);
+    mbedtls_ssl_set_bio(&ssl, &bio, esp_netconn_bio_send, counted_bio_recv, counted_bio_recv_timeout);
+
+    /* nothing to read until the request is sent */
+    CHECK(mbedtls_ssl_handshake(&ssl) == 0);
+    CHECK(mbedtls_ssl_read(&ssl, buf, sizeof(buf)) == MBEDTLS_ERR_SSL_TIMEOUT);
+
+    counting = 1;
+    msgs = download(&ssl, "netconn");
+    counting = 0;
+    mbedtls_ssl_free(&ssl);
+    esp_netconn_bio_free(&bio);
+    CHECK(bio.conn == NULL);
+    return msgs;
+}
+
+static void setup(void)
+{
+    mbedtls_x509_crt_init(&ca);
+    mbedtls_x509_crt_init(&server_crt);
+    mbedtls_pk_init(&server_key);
+    CHECK(mbedtls_x509_crt_parse(&ca, (const unsigned char *) mbedtls_test_ca_crt_ec,
+                                 mbedtls_test_ca_crt_ec_len) == 0);
+    CHECK(mbedtls_x509_crt_parse(&server_crt, (const unsigned char *) mbedtls_test_srv_crt_ec,
+                                 mbedtls_test_srv_crt_ec_len) == 0);
+    CHECK(mbedtls_pk_parse_key(&server_key, (const unsigned char *) mbedtls_test_srv_key_ec,
+                               mbedtls_test_srv_key_ec_len, NULL, 0) == 0);
+
+    mbedtls_ssl_config_init(&server_conf);
+    CHECK(mbedtls_ssl_config_defaults(&server_conf, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                      MBEDTLS_SSL_PRESET_DEFAULT) == 0);
+    mbedtls_ssl_conf_rng(&server_conf, test_rng, NULL);
+    CHECK(mbedtls_ssl_conf_own_cert(&server_conf, &server_crt, &server_key) == 0);
+
+    mbedtls_ssl_config_init(&client_conf);
+    CHECK(mbedtls_ssl_config_defaults(&client_conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                      MBEDTLS_SSL_PRESET_DEFAULT) == 0);
+    mbedtls_ssl_conf_rng(&client_conf, test_rng, NULL);
+    mbedtls_ssl_conf_authmode(&client_conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ca_chain(&client_conf, &ca, NULL);
+    /* only used with a receive callback that takes a timeout */
+    mbedtls_ssl_conf_read_timeout(&client_conf, READ_TIMEOUT);
+}
+
+static void teardown(void)
+{
+    mbedtls_ssl_config_free(&client_conf);
+    mbedtls_ssl_config_free(&server_conf);
+    mbedtls_x509_crt_free(&ca);
+    mbedtls_x509_crt_free(&server_crt);
+    mbedtls_pk_free(&server_key);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long socket_msgs, netconn_msgs;
+    int downloads = 2;
+    pthread_t server;
+    sys_sem_t sem;
+
+    quiet = argc > 1 && strcmp(argv[1], "-q") == 0;
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    sys_sem_new(&sem, 0);
+    tcpip_init(tcpip_init_done, &sem);
+    sys_arch_sem_wait(&sem, 0);
+
+    setup();
+    sys_sem_new(&listening, 0);
+    pthread_create(&server, NULL, server_task, &downloads);
+    sys_arch_sem_wait(&listening, 0);
+    socket_msgs = socket_client();
+    netconn_msgs = netconn_client();
+    /* the window goes back to the stack in larger steps */
+    CHECK(netconn_msgs < socket_msgs);
+    pthread_join(server, NULL);
+    teardown();
+
+    return failures != 0;
+}
@@ -0,0 +1,367 @@
+/*
+ * Host test for the client session cache of port/esp_session_cache.c.
+ *
+ * A client and a server of the library talk TLS 1.2 with ECDHE-ECDSA
+ * through buffers in memory. The server issues session tickets and keeps
+ * a session ID cache. The test checks that a cached session is offered
+ * and resumed, with a ticket and with a session ID, after a round trip
+ * through NVS (nvs_host.c), that the cache evicts the least recently
+ * used host, and that saving writes only the entries that changed.
+ * The Makefile also builds it with the largest configuration, which
+ * NVS must still be able to hold.
+ *
+ * Then times full and resumed handshakes; with -q only the checks are run.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "mbedtls/esp_session_cache.h"
+#include "mbedtls/ssl_cache.h"
+#include "mbedtls/ssl_ticket.h"
+#include "mbedtls/certs.h"
+
+#define HOST    "localhost"
+#define PORT    443
+
+extern unsigned nvs_host_commits;
+extern unsigned nvs_host_writes;
+
+/* One direction of the connection */
+typedef struct {
+    unsigned char data[32768];
+    size_t len;
+} pipe_t;
+
+typedef struct {
+    pipe_t *in;
+    pipe_t *out;
+} endpoint_t;
+
+static pipe_t to_server, to_client;
+static endpoint_t client_end = { &to_client, &to_server };
+static endpoint_t server_end = { &to_server, &to_client };
+
+static mbedtls_ssl_config client_conf, client_conf_no_tickets, server_conf;
+static mbedtls_x509_crt ca, server_crt;
+static mbedtls_pk_context server_key;
+static mbedtls_ssl_ticket_context ticket_ctx;
+static mbedtls_ssl_cache_context id_cache;
+
+static int failures;
+
+#define CHECK(cond) do { if (!(cond)) { \
+    fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+    failures++; } } while (0)
+
+static int test_rng(void *p_rng, unsigned char *output, size_t len)
+{
+    static unsigned int state = 0x2545f491;
+    size_t i;
+
+    (void) p_rng;
+    for (i = 0; i < len; i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        output[i] = (unsigned char) state;
+    }
+    return 0;
+}
+
+static int pipe_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    pipe_t *out = ((endpoint_t *) ctx)->out;
+
+    if (len > sizeof(out->data) - out->len) {
+        len = sizeof(out->data) - out->len;
+    }
+    if (len == 0) {
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
+    memcpy(out->data + out->len, buf, len);
+    out->len += len;
+    return len;
+}
+
+static int pipe_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    pipe_t *in = ((endpoint_t *) ctx)->in;
+
+    if (in->len == 0) {
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    }
+    if (len > in->len) {
+        len = in->len;
+    }
+    memcpy(buf, in->data, len);
+    memmove(in->data, in->data + len, in->len - len);
+    in->len -= len;
+    return len;
+}
+
+static void client_conf_setup(mbedtls_ssl_config *conf, int tickets)
+{
+    mbedtls_ssl_config_init(conf);
+    CHECK(mbedtls_ssl_config_defaults(conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                      MBEDTLS_SSL_PRESET_DEFAULT) == 0);
+    mbedtls_ssl_conf_rng(conf, test_rng, NULL);
+    mbedtls_ssl_conf_authmode(conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ca_chain(conf, &ca, NULL);
+    mbedtls_ssl_conf_session_tickets(conf, tickets);
+}
+
+static void setup(void)
+{
+    mbedtls_x509_crt_init(&ca);
+    mbedtls_x509_crt_init(&server_crt);
+    mbedtls_pk_init(&server_key);
+    CHECK(mbedtls_x509_crt_parse(&ca, (const unsigned char *) mbedtls_test_ca_crt_ec,
+                                 mbedtls_test_ca_crt_ec_len) == 0);
+    CHECK(mbedtls_x509_crt_parse(&server_crt, (const unsigned char *) mbedtls_test_srv_crt_ec,
+                                 mbedtls_test_srv_crt_ec_len) == 0);
+    CHECK(mbedtls_pk_parse_key(&server_key, (const unsigned char *) mbedtls_test_srv_key_ec,
+                               mbedtls_test_srv_key_ec_len, NULL, 0) == 0);
+
+    mbedtls_ssl_config_init(&server_conf);
+    CHECK(mbedtls_ssl_config_defaults(&server_conf, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                      MBEDTLS_SSL_PRESET_DEFAULT) == 0);
+    mbedtls_ssl_conf_rng(&server_conf, test_rng, NULL);
+    CHECK(mbedtls_ssl_conf_own_cert(&server_conf, &server_crt, &server_key) == 0);
+    mbedtls_ssl_ticket_init(&ticket_ctx);
+    CHECK(mbedtls_ssl_ticket_setup(&ticket_ctx, test_rng, NULL, MBEDTLS_CIPHER_AES_128_GCM, 86400) == 0);
+    mbedtls_ssl_conf_session_tickets_cb(&server_conf, mbedtls_ssl_ticket_write, mbedtls_ssl_ticket_parse,
+                                        &ticket_ctx);
+    mbedtls_ssl_cache_init(&id_cache);
+    mbedtls_ssl_conf_session_cache(&server_conf, &id_cache, mbedtls_ssl_cache_get, mbedtls_ssl_cache_set);
+
+    client_conf_setup(&client_conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+    client_conf_setup(&client_conf_no_tickets, MBEDTLS_SSL_SESSION_TICKETS_DISABLED);
+}
+
+static void teardown(void)
+{
+    mbedtls_ssl_config_free(&client_conf);
+    mbedtls_ssl_config_free(&client_conf_no_tickets);
+    mbedtls_ssl_config_free(&server_conf);
+    mbedtls_ssl_ticket_free(&ticket_ctx);
+    mbedtls_ssl_cache_free(&id_cache);
+    mbedtls_x509_crt_free(&ca);
+    mbedtls_x509_crt_free(&server_crt);
+    mbedtls_pk_free(&server_key);
+}
+
+/* Handshake of client, set up with conf, with a new server context.
+   Offers the session cached for HOST:PORT, if any, and returns whether
+   it did in *offered. */
+static int handshake(mbedtls_ssl_context *client, const mbedtls_ssl_config *conf, int *offered)
+{
+    mbedtls_ssl_context server;
+    int ret_client, ret_server;
+
+    to_server.len = to_client.len = 0;
+    mbedtls_ssl_init(&server);
+    if ((ret_client = mbedtls_ssl_setup(client, conf)) != 0 ||
+        (ret_client = mbedtls_ssl_set_hostname(client, HOST)) != 0 ||
+        (ret_client = mbedtls_ssl_setup(&server, &server_conf)) != 0) {
+        goto out;
+    }
+    mbedtls_ssl_set_bio(client, &client_end, pipe_send, pipe_recv, NULL);
+    mbedtls_ssl_set_bio(&server, &server_end, pipe_send, pipe_recv, NULL);
+
+    *offered = (esp_session_cache_get(HOST, PORT, client) == 0);
+    do {
+        ret_client = mbedtls_ssl_handshake(client);
+        ret_server = mbedtls_ssl_handshake(&server);
+    } while ((ret_client == MBEDTLS_ERR_SSL_WANT_READ || ret_client == 0) &&
+             (ret_server == MBEDTLS_ERR_SSL_WANT_READ || ret_server == 0) &&
+             (ret_client != 0 || ret_server != 0));
+    if (ret_client == 0 && ret_server != 0) {
+        ret_client = ret_server;
+    }
+
+ out:
+    if (ret_client != 0) {
+        fprintf(stderr, "handshake failed: -0x%04x\n", -ret_client);
+    }
+    mbedtls_ssl_free(&server);
+    return ret_client;
+}
+
+/* Connect to HOST:PORT through the cache. Returns 1 if the client offered
+   a cached session and the handshake resumed it, 0 for a full handshake,
+   -1 on errors. */
+static int connect_host(const mbedtls_ssl_config *conf)
+{
+    mbedtls_ssl_context client;
+    esp_session_cache_stats_t before, after;
+    int offered, result = -1;
+
+    mbedtls_ssl_init(&client);
+    if (handshake(&client, conf, &offered) != 0) {
+        goto out;
+    }
+    CHECK(mbedtls_ssl_get_verify_result(&client) == 0);
+
+    esp_session_cache_get_stats(&before);
+    CHECK(esp_session_cache_put(HOST, PORT, &client) == 0);
+    esp_session_cache_get_stats(&after);
+    result = (after.resumed != before.resumed);
+    CHECK(!result || offered);
+    /* a resumed handshake has no certificate, see esp_session_cache.h */
+    CHECK(result == (mbedtls_ssl_get_peer_cert(&client) == NULL));
+
+ out:
+    mbedtls_ssl_free(&client);
+    return result;
+}
+
+static void test_resumption(void)
+{
+    esp_session_cache_stats_t stats;
+    unsigned commits;
+
+    /* nothing cached: full handshake, then resumed ones with the ticket */
+    CHECK(connect_host(&client_conf) == 0);
+    CHECK(connect_host(&client_conf) == 1);
+    CHECK(connect_host(&client_conf) == 1);
+
+    /* through NVS, like across deep sleep */
+    CHECK(esp_session_cache_save(0) == ESP_OK);
+    commits = nvs_host_commits;
+    CHECK(commits == 1);
+    CHECK(esp_session_cache_save(0) == ESP_OK);
+    CHECK(nvs_host_commits == commits);
+    esp_session_cache_clear();
+    CHECK(connect_host(&client_conf) == 0);
+    CHECK(esp_session_cache_load(0) == ESP_OK);
+    CHECK(connect_host(&client_conf) == 1);
+
+    /* without tickets, by session ID */
+    esp_session_cache_clear();
+    CHECK(connect_host(&client_conf_no_tickets) == 0);
+    CHECK(connect_host(&client_conf_no_tickets) == 1);
+
+    /* the server lost the session: full handshake */
+    mbedtls_ssl_cache_free(&id_cache);
+    mbedtls_ssl_cache_init(&id_cache);
+    CHECK(connect_host(&client_conf_no_tickets) == 0);
+    CHECK(connect_host(&client_conf_no_tickets) == 1);
+
+    esp_session_cache_get_stats(&stats);
+    CHECK(stats.resumed == 5);
+    CHECK(stats.misses == 3);
+}
+
+static void test_eviction(void)
+{
+    mbedtls_ssl_context client;
+    esp_session_cache_stats_t before, after;
+    char host[ESP_SESSION_CACHE_HOST_MAX + 2];
+    int i, offered;
+
+    /* the session of any connection will do */
+    esp_session_cache_clear();
+    mbedtls_ssl_init(&client);
+    CHECK(handshake(&client, &client_conf, &offered) == 0);
+    CHECK(esp_session_cache_put(HOST, PORT, &client) == 0);
+
+    esp_session_cache_get_stats(&before);
+    for (i = 0; i <= CONFIG_MBEDTLS_CLIENT_SESSION_CACHE_ENTRIES; i++) {
+        sprintf(host, "host%d", i);
+        CHECK(esp_session_cache_put(host, PORT, &client) == 0);
+    }
+    esp_session_cache_get_stats(&after);
+    CHECK(after.evictions - before.evictions == 2);     /* HOST and host0 */
+
+    mbedtls_ssl_session_reset(&client);
+    CHECK(esp_session_cache_get(HOST, PORT, &client) == 1);
+    CHECK(esp_session_cache_get("host0", PORT, &client) == 1);
+    CHECK(esp_session_cache_get("host1", PORT, &client) == 0);
+    CHECK(esp_session_cache_get("host1", PORT + 1, &client) == 1);
+
+    memset(host, 'x', sizeof(host) - 1);
+    host[sizeof(host) - 1] = '\0';
+    CHECK(esp_session_cache_put(host, PORT, &client) == MBEDTLS_ERR_SSL_BAD_INPUT_DATA);
+
+    mbedtls_ssl_free(&client);
+}
+
+static void test_save(void)
+{
+    static unsigned char big[4096];
+    mbedtls_ssl_context client;
+    char host[ESP_SESSION_CACHE_HOST_MAX + 1];
+    unsigned writes;
+    int i, offered;
+
+    /* NVS keeps a blob within one page */
+    CHECK(nvs_set_blob(0, "big", big, sizeof(big)) == ESP_ERR_NVS_NOT_ENOUGH_SPACE);
+
+    /* every entry in use */
+    esp_session_cache_clear();
+    mbedtls_ssl_init(&client);
+    CHECK(handshake(&client, &client_conf, &offered) == 0);
+    for (i = 0; i < CONFIG_MBEDTLS_CLIENT_SESSION_CACHE_ENTRIES; i++) {
+        sprintf(host, "host%d", i);
+        CHECK(esp_session_cache_put(host, PORT, &client) == 0);
+    }
+    CHECK(esp_session_cache_save(0) == ESP_OK);
+
+    /* one entry freed: the format and that entry are written */
+    writes = nvs_host_writes;
+    esp_session_cache_remove("host0", PORT);
+    CHECK(esp_session_cache_save(0) == ESP_OK);
+    CHECK(nvs_host_writes - writes == 2);
+
+    esp_session_cache_clear();
+    CHECK(esp_session_cache_load(0) == ESP_OK);
+    mbedtls_ssl_session_reset(&client);
+    CHECK(esp_session_cache_get("host0", PORT, &client) == 1);
+    for (i = 1; i < CONFIG_MBEDTLS_CLIENT_SESSION_CACHE_ENTRIES; i++) {
+        sprintf(host, "host%d", i);
+        CHECK(esp_session_cache_get(host, PORT, &client) == 0);
+    }
+
+    mbedtls_ssl_free(&client);
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void bench(void)
+{
+    double t0, full, resumed;
+    int i, n = 20;
+
+    t0 = now_sec();
+    for (i = 0; i < n; i++) {
+        esp_session_cache_remove(HOST, PORT);
+        connect_host(&client_conf);
+    }
+    full = (now_sec() - t0) / n;
+    t0 = now_sec();
+    for (i = 0; i < n; i++) {
+        connect_host(&client_conf);
+    }
+    resumed = (now_sec() - t0) / n;
+    printf("ECDHE-ECDSA P-256 handshake, client and server: full %.2f ms, resumed %.2f ms\n",
+           full * 1e3, resumed * 1e3);
+}
+
+int main(int argc, char **argv)
+{
+    setup();
+    test_resumption();
+    test_eviction();
+    test_save();
+    if (failures == 0 && !(argc > 1 && strcmp(argv[1], "-q") == 0)) {
+        bench();
+    }
+    teardown();
+    return failures != 0;
+}
@@ -0,0 +1,393 @@
+/*
+ * Host test and heap benchmark for the TLS record buffers.
+ *
+ * Built three times, see the Makefile: test_ssl_buffers_static with the
+ * buffers mbedtls_ssl_setup() allocates for the life of the connection,
+ * test_ssl_buffers_dynamic with MBEDTLS_SSL_DYNAMIC_BUFFERS, and
+ * test_ssl_buffers_asym with a 4 KB output buffer as well.
+ *
+ * Clients and servers of the library talk TLS 1.2 with ECDHE-ECDSA
+ * through buffers in memory, with and without a negotiated maximum
+ * fragment length. Every connection echoes data of several records and
+ * renegotiates, and the dynamic builds check that the buffers of an idle
+ * connection are released.
+ *
+ * Prints the heap a client connection uses: at the most during the
+ * handshake and during the transfers, and while idle, with several
+ * connections open. With -q only the checks are run.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mbedtls/platform.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/certs.h"
+
+#define CONNECTIONS 4
+#define ECHO_LEN    10000
+
+/* One direction of a connection */
+typedef struct {
+    unsigned char data[32768];
+    size_t len;
+} pipe_t;
+
+typedef struct {
+    pipe_t *in;
+    pipe_t *out;
+} endpoint_t;
+
+typedef struct {
+    pipe_t to_server, to_client;
+    endpoint_t client_end, server_end;
+    mbedtls_ssl_context client, server;
+} connection_t;
+
+static mbedtls_ssl_config client_conf, server_conf;
+static mbedtls_x509_crt ca, server_crt;
+static mbedtls_pk_context server_key;
+
+static int failures;
+static int quiet;
+
+#define CHECK(cond) do { if (!(cond)) { \
+    fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+    failures++; } } while (0)
+
+/*
+ * Heap accounting: only the allocations made while counting is set, that
+ * is by the client side of the connections
+ */
+typedef union {
+    size_t size;
+    long double align;
+} block_t;
+
+static int counting;
+static size_t heap_now, heap_peak;
+
+static void *count_calloc(size_t n, size_t size)
+{
+    block_t *block;
+
+    if (size != 0 && n > ((size_t) -1 - sizeof(block_t)) / size) {
+        return NULL;
+    }
+    block = calloc(1, sizeof(block_t) + n * size);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->size = counting ? n * size : 0;
+    heap_now += block->size;
+    if (heap_now > heap_peak) {
+        heap_peak = heap_now;
+    }
+    return block + 1;
+}
+
+static void count_free(void *p)
+{
+    block_t *block = (block_t *) p - 1;
+
+    if (p == NULL) {
+        return;
+    }
+    heap_now -= block->size;
+    free(block);
+}
+
+static int test_rng(void *p_rng, unsigned char *output, size_t len)
+{
+    static unsigned int state = 0x2545f491;
+    size_t i;
+
+    (void) p_rng;
+    for (i = 0; i < len; i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        output[i] = (unsigned char) state;
+    }
+    return 0;
+}
+
+static int pipe_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    pipe_t *out = ((endpoint_t *) ctx)->out;
+
+    if (len > sizeof(out->data) - out->len) {
+        len = sizeof(out->data) - out->len;
+    }
+    if (len == 0) {
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
+    memcpy(out->data + out->len, buf, len);
+    out->len += len;
+    return len;
+}
+
+static int pipe_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    pipe_t *in = ((endpoint_t *) ctx)->in;
+
+    if (in->len == 0) {
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    }
+    if (len > in->len) {
+        len = in->len;
+    }
+    memcpy(buf, in->data, len);
+    memmove(in->data, in->data + len, in->len - len);
+    in->len -= len;
+    return len;
+}
+
+static void setup(void)
+{
+    mbedtls_platform_set_calloc_free(count_calloc, count_free);
+
+    mbedtls_x509_crt_init(&ca);
+    mbedtls_x509_crt_init(&server_crt);
+    mbedtls_pk_init(&server_key);
+    CHECK(mbedtls_x509_crt_parse(&ca, (const unsigned char *) mbedtls_test_ca_crt_ec,
+                                 mbedtls_test_ca_crt_ec_len) == 0);
+    CHECK(mbedtls_x509_crt_parse(&server_crt, (const unsigned char *) mbedtls_test_srv_crt_ec,
+                                 mbedtls_test_srv_crt_ec_len) == 0);
+    CHECK(mbedtls_pk_parse_key(&server_key, (const unsigned char *) mbedtls_test_srv_key_ec,
+                               mbedtls_test_srv_key_ec_len, NULL, 0) == 0);
+
+    mbedtls_ssl_config_init(&server_conf);
+    CHECK(mbedtls_ssl_config_defaults(&server_conf, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                      MBEDTLS_SSL_PRESET_DEFAULT) == 0);
+    mbedtls_ssl_conf_rng(&server_conf, test_rng, NULL);
+    mbedtls_ssl_conf_renegotiation(&server_conf, MBEDTLS_SSL_RENEGOTIATION_ENABLED);
+    CHECK(mbedtls_ssl_conf_own_cert(&server_conf, &server_crt, &server_key) == 0);
+
+    mbedtls_ssl_config_init(&client_conf);
+    CHECK(mbedtls_ssl_config_defaults(&client_conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                      MBEDTLS_SSL_PRESET_DEFAULT) == 0);
+    mbedtls_ssl_conf_rng(&client_conf, test_rng, NULL);
+    mbedtls_ssl_conf_renegotiation(&client_conf, MBEDTLS_SSL_RENEGOTIATION_ENABLED);
+    mbedtls_ssl_conf_authmode(&client_conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ca_chain(&client_conf, &ca, NULL);
+}
+
+static void teardown(void)
+{
+    mbedtls_ssl_config_free(&client_conf);
+    mbedtls_ssl_config_free(&server_conf);
+    mbedtls_x509_crt_free(&ca);
+    mbedtls_x509_crt_free(&server_crt);
+    mbedtls_pk_free(&server_key);
+}
+
+static int client_idle(const mbedtls_ssl_context *ssl)
+{
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    return ssl->in_buf == NULL && ssl->out_buf == NULL;
+#else
+    return 1;
+#endif
+}
+
+static int open_connection(connection_t *c)
+{
+    int ret_client, ret_server;
+
+    memset(c, 0, sizeof(*c));
+    c->client_end.in = &c->to_client;
+    c->client_end.out = &c->to_server;
+    c->server_end.in = &c->to_server;
+    c->server_end.out = &c->to_client;
+    mbedtls_ssl_init(&c->client);
+    mbedtls_ssl_init(&c->server);
+
+    counting = 1;
+    ret_client = mbedtls_ssl_setup(&c->client, &client_conf);
+    if (ret_client == 0) {
+        ret_client = mbedtls_ssl_set_hostname(&c->client, "localhost");
+    }
+    counting = 0;
+    if (ret_client != 0 || (ret_server = mbedtls_ssl_setup(&c->server, &server_conf)) != 0) {
+        return -1;
+    }
+    mbedtls_ssl_set_bio(&c->client, &c->client_end, pipe_send, pipe_recv, NULL);
+    mbedtls_ssl_set_bio(&c->server, &c->server_end, pipe_send, pipe_recv, NULL);
+
+    do {
+        counting = 1;
+        ret_client = mbedtls_ssl_handshake(&c->client);
+        counting = 0;
+        ret_server = mbedtls_ssl_handshake(&c->server);
+    } while ((ret_client == MBEDTLS_ERR_SSL_WANT_READ || ret_client == 0) &&
+             (ret_server == MBEDTLS_ERR_SSL_WANT_READ || ret_server == 0) &&
+             (ret_client != 0 || ret_server != 0));
+    if (ret_client != 0 || ret_server != 0) {
+        fprintf(stderr, "handshake failed: -0x%04x -0x%04x\n", -ret_client, -ret_server);
+        return -1;
+    }
+    CHECK(mbedtls_ssl_get_verify_result(&c->client) == 0);
+    CHECK(client_idle(&c->client));
+    return 0;
+}
+
+static void close_connection(connection_t *c)
+{
+    counting = 1;
+    mbedtls_ssl_free(&c->client);
+    counting = 0;
+    mbedtls_ssl_free(&c->server);
+}
+
+/* Write all of len bytes, counting the client's allocations */
+static int write_all(mbedtls_ssl_context *ssl, const unsigned char *buf, size_t len, int client)
+{
+    size_t done = 0;
+    int ret;
+
+    while (done < len) {
+        counting = client;
+        ret = mbedtls_ssl_write(ssl, buf + done, len - done);
+        counting = 0;
+        if (ret <= 0) {
+            fprintf(stderr, "write failed: -0x%04x\n", -ret);
+            return -1;
+        }
+        CHECK((size_t) ret <= mbedtls_ssl_get_max_frag_len(ssl));
+        done += ret;
+    }
+    return 0;
+}
+
+/* Read exactly len bytes, in pieces of various sizes */
+static int read_all(mbedtls_ssl_context *ssl, unsigned char *buf, size_t len, int client)
+{
+    size_t done = 0, piece = 1000;
+    int ret;
+
+    while (done < len) {
+        counting = client;
+        ret = mbedtls_ssl_read(ssl, buf + done, piece < len - done ? piece : len - done);
+        counting = 0;
+        if (ret <= 0) {
+            fprintf(stderr, "read failed: -0x%04x\n", -ret);
+            return -1;
+        }
+        done += ret;
+        piece = piece * 3 % 1777 + 1;
+    }
+    return 0;
+}
+
+/* The client sends ECHO_LEN bytes, the server sends them back */
+static void echo(connection_t *c, unsigned int seed)
+{
+    static unsigned char sent[ECHO_LEN], at_server[ECHO_LEN], received[ECHO_LEN];
+    size_t i;
+
+    for (i = 0; i < sizeof(sent); i++) {
+        sent[i] = (unsigned char) (i * 7 + seed);
+    }
+    CHECK(write_all(&c->client, sent, sizeof(sent), 1) == 0);
+    CHECK(read_all(&c->server, at_server, sizeof(at_server), 0) == 0);
+    CHECK(memcmp(sent, at_server, sizeof(sent)) == 0);
+    CHECK(write_all(&c->server, at_server, sizeof(at_server), 0) == 0);
+    CHECK(read_all(&c->client, received, sizeof(received), 1) == 0);
+    CHECK(memcmp(sent, received, sizeof(sent)) == 0);
+    CHECK(client_idle(&c->client));
+}
+
+/* The client renegotiates, with the server reading */
+static void renegotiate(connection_t *c)
+{
+    unsigned char byte;
+    int ret_client, ret_server;
+
+    do {
+        counting = 1;
+        ret_client = mbedtls_ssl_renegotiate(&c->client);
+        counting = 0;
+        ret_server = mbedtls_ssl_read(&c->server, &byte, 1);
+    } while ((ret_client == MBEDTLS_ERR_SSL_WANT_READ || ret_client == 0) &&
+             ret_server == MBEDTLS_ERR_SSL_WANT_READ &&
+             (ret_client != 0 || c->server.state != MBEDTLS_SSL_HANDSHAKE_OVER));
+    CHECK(ret_client == 0);
+    CHECK(ret_server == MBEDTLS_ERR_SSL_WANT_READ);
+    CHECK(c->server.state == MBEDTLS_SSL_HANDSHAKE_OVER);
+}
+
+static void run(const char *name, unsigned char mfl_code)
+{
+    static connection_t connections[CONNECTIONS];
+    size_t base, handshake_peak, transfer_peak, idle;
+    int i;
+
+    CHECK(mbedtls_ssl_conf_max_frag_len(&client_conf, mfl_code) == 0);
+
+    /* one connection at a time for the peaks */
+    base = heap_peak = heap_now;
+    if (open_connection(&connections[0]) != 0) {
+        failures++;
+        return;
+    }
+    handshake_peak = heap_peak - base;
+
+    heap_peak = heap_now;
+    echo(&connections[0], 1);
+    transfer_peak = heap_peak - base;
+
+    /* which needs full size buffers again, and keeps the record counters */
+    renegotiate(&connections[0]);
+    heap_peak = heap_now;
+    echo(&connections[0], 2);
+    if (heap_peak - base > transfer_peak) {
+        transfer_peak = heap_peak - base;
+    }
+
+    /* then all of them, idle */
+    for (i = 1; i < CONNECTIONS; i++) {
+        if (open_connection(&connections[i]) != 0) {
+            failures++;
+            while (--i >= 0) {
+                close_connection(&connections[i]);
+            }
+            return;
+        }
+        echo(&connections[i], i);
+    }
+    idle = (heap_now - base) / CONNECTIONS;
+
+    for (i = 0; i < CONNECTIONS; i++) {
+        close_connection(&connections[i]);
+    }
+    CHECK(heap_now == base);
+
+    if (!quiet) {
+        printf("%-8s in %5d, out %5d, %-8s heap per client connection: "
+               "handshake peak %6zu, transfer peak %6zu, idle %6zu\n",
+               name, MBEDTLS_SSL_IN_CONTENT_LEN, MBEDTLS_SSL_OUT_CONTENT_LEN,
+               mfl_code == MBEDTLS_SSL_MAX_FRAG_LEN_NONE ? "no MFL," : "MFL 2K,",
+               handshake_peak, transfer_peak, idle);
+    }
+
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    /* idle connections have no buffers, transfers no full size ones with a small MFL */
+    CHECK(idle + MBEDTLS_SSL_IN_CONTENT_LEN + MBEDTLS_SSL_OUT_CONTENT_LEN < handshake_peak);
+    if (mfl_code != MBEDTLS_SSL_MAX_FRAG_LEN_NONE) {
+        CHECK(transfer_peak < handshake_peak);
+    }
+#endif
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = BUFFERS_NAME;
+
+    quiet = argc > 1 && strcmp(argv[1], "-q") == 0;
+    setup();
+    run(name, MBEDTLS_SSL_MAX_FRAG_LEN_NONE);
+    run(name, MBEDTLS_SSL_MAX_FRAG_LEN_2048);
+    teardown();
+    return failures != 0;
+}
@@ -36,8 +36,14 @@ esp_err_t Page::load(uint32_t sectorNumber)
     mUsedEntryCount = 0;
     mErasedEntryCount = 0;
 
+    // read the entry state table along with the header, mLoadEntryTable
+    // uses it if the page has data
     Header header;
-    auto rc = spi_flash_read(mBaseAddress, &header, sizeof(header));
+    const spi_flash_read_req_t reqs[] = {
+        { mBaseAddress, &header, sizeof(header) },
+        { mBaseAddress + ENTRY_TABLE_OFFSET, mEntryTable.data(), mEntryTable.byteSize() },
+    };
+    auto rc = spi_flash_read_batch(reqs, sizeof(reqs) / sizeof(reqs[0]));
     if (rc != ESP_OK) {
         mState = PageState::INVALID;
         return rc;
@@ -425,18 +431,7 @@ esp_err_t Page::moveItem(Page& other)
 
 esp_err_t Page::mLoadEntryTable()
 {
-    // for states where we actually care about data in the page, read entry state table
-    if (mState == PageState::ACTIVE ||
-            mState == PageState::FULL ||
-            mState == PageState::FREEING) {
-        auto rc = spi_flash_read(mBaseAddress + ENTRY_TABLE_OFFSET, mEntryTable.data(),
-                                 mEntryTable.byteSize());
-        if (rc != ESP_OK) {
-            mState = PageState::INVALID;
-            return rc;
-        }
-    }
-
+    // entry state table has been read by load()
     mErasedEntryCount = 0;
     mUsedEntryCount = 0;
     for (size_t i = 0; i < ENTRY_COUNT; ++i) {
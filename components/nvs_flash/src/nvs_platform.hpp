@@ -18,6 +18,7 @@
 #ifdef ESP_PLATFORM
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "esp_spi_flash.h"
 
 namespace nvs
 {
@@ -30,10 +31,12 @@ public:
         if (mSemaphore) {
             xSemaphoreTake(mSemaphore, portMAX_DELAY);
         }
+        mFlashCaller = spi_flash_caller_begin(SPI_FLASH_CALLER_NVS);
     }
 
     ~Lock()
     {
+        spi_flash_caller_end(mFlashCaller);
         if (mSemaphore) {
             xSemaphoreGive(mSemaphore);
         }
@@ -60,6 +63,9 @@ public:
     }
 
     static SemaphoreHandle_t mSemaphore;
+
+private:
+    spi_flash_caller_t mFlashCaller;
 };
 } // namespace nvs
 
@@ -61,6 +61,18 @@ esp_err_t spi_flash_read(size_t src_addr, void *des_addr, size_t size)
     return ESP_OK;
 }
 
+esp_err_t spi_flash_read_batch(const spi_flash_read_req_t *reqs, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        auto err = spi_flash_read(reqs[i].src, reqs[i].dest, reqs[i].size);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    return ESP_OK;
+}
+
 // timing data for ESP8266, 160MHz CPU frequency, 80MHz flash requency
 // all values in microseconds
 // values are for block sizes starting at 4 bytes and going up to 4096 bytes
@@ -40,5 +40,15 @@ void spi_flash_disable_interrupts_caches_and_other_cpu();
 // Enable cache, enable interrupts (to be added in future), resume scheduler
 void spi_flash_enable_interrupts_caches_and_other_cpu();
 
+// Flash in [addr, addr + size) has been written or erased: unused mappings
+// of it kept by spi_flash_munmap go (flash_mmap.c)
+void spi_flash_mmap_flash_changed(size_t addr, size_t size);
+
+#if CONFIG_SPI_FLASH_ENABLE_COUNTERS
+// spi_flash_mmap call which started at CCOUNT ts_begin and had the caches
+// disabled for guard_time us, for the operation counters (flash_ops.c)
+void spi_flash_mmap_counted(uint32_t ts_begin, uint32_t guard_time, size_t size);
+#endif
+
 
 #endif //ESP_SPI_FLASH_CACHE_UTILS_H
@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
@@ -31,14 +32,10 @@
 #include "esp_log.h"
 #include "cache_utils.h"
 
-#ifndef NDEBUG
-// Enable built-in checks in queue.h in debug builds
-#define INVARIANTS
-#endif
-#include "rom/queue.h"
 
 #define REGIONS_COUNT 4
 #define PAGES_PER_REGION 64
+#define PAGES_COUNT (REGIONS_COUNT * PAGES_PER_REGION)
 #define FLASH_PAGE_SIZE 0x10000
 #define INVALID_ENTRY_VAL 0x100
 #define VADDR0_START_ADDR 0x3F400000
@@ -46,24 +43,63 @@
 #define VADDR1_FIRST_USABLE_ADDR 0x400D0000
 #define PRO_IRAM0_FIRST_USABLE_PAGE ((VADDR1_FIRST_USABLE_ADDR - VADDR1_START_ADDR) / FLASH_PAGE_SIZE + 64)
 
+/* Handles are (sequence number << 8) | (entry index + 1), so that
+   spi_flash_munmap finds the entry straight away. Every handle holds a
+   reference to its pages, so the table size also keeps the uint8_t page
+   reference counts from overflowing. */
+#define MMAP_MAX_HANDLES 128
+#define HANDLE_INDEX(handle) (((handle) & 0xff) - 1)
 
-typedef struct mmap_entry_{
-    uint32_t handle;
-    int page;
-    int count;
-    LIST_ENTRY(mmap_entry_) entries;
-} mmap_entry_t;
+_Static_assert(MMAP_MAX_HANDLES + 1 <= UINT8_MAX, "entry index and page refcnt must fit in 8 bits");
 
+typedef struct {
+    uint32_t handle;    // 0 if the entry is free
+    uint16_t page;
+    uint16_t count;
+} mmap_entry_t;
 
-static LIST_HEAD(mmap_entries_head, mmap_entry_) s_mmap_entries_head =
-        LIST_HEAD_INITIALIZER(s_mmap_entries_head);
-static uint8_t s_mmap_page_refcnt[REGIONS_COUNT * PAGES_PER_REGION] = {0};
+static mmap_entry_t s_mmap_entries[MMAP_MAX_HANDLES];
+static uint32_t s_mmap_entries_free[MMAP_MAX_HANDLES / 32];
 static uint32_t s_mmap_last_handle = 0;
 
+/* Pages keep their mapping after the last handle is unmapped, so that
+   mapping the same flash again only takes a look at s_mmap_page_paddr.
+   A page is used if it has references, valid if s_mmap_page_paddr holds
+   what the MMU table maps there. Flash writes make the unused pages over
+   the flash written invalid. */
+static uint8_t s_mmap_page_refcnt[PAGES_COUNT] = {0};
+static uint16_t s_mmap_page_paddr[PAGES_COUNT];
+static uint32_t s_mmap_page_used[PAGES_COUNT / 32];
+static uint32_t s_mmap_page_valid[PAGES_COUNT / 32];
+static bool s_mmap_flush_cache;         // pages were made invalid
+static bool s_mmap_initialized;
+
+static spi_flash_mmap_counters_t s_mmap_counters;
+
+/* Bookkeeping is done with this held, MMU table changes with the caches
+   and the other CPU disabled as well */
+static portMUX_TYPE s_mmap_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+static inline bool page_bit(const uint32_t* bits, int page)
+{
+    return (bits[page / 32] & (1u << (page % 32))) != 0;
+}
+
+static inline void set_page_bit(uint32_t* bits, int page, bool value)
+{
+    if (value) {
+        bits[page / 32] |= 1u << (page % 32);
+    } else {
+        bits[page / 32] &= ~(1u << (page % 32));
+    }
+}
 
 static void IRAM_ATTR spi_flash_mmap_init()
 {
-    for (int i = 0; i < REGIONS_COUNT * PAGES_PER_REGION; ++i) {
+    for (int i = 0; i < MMAP_MAX_HANDLES / 32; ++i) {
+        s_mmap_entries_free[i] = UINT32_MAX;
+    }
+    for (int i = 0; i < PAGES_COUNT; ++i) {
         uint32_t entry_pro = DPORT_PRO_FLASH_MMU_TABLE[i];
         uint32_t entry_app = DPORT_APP_FLASH_MMU_TABLE[i];
         if (entry_pro != entry_app) {
@@ -71,29 +107,133 @@ static void IRAM_ATTR spi_flash_mmap_init()
             entry_pro = 0;
             DPORT_PRO_FLASH_MMU_TABLE[i] = 0;
         }
+        s_mmap_page_paddr[i] = INVALID_ENTRY_VAL;
         if ((entry_pro & 0x100) == 0 && (i == 0 || i == PRO_IRAM0_FIRST_USABLE_PAGE || entry_pro != 0)) {
+            // mapped by the app itself, stays mapped
             s_mmap_page_refcnt[i] = 1;
+            s_mmap_page_paddr[i] = entry_pro;
+            set_page_bit(s_mmap_page_used, i, true);
+            set_page_bit(s_mmap_page_valid, i, true);
+        }
+    }
+    s_mmap_initialized = true;
+}
+
+// pages [start, start + count) map the flash pages from phys_page on
+static bool IRAM_ATTR range_mapped(int start, int count, int phys_page)
+{
+    for (int i = 0; i < count; ++i) {
+        if (!page_bit(s_mmap_page_valid, start + i) || s_mmap_page_paddr[start + i] != phys_page + i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// pages [start, start + count) are unused, or used with the right mapping
+static bool IRAM_ATTR range_usable(int start, int count, int phys_page)
+{
+    for (int i = 0; i < count; ++i) {
+        if (page_bit(s_mmap_page_used, start + i) && s_mmap_page_paddr[start + i] != phys_page + i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// first count pages in [begin, end) neither used nor valid, going through
+// the bitmaps a word at a time where it can
+static int IRAM_ATTR find_fresh_range(int begin, int end, int count)
+{
+    int run = 0;
+    for (int i = begin; i < end; ++i) {
+        uint32_t taken = s_mmap_page_used[i / 32] | s_mmap_page_valid[i / 32];
+        if (i % 32 == 0 && i + 32 <= end) {
+            if (taken == 0 && run + 32 < count) {
+                run += 32;
+                i += 31;
+                continue;
+            }
+            if (taken == UINT32_MAX) {
+                run = 0;
+                i += 31;
+                continue;
+            }
+        }
+        if (taken & (1u << (i % 32))) {
+            run = 0;
+        } else if (++run == count) {
+            return i - count + 1;
+        }
+    }
+    return -1;
+}
+
+// Find pages for the mapping: pages which already map this flash, which
+// need no MMU changes; or else pages which map nothing, to keep other
+// mappings around; or else unused pages, or used ones which happen to map
+// the right flash page.
+static int IRAM_ATTR find_range(int begin, int end, int count, int phys_page, bool* hit)
+{
+    int start;
+    *hit = true;
+    for (start = begin; start <= end - count; ++start) {
+        if (s_mmap_page_paddr[start] == phys_page && range_mapped(start, count, phys_page)) {
+            return start;
+        }
+    }
+    *hit = false;
+    start = find_fresh_range(begin, end, count);
+    if (start >= 0) {
+        return start;
+    }
+    for (start = begin; start <= end - count; ++start) {
+        if (range_usable(start, count, phys_page)) {
+            return start;
         }
     }
+    return -1;
+}
+
+static int IRAM_ATTR alloc_entry()
+{
+    for (int i = 0; i < MMAP_MAX_HANDLES / 32; ++i) {
+        if (s_mmap_entries_free[i] != 0) {
+            int index = i * 32 + __builtin_ctz(s_mmap_entries_free[i]);
+            s_mmap_entries_free[i] &= ~(1u << (index % 32));
+            return index;
+        }
+    }
+    return -1;
+}
+
+static void IRAM_ATTR free_entry(int index)
+{
+    s_mmap_entries[index].handle = 0;
+    s_mmap_entries_free[index / 32] |= 1u << (index % 32);
 }
 
 esp_err_t IRAM_ATTR spi_flash_mmap(uint32_t src_addr, size_t size, spi_flash_mmap_memory_t memory,
                          const void** out_ptr, spi_flash_mmap_handle_t* out_handle)
 {
-    esp_err_t ret;
-    mmap_entry_t* new_entry = (mmap_entry_t*) malloc(sizeof(mmap_entry_t));
-    if (new_entry == 0) {
-        return ESP_ERR_NO_MEM;
-    }
+    *out_handle = 0;
+    *out_ptr = NULL;
     if (src_addr & 0xffff) {
         return ESP_ERR_INVALID_ARG;
     }
-    if (src_addr + size > g_rom_flashchip.chip_size) {
+    if (size == 0 || src_addr + size > g_rom_flashchip.chip_size) {
         return ESP_ERR_INVALID_ARG;
     }
-    spi_flash_disable_interrupts_caches_and_other_cpu();
-    if (s_mmap_page_refcnt[0] == 0) {
-        spi_flash_mmap_init();
+#if CONFIG_SPI_FLASH_ENABLE_COUNTERS
+    uint32_t ts_begin = xthal_get_ccount();
+    uint32_t guard_time = 0;
+#endif
+    if (!s_mmap_initialized) {
+        spi_flash_disable_interrupts_caches_and_other_cpu();
+        if (!s_mmap_initialized) {
+            spi_flash_mmap_init();
+        }
+        spi_flash_enable_interrupts_caches_and_other_cpu();
     }
     // figure out the memory region where we should look for pages
     int region_begin;   // first page to check
@@ -106,109 +246,161 @@ esp_err_t IRAM_ATTR spi_flash_mmap(uint32_t src_addr, size_t size, spi_flash_mma
         region_addr = VADDR0_START_ADDR;
     } else {
         // only part of VAddr1 is usable, so adjust for that
-        region_begin = VADDR1_FIRST_USABLE_ADDR;
+        region_begin = PRO_IRAM0_FIRST_USABLE_PAGE;
         region_size = 3 * 64 - region_begin;
         region_addr = VADDR1_FIRST_USABLE_ADDR;
     }
     // region which should be mapped
     int phys_page = src_addr / FLASH_PAGE_SIZE;
     int page_count = (size + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE;
-    // The following part searches for a range of MMU entries which can be used.
-    // Algorithm is essentially naïve strstr algorithm, except that unused MMU
-    // entries are treated as wildcards.
-    int start;
-    int end = region_begin + region_size - page_count;
-    for (start = region_begin; start < end; ++start) {
-        int page = phys_page;
-        int pos;
-        for (pos = start; pos < start + page_count; ++pos, ++page) {
-            int table_val = (int) DPORT_PRO_FLASH_MMU_TABLE[pos];
-            uint8_t refcnt = s_mmap_page_refcnt[pos];
-            if (refcnt != 0 && table_val != page) {
-                break;
-            }
-        }
-        // whole mapping range matched, bail out
-        if (pos - start == page_count) {
-            break;
+
+    // Search with the caches enabled, and take the pages. An existing
+    // mapping is used right away, otherwise the MMU table is changed below.
+    bool hit;
+    bool flush = false;
+    portENTER_CRITICAL(&s_mmap_spinlock);
+    int start = find_range(region_begin, region_begin + region_size, page_count, phys_page, &hit);
+    int index = (start >= 0) ? alloc_entry() : -1;
+    if (index < 0) {
+        portEXIT_CRITICAL(&s_mmap_spinlock);
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = start; i < start + page_count; ++i) {
+        if (!hit && s_mmap_page_refcnt[i] == 0) {
+            // stale lines of the previous mapping must go from the cache
+            flush |= page_bit(s_mmap_page_valid, i);
+            set_page_bit(s_mmap_page_valid, i, false);
+            s_mmap_page_paddr[i] = INVALID_ENTRY_VAL;
         }
+        ++s_mmap_page_refcnt[i];
+        set_page_bit(s_mmap_page_used, i, true);
     }
-    // checked all the region(s) and haven't found anything?
-    if (start == end) {
-        *out_handle = 0;
-        *out_ptr = NULL;
-        ret = ESP_ERR_NO_MEM;
+    s_mmap_entries[index].page = start;
+    s_mmap_entries[index].count = page_count;
+    s_mmap_entries[index].handle = (++s_mmap_last_handle << 8) | (index + 1);
+    *out_handle = s_mmap_entries[index].handle;
+    if (hit) {
+        s_mmap_counters.hits++;
     } else {
+        s_mmap_counters.misses++;
+    }
+    portEXIT_CRITICAL(&s_mmap_spinlock);
+
+    if (!hit) {
         // set up mapping using pages [start, start + page_count)
+        spi_flash_disable_interrupts_caches_and_other_cpu();
+#if CONFIG_SPI_FLASH_ENABLE_COUNTERS
+        uint32_t ts_guard = xthal_get_ccount();
+#endif
+        // Take the flag only here: a flush pending for pages invalidated by
+        // flash writes is then done before any other mapping can use them.
+        portENTER_CRITICAL(&s_mmap_spinlock);
+        flush |= s_mmap_flush_cache;
+        s_mmap_flush_cache = false;
+        portEXIT_CRITICAL(&s_mmap_spinlock);
         uint32_t entry_val = (uint32_t) phys_page;
         for (int i = start; i != start + page_count; ++i, ++entry_val) {
-            // sanity check: we won't reconfigure entries with non-zero reference count
-            assert(s_mmap_page_refcnt[i] == 0 ||
-                    (DPORT_PRO_FLASH_MMU_TABLE[i] == entry_val &&
-                     DPORT_APP_FLASH_MMU_TABLE[i] == entry_val));
-            if (s_mmap_page_refcnt[i] == 0) {
-                DPORT_PRO_FLASH_MMU_TABLE[i] = entry_val;
-                DPORT_APP_FLASH_MMU_TABLE[i] = entry_val;
-            }
-            ++s_mmap_page_refcnt[i];
+            DPORT_PRO_FLASH_MMU_TABLE[i] = entry_val;
+            DPORT_APP_FLASH_MMU_TABLE[i] = entry_val;
         }
+        if (flush) {
+            Cache_Flush(0);
+#ifndef CONFIG_FREERTOS_UNICORE
+            Cache_Flush(1);
+#endif
+        }
+#if CONFIG_SPI_FLASH_ENABLE_COUNTERS
+        guard_time = (xthal_get_ccount() - ts_guard) / (XT_CLOCK_FREQ / 1000000);
+#endif
+        spi_flash_enable_interrupts_caches_and_other_cpu();
 
-        LIST_INSERT_HEAD(&s_mmap_entries_head, new_entry, entries);
-        new_entry->page = start;
-        new_entry->count = page_count;
-        new_entry->handle = ++s_mmap_last_handle;
-        *out_handle = new_entry->handle;
-        *out_ptr = (void*) (region_addr + start * FLASH_PAGE_SIZE);
-        ret = ESP_OK;
-    }
-    spi_flash_enable_interrupts_caches_and_other_cpu();
-    if (*out_ptr == NULL) {
-        free(new_entry);
+        portENTER_CRITICAL(&s_mmap_spinlock);
+        entry_val = (uint32_t) phys_page;
+        for (int i = start; i != start + page_count; ++i, ++entry_val) {
+            s_mmap_page_paddr[i] = entry_val;
+            set_page_bit(s_mmap_page_valid, i, true);
+        }
+        portEXIT_CRITICAL(&s_mmap_spinlock);
     }
-    return ret;
+    *out_ptr = (void*) (region_addr + (start - region_begin) * FLASH_PAGE_SIZE);
+#if CONFIG_SPI_FLASH_ENABLE_COUNTERS
+    spi_flash_mmap_counted(ts_begin, guard_time, page_count * FLASH_PAGE_SIZE);
+#endif
+    return ESP_OK;
 }
 
 void IRAM_ATTR spi_flash_munmap(spi_flash_mmap_handle_t handle)
 {
-    spi_flash_disable_interrupts_caches_and_other_cpu();
-    mmap_entry_t* it;
-    // look for handle in linked list
-    for (it = LIST_FIRST(&s_mmap_entries_head); it != NULL; it = LIST_NEXT(it, entries)) {
-        if (it->handle == handle) {
-            // for each page, decrement reference counter
-            // if reference count is zero, disable MMU table entry to
-            // facilitate debugging of use-after-free conditions
-            for (int i = it->page; i < it->page + it->count; ++i) {
-                assert(s_mmap_page_refcnt[i] > 0);
-                if (--s_mmap_page_refcnt[i] == 0) {
-                    DPORT_PRO_FLASH_MMU_TABLE[i] = INVALID_ENTRY_VAL;
-                    DPORT_APP_FLASH_MMU_TABLE[i] = INVALID_ENTRY_VAL;
-                }
+    int index = HANDLE_INDEX(handle);
+    portENTER_CRITICAL(&s_mmap_spinlock);
+    bool valid = index >= 0 && index < MMAP_MAX_HANDLES && s_mmap_entries[index].handle == handle;
+    if (valid) {
+        // for each page, decrement reference counter. The page keeps its
+        // mapping, for spi_flash_mmap to find again.
+        mmap_entry_t* it = &s_mmap_entries[index];
+        for (int i = it->page; i < it->page + it->count; ++i) {
+            assert(s_mmap_page_refcnt[i] > 0);
+            if (--s_mmap_page_refcnt[i] == 0) {
+                set_page_bit(s_mmap_page_used, i, false);
             }
-            LIST_REMOVE(it, entries);
-            break;
         }
+        free_entry(index);
     }
-    spi_flash_enable_interrupts_caches_and_other_cpu();
-    if (it == NULL) {
+    portEXIT_CRITICAL(&s_mmap_spinlock);
+    if (!valid) {
         assert(0 && "invalid handle, or handle already unmapped");
     }
-    free(it);
+}
+
+void IRAM_ATTR spi_flash_mmap_flash_changed(size_t addr, size_t size)
+{
+    uint32_t first = addr / FLASH_PAGE_SIZE;
+    uint32_t last = (addr + size - 1) / FLASH_PAGE_SIZE;
+    if (size == 0) {
+        return;
+    }
+    portENTER_CRITICAL(&s_mmap_spinlock);
+    for (int w = 0; w < PAGES_COUNT / 32; ++w) {
+        // unused pages with a mapping
+        uint32_t cached = s_mmap_page_valid[w] & ~s_mmap_page_used[w];
+        while (cached != 0) {
+            int i = w * 32 + __builtin_ctz(cached);
+            cached &= cached - 1;
+            if (s_mmap_page_paddr[i] >= first && s_mmap_page_paddr[i] <= last) {
+                set_page_bit(s_mmap_page_valid, i, false);
+                s_mmap_page_paddr[i] = INVALID_ENTRY_VAL;
+                s_mmap_flush_cache = true;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&s_mmap_spinlock);
+}
+
+void spi_flash_mmap_get_counters(spi_flash_mmap_counters_t* counters)
+{
+    portENTER_CRITICAL(&s_mmap_spinlock);
+    *counters = s_mmap_counters;
+    portEXIT_CRITICAL(&s_mmap_spinlock);
 }
 
 void spi_flash_mmap_dump()
 {
-    if (s_mmap_page_refcnt[0] == 0) {
+    if (!s_mmap_initialized) {
         spi_flash_mmap_init();
     }
-    mmap_entry_t* it;
-    for (it = LIST_FIRST(&s_mmap_entries_head); it != NULL; it = LIST_NEXT(it, entries)) {
-        printf("handle=%d page=%d count=%d\n", it->handle, it->page, it->count);
+    for (int i = 0; i < MMAP_MAX_HANDLES; ++i) {
+        mmap_entry_t* it = &s_mmap_entries[i];
+        if (it->handle != 0) {
+            printf("handle=%d page=%d count=%d\n", it->handle, it->page, it->count);
+        }
     }
-    for (int i = 0; i < REGIONS_COUNT * PAGES_PER_REGION; ++i) {
+    for (int i = 0; i < PAGES_COUNT; ++i) {
         if (s_mmap_page_refcnt[i] != 0) {
             printf("page %d: refcnt=%d paddr=%d\n",
                     i, (int) s_mmap_page_refcnt[i], DPORT_PRO_FLASH_MMU_TABLE[i]);
+        } else if (page_bit(s_mmap_page_valid, i)) {
+            printf("page %d: unused paddr=%d\n", i, s_mmap_page_paddr[i]);
         }
     }
+    printf("hits=%d misses=%d\n", s_mmap_counters.hits, s_mmap_counters.misses);
 }
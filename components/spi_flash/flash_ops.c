@@ -35,27 +35,70 @@
 /* bytes erased by SPIEraseBlock() ROM function */
 #define BLOCK_ERASE_SIZE 65536
 
+/* about as long as reading this many bytes takes the command and address
+   of a read, for packing small reads in spi_flash_read_batch */
+#define READ_COMMAND_COST 16
+
+/* requests spi_flash_read_batch reads with the caches disabled once at most,
+   copied to the stack first */
+#define READ_BATCH_SIZE 8
+
 #if CONFIG_SPI_FLASH_ENABLE_COUNTERS
 static const char* TAG = "spi_flash";
 static spi_flash_counters_t s_flash_stats;
+static portMUX_TYPE s_flash_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Tasks between spi_flash_caller_begin and spi_flash_caller_end. Operations
+   of tasks which don't fit count for SPI_FLASH_CALLER_OTHER. */
+#define CALLER_TASKS 8
+static struct {
+    TaskHandle_t task;
+    spi_flash_caller_t caller;
+} s_caller_tasks[CALLER_TASKS];
+
+static void spi_flash_counter_stop(spi_flash_counter_t* counter, uint32_t ts_begin);
+static void spi_flash_counter_guard(spi_flash_counter_t* counter, uint32_t guard_time, uint32_t bytes);
 
 #define COUNTER_START()     uint32_t ts_begin = xthal_get_ccount()
-#define COUNTER_STOP(counter)  \
-    do{ \
-        s_flash_stats.counter.count++; \
-        s_flash_stats.counter.time += (xthal_get_ccount() - ts_begin) / (XT_CLOCK_FREQ / 1000000); \
-    } while(0)
+#define COUNTER_STOP(counter)  spi_flash_counter_stop(&s_flash_stats.counter, ts_begin)
 
 #define COUNTER_ADD_BYTES(counter, size) \
     do { \
         s_flash_stats.counter.bytes += size; \
     } while (0)
 
+/* Caches and the other CPU are disabled between GUARD_START and GUARD_END.
+   The flash op lock is held in between, so one start time is enough, and
+   the bytes added meanwhile are those of the operation in progress. */
+static uint32_t s_guard_begin;
+static uint32_t s_guard_bytes;
+
+#define GUARD_BYTES() \
+    (s_flash_stats.read.bytes + s_flash_stats.write.bytes + s_flash_stats.erase.bytes)
+
+#define GUARD_START() \
+    do { \
+        spi_flash_disable_interrupts_caches_and_other_cpu(); \
+        s_guard_begin = xthal_get_ccount(); \
+        s_guard_bytes = GUARD_BYTES(); \
+    } while (0)
+
+#define GUARD_END(counter) \
+    do { \
+        uint32_t guard_time = (xthal_get_ccount() - s_guard_begin) / (XT_CLOCK_FREQ / 1000000); \
+        uint32_t guard_bytes = GUARD_BYTES() - s_guard_bytes; \
+        spi_flash_enable_interrupts_caches_and_other_cpu(); \
+        spi_flash_counter_guard(&s_flash_stats.counter, guard_time, guard_bytes); \
+    } while (0)
+
 #else
 #define COUNTER_START()
 #define COUNTER_STOP(counter)
 #define COUNTER_ADD_BYTES(counter, size)
 
+#define GUARD_START()       spi_flash_disable_interrupts_caches_and_other_cpu()
+#define GUARD_END(counter)  spi_flash_enable_interrupts_caches_and_other_cpu()
+
 #endif //CONFIG_SPI_FLASH_ENABLE_COUNTERS
 
 static esp_err_t spi_flash_translate_rc(SpiFlashOpResult rc);
@@ -91,7 +134,40 @@ esp_err_t IRAM_ATTR spi_flash_erase_sector(size_t sec)
     return spi_flash_erase_range(sec * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE);
 }
 
-esp_err_t IRAM_ATTR spi_flash_erase_range(uint32_t start_addr, uint32_t size)
+/* Erase one 64KB block or one sector at *sector, with caches and the other
+   CPU disabled for this only. On success *sector is advanced past it. */
+static SpiFlashOpResult IRAM_ATTR spi_flash_erase_step(size_t *sector, size_t end)
+{
+    SpiFlashOpResult rc;
+    size_t first = *sector;
+    GUARD_START();
+    rc = spi_flash_unlock();
+    if (rc == SPI_FLASH_RESULT_OK) {
+#if CONFIG_SPI_FLASH_ERASE_BLOCKS
+        const size_t sectors_per_block = BLOCK_ERASE_SIZE / SPI_FLASH_SEC_SIZE;
+        size_t step = 1;
+        if (*sector % sectors_per_block == 0 && end - *sector >= sectors_per_block) {
+            step = sectors_per_block;
+            rc = SPIEraseBlock(*sector / sectors_per_block);
+        } else
+#else
+        const size_t step = 1;
+#endif
+        {
+            rc = SPIEraseSector(*sector);
+        }
+        if (rc == SPI_FLASH_RESULT_OK) {
+            *sector += step;
+            COUNTER_ADD_BYTES(erase, step * SPI_FLASH_SEC_SIZE);
+        }
+    }
+    GUARD_END(erase);
+    /* a failed erase may have erased part of the sector */
+    spi_flash_mmap_flash_changed(first * SPI_FLASH_SEC_SIZE, MAX(*sector - first, 1) * SPI_FLASH_SEC_SIZE);
+    return rc;
+}
+
+static esp_err_t spi_flash_check_erase_range(uint32_t start_addr, uint32_t size)
 {
     if (start_addr % SPI_FLASH_SEC_SIZE != 0) {
         return ESP_ERR_INVALID_ARG;
@@ -102,31 +178,81 @@ esp_err_t IRAM_ATTR spi_flash_erase_range(uint32_t start_addr, uint32_t size)
     if (size + start_addr > spi_flash_get_chip_size()) {
         return ESP_ERR_INVALID_SIZE;
     }
+    return ESP_OK;
+}
+
+esp_err_t IRAM_ATTR spi_flash_erase_range(uint32_t start_addr, uint32_t size)
+{
+    esp_err_t err = spi_flash_check_erase_range(start_addr, size);
+    if (err != ESP_OK) {
+        return err;
+    }
     size_t start = start_addr / SPI_FLASH_SEC_SIZE;
     size_t end = start + size / SPI_FLASH_SEC_SIZE;
-    const size_t sectors_per_block = BLOCK_ERASE_SIZE / SPI_FLASH_SEC_SIZE;
     COUNTER_START();
-    spi_flash_disable_interrupts_caches_and_other_cpu();
-    SpiFlashOpResult rc;
-    rc = spi_flash_unlock();
-    if (rc == SPI_FLASH_RESULT_OK) {
-        for (size_t sector = start; sector != end && rc == SPI_FLASH_RESULT_OK; ) {
-            if (sector % sectors_per_block == 0 && end - sector > sectors_per_block) {
-                rc = SPIEraseBlock(sector / sectors_per_block);
-                sector += sectors_per_block;
-                COUNTER_ADD_BYTES(erase, sectors_per_block * SPI_FLASH_SEC_SIZE);
-            } else {
-                rc = SPIEraseSector(sector);
-                ++sector;
-                COUNTER_ADD_BYTES(erase, SPI_FLASH_SEC_SIZE);
-            }
-        }
+    SpiFlashOpResult rc = SPI_FLASH_RESULT_OK;
+    /* Other tasks and the other CPU get to run between the steps */
+    for (size_t sector = start; sector != end && rc == SPI_FLASH_RESULT_OK; ) {
+        rc = spi_flash_erase_step(&sector, end);
     }
-    spi_flash_enable_interrupts_caches_and_other_cpu();
     COUNTER_STOP(erase);
     return spi_flash_translate_rc(rc);
 }
 
+typedef struct {
+    size_t start;
+    size_t size;
+    spi_flash_erase_cb_t callback;
+    void *arg;
+} erase_async_args_t;
+
+static void spi_flash_erase_task(void *param)
+{
+    erase_async_args_t args = *(erase_async_args_t *) param;
+    free(param);
+
+    size_t start = args.start / SPI_FLASH_SEC_SIZE;
+    size_t end = start + args.size / SPI_FLASH_SEC_SIZE;
+    size_t sector = start;
+    esp_err_t err = ESP_OK;
+    COUNTER_START();
+    while (sector != end && err == ESP_OK) {
+        err = spi_flash_translate_rc(spi_flash_erase_step(&sector, end));
+        args.callback(args.arg, (sector - start) * SPI_FLASH_SEC_SIZE, args.size, err);
+    }
+    COUNTER_STOP(erase);
+    if (args.size == 0) {
+        args.callback(args.arg, 0, 0, ESP_OK);
+    }
+    vTaskDelete(NULL);
+}
+
+esp_err_t spi_flash_erase_range_async(size_t start_address, size_t size,
+                                      spi_flash_erase_cb_t callback, void *arg)
+{
+    esp_err_t err = spi_flash_check_erase_range(start_address, size);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (callback == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    erase_async_args_t *args = malloc(sizeof(erase_async_args_t));
+    if (args == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    args->start = start_address;
+    args->size = size;
+    args->callback = callback;
+    args->arg = arg;
+    if (xTaskCreate(spi_flash_erase_task, "flash_erase", 2048, args,
+                    uxTaskPriorityGet(NULL), NULL) != pdPASS) {
+        free(args);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
 esp_err_t IRAM_ATTR spi_flash_write(size_t dst, const void *srcv, size_t size)
 {
     // Out of bound writes are checked in ROM code, but we can give better
@@ -160,13 +286,15 @@ esp_err_t IRAM_ATTR spi_flash_write(size_t dst, const void *srcv, size_t size)
     if (left_size > 0) {
         uint32_t t = 0xffffffff;
         memcpy(((uint8_t *) &t) + (dst - left_off), srcc, left_size);
-        spi_flash_disable_interrupts_caches_and_other_cpu();
+        GUARD_START();
         rc = SPIWrite(left_off, &t, 4);
-        spi_flash_enable_interrupts_caches_and_other_cpu();
+        if (rc == SPI_FLASH_RESULT_OK) {
+            COUNTER_ADD_BYTES(write, 4);
+        }
+        GUARD_END(write);
         if (rc != SPI_FLASH_RESULT_OK) {
             goto out;
         }
-        COUNTER_ADD_BYTES(write, 4);
     }
     if (mid_size > 0) {
         /* If src buffer is 4-byte aligned as well and is not in a region that
@@ -178,13 +306,15 @@ esp_err_t IRAM_ATTR spi_flash_write(size_t dst, const void *srcv, size_t size)
         bool in_dram = true;
 #endif
         if (in_dram && (((uintptr_t) srcc) + mid_off) % 4 == 0) {
-            spi_flash_disable_interrupts_caches_and_other_cpu();
+            GUARD_START();
             rc = SPIWrite(dst + mid_off, (const uint32_t *) (srcc + mid_off), mid_size);
-            spi_flash_enable_interrupts_caches_and_other_cpu();
+            if (rc == SPI_FLASH_RESULT_OK) {
+                COUNTER_ADD_BYTES(write, mid_size);
+            }
+            GUARD_END(write);
             if (rc != SPI_FLASH_RESULT_OK) {
                 goto out;
             }
-            COUNTER_ADD_BYTES(write, mid_size);
         } else {
             /*
              * Otherwise, unlike for read, we cannot manipulate data in the
@@ -194,13 +324,15 @@ esp_err_t IRAM_ATTR spi_flash_write(size_t dst, const void *srcv, size_t size)
                 uint32_t t[8];
                 uint32_t write_size = MIN(mid_size, sizeof(t));
                 memcpy(t, srcc + mid_off, write_size);
-                spi_flash_disable_interrupts_caches_and_other_cpu();
+                GUARD_START();
                 rc = SPIWrite(dst + mid_off, t, write_size);
-                spi_flash_enable_interrupts_caches_and_other_cpu();
+                if (rc == SPI_FLASH_RESULT_OK) {
+                    COUNTER_ADD_BYTES(write, write_size);
+                }
+                GUARD_END(write);
                 if (rc != SPI_FLASH_RESULT_OK) {
                     goto out;
                 }
-                COUNTER_ADD_BYTES(write, write_size);
                 mid_size -= write_size;
                 mid_off += write_size;
             }
@@ -209,16 +341,19 @@ esp_err_t IRAM_ATTR spi_flash_write(size_t dst, const void *srcv, size_t size)
     if (right_size > 0) {
         uint32_t t = 0xffffffff;
         memcpy(&t, srcc + right_off, right_size);
-        spi_flash_disable_interrupts_caches_and_other_cpu();
+        GUARD_START();
         rc = SPIWrite(dst + right_off, &t, 4);
-        spi_flash_enable_interrupts_caches_and_other_cpu();
+        if (rc == SPI_FLASH_RESULT_OK) {
+            COUNTER_ADD_BYTES(write, 4);
+        }
+        GUARD_END(write);
         if (rc != SPI_FLASH_RESULT_OK) {
             goto out;
         }
-        COUNTER_ADD_BYTES(write, 4);
     }
 out:
     COUNTER_STOP(write);
+    spi_flash_mmap_flash_changed(dst, size);
     return spi_flash_translate_rc(rc);
 }
 
@@ -237,7 +372,7 @@ esp_err_t IRAM_ATTR spi_flash_write_encrypted(size_t dest_addr, const void *src,
         return ESP_ERR_INVALID_ARG;
     }
     COUNTER_START();
-    spi_flash_disable_interrupts_caches_and_other_cpu();
+    GUARD_START();
     SpiFlashOpResult rc;
     rc = spi_flash_unlock();
     if (rc == SPI_FLASH_RESULT_OK) {
@@ -255,23 +390,19 @@ esp_err_t IRAM_ATTR spi_flash_write_encrypted(size_t dest_addr, const void *src,
         bzero(encrypt_buf, sizeof(encrypt_buf));
     }
     COUNTER_ADD_BYTES(write, size);
+    GUARD_END(write);
+    COUNTER_STOP(write);
+    spi_flash_mmap_flash_changed(dest_addr, size);
     return spi_flash_translate_rc(rc);
 }
 
-esp_err_t IRAM_ATTR spi_flash_read(size_t src, void *dstv, size_t size)
+/* Read with caches and the other CPU disabled */
+static SpiFlashOpResult IRAM_ATTR spi_flash_read_unguarded(size_t src, void *dstv, size_t size)
 {
-    // Out of bound reads are checked in ROM code, but we can give better
-    // error code here
-    if (src + size > g_rom_flashchip.chip_size) {
-        return ESP_ERR_INVALID_SIZE;
-    }
+    SpiFlashOpResult rc = SPI_FLASH_RESULT_OK;
     if (size == 0) {
-        return ESP_OK;
+        return rc;
     }
-
-    SpiFlashOpResult rc = SPI_FLASH_RESULT_OK;
-    COUNTER_START();
-    spi_flash_disable_interrupts_caches_and_other_cpu();
     /* To simplify boundary checks below, we handle small reads separately. */
     if (size < 16) {
         uint32_t t[6]; /* Enough for 16 bytes + 4 on either side for padding. */
@@ -345,7 +476,62 @@ esp_err_t IRAM_ATTR spi_flash_read(size_t src, void *dstv, size_t size)
         memcpy(dstc + pad_right_off, t, pad_right_size);
     }
 out:
-    spi_flash_enable_interrupts_caches_and_other_cpu();
+    return rc;
+}
+
+esp_err_t IRAM_ATTR spi_flash_read(size_t src, void *dstv, size_t size)
+{
+    spi_flash_read_req_t req = {
+        .src = src,
+        .dest = dstv,
+        .size = size,
+    };
+    return spi_flash_read_batch(&req, 1);
+}
+
+esp_err_t IRAM_ATTR spi_flash_read_batch(const spi_flash_read_req_t *reqs, size_t count)
+{
+    const size_t chunk_size = CONFIG_SPI_FLASH_READ_CHUNK_SIZE & ~3U;
+    for (size_t i = 0; i < count; i++) {
+        // Out of bound reads are checked in ROM code, but we can give better
+        // error code here
+        if (reqs[i].size > g_rom_flashchip.chip_size
+            || reqs[i].src > g_rom_flashchip.chip_size - reqs[i].size) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+    }
+
+    SpiFlashOpResult rc = SPI_FLASH_RESULT_OK;
+    size_t i = 0;
+    size_t done = 0;    // bytes of reqs[i] read
+    COUNTER_START();
+    while (i < count && rc == SPI_FLASH_RESULT_OK) {
+        /* reqs may be in flash, which can't be read with the caches off */
+        spi_flash_read_req_t batch[READ_BATCH_SIZE];
+        size_t batch_count = MIN(count - i, READ_BATCH_SIZE);
+        memcpy(batch, reqs + i, batch_count * sizeof(batch[0]));
+        /* Whole requests while they fit in the chunk, requests larger than
+           a chunk in pieces. Each request counts for one read command. */
+        size_t budget = chunk_size;
+        size_t j = 0;
+        GUARD_START();
+        do {
+            size_t left = batch[j].size - done;
+            if (left > budget && budget < chunk_size) {
+                break;
+            }
+            size_t n = MIN(left, budget);
+            rc = spi_flash_read_unguarded(batch[j].src + done, (char *) batch[j].dest + done, n);
+            budget -= MIN(budget, n + READ_COMMAND_COST);
+            done += n;
+            if (done == batch[j].size) {
+                ++j;
+                done = 0;
+            }
+        } while (j < batch_count && budget > 0 && rc == SPI_FLASH_RESULT_OK);
+        GUARD_END(read);
+        i += j;
+    }
     COUNTER_STOP(read);
     return spi_flash_translate_rc(rc);
 }
@@ -365,10 +551,128 @@ static esp_err_t spi_flash_translate_rc(SpiFlashOpResult rc)
 
 #if CONFIG_SPI_FLASH_ENABLE_COUNTERS
 
-static inline void dump_counter(spi_flash_counter_t* counter, const char* name)
+static const char* const s_caller_names[SPI_FLASH_CALLER_MAX] = {
+    "other", "nvs  ", "ota  ", "part ", "mmap ",
+};
+
+static inline int hist_bucket(uint32_t time)
+{
+    int bucket = (time < 2) ? 0 : 31 - __builtin_clz(time);
+    return MIN(bucket, SPI_FLASH_COUNTER_HIST_SIZE - 1);
+}
+
+static inline void counter_add_op(spi_flash_counter_t* counter, uint32_t time)
+{
+    counter->count++;
+    counter->time += time;
+    counter->hist[hist_bucket(time)]++;
+}
+
+static inline void counter_add_guard(spi_flash_counter_t* counter, uint32_t guard_time)
+{
+    counter->max_time = MAX(counter->max_time, guard_time);
+    s_flash_stats.max_disabled_time = MAX(s_flash_stats.max_disabled_time, guard_time);
+}
+
+// caller of the current task, with s_flash_stats_lock held
+static spi_flash_caller_t current_caller()
 {
-    ESP_LOGI(TAG, "%s  count=%8d  time=%8dms  bytes=%8d\n", name,
-             counter->count, counter->time, counter->bytes);
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    for (int i = 0; i < CALLER_TASKS && task != NULL; i++) {
+        if (s_caller_tasks[i].task == task) {
+            return s_caller_tasks[i].caller;
+        }
+    }
+    return SPI_FLASH_CALLER_OTHER;
+}
+
+static void spi_flash_counter_stop(spi_flash_counter_t* counter, uint32_t ts_begin)
+{
+    uint32_t time = (xthal_get_ccount() - ts_begin) / (XT_CLOCK_FREQ / 1000000);
+    portENTER_CRITICAL(&s_flash_stats_lock);
+    counter_add_op(counter, time);
+    counter_add_op(&s_flash_stats.callers[current_caller()], time);
+    portEXIT_CRITICAL(&s_flash_stats_lock);
+}
+
+static void spi_flash_counter_guard(spi_flash_counter_t* counter, uint32_t guard_time, uint32_t bytes)
+{
+    portENTER_CRITICAL(&s_flash_stats_lock);
+    spi_flash_counter_t* caller = &s_flash_stats.callers[current_caller()];
+    caller->bytes += bytes;
+    counter_add_guard(counter, guard_time);
+    counter_add_guard(caller, guard_time);
+    portEXIT_CRITICAL(&s_flash_stats_lock);
+}
+
+void spi_flash_mmap_counted(uint32_t ts_begin, uint32_t guard_time, size_t size)
+{
+    uint32_t time = (xthal_get_ccount() - ts_begin) / (XT_CLOCK_FREQ / 1000000);
+    portENTER_CRITICAL(&s_flash_stats_lock);
+    spi_flash_caller_t caller_id = current_caller();
+    spi_flash_counter_t* caller = &s_flash_stats.callers[
+        caller_id == SPI_FLASH_CALLER_OTHER ? SPI_FLASH_CALLER_MMAP : caller_id];
+    counter_add_op(&s_flash_stats.mmap, time);
+    counter_add_op(caller, time);
+    s_flash_stats.mmap.bytes += size;
+    caller->bytes += size;
+    counter_add_guard(&s_flash_stats.mmap, guard_time);
+    counter_add_guard(caller, guard_time);
+    portEXIT_CRITICAL(&s_flash_stats_lock);
+}
+
+spi_flash_caller_t spi_flash_caller_begin(spi_flash_caller_t caller)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    spi_flash_caller_t previous = SPI_FLASH_CALLER_OTHER;
+    if (task == NULL) {
+        return previous;
+    }
+    portENTER_CRITICAL(&s_flash_stats_lock);
+    previous = current_caller();
+    for (int i = 0; i < CALLER_TASKS && previous == SPI_FLASH_CALLER_OTHER; i++) {
+        if (s_caller_tasks[i].task == NULL) {
+            s_caller_tasks[i].task = task;
+            s_caller_tasks[i].caller = caller;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_flash_stats_lock);
+    return previous;
+}
+
+void spi_flash_caller_end(spi_flash_caller_t previous)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    if (previous != SPI_FLASH_CALLER_OTHER || task == NULL) {
+        // the outer caller goes on
+        return;
+    }
+    portENTER_CRITICAL(&s_flash_stats_lock);
+    for (int i = 0; i < CALLER_TASKS; i++) {
+        if (s_caller_tasks[i].task == task) {
+            s_caller_tasks[i].task = NULL;
+        }
+    }
+    portEXIT_CRITICAL(&s_flash_stats_lock);
+}
+
+static void dump_counter(const spi_flash_counter_t* counter, const char* name)
+{
+    char hist[128];
+    int len = 0;
+    ESP_LOGI(TAG, "%s  count=%8d  time=%8dus  max=%8dus  bytes=%8d\n", name,
+             counter->count, counter->time, counter->max_time, counter->bytes);
+    // non-empty buckets, as lowest time:operations
+    for (int i = 0; i < SPI_FLASH_COUNTER_HIST_SIZE && len < sizeof(hist); i++) {
+        if (counter->hist[i] != 0) {
+            len += snprintf(hist + len, sizeof(hist) - len, " %u:%u",
+                            (i == 0) ? 0 : 1u << i, counter->hist[i]);
+        }
+    }
+    if (len > 0) {
+        ESP_LOGI(TAG, "%s  us:count%s\n", name, hist);
+    }
 }
 
 const spi_flash_counters_t* spi_flash_get_counters()
@@ -378,14 +682,26 @@ const spi_flash_counters_t* spi_flash_get_counters()
 
 void spi_flash_reset_counters()
 {
+    portENTER_CRITICAL(&s_flash_stats_lock);
     memset(&s_flash_stats, 0, sizeof(s_flash_stats));
+    portEXIT_CRITICAL(&s_flash_stats_lock);
 }
 
 void spi_flash_dump_counters()
 {
+    spi_flash_mmap_counters_t mmap;
     dump_counter(&s_flash_stats.read,  "read ");
     dump_counter(&s_flash_stats.write, "write");
     dump_counter(&s_flash_stats.erase, "erase");
+    dump_counter(&s_flash_stats.mmap,  "mmap ");
+    spi_flash_mmap_get_counters(&mmap);
+    ESP_LOGI(TAG, "mmap   hits=%8d  misses=%8d\n", mmap.hits, mmap.misses);
+    ESP_LOGI(TAG, "caches disabled for at most %dus\n", s_flash_stats.max_disabled_time);
+    for (int i = 0; i < SPI_FLASH_CALLER_MAX; i++) {
+        if (s_flash_stats.callers[i].count != 0) {
+            dump_counter(&s_flash_stats.callers[i], s_caller_names[i]);
+        }
+    }
 }
 
 #endif //CONFIG_SPI_FLASH_ENABLE_COUNTERS
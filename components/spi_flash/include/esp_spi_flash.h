@@ -63,6 +63,10 @@ esp_err_t spi_flash_erase_sector(size_t sector);
 /**
  * @brief  Erase a range of flash sectors
  *
+ * The range is erased one 64KB block or 4KB sector at a time (see
+ * CONFIG_SPI_FLASH_ERASE_BLOCKS). Caches and the other CPU are only disabled
+ * for each of these steps, other tasks can run in between.
+ *
  * @param  start_address  Address where erase operation has to start.
  *                                  Must be 4kB-aligned
  * @param  size  Size of erased range, in bytes. Must be divisible by 4kB.
@@ -71,6 +75,38 @@ esp_err_t spi_flash_erase_sector(size_t sector);
  */
 esp_err_t spi_flash_erase_range(size_t start_address, size_t size);
 
+/**
+ * @brief Progress callback of spi_flash_erase_range_async
+ *
+ * Called from the erase task after each erase step, and once with
+ * erased == size == 0 for an empty range. The last call is the one
+ * with erased == size or err != ESP_OK.
+ *
+ * @param arg  Argument passed to spi_flash_erase_range_async
+ * @param erased  Bytes erased so far, from the start of the range
+ * @param size  Size of the range
+ * @param err  ESP_OK, or the error of the failed step
+ */
+typedef void (*spi_flash_erase_cb_t)(void *arg, size_t erased, size_t size, esp_err_t err);
+
+/**
+ * @brief  Erase a range of flash sectors in the background
+ *
+ * Like spi_flash_erase_range, but the erase runs in a new task with the
+ * priority of the calling task, and the function returns immediately.
+ *
+ * @param  start_address  Address where erase operation has to start.
+ *                                  Must be 4kB-aligned
+ * @param  size  Size of erased range, in bytes. Must be divisible by 4kB.
+ * @param  callback  Called with the progress of the erase, see spi_flash_erase_cb_t
+ * @param  arg  Argument for the callback
+ *
+ * @return ESP_OK if the erase has started, ESP_ERR_NO_MEM if the task
+ *         couldn't be created, or the argument errors of spi_flash_erase_range
+ */
+esp_err_t spi_flash_erase_range_async(size_t start_address, size_t size,
+                                      spi_flash_erase_cb_t callback, void *arg);
+
 
 /**
  * @brief  Write data to Flash.
@@ -108,6 +144,13 @@ esp_err_t spi_flash_write_encrypted(size_t dest, const void *src, size_t size);
 /**
  * @brief  Read data from Flash.
  *
+ * Caches and the other CPU are disabled for at most
+ * CONFIG_SPI_FLASH_READ_CHUNK_SIZE bytes at a time; longer reads are split
+ * and let other tasks and interrupts run in between.
+ *
+ * @note Reading into a 4-byte aligned destination at a 4-byte aligned
+ *       address in flash saves moving the data into place afterwards.
+ *
  * @param  src   source address of the data in Flash.
  * @param  dest  pointer to the destination buffer
  * @param  size  length of data
@@ -116,6 +159,34 @@ esp_err_t spi_flash_write_encrypted(size_t dest, const void *src, size_t size);
  */
 esp_err_t spi_flash_read(size_t src, void *dest, size_t size);
 
+/**
+ * @brief One read of spi_flash_read_batch
+ */
+typedef struct {
+    size_t src;         /**< source address of the data in Flash */
+    void *dest;         /**< pointer to the destination buffer */
+    size_t size;        /**< length of data */
+} spi_flash_read_req_t;
+
+/**
+ * @brief  Read several pieces of data from Flash.
+ *
+ * Same as calling spi_flash_read for each request, but as many requests as
+ * fit in CONFIG_SPI_FLASH_READ_CHUNK_SIZE bytes are read with caches and the
+ * other CPU disabled once, up to 8 of them. Requests longer than that are
+ * split as in spi_flash_read. The requests are read in order.
+ *
+ * The requests can be anywhere, also in flash (a static const table).
+ *
+ * @param  reqs   the reads
+ * @param  count  number of reads
+ *
+ * @return ESP_ERR_INVALID_SIZE if a request goes past the end of the chip,
+ *         in which case nothing is read; otherwise the result of the first
+ *         read which failed, later ones are not done.
+ */
+esp_err_t spi_flash_read_batch(const spi_flash_read_req_t *reqs, size_t count);
+
 /**
  * @brief Enumeration which specifies memory space requested in an mmap call
  */
@@ -139,6 +210,13 @@ typedef uint32_t spi_flash_mmap_handle_t;
  * of address space if mmap/munmap are heavily used. To troubleshoot issues with
  * page allocation, use spi_flash_mmap_dump function.
  *
+ * Pages keep their mapping after spi_flash_munmap, until they are needed
+ * for another one or the flash under them is written. Mapping flash which
+ * is still mapped this way doesn't disable the caches and the other CPU.
+ * spi_flash_mmap_get_counters tells how often that happens.
+ *
+ * Up to 128 regions can be mapped at a time.
+ *
  * @param src_addr  Physical address in flash where requested region starts.
  *                  This address *must* be aligned to 64kB boundary.
  * @param size  Size of region which has to be mapped. This size will be rounded
@@ -147,7 +225,8 @@ typedef uint32_t spi_flash_mmap_handle_t;
  * @param out_ptr  Output, pointer to the mapped memory region
  * @param out_handle  Output, handle which should be used for spi_flash_munmap call
  *
- * @return  ESP_OK on success, ESP_ERR_NO_MEM if pages can not be allocated
+ * @return  ESP_OK on success, ESP_ERR_NO_MEM if pages or handles can not be
+ *          allocated (at most 128 mappings can be held at a time)
  */
 esp_err_t spi_flash_mmap(uint32_t src_addr, size_t size, spi_flash_mmap_memory_t memory,
                          const void** out_ptr, spi_flash_mmap_handle_t* out_handle);
@@ -173,8 +252,40 @@ void spi_flash_munmap(spi_flash_mmap_handle_t handle);
  */
 void spi_flash_mmap_dump();
 
+/**
+ * @brief Statistics of spi_flash_mmap calls
+ */
+typedef struct {
+    uint32_t hits;      /**< calls which used a mapping already there */
+    uint32_t misses;    /**< calls which changed the MMU table */
+} spi_flash_mmap_counters_t;
+
+/**
+ * @brief Get the statistics of spi_flash_mmap calls
+ *
+ * @param counters  Output, the statistics since startup
+ */
+void spi_flash_mmap_get_counters(spi_flash_mmap_counters_t* counters);
+
+/**
+ * @brief Users of the SPI flash APIs told apart by the operation counters
+ */
+typedef enum {
+    SPI_FLASH_CALLER_OTHER = 0,     /**< none of the below */
+    SPI_FLASH_CALLER_NVS,           /**< NVS library */
+    SPI_FLASH_CALLER_OTA,           /**< esp_ota_* functions */
+    SPI_FLASH_CALLER_PARTITION,     /**< esp_partition_* functions */
+    SPI_FLASH_CALLER_MMAP,          /**< spi_flash_mmap */
+    SPI_FLASH_CALLER_MAX,
+} spi_flash_caller_t;
+
 #if CONFIG_SPI_FLASH_ENABLE_COUNTERS
 
+/* Buckets of the latency histograms: bucket 0 counts operations which took
+   less than 2us, bucket n those which took 2^n to 2^(n+1)-1 us, and the last
+   bucket all longer ones */
+#define SPI_FLASH_COUNTER_HIST_SIZE 20
+
 /**
  * Structure holding statistics for one type of operation
  */
@@ -182,12 +293,20 @@ typedef struct {
     uint32_t count;     // number of times operation was executed
     uint32_t time;      // total time taken, in microseconds
     uint32_t bytes;     // total number of bytes
+    uint32_t max_time;  // longest time caches and the other CPU were disabled
+                        // at once, in microseconds
+    uint32_t hist[SPI_FLASH_COUNTER_HIST_SIZE]; // operations by time taken
 } spi_flash_counter_t;
 
 typedef struct {
     spi_flash_counter_t read;
     spi_flash_counter_t write;
     spi_flash_counter_t erase;
+    spi_flash_counter_t mmap;       // spi_flash_mmap calls, bytes mapped
+    uint32_t max_disabled_time;     // longest time caches, non-IRAM interrupts
+                                    // and the other CPU were disabled at once,
+                                    // in microseconds
+    spi_flash_counter_t callers[SPI_FLASH_CALLER_MAX]; // all operations, by caller
 } spi_flash_counters_t;
 
 /**
@@ -208,6 +327,38 @@ void spi_flash_dump_counters();
  */
 const spi_flash_counters_t* spi_flash_get_counters();
 
+/**
+ * @brief  Count the SPI flash operations of the calling task for a caller
+ *
+ * Until the matching spi_flash_caller_end, operations of the calling task
+ * are counted in spi_flash_counters_t callers[caller], unless the task
+ * already is in a spi_flash_caller_begin/spi_flash_caller_end pair: then
+ * they go on counting for the outer caller.
+ *
+ * @param  caller  caller to count operations for
+ *
+ * @return  the value to pass to spi_flash_caller_end
+ */
+spi_flash_caller_t spi_flash_caller_begin(spi_flash_caller_t caller);
+
+/**
+ * @brief  End counting operations for the caller set by spi_flash_caller_begin
+ *
+ * @param  previous  value returned by spi_flash_caller_begin
+ */
+void spi_flash_caller_end(spi_flash_caller_t previous);
+
+#else
+
+static inline spi_flash_caller_t spi_flash_caller_begin(spi_flash_caller_t caller)
+{
+    return SPI_FLASH_CALLER_OTHER;
+}
+
+static inline void spi_flash_caller_end(spi_flash_caller_t previous)
+{
+}
+
 #endif //CONFIG_SPI_FLASH_ENABLE_COUNTERS
 
 #ifdef __cplusplus
@@ -208,7 +208,10 @@ esp_err_t esp_partition_read(const esp_partition_t* partition,
     }
 
     if (!partition->encrypted) {
-        return spi_flash_read(partition->address + src_offset, dst, size);
+        spi_flash_caller_t caller = spi_flash_caller_begin(SPI_FLASH_CALLER_PARTITION);
+        esp_err_t err = spi_flash_read(partition->address + src_offset, dst, size);
+        spi_flash_caller_end(caller);
+        return err;
     } else {
         /* Encrypted partitions need to be read via a cache mapping */
         const void *buf;
@@ -241,11 +244,15 @@ esp_err_t esp_partition_write(const esp_partition_t* partition,
         return ESP_ERR_INVALID_SIZE;
     }
     dst_offset = partition->address + dst_offset;
+    esp_err_t err;
+    spi_flash_caller_t caller = spi_flash_caller_begin(SPI_FLASH_CALLER_PARTITION);
     if (partition->encrypted) {
-        return spi_flash_write_encrypted(dst_offset, src, size);
+        err = spi_flash_write_encrypted(dst_offset, src, size);
     } else {
-        return spi_flash_write(dst_offset, src, size);
+        err = spi_flash_write(dst_offset, src, size);
     }
+    spi_flash_caller_end(caller);
+    return err;
 }
 
 esp_err_t esp_partition_erase_range(const esp_partition_t* partition,
@@ -264,8 +271,10 @@ esp_err_t esp_partition_erase_range(const esp_partition_t* partition,
     if (start_addr % SPI_FLASH_SEC_SIZE != 0) {
         return ESP_ERR_INVALID_ARG;
     }
-    return spi_flash_erase_range(partition->address + start_addr, size);
-
+    spi_flash_caller_t caller = spi_flash_caller_begin(SPI_FLASH_CALLER_PARTITION);
+    esp_err_t err = spi_flash_erase_range(partition->address + start_addr, size);
+    spi_flash_caller_end(caller);
+    return err;
 }
 
 /*
@@ -291,7 +300,9 @@ esp_err_t esp_partition_mmap(const esp_partition_t* partition, uint32_t offset,
     // offset within 64kB block
     size_t region_offset = phys_addr & 0xffff;
     size_t mmap_addr = phys_addr & 0xffff0000;
+    spi_flash_caller_t caller = spi_flash_caller_begin(SPI_FLASH_CALLER_PARTITION);
     esp_err_t rc = spi_flash_mmap(mmap_addr, size, memory, out_ptr, out_handle);
+    spi_flash_caller_end(caller);
     // adjust returned pointer to point to the correct offset
     if (rc == ESP_OK) {
         *out_ptr = (void*) (((ptrdiff_t) *out_ptr) + region_offset);
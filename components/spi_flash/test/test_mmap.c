@@ -81,3 +81,41 @@ TEST_CASE("Can mmap into data address space", "[mmap]")
     printf("Unmapping handle3\n");
     spi_flash_munmap(handle3);
 }
+
+TEST_CASE("mmap reuses mappings until the flash is written", "[mmap]")
+{
+    const uint32_t addr = end - 0x10000;
+    spi_flash_mmap_counters_t before, after;
+    spi_flash_mmap_handle_t handle1, handle2;
+    const void *ptr1, *ptr2;
+
+    ESP_ERROR_CHECK( spi_flash_mmap(addr, 0x10000, SPI_FLASH_MMAP_DATA, &ptr1, &handle1) );
+    spi_flash_mmap_get_counters(&before);
+    ESP_ERROR_CHECK( spi_flash_mmap(addr, 0x10000, SPI_FLASH_MMAP_DATA, &ptr2, &handle2) );
+    spi_flash_mmap_get_counters(&after);
+    TEST_ASSERT_EQUAL_PTR(ptr1, ptr2);
+    TEST_ASSERT_EQUAL_UINT32(before.hits + 1, after.hits);
+    spi_flash_munmap(handle1);
+    spi_flash_munmap(handle2);
+
+    /* unmapped, but still there */
+    spi_flash_mmap_get_counters(&before);
+    ESP_ERROR_CHECK( spi_flash_mmap(addr, 0x10000, SPI_FLASH_MMAP_DATA, &ptr2, &handle2) );
+    spi_flash_mmap_get_counters(&after);
+    TEST_ASSERT_EQUAL_PTR(ptr1, ptr2);
+    TEST_ASSERT_EQUAL_UINT32(before.hits + 1, after.hits);
+    spi_flash_munmap(handle2);
+
+    /* the mapping goes with the data under it */
+    for (uint32_t word = 0; word < 1024; ++word) {
+        buffer[word] = ~word;
+    }
+    ESP_ERROR_CHECK( spi_flash_erase_sector(addr / SPI_FLASH_SEC_SIZE) );
+    ESP_ERROR_CHECK( spi_flash_write(addr, buffer, sizeof(buffer)) );
+    spi_flash_mmap_get_counters(&before);
+    ESP_ERROR_CHECK( spi_flash_mmap(addr, 0x10000, SPI_FLASH_MMAP_DATA, &ptr2, &handle2) );
+    spi_flash_mmap_get_counters(&after);
+    TEST_ASSERT_EQUAL_UINT32(before.misses + 1, after.misses);
+    TEST_ASSERT_EQUAL_MEMORY(buffer, ptr2, sizeof(buffer));
+    spi_flash_munmap(handle2);
+}
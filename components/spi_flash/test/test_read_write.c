@@ -17,6 +17,7 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/param.h>
 
@@ -205,3 +206,76 @@ TEST_CASE("Test spi_flash_write", "[spi_flash_write]")
     ESP_ERROR_CHECK(spi_flash_write(FLASH_BASE, (char *) 0x40078000, 16));
     ESP_ERROR_CHECK(spi_flash_write(FLASH_BASE, (char *) 0x40080000, 16));
 }
+
+TEST_CASE("Test spi_flash_read_batch", "[spi_flash_read]")
+{
+    /* longer than a chunk, so that it is split, with odd offsets */
+    const size_t len = 2 * CONFIG_SPI_FLASH_READ_CHUNK_SIZE + 7;
+    const size_t flash_len = (len + 64 + SPI_FLASH_SEC_SIZE - 1) & ~(SPI_FLASH_SEC_SIZE - 1);
+    char *src_buf = malloc(flash_len);
+    char *dst_buf = malloc(len + 64);
+    TEST_ASSERT_NOT_NULL(src_buf);
+    TEST_ASSERT_NOT_NULL(dst_buf);
+
+    fill(src_buf, 0, flash_len);
+    ESP_ERROR_CHECK(spi_flash_erase_range(FLASH_BASE, flash_len));
+    ESP_ERROR_CHECK(spi_flash_write(FLASH_BASE, src_buf, flash_len));
+
+    memset(dst_buf, 0x55, len + 64);
+    const spi_flash_read_req_t reqs[] = {
+        { FLASH_BASE + 1, dst_buf, 3 },
+        { FLASH_BASE + 40, dst_buf + 3, 0 },
+        { FLASH_BASE + 5, dst_buf + 5, 17 },
+        { FLASH_BASE + 61, dst_buf + 23, len },
+    };
+    ESP_ERROR_CHECK(spi_flash_read_batch(reqs, sizeof(reqs) / sizeof(reqs[0])));
+    TEST_ASSERT_EQUAL_INT(0, cmp_or_dump(dst_buf, src_buf + 1, 3));
+    TEST_ASSERT_EQUAL_INT(0x55, dst_buf[3]);
+    TEST_ASSERT_EQUAL_INT(0x55, dst_buf[4]);
+    TEST_ASSERT_EQUAL_INT(0, cmp_or_dump(dst_buf + 5, src_buf + 5, 17));
+    TEST_ASSERT_EQUAL_INT(0x55, dst_buf[22]);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(dst_buf + 23, src_buf + 61, len));
+    TEST_ASSERT_EQUAL_INT(0x55, dst_buf[23 + len]);
+
+    /* nothing is read if a request goes past the end of the chip */
+    const spi_flash_read_req_t bad_reqs[] = {
+        { FLASH_BASE, dst_buf, 4 },
+        { spi_flash_get_chip_size() - 4, dst_buf, 8 },
+    };
+    memset(dst_buf, 0x55, 4);
+    TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_SIZE, spi_flash_read_batch(bad_reqs, 2));
+    TEST_ASSERT_EQUAL_INT(0x55, dst_buf[0]);
+
+    free(src_buf);
+    free(dst_buf);
+}
+
+/* static const puts the requests in flash, more of them than are read at once */
+static char s_batch_dst[40];
+static const spi_flash_read_req_t s_batch_reqs[] = {
+    { FLASH_BASE + 36, s_batch_dst + 0, 4 },
+    { FLASH_BASE + 32, s_batch_dst + 4, 4 },
+    { FLASH_BASE + 28, s_batch_dst + 8, 4 },
+    { FLASH_BASE + 24, s_batch_dst + 12, 4 },
+    { FLASH_BASE + 20, s_batch_dst + 16, 4 },
+    { FLASH_BASE + 16, s_batch_dst + 20, 4 },
+    { FLASH_BASE + 12, s_batch_dst + 24, 4 },
+    { FLASH_BASE + 8, s_batch_dst + 28, 4 },
+    { FLASH_BASE + 4, s_batch_dst + 32, 4 },
+    { FLASH_BASE + 0, s_batch_dst + 36, 4 },
+};
+
+TEST_CASE("Test spi_flash_read_batch with requests in flash", "[spi_flash_read]")
+{
+    char src_buf[sizeof(s_batch_dst)];
+
+    fill(src_buf, 0, sizeof(src_buf));
+    ESP_ERROR_CHECK(spi_flash_erase_range(FLASH_BASE, SPI_FLASH_SEC_SIZE));
+    ESP_ERROR_CHECK(spi_flash_write(FLASH_BASE, src_buf, sizeof(src_buf)));
+
+    memset(s_batch_dst, 0x55, sizeof(s_batch_dst));
+    ESP_ERROR_CHECK(spi_flash_read_batch(s_batch_reqs, sizeof(s_batch_reqs) / sizeof(s_batch_reqs[0])));
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT_EQUAL_INT(0, cmp_or_dump(s_batch_dst + 4 * i, src_buf + 4 * (9 - i), 4));
+    }
+}
@@ -90,3 +90,100 @@ TEST_CASE("flash write and erase work both on PRO CPU and on APP CPU", "[spi_fla
     }
 }
 
+
+typedef struct {
+    size_t erased;
+    int calls;
+    esp_err_t err;
+    SemaphoreHandle_t done;
+} erase_progress_t;
+
+static void erase_progress(void *arg, size_t erased, size_t size, esp_err_t err)
+{
+    erase_progress_t *progress = (erase_progress_t *) arg;
+    if (erased <= progress->erased && size != 0) {
+        progress->err = ESP_FAIL; /* no progress */
+    }
+    progress->erased = erased;
+    progress->calls++;
+    if (err != ESP_OK) {
+        progress->err = err;
+    }
+    if (erased == size || err != ESP_OK) {
+        xSemaphoreGive(progress->done);
+    }
+}
+
+TEST_CASE("flash erase in the background lets other tasks run", "[spi_flash]")
+{
+    /* two sectors, one 64KB block, two sectors */
+    const uint32_t start = 0x20e000;
+    const uint32_t size = 0x14000;
+    uint32_t val = 0x12345678;
+    erase_progress_t progress = { 0 };
+
+    for (uint32_t offset = 0; offset < size; offset += SPI_FLASH_SEC_SIZE) {
+        TEST_ESP_OK(spi_flash_write(start + offset, &val, sizeof(val)));
+    }
+
+#if CONFIG_SPI_FLASH_ENABLE_COUNTERS
+    spi_flash_reset_counters();
+#endif
+    progress.done = xSemaphoreCreateBinary();
+    TEST_ESP_OK(spi_flash_erase_range_async(start, size, erase_progress, &progress));
+
+    /* this task keeps running while the erase is in progress */
+    int ticks = 0;
+    while (xSemaphoreTake(progress.done, 1) != pdTRUE) {
+        ticks++;
+    }
+    vSemaphoreDelete(progress.done);
+    printf("erase took %d progress calls, %d ticks\n", progress.calls, ticks);
+    TEST_ESP_OK(progress.err);
+    TEST_ASSERT_EQUAL(size, progress.erased);
+    TEST_ASSERT(ticks > 0);
+
+    for (uint32_t offset = 0; offset < size; offset += SPI_FLASH_SEC_SIZE) {
+        TEST_ESP_OK(spi_flash_read(start + offset, &val, sizeof(val)));
+        TEST_ASSERT_EQUAL_HEX32(0xffffffff, val);
+    }
+
+#if CONFIG_SPI_FLASH_ENABLE_COUNTERS
+    const spi_flash_counters_t *counters = spi_flash_get_counters();
+    printf("longest erase step %dus of %dus\n", counters->erase.max_time, counters->erase.time);
+    TEST_ASSERT(counters->erase.max_time > 0);
+    TEST_ASSERT(counters->erase.max_time < counters->erase.time);
+#endif
+}
+
+#if CONFIG_SPI_FLASH_ENABLE_COUNTERS
+TEST_CASE("flash counters keep latency histograms and callers", "[spi_flash]")
+{
+    const spi_flash_counters_t *counters = spi_flash_get_counters();
+    uint32_t val;
+
+    spi_flash_reset_counters();
+    for (int i = 0; i < 10; i++) {
+        TEST_ESP_OK(spi_flash_read(0x1000, &val, sizeof(val)));
+    }
+    spi_flash_caller_t caller = spi_flash_caller_begin(SPI_FLASH_CALLER_NVS);
+    TEST_ASSERT_EQUAL(SPI_FLASH_CALLER_OTHER, caller);
+    /* an inner caller doesn't take over */
+    TEST_ASSERT_EQUAL(SPI_FLASH_CALLER_NVS, spi_flash_caller_begin(SPI_FLASH_CALLER_PARTITION));
+    spi_flash_caller_end(SPI_FLASH_CALLER_NVS);
+    TEST_ESP_OK(spi_flash_read(0x1000, &val, sizeof(val)));
+    spi_flash_caller_end(caller);
+    spi_flash_dump_counters();
+
+    uint32_t hist_count = 0;
+    for (int i = 0; i < SPI_FLASH_COUNTER_HIST_SIZE; i++) {
+        hist_count += counters->read.hist[i];
+    }
+    TEST_ASSERT_EQUAL(11, counters->read.count);
+    TEST_ASSERT_EQUAL(11, hist_count);
+    TEST_ASSERT_EQUAL(10, counters->callers[SPI_FLASH_CALLER_OTHER].count);
+    TEST_ASSERT_EQUAL(1, counters->callers[SPI_FLASH_CALLER_NVS].count);
+    TEST_ASSERT_EQUAL(0, counters->callers[SPI_FLASH_CALLER_PARTITION].count);
+    TEST_ASSERT(counters->max_disabled_time >= counters->read.max_time);
+}
+#endif
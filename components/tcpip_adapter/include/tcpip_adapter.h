@@ -93,6 +93,7 @@ typedef struct {
 #define ESP_ERR_TCPIP_ADAPTER_DHCP_ALREADY_STOPPED  ESP_ERR_TCPIP_ADAPTER_BASE + 0x04
 #define ESP_ERR_TCPIP_ADAPTER_NO_MEM                ESP_ERR_TCPIP_ADAPTER_BASE + 0x05
 #define ESP_ERR_TCPIP_ADAPTER_DHCP_NOT_STOPPED      ESP_ERR_TCPIP_ADAPTER_BASE + 0x06
+#define ESP_ERR_TCPIP_ADAPTER_NOT_SUPPORTED         ESP_ERR_TCPIP_ADAPTER_BASE + 0x07
 
 /* TODO: add Ethernet interface */
 typedef enum {
@@ -436,6 +437,42 @@ esp_err_t tcpip_adapter_set_hostname(tcpip_adapter_if_t tcpip_if, const char *ho
  */
 esp_err_t tcpip_adapter_get_hostname(tcpip_adapter_if_t tcpip_if, const char **hostname);
 
+#define TCPIP_ADAPTER_NETSTATS_ALL_CORES   (-1)
+
+/* network stack counters, see tcpip_adapter_get_netstats */
+typedef struct {
+    uint32_t rx_frames;         /**< frames handed to the stack by the drivers */
+    uint32_t tx_frames;         /**< frames handed to the drivers by the stack */
+    uint32_t pbuf_alloc_fail;   /**< failed pbuf allocations */
+    uint32_t mbox_post_fail;    /**< messages dropped because a mailbox was full */
+    uint32_t tcp_rexmit_rto;    /**< TCP retransmission timeouts */
+    uint32_t tcp_rexmit_fast;   /**< TCP fast retransmits */
+    uint32_t tcp_ooseq;         /**< TCP segments received out of sequence */
+    uint32_t tcp_ooseq_max;     /**< longest out-of-sequence queue of a connection, in segments */
+    uint32_t tcp_pcb_max;       /**< high-water mark of TCP connections */
+    uint32_t tcp_seg_max;       /**< high-water mark of queued TCP segments */
+    uint32_t udp_pcb_max;       /**< high-water mark of UDP pcbs */
+    uint32_t netconn_max;       /**< high-water mark of netconns (sockets) */
+    uint32_t netbuf_max;        /**< high-water mark of netbufs */
+    uint32_t pbuf_max;          /**< high-water mark of PBUF_REF/PBUF_ROM pbufs */
+    uint32_t tcpip_msg_max;     /**< high-water mark of messages to the tcpip thread */
+} tcpip_adapter_netstats_t;
+
+/**
+ * @brief  Get the network stack counters
+ *
+ * The counters run from boot and are never reset. Traffic counters are kept per core;
+ * the high-water marks are global and reported whatever core is asked for.
+ *
+ * @param[in]   core: the core whose counters to read, or TCPIP_ADAPTER_NETSTATS_ALL_CORES for the sum over all cores
+ * @param[out]  stats: the counters
+ *
+ * @return ESP_OK:success
+ *         ESP_ERR_TCPIP_ADAPTER_INVALID_PARAMS:parameter error
+ *         ESP_ERR_TCPIP_ADAPTER_NOT_SUPPORTED:counters disabled in menuconfig
+ */
+esp_err_t tcpip_adapter_get_netstats(int core, tcpip_adapter_netstats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -25,6 +25,7 @@
 #include "lwip/ip_addr.h"
 #include "lwip/ip6_addr.h"
 #include "lwip/nd6.h"
+#include "lwip/stats.h"
 #if LWIP_DNS /* don't build if not configured for use in lwipopts.h */
 #include "lwip/dns.h"
 #endif
@@ -748,4 +749,44 @@ esp_err_t tcpip_adapter_get_hostname(tcpip_adapter_if_t tcpip_if, const char **h
     }
 }
 
+esp_err_t tcpip_adapter_get_netstats(int core, tcpip_adapter_netstats_t *stats)
+{
+#if ESP_NETSTATS
+    int first = core, last = core;
+    int i;
+
+    if (stats == NULL || core < TCPIP_ADAPTER_NETSTATS_ALL_CORES || core >= LWIP_NUM_CORES) {
+        return ESP_ERR_TCPIP_ADAPTER_INVALID_PARAMS;
+    }
+
+    if (core == TCPIP_ADAPTER_NETSTATS_ALL_CORES) {
+        first = 0;
+        last = LWIP_NUM_CORES - 1;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    for (i = first; i <= last; i++) {
+        const struct stats_netcore *c = &netstats.core[i];
+        stats->rx_frames += c->rx_frames;
+        stats->tx_frames += c->tx_frames;
+        stats->pbuf_alloc_fail += c->pbuf_alloc_fail;
+        stats->mbox_post_fail += c->mbox_post_fail;
+        stats->tcp_rexmit_rto += c->tcp_rexmit_rto;
+        stats->tcp_rexmit_fast += c->tcp_rexmit_fast;
+        stats->tcp_ooseq += c->tcp_ooseq;
+    }
+    stats->tcp_ooseq_max = netstats.tcp_ooseq_max;
+    stats->tcp_pcb_max = netstats.memp_max[MEMP_TCP_PCB];
+    stats->tcp_seg_max = netstats.memp_max[MEMP_TCP_SEG];
+    stats->udp_pcb_max = netstats.memp_max[MEMP_UDP_PCB];
+    stats->netconn_max = netstats.memp_max[MEMP_NETCONN];
+    stats->netbuf_max = netstats.memp_max[MEMP_NETBUF];
+    stats->pbuf_max = netstats.memp_max[MEMP_PBUF];
+    stats->tcpip_msg_max = netstats.memp_max[MEMP_TCPIP_MSG_API] + netstats.memp_max[MEMP_TCPIP_MSG_INPKT];
+    return ESP_OK;
+#else
+    return ESP_ERR_TCPIP_ADAPTER_NOT_SUPPORTED;
+#endif
+}
+
 #endif
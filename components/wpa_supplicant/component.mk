@@ -2,3 +2,8 @@ COMPONENT_ADD_INCLUDEDIRS := include port/include
 COMPONENT_SRCDIRS := src/crypto port
 
 CFLAGS += -DEMBEDDED_SUPP -D__ets__ -Wno-strict-aliasing
+
+# bignum.c or crypto_mbedtls-bignum.c
+ifdef CONFIG_WPA_MBEDTLS_CRYPTO
+CFLAGS += -DUSE_MBEDTLS_CRYPTO
+endif
@@ -12,6 +12,8 @@
  * See README and COPYING for more details.
  */
 
+#ifndef USE_MBEDTLS_CRYPTO
+
 #include "crypto/includes.h"
 #include "crypto/common.h"
 #include "wpa/wpabuf.h"
@@ -242,3 +244,5 @@ bignum_exptmod(const struct bignum *a, const struct bignum *b,
 	}
 	return 0;
 }
+
+#endif /* USE_MBEDTLS_CRYPTO */
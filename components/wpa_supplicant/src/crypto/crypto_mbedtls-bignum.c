@@ -0,0 +1,317 @@
+/*
+ * Big number math on mbedTLS
+ * Copyright (c) 2016, Espressif Systems (Shanghai) PTE Ltd
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of BSD
+ * license.
+ *
+ * See README and COPYING for more details.
+ */
+
+#ifdef USE_MBEDTLS_CRYPTO
+
+#include "crypto/includes.h"
+#include "crypto/common.h"
+#include "wpa/wpabuf.h"
+#include "wpa/wpa_debug.h"
+#include "bignum.h"
+
+#include "mbedtls/bignum.h"
+
+/*
+ * The bignum.c API on mbedtls_mpi instead of LibTomMath: struct bignum is
+ * just typecast to mbedtls_mpi. crypto_mod_exp() and the RSA code use
+ * bignum_exptmod(), which is mbedtls_mpi_exp_mod() and so runs on the RSA
+ * accelerator with CONFIG_MBEDTLS_HARDWARE_MPI.
+ */
+
+/**
+ * bignum_init - Allocate memory for bignum
+ * Returns: Pointer to allocated bignum or %NULL on failure
+ */
+struct bignum *
+bignum_init(void)
+{
+	struct bignum *n = (struct bignum *)os_zalloc(sizeof(mbedtls_mpi));
+	if (n == NULL)
+		return NULL;
+	mbedtls_mpi_init((mbedtls_mpi *) n);
+	return n;
+}
+
+
+/**
+ * bignum_deinit - Free bignum
+ * @n: Bignum from bignum_init()
+ */
+void
+bignum_deinit(struct bignum *n)
+{
+	if (n) {
+		mbedtls_mpi_free((mbedtls_mpi *) n);
+		os_free(n);
+	}
+}
+
+
+/**
+ * bignum_get_unsigned_bin - Get length of bignum as an unsigned binary buffer
+ * @n: Bignum from bignum_init()
+ * Returns: Length of n if written to a binary buffer
+ */
+size_t
+bignum_get_unsigned_bin_len(struct bignum *n)
+{
+	return mbedtls_mpi_size((mbedtls_mpi *) n);
+}
+
+
+/**
+ * bignum_get_unsigned_bin - Set binary buffer to unsigned bignum
+ * @n: Bignum from bignum_init()
+ * @buf: Buffer for the binary number
+ * @len: Length of the buffer, can be %NULL if buffer is known to be long
+ * enough. Set to used buffer length on success if not %NULL.
+ * Returns: 0 on success, -1 on failure
+ */
+int
+bignum_get_unsigned_bin(const struct bignum *n, u8 *buf, size_t *len)
+{
+	size_t need = mbedtls_mpi_size((const mbedtls_mpi *) n);
+	if (len && need > *len) {
+		*len = need;
+		return -1;
+	}
+	if (mbedtls_mpi_write_binary((const mbedtls_mpi *) n, buf, need) != 0) {
+		wpa_printf(MSG_DEBUG, "BIGNUM: %s failed", __func__);
+		return -1;
+	}
+	if (len)
+		*len = need;
+	return 0;
+}
+
+
+/**
+ * bignum_set_unsigned_bin - Set bignum based on unsigned binary buffer
+ * @n: Bignum from bignum_init(); to be set to the given value
+ * @buf: Buffer with unsigned binary value
+ * @len: Length of buf in octets
+ * Returns: 0 on success, -1 on failure
+ */
+int
+bignum_set_unsigned_bin(struct bignum *n, const u8 *buf, size_t len)
+{
+	if (mbedtls_mpi_read_binary((mbedtls_mpi *) n, buf, len) != 0) {
+		wpa_printf(MSG_DEBUG, "BIGNUM: %s failed", __func__);
+		return -1;
+	}
+	return 0;
+}
+
+
+/**
+ * bignum_cmp - Signed comparison
+ * @a: Bignum from bignum_init()
+ * @b: Bignum from bignum_init()
+ * Returns: 0 on success, -1 on failure
+ */
+int
+bignum_cmp(const struct bignum *a, const struct bignum *b)
+{
+	return mbedtls_mpi_cmp_mpi((const mbedtls_mpi *) a,
+				   (const mbedtls_mpi *) b);
+}
+
+
+/**
+ * bignum_cmd_d - Compare bignum to standard integer
+ * @a: Bignum from bignum_init()
+ * @b: Small integer
+ * Returns: 0 on success, -1 on failure
+ */
+int
+bignum_cmp_d(const struct bignum *a, unsigned long b)
+{
+	/* mbedtls_mpi_cmp_int() takes a signed limb, which b may not fit */
+	u8 buf[sizeof(b)];
+	mbedtls_mpi mpi_b;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < sizeof(b); i++)
+		buf[sizeof(b) - 1 - i] = (u8) (b >> (8 * i));
+	mbedtls_mpi_init(&mpi_b);
+	if (mbedtls_mpi_read_binary(&mpi_b, buf, sizeof(buf)) == 0)
+		ret = mbedtls_mpi_cmp_mpi((const mbedtls_mpi *) a, &mpi_b);
+	else
+		ret = -1;
+	mbedtls_mpi_free(&mpi_b);
+	return ret;
+}
+
+
+/**
+ * bignum_add - c = a + b
+ * @a: Bignum from bignum_init()
+ * @b: Bignum from bignum_init()
+ * @c: Bignum from bignum_init(); used to store the result of a + b
+ * Returns: 0 on success, -1 on failure
+ */
+int
+bignum_add(const struct bignum *a, const struct bignum *b,
+	       struct bignum *c)
+{
+	if (mbedtls_mpi_add_mpi((mbedtls_mpi *) c, (const mbedtls_mpi *) a,
+				(const mbedtls_mpi *) b) != 0) {
+		wpa_printf(MSG_DEBUG, "BIGNUM: %s failed", __func__);
+		return -1;
+	}
+	return 0;
+}
+
+
+/**
+ * bignum_sub - c = a - b
+ * @a: Bignum from bignum_init()
+ * @b: Bignum from bignum_init()
+ * @c: Bignum from bignum_init(); used to store the result of a - b
+ * Returns: 0 on success, -1 on failure
+ */
+int
+bignum_sub(const struct bignum *a, const struct bignum *b,
+	       struct bignum *c)
+{
+	if (mbedtls_mpi_sub_mpi((mbedtls_mpi *) c, (const mbedtls_mpi *) a,
+				(const mbedtls_mpi *) b) != 0) {
+		wpa_printf(MSG_DEBUG, "BIGNUM: %s failed", __func__);
+		return -1;
+	}
+	return 0;
+}
+
+
+/**
+ * bignum_mul - c = a * b
+ * @a: Bignum from bignum_init()
+ * @b: Bignum from bignum_init()
+ * @c: Bignum from bignum_init(); used to store the result of a * b
+ * Returns: 0 on success, -1 on failure
+ */
+int
+bignum_mul(const struct bignum *a, const struct bignum *b,
+	       struct bignum *c)
+{
+	if (mbedtls_mpi_mul_mpi((mbedtls_mpi *) c, (const mbedtls_mpi *) a,
+				(const mbedtls_mpi *) b) != 0) {
+		wpa_printf(MSG_DEBUG, "BIGNUM: %s failed", __func__);
+		return -1;
+	}
+	return 0;
+}
+
+
+/**
+ * bignum_mulmod - d = a * b (mod c)
+ * @a: Bignum from bignum_init()
+ * @b: Bignum from bignum_init()
+ * @c: Bignum from bignum_init(); modulus
+ * @d: Bignum from bignum_init(); used to store the result of a * b (mod c)
+ * Returns: 0 on success, -1 on failure
+ */
+int
+bignum_mulmod(const struct bignum *a, const struct bignum *b,
+		  const struct bignum *c, struct bignum *d)
+{
+	mbedtls_mpi tmp;
+	int ret;
+
+	/* c may be d */
+	mbedtls_mpi_init(&tmp);
+	ret = mbedtls_mpi_mul_mpi(&tmp, (const mbedtls_mpi *) a,
+				  (const mbedtls_mpi *) b);
+	if (ret == 0)
+		ret = mbedtls_mpi_mod_mpi((mbedtls_mpi *) d, &tmp,
+					  (const mbedtls_mpi *) c);
+	mbedtls_mpi_free(&tmp);
+	if (ret != 0) {
+		wpa_printf(MSG_DEBUG, "BIGNUM: %s failed", __func__);
+		return -1;
+	}
+	return 0;
+}
+
+
+/*
+ * Square-and-multiply, for what mbedtls_mpi_exp_mod() does not take: an
+ * even modulus (it uses Montgomery multiplication, in software and in
+ * hardware), and an exponent of zero, which needs no exponentiation.
+ * Diffie-Hellman and RSA use neither.
+ */
+static int
+bignum_exptmod_slow(mbedtls_mpi *Z, const mbedtls_mpi *X,
+		    const mbedtls_mpi *Y, const mbedtls_mpi *M)
+{
+	mbedtls_mpi R;
+	size_t i;
+	int ret;
+
+	mbedtls_mpi_init(&R);
+	MBEDTLS_MPI_CHK(mbedtls_mpi_lset(&R, 1));
+	for (i = mbedtls_mpi_bitlen(Y); i > 0; i--) {
+		MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&R, &R, &R));
+		MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&R, &R, M));
+		if (mbedtls_mpi_get_bit(Y, i - 1)) {
+			MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&R, &R, X));
+			MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&R, &R, M));
+		}
+	}
+	MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(Z, &R, M));
+
+cleanup:
+	mbedtls_mpi_free(&R);
+	return ret;
+}
+
+
+/**
+ * bignum_exptmod - Modular exponentiation: d = a^b (mod c)
+ * @a: Bignum from bignum_init(); base
+ * @b: Bignum from bignum_init(); exponent
+ * @c: Bignum from bignum_init(); modulus
+ * @d: Bignum from bignum_init(); used to store the result of a^b (mod c)
+ * Returns: 0 on success, -1 on failure
+ */
+int
+bignum_exptmod(const struct bignum *a, const struct bignum *b,
+		   const struct bignum *c, struct bignum *d)
+{
+	const mbedtls_mpi *M = (const mbedtls_mpi *) c;
+	const mbedtls_mpi *Y = (const mbedtls_mpi *) b;
+	mbedtls_mpi X;
+	int ret;
+
+	/* the accelerator takes a base smaller than the modulus only */
+	mbedtls_mpi_init(&X);
+	ret = mbedtls_mpi_mod_mpi(&X, (const mbedtls_mpi *) a, M);
+	if (ret == 0) {
+		if (mbedtls_mpi_get_bit(M, 0) == 1 &&
+		    mbedtls_mpi_cmp_int(Y, 0) != 0)
+			ret = mbedtls_mpi_exp_mod((mbedtls_mpi *) d, &X, Y, M,
+						  NULL);
+		else
+			ret = bignum_exptmod_slow((mbedtls_mpi *) d, &X, Y, M);
+	}
+	mbedtls_mpi_free(&X);
+	if (ret != 0) {
+		wpa_printf(MSG_DEBUG, "BIGNUM: %s failed", __func__);
+		return -1;
+	}
+	return 0;
+}
+
+#endif /* USE_MBEDTLS_CRYPTO */
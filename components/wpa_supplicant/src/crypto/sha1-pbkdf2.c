@@ -18,17 +18,159 @@
 #include "crypto/md5.h"
 #include "crypto/crypto.h"
 
+#define PBKDF2_ROL(value, bits) (((value) << (bits)) | ((value) >> (32 - (bits))))
+
+/* the message schedule is kept in 16 words and extended in place */
+#define PBKDF2_W(i) (W[(i) & 15] = PBKDF2_ROL(W[((i) + 13) & 15] ^ \
+	W[((i) + 8) & 15] ^ W[((i) + 2) & 15] ^ W[(i) & 15], 1))
+
+#define PBKDF2_R0(v, w, x, y, z, i) \
+	z += ((w & (x ^ y)) ^ y) + W[i] + 0x5A827999 + PBKDF2_ROL(v, 5); \
+	w = PBKDF2_ROL(w, 30);
+#define PBKDF2_R1(v, w, x, y, z, i) \
+	z += ((w & (x ^ y)) ^ y) + PBKDF2_W(i) + 0x5A827999 + \
+		PBKDF2_ROL(v, 5); \
+	w = PBKDF2_ROL(w, 30);
+#define PBKDF2_R2(v, w, x, y, z, i) \
+	z += (w ^ x ^ y) + PBKDF2_W(i) + 0x6ED9EBA1 + PBKDF2_ROL(v, 5); \
+	w = PBKDF2_ROL(w, 30);
+#define PBKDF2_R3(v, w, x, y, z, i) \
+	z += (((w | x) & y) | (w & x)) + PBKDF2_W(i) + 0x8F1BBCDC + \
+		PBKDF2_ROL(v, 5); \
+	w = PBKDF2_ROL(w, 30);
+#define PBKDF2_R4(v, w, x, y, z, i) \
+	z += (w ^ x ^ y) + PBKDF2_W(i) + 0xCA62C1D6 + PBKDF2_ROL(v, 5); \
+	w = PBKDF2_ROL(w, 30);
+
+/*
+ * SHA-1 compression of one block given as 16 host order words, which
+ * saves the byte swapping of SHA1Transform() when the block is built from
+ * the state words of another hash. W is overwritten.
+ */
+static void
+pbkdf2_sha1_block(u32 state[5], u32 W[16])
+{
+	u32 a = state[0], b = state[1], c = state[2], d = state[3],
+		e = state[4];
+
+	PBKDF2_R0(a,b,c,d,e, 0); PBKDF2_R0(e,a,b,c,d, 1);
+	PBKDF2_R0(d,e,a,b,c, 2); PBKDF2_R0(c,d,e,a,b, 3);
+	PBKDF2_R0(b,c,d,e,a, 4); PBKDF2_R0(a,b,c,d,e, 5);
+	PBKDF2_R0(e,a,b,c,d, 6); PBKDF2_R0(d,e,a,b,c, 7);
+	PBKDF2_R0(c,d,e,a,b, 8); PBKDF2_R0(b,c,d,e,a, 9);
+	PBKDF2_R0(a,b,c,d,e,10); PBKDF2_R0(e,a,b,c,d,11);
+	PBKDF2_R0(d,e,a,b,c,12); PBKDF2_R0(c,d,e,a,b,13);
+	PBKDF2_R0(b,c,d,e,a,14); PBKDF2_R0(a,b,c,d,e,15);
+	PBKDF2_R1(e,a,b,c,d,16); PBKDF2_R1(d,e,a,b,c,17);
+	PBKDF2_R1(c,d,e,a,b,18); PBKDF2_R1(b,c,d,e,a,19);
+	PBKDF2_R2(a,b,c,d,e,20); PBKDF2_R2(e,a,b,c,d,21);
+	PBKDF2_R2(d,e,a,b,c,22); PBKDF2_R2(c,d,e,a,b,23);
+	PBKDF2_R2(b,c,d,e,a,24); PBKDF2_R2(a,b,c,d,e,25);
+	PBKDF2_R2(e,a,b,c,d,26); PBKDF2_R2(d,e,a,b,c,27);
+	PBKDF2_R2(c,d,e,a,b,28); PBKDF2_R2(b,c,d,e,a,29);
+	PBKDF2_R2(a,b,c,d,e,30); PBKDF2_R2(e,a,b,c,d,31);
+	PBKDF2_R2(d,e,a,b,c,32); PBKDF2_R2(c,d,e,a,b,33);
+	PBKDF2_R2(b,c,d,e,a,34); PBKDF2_R2(a,b,c,d,e,35);
+	PBKDF2_R2(e,a,b,c,d,36); PBKDF2_R2(d,e,a,b,c,37);
+	PBKDF2_R2(c,d,e,a,b,38); PBKDF2_R2(b,c,d,e,a,39);
+	PBKDF2_R3(a,b,c,d,e,40); PBKDF2_R3(e,a,b,c,d,41);
+	PBKDF2_R3(d,e,a,b,c,42); PBKDF2_R3(c,d,e,a,b,43);
+	PBKDF2_R3(b,c,d,e,a,44); PBKDF2_R3(a,b,c,d,e,45);
+	PBKDF2_R3(e,a,b,c,d,46); PBKDF2_R3(d,e,a,b,c,47);
+	PBKDF2_R3(c,d,e,a,b,48); PBKDF2_R3(b,c,d,e,a,49);
+	PBKDF2_R3(a,b,c,d,e,50); PBKDF2_R3(e,a,b,c,d,51);
+	PBKDF2_R3(d,e,a,b,c,52); PBKDF2_R3(c,d,e,a,b,53);
+	PBKDF2_R3(b,c,d,e,a,54); PBKDF2_R3(a,b,c,d,e,55);
+	PBKDF2_R3(e,a,b,c,d,56); PBKDF2_R3(d,e,a,b,c,57);
+	PBKDF2_R3(c,d,e,a,b,58); PBKDF2_R3(b,c,d,e,a,59);
+	PBKDF2_R4(a,b,c,d,e,60); PBKDF2_R4(e,a,b,c,d,61);
+	PBKDF2_R4(d,e,a,b,c,62); PBKDF2_R4(c,d,e,a,b,63);
+	PBKDF2_R4(b,c,d,e,a,64); PBKDF2_R4(a,b,c,d,e,65);
+	PBKDF2_R4(e,a,b,c,d,66); PBKDF2_R4(d,e,a,b,c,67);
+	PBKDF2_R4(c,d,e,a,b,68); PBKDF2_R4(b,c,d,e,a,69);
+	PBKDF2_R4(a,b,c,d,e,70); PBKDF2_R4(e,a,b,c,d,71);
+	PBKDF2_R4(d,e,a,b,c,72); PBKDF2_R4(c,d,e,a,b,73);
+	PBKDF2_R4(b,c,d,e,a,74); PBKDF2_R4(a,b,c,d,e,75);
+	PBKDF2_R4(e,a,b,c,d,76); PBKDF2_R4(d,e,a,b,c,77);
+	PBKDF2_R4(c,d,e,a,b,78); PBKDF2_R4(b,c,d,e,a,79);
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+}
+
+/* SHA-1 state after the key XOR pad block, the first block of HMAC */
+static void
+pbkdf2_sha1_pad_state(const u8 *key, size_t key_len, u8 pad, u32 state[5])
+{
+	u8 block[64];
+	u32 W[16];
+	size_t i;
+
+	os_memset(block, pad, sizeof(block));
+	for (i = 0; i < key_len; i++)
+		block[i] ^= key[i];
+	for (i = 0; i < 16; i++)
+		W[i] = WPA_GET_BE32(block + 4 * i);
+
+	state[0] = 0x67452301;
+	state[1] = 0xEFCDAB89;
+	state[2] = 0x98BADCFE;
+	state[3] = 0x10325476;
+	state[4] = 0xC3D2E1F0;
+	pbkdf2_sha1_block(state, W);
+
+	os_memset(block, 0, sizeof(block));
+	os_memset(W, 0, sizeof(W));
+}
+
+/*
+ * HMAC-SHA1 of a 20 byte message, with the states after the inner and
+ * outer pad blocks already computed: two compressions instead of four, and
+ * no key processing. The message and the result are host order words.
+ */
+static void
+pbkdf2_sha1_hmac20(const u32 istate[5], const u32 ostate[5], const u32 in[5],
+		   u32 out[5])
+{
+	u32 W[16];
+	u32 state[5];
+	int i;
+
+	/* message words, the 0x80 end marker, zeros and the length in bits
+	 * of the pad block and the 20 byte message */
+	for (i = 0; i < 5; i++)
+		W[i] = in[i];
+	W[5] = 0x80000000;
+	for (i = 6; i < 15; i++)
+		W[i] = 0;
+	W[15] = (64 + SHA1_MAC_LEN) * 8;
+	os_memcpy(state, istate, sizeof(state));
+	pbkdf2_sha1_block(state, W);
+
+	for (i = 0; i < 5; i++)
+		W[i] = state[i];
+	W[5] = 0x80000000;
+	for (i = 6; i < 15; i++)
+		W[i] = 0;
+	W[15] = (64 + SHA1_MAC_LEN) * 8;
+	os_memcpy(out, ostate, sizeof(state));
+	pbkdf2_sha1_block(out, W);
+}
+
 static int 
-pbkdf2_sha1_f(const char *passphrase, const char *ssid,
-			 size_t ssid_len, int iterations, unsigned int count,
-			 u8 *digest)
+pbkdf2_sha1_f(const u8 *key, size_t key_len, const u32 istate[5],
+	      const u32 ostate[5], const char *ssid, size_t ssid_len,
+	      int iterations, unsigned int count, u8 *digest)
 {
-	unsigned char tmp[SHA1_MAC_LEN], tmp2[SHA1_MAC_LEN];
+	unsigned char tmp[SHA1_MAC_LEN];
+	u32 u[5], acc[5];
 	int i, j;
 	unsigned char count_buf[4];
 	const u8 *addr[2];
 	size_t len[2];
-	size_t passphrase_len = os_strlen(passphrase);
 
 	addr[0] = (u8 *) ssid;
 	len[0] = ssid_len;
@@ -45,20 +187,23 @@ pbkdf2_sha1_f(const char *passphrase, const char *ssid,
 	count_buf[1] = (count >> 16) & 0xff;
 	count_buf[2] = (count >> 8) & 0xff;
 	count_buf[3] = count & 0xff;
-	if (hmac_sha1_vector((u8 *) passphrase, passphrase_len, 2, addr, len,
-			     tmp))
+	if (hmac_sha1_vector(key, key_len, 2, addr, len, tmp))
 		return -1;
-	os_memcpy(digest, tmp, SHA1_MAC_LEN);
+	for (j = 0; j < 5; j++)
+		acc[j] = u[j] = WPA_GET_BE32(tmp + 4 * j);
 
 	for (i = 1; i < iterations; i++) {
-		if (hmac_sha1((u8 *) passphrase, passphrase_len, tmp,
-			      SHA1_MAC_LEN, tmp2))
-			return -1;
-		os_memcpy(tmp, tmp2, SHA1_MAC_LEN);
-		for (j = 0; j < SHA1_MAC_LEN; j++)
-			digest[j] ^= tmp2[j];
+		pbkdf2_sha1_hmac20(istate, ostate, u, u);
+		for (j = 0; j < 5; j++)
+			acc[j] ^= u[j];
 	}
 
+	for (j = 0; j < 5; j++)
+		WPA_PUT_BE32(digest + 4 * j, acc[j]);
+	os_memset(tmp, 0, sizeof(tmp));
+	os_memset(u, 0, sizeof(u));
+	os_memset(acc, 0, sizeof(acc));
+
 	return 0;
 }
 
@@ -85,17 +230,41 @@ pbkdf2_sha1(const char *passphrase, const char *ssid, size_t ssid_len,
 	unsigned char *pos = buf;
 	size_t left = buflen, plen;
 	unsigned char digest[SHA1_MAC_LEN];
+	unsigned char tk[SHA1_MAC_LEN];
+	const u8 *key = (const u8 *) passphrase;
+	size_t key_len = os_strlen(passphrase);
+	u32 istate[5], ostate[5];
+	int ret = 0;
+
+	/* keys longer than a block are hashed first, as in hmac_sha1() */
+	if (key_len > 64) {
+		if (sha1_vector(1, &key, &key_len, tk))
+			return -1;
+		key = tk;
+		key_len = SHA1_MAC_LEN;
+	}
+
+	/* the HMAC key is the same for every iteration: hash the pad blocks
+	 * once and start each HMAC from the resulting states */
+	pbkdf2_sha1_pad_state(key, key_len, 0x36, istate);
+	pbkdf2_sha1_pad_state(key, key_len, 0x5c, ostate);
 
 	while (left > 0) {
 		count++;
-		if (pbkdf2_sha1_f(passphrase, ssid, ssid_len, iterations,
-				  count, digest))
-			return -1;
+		if (pbkdf2_sha1_f(key, key_len, istate, ostate, ssid, ssid_len,
+				  iterations, count, digest)) {
+			ret = -1;
+			break;
+		}
 		plen = left > SHA1_MAC_LEN ? SHA1_MAC_LEN : left;
 		os_memcpy(pos, digest, plen);
 		pos += plen;
 		left -= plen;
 	}
 
-	return 0;
+	os_memset(istate, 0, sizeof(istate));
+	os_memset(ostate, 0, sizeof(ostate));
+	os_memset(digest, 0, sizeof(digest));
+	os_memset(tk, 0, sizeof(tk));
+	return ret;
 }
@@ -0,0 +1,154 @@
+/*
+ * Host test and benchmark for pbkdf2_sha1().
+ *
+ * Checks the RFC 6070 vectors which pbkdf2_sha1() can take (its passphrase
+ * is a C string, so not the one with an embedded NUL) and the WPA-PSK
+ * vector of IEEE 802.11 (passphrase "password", SSID "IEEE"). Then times a
+ * WPA-PSK derivation (4096 iterations, 32 bytes) against a straightforward
+ * PBKDF2 on hmac_sha1(), which is how pbkdf2_sha1() used to work.
+ *
+ * With -q only the vectors are checked.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "crypto/includes.h"
+#include "crypto/common.h"
+#include "crypto/sha1.h"
+
+struct vector {
+    const char *passphrase;
+    const char *salt;
+    int iterations;
+    size_t len;
+    const char *hex;
+};
+
+static const struct vector vectors[] = {
+    /* RFC 6070 */
+    { "password", "salt", 1, 20, "0c60c80f961f0e71f3a9b524af6012062fe037a6" },
+    { "password", "salt", 2, 20, "ea6c014dc72d6f8ccd1ed92ace1d41f0d8de8957" },
+    { "password", "salt", 4096, 20, "4b007901b765489abead49d926f721d065a429c1" },
+    { "passwordPASSWORDpassword", "saltSALTsaltSALTsaltSALTsaltSALTsalt", 4096, 25,
+      "3d2eec4fe41c849b80c8d83662c0e44a8b291a964cf2f07038" },
+    /* IEEE 802.11-2016, J.4.2 */
+    { "password", "IEEE", 4096, 32,
+      "f42c6fc52df0ebef9ebb4b90b38a5f902e83fe1b135a70e23aed762e9710a12e" },
+    /* a key longer than a SHA-1 block is hashed first */
+    { "0123456789012345678901234567890123456789012345678901234567890123456789", "salt", 2, 20,
+      NULL },
+};
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void to_hex(const u8 *buf, size_t len, char *hex)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        sprintf(hex + 2 * i, "%02x", buf[i]);
+    }
+}
+
+/* PBKDF2 on hmac_sha1(), as pbkdf2_sha1() was written before */
+static int pbkdf2_sha1_ref(const char *passphrase, const char *ssid, size_t ssid_len,
+                           int iterations, u8 *buf, size_t buflen)
+{
+    size_t passphrase_len = strlen(passphrase);
+    unsigned int count = 0;
+    u8 tmp[SHA1_MAC_LEN], digest[SHA1_MAC_LEN], count_buf[4];
+    const u8 *addr[2] = { (const u8 *) ssid, count_buf };
+    size_t len[2] = { ssid_len, 4 };
+    size_t plen;
+    int i, j;
+
+    while (buflen > 0) {
+        count++;
+        WPA_PUT_BE32(count_buf, count);
+        if (hmac_sha1_vector((const u8 *) passphrase, passphrase_len, 2, addr, len, tmp)) {
+            return -1;
+        }
+        memcpy(digest, tmp, SHA1_MAC_LEN);
+        for (i = 1; i < iterations; i++) {
+            if (hmac_sha1((const u8 *) passphrase, passphrase_len, tmp, SHA1_MAC_LEN, tmp)) {
+                return -1;
+            }
+            for (j = 0; j < SHA1_MAC_LEN; j++) {
+                digest[j] ^= tmp[j];
+            }
+        }
+        plen = buflen > SHA1_MAC_LEN ? SHA1_MAC_LEN : buflen;
+        memcpy(buf, digest, plen);
+        buf += plen;
+        buflen -= plen;
+    }
+    return 0;
+}
+
+static int check_vectors(void)
+{
+    u8 out[64], ref[64];
+    char hex[129];
+    int failures = 0;
+    size_t i;
+
+    for (i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        const struct vector *v = &vectors[i];
+
+        pbkdf2_sha1(v->passphrase, v->salt, strlen(v->salt), v->iterations, out, v->len);
+        to_hex(out, v->len, hex);
+        if (v->hex != NULL && strcmp(hex, v->hex) != 0) {
+            printf("vector %d: got %s, expected %s\n", (int) i, hex, v->hex);
+            failures++;
+        }
+        pbkdf2_sha1_ref(v->passphrase, v->salt, strlen(v->salt), v->iterations, ref, v->len);
+        if (memcmp(out, ref, v->len) != 0) {
+            printf("vector %d: differs from the hmac_sha1() PBKDF2\n", (int) i);
+            failures++;
+        }
+    }
+    printf("pbkdf2_sha1: %d vectors, %d failures\n", (int) i, failures);
+    return failures;
+}
+
+typedef int (*pbkdf2_fn)(const char *, const char *, size_t, int, u8 *, size_t);
+
+/* WPA-PSK derivations per second, each 2 x 4096 iterations */
+static double bench(pbkdf2_fn fn)
+{
+    u8 psk[32];
+    double t0, t;
+    int n = 0;
+
+    t0 = now_sec();
+    do {
+        fn("correct horse battery staple", "esp32-bench", 11, 4096, psk, sizeof(psk));
+        n++;
+        t = now_sec() - t0;
+    } while (t < 1.0);
+    return n / t;
+}
+
+int main(int argc, char **argv)
+{
+    double fast, ref;
+
+    if (check_vectors() != 0) {
+        return 1;
+    }
+    if (argc > 1 && strcmp(argv[1], "-q") == 0) {
+        return 0;
+    }
+    ref = bench(pbkdf2_sha1_ref);
+    fast = bench(pbkdf2_sha1);
+    printf("hmac_sha1 PBKDF2    %8.1f PSK/s  %10.0f iterations/s\n", ref, ref * 2 * 4096);
+    printf("pbkdf2_sha1         %8.1f PSK/s  %10.0f iterations/s  (x%.2f)\n",
+           fast, fast * 2 * 4096, fast / ref);
+    return 0;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+/* Host stand-in for port/include/os.h: the C library does the work */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define os_malloc(s) malloc((s))
+#define os_realloc(p, s) realloc((p), (s))
+#define os_zalloc(s) calloc(1, (s))
+#define os_free(p) free((p))
+#define os_memcpy(d, s, n) memcpy((d), (s), (n))
+#define os_memmove(d, s, n) memmove((d), (s), (n))
+#define os_memset(s, c, n) memset(s, c, n)
+#define os_memcmp(s1, s2, n) memcmp((s1), (s2), (n))
+#define os_strlen(s) strlen(s)
+#define os_strcmp(s1, s2) strcmp((s1), (s2))
+#define os_strncmp(s1, s2, n) strncmp((s1), (s2), (n))
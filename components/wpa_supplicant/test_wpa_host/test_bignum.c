@@ -0,0 +1,353 @@
+/*
+ * Host test for the big number arithmetic of src/crypto.
+ *
+ * Built twice, see the Makefile: test_bignum_internal with bignum.c
+ * (LibTomMath), test_bignum_mbedtls with crypto_mbedtls-bignum.c on the
+ * MPI library of mbedTLS (USE_MBEDTLS_CRYPTO), in software on the host.
+ * Both check crypto_mod_exp() with the same vectors: a Diffie-Hellman
+ * exchange in group 5 (RFC 3526, as in WPS), 2048-bit RSA with the public
+ * and a private size exponent, and the cases mbedtls_mpi_exp_mod() does not
+ * take directly (even modulus, zero exponent, base larger than the
+ * modulus). The expected values were computed with Python's pow().
+ *
+ * Then times the group 5 exchange, unless run with -q.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "crypto/includes.h"
+#include "crypto/common.h"
+#include "crypto/crypto.h"
+#include "bignum.h"
+
+struct vector {
+    const char *name;
+    const char *base;
+    const char *power;
+    const char *modulus;
+    const char *result;
+};
+
+/* RFC 3526, 1536-bit MODP group */
+static const char group5_prime[] =
+    "ffffffffffffffffc90fdaa22168c234c4c6628b80dc1cd129024e088a67cc74"
+    "020bbea63b139b22514a08798e3404ddef9519b3cd3a431b302b0a6df25f1437"
+    "4fe1356d6d51c245e485b576625e7ec6f44c42e9a637ed6b0bff5cb6f406b7ed"
+    "ee386bfb5a899fa5ae9f24117c4b1fe649286651ece45b3dc2007cb8a163bf05"
+    "98da48361c55d39a69163fa8fd24cf5f83655d23dca3ad961c62f356208552bb"
+    "9ed529077096966d670c354e4abc9804f1746c08ca237327ffffffffffffffff";
+
+/* private values a and b, public values 2^a and 2^b, shared value 2^ab */
+static const char dh_a[] =
+    "48266838ddec9d4f6ebeb4400873189296772783c8c8d2761eac708b0f3b5607"
+    "9573164a9eeb0203b0f2b5d2a7977bac41ec61502ae1fc8851a264abb921a5c0"
+    "fadf6031265b9716fc96170a27b1519df2e4d9af707c289904b184cfd6dc3c3b"
+    "ff72b36ba95d5ec73fc31a98c7fd59a0026355459390c87cc36492adbb4bb95c"
+    "da1a4658622ff19b46db76078d954e504890afe0b0ac88b8e57b47b993f3cfc7"
+    "62b8a158e9f0fcf8e6e9d6a12a8161e5fe1b14343b106980550caef9618a9261";
+static const char dh_b[] =
+    "3afbb5fc65133757dc083c637e4695d1a80f5fbaa9d0a2a305812369683dada3"
+    "17f0e77daaebb6861b517272255a3355664288d84d299e5e0eb12942d8b60441"
+    "cbeeac87e345923a6f5567212e9d7aaf93e9f59b9bb36f0a06aceac69eb1c2e0"
+    "39ae678d515b5b07443d65ec0db41c812d808c68fae19a66e69c9cfdb058928d"
+    "24c23874e9c8e3801943aaf51faf3b7004bee4f7ab81fe968e24341020003f96"
+    "79a5c140bb7aa4415c367095b9eabb84129d9ca5374379d5bc1dd3d8d74ec826";
+static const char dh_pub_a[] =
+    "d888a5b5029d8807e986f3771c28664a8688bbc4390006f639a2ab721ca70a20"
+    "35c5756df17092ba130f834e079e5b70116d647002ccf68427f3f47e6c59f1f8"
+    "e7f172f2188d8e9344a349f56e10320724f8d987a6d1189f2280fb1e0a3c21ce"
+    "a2a0266bf7ea7372b9123ba04c6414b25d7cbef43b4133863266fbefe3382db0"
+    "a772861db0491f3c97a59e315a340d30f11ad9ddc19c01e9801e36a24dfa9abd"
+    "192cf4bcc62e8b790e53dcda68bf892a1088bc71c3cde15f1dc53f3674ad5d77";
+static const char dh_pub_b[] =
+    "806a9b04f4d201e06f241c2bafacc9874b0124b7ebc2809053eec3c91acec4c4"
+    "89103df3a91933b67b24674f47d9e33d752fb97817137b6102fcb6d93199556c"
+    "89bd6759979a8d174f5f68216ce30b211170972c44b22d073333dd635d149d2a"
+    "c80099c5c0285ac4fd15b1f85deb80c2af111252532f5b695b90704ed70f7f54"
+    "cfd010e9e4a701e41a49bc55176f97294a2c80014babb18748b5076dec166097"
+    "9d613a734bf6954519e9093dd949fad9e7b1474bc9dfa36b23518197a5a485e0";
+static const char dh_shared[] =
+    "1f6dcd4af2442352bbe7c941cbdb74d64e546839837fe8f8e1d070c9d8240afa"
+    "49deeabe7a217242555833c9f47c336b71c3b195a1bdfc6606c32538cac45b3d"
+    "06ba669721f340b006e6ce12d8a1e668b16f15969b25004b6ca7b73fc7eae7b2"
+    "1541343746e6e7e720c0ef334a90a36ea8ccc5f1872b4d8b4ed811a6a8eecc26"
+    "68a3f369a3a8bfcbfca92d8894c7dae66d7cf762c19ef565828fdebcaee5c417"
+    "8c3877923908e78724dbe5ace762a912c3b5d749ac0000da218cbe6ce2164f23";
+
+/* 2048-bit odd modulus */
+static const char rsa_modulus[] =
+    "953f00a973342e0dc9f6f009691dec50b8d74119ae116fd075abb1c3bbc17f89"
+    "5cfa76c56ff8a49f3879dba43de38e8cf1fe34e4f630831919775ab3d930f04c"
+    "99e9eafe6b1b028a876a2d839beb204c15d748aabfe6f1fcb5b96adea7cad5cd"
+    "69cb455de399edebe513324d20ae04b9b485782ca916e2b0fc8dc44f1bfd008a"
+    "d6bad644c059c089da099928dfe5395bae9b3deedccbbd13b8626f980a22fbf9"
+    "b7591f2810d3af43cea155d123892f622d23ed4952661ac776b83ed8a7b5dbec"
+    "03a5c5a7e15ec917073114388a2f7f42479d6f39be93ba2a88457b9c6cf85782"
+    "66df288eba6c1e33f21b8ca8755ad4f613ef16dd228c092f15fc0d51058bd2bb";
+static const char rsa_base[] =
+    "455f8ae4cad7535b4960cff87ee76c648b506e7f71091fc609aaf38d74310931"
+    "6af664b68a3f94bd66f8389946d722727e269bff5da487d295f3981e571249b8"
+    "ba857bad141abf625b4f683a76b2781f390b7c543df0f97e2749dd27b7e78b9f"
+    "691e3191293fdb8c3273fd3cb9abb3fcdeac7e107a48f73da45f50aaa347c878"
+    "0248a32e3d79e539bd6c0c07f1327536be4a292a0c76938d5b078036dd706d14"
+    "a06dd8bb6578c470e80f09c0499c6e4b7437e4e2971d60c9a382b2613b664d9f"
+    "685032ecb42538ced3715c5363a2d0b43c6868e5bf41f2609341e646e6f2bc3f"
+    "b43212afa633beedd6cd0c3626fd2b8ac8fd3b46a42223ab254c20f7b6a0dc";
+static const char rsa_private[] =
+    "3ded6a603ba811ba70f361d79819ef02784966268008a8c218fb06e33d32382f"
+    "d9d3be82b10a12c37dd27234cc286f1167362deb4da0328d6aa78b5c965f23de"
+    "9f283bbf4789af0db4e49e2ede71f58c1f7fff77d45b3dfb3b08cd119ca9c914"
+    "6134d256da9b5a34424ce0d226d98b3748b0891f4ec9f4e9f48b6bdde7fc83d2"
+    "ee9ce484ec03bc5f66380fd3ae83b88936d04d195a1dcc89b19788b898610b63"
+    "aa9f73408281e2ae0abbf3f3125c34ccf6254801c8a0fb3ff90146c6ba4a4bcd"
+    "694742f42d50711feb77a646a652cada84ac06d18353272e272f17afa3680813"
+    "277ce18df113750fb55f931296ea632b2db78b5f07a3d8e45a930220d26affa0";
+static const char rsa_result_e[] =
+    "429bdc2a01b87c3cc38d023f62c461663a2973421b84abad1ccfcec28d81604d"
+    "f6772711dab287e76186441d6a5bac9b426e18ea50b2f289eaeb2be1c075b488"
+    "16fa8091c0773245944a5fb760b06ec2ecda32d25ae77b613ff50c39091a3944"
+    "ae4961a077b49f876aa6cc0e218999fd5393652fb4ee5967d7414624386ee788"
+    "e15300068b96d9d8b3ad29027dd832ed7202122a76a0a183839b8321ab66407c"
+    "b297dbf10ac8fe0f527bb15324c724f6151045c498eb8ac2159ac6aad9182bcf"
+    "c56d0f40022a8b718d344f9588d6cd82df10eeecdff6f69a6e48cf4994560166"
+    "91cff14758b6c0873fb484527f5365c9371e37faf8147195ae409f722376f142";
+static const char rsa_result_d[] =
+    "78ac79321d45e11a96a0e13ab52004d9055a785597f838c8016e80d35bcc937a"
+    "4fa291844238e9dae9ca8e7298b6dfd6548c11b860e40c91b06bdbb81666da55"
+    "3a80ed7a9ecc600fd996f772c841d0cdfe9af339911034a947e1d83921201baa"
+    "73b3fa08bf9ef870833bb1b0e0f436c380172d22035289df53064634c9b8a94f"
+    "a36531fd0c8fd535a2321878c11f6e73e399e459240b69b7cbec430253e2c3a2"
+    "031823f058910503d7af9ae4b4f14ac5feda69a879d7e5b9e61b279c50b2076c"
+    "accec9530e6b543ea23de09a7ce88d43b3b8ac8b326e37389e39167360d5c97e"
+    "9784aae7e8b62eb8e823f45ef8516752f9c12f3eef9f84e9c663efcb4a7ad4f0";
+static const char rsa_base_big[] =
+    "953f00a973342e0dc9f6f009691dec50b8d74119ae116fd075abb1c3bbc17f89"
+    "5cfa76c56ff8a49f3879dba43de38e8cf1fe34e4f630831919775ab3d930f04c"
+    "99e9eafe6b1b028a876a2d839beb204c15d748aabfe6f1fcb5b96adea7cad5cd"
+    "69cb455de399edebe513324d20ae04b9b485782ca916e2b0fc8dc44f1bfd008a"
+    "d6bad644c059c089da099928dfe5395bae9b3deedccbbd13b8626f980a22fbf9"
+    "b7591f2810d3af43cea155d123892f622d23ed4952661ac776b83ed8a7b5dbec"
+    "03a5c5a7e15ec917073114388a2f7f42479d6f39be93ba2a88457b9c6cf85782"
+    "66df288eba6c1e33f21b8ca8755ad4f613ef16dd228c092f15fc0d51058bd2c0";
+static const char rsa_result_big[] =
+    "7d";
+
+static const struct vector vectors[] = {
+    { "group 5 public a", "02", dh_a, group5_prime, dh_pub_a },
+    { "group 5 public b", "02", dh_b, group5_prime, dh_pub_b },
+    { "group 5 shared a", dh_pub_b, dh_a, group5_prime, dh_shared },
+    { "group 5 shared b", dh_pub_a, dh_b, group5_prime, dh_shared },
+    { "rsa public", rsa_base, "010001", rsa_modulus, rsa_result_e },
+    { "rsa private", rsa_base, rsa_private, rsa_modulus, rsa_result_d },
+    { "base > modulus", rsa_base_big, "03", rsa_modulus, rsa_result_big },
+    { "zero exponent", rsa_base, "00", rsa_modulus, "01" },
+    { "zero base", "00", "03", rsa_modulus, "" },
+    { "even modulus",
+      "0d12b7698757ffb3e83bd36479e39c4b563a0de7be86600acfe8d373f7d691b9"
+      "cf2bf0a28824",
+      "c3",
+      "f8b94d187ec2d76e3f3d66dd1274955c4a9b1f2479679d16e74f0fee2eb7c4bc",
+      "9edfaa43eb3aaa2b0d0ac8432baa92f49b37bc01708e026490598d018d7776f8" },
+};
+
+/* rsa_base and rsa_private: sum, difference, product, product mod rsa_modulus */
+static const char op_sum[] =
+    "3e32c9eb2072e90dcc3cc2a79098d66edcd4b694ff79b1e1df04b1d6caa66939"
+    "0b3eb4e7679452583b396a6d656f4633d9b454874cfdd7153d3d7ef4b4b63628"
+    "57e2c13af49dc9cd173fed9718e8a8043eb90af428992ef4b93016eec461b0a0"
+    "009df0886bc49a0fce7f54cf639336eb458f359d5f443de1322fcb2e929fcb9b"
+    "669f2d281a4136449ff57bdfb674eafe6d8e9742842a431d3ef29038cf3e7bd0"
+    "bf3fe1193de75b727ba402fcd2a5d13b41997fe6ab3818a0c2a4c9791b85b21b"
+    "08af93271a049658ba4b17a2f9b66dab38e86f3a6912692087c25995ea4efacf"
+    "673113a0a0b9a8cea336601ecd116056b880889a4e47fb0805b84e41ca21a07c";
+static const char op_difference[] =
+    "3da80ad556dd3a6715aa01079f9b079613be15b800979fa252f15befafbe0726"
+    "a868c81dfa7fd32ec06b79fc32e197eef4b8074f4e428e05981197c478081194"
+    "e66db6439a75944e52894ec6a3fb43140046f3fb801d4d01bce1833474f1e188"
+    "c1cbb42549721a58b61a6cd4ea1fdf834bd1dca13e4fabf2b6e70c8d3d593c0a"
+    "769a9be1bdc6427a2c7aa3c7a6928614001202f0301155f6243c813861839af6"
+    "95ff0567c71c69e999d3e4e95212985eaab1101ce609dddf2f5dc414590ee57f"
+    "c9def2c1409c4be71ca434ea52ef2809d06f9e689d93e53bc69bd5c95c811556"
+    "e7c8af7b416d4150c788c60660c365ffa2ee8e23c0ffb6c0af6db5ffdab45ec4";
+static const char op_product[] =
+    "10c81a5fbda67a81e466a8fd548371e77e634312d44c239dab870a9e3dcddf76"
+    "7a80627a5a292563607297533c6e51953b72e5fc1569926697474a730c06313e"
+    "9cbb98e9119cf2def9b6c5fa9046843a1ff678ef286fb48031cd6c7c154ab64f"
+    "a2001ea6b3ebf69f82c38fd2029e45717d991e266b998c2ed57b0ef8e49aa335"
+    "df0e763a221a5cab1376f531314570dbeef22d7bf70772eb74e48997dcaa087c"
+    "6a16ee615716561f4e776b4b8e235e87a14a81fedeb498c4a5bed88b03256b6a"
+    "65b8d5f4b7ad51d292c2de8152499b85b42e1434d1ad11737a529b5c7a2e119b"
+    "1a393bd7083d0bff140814d7f36fe9594a8a2bc3252a4e6f6a5d98704472693b"
+    "c3cecbd0f0822e531a88b5f0a0def96c9ecfd431a28f1ada7b5fa4c32287ff68"
+    "12c604e764eaf0192638257ba93433b11ac4ec6bbcfd545b915d32904ffa4262"
+    "728d8d899bb13e41a05a40bfe48ec4b91ac7bc0d6da6b85b4ae29b6a5596ed23"
+    "e7565675dc9425595ee6169baa9b5220a00cc2152fa5501a9289e7f90d848b14"
+    "1f9e0366eaf384581a4f7bb818b9af7b80166ea9a21f73cc90253cf93754b27f"
+    "8dcbef95baeeb2514197c36a3962a9a7eb59fee5b2eb833bd4c370897ca37d1c"
+    "56250bc4e100c2863e935d02d0df75717261bd2dd9f5646fbc2c6d50f0a14fcb"
+    "956323e5b97304f1d39f64aa0a3f22b2619f0c2d7b7013c968a06ccf77ad80";
+static const char op_mulmod[] =
+    "294947289367a1aa12bee2012a5c39913af7592f8c6d8dcea37ca8eb5159b068"
+    "377059eec81ed6c8afaf6658ffead181c10d83fcadc1557751854484c2f6381b"
+    "db02bc059bc16cd8672a9564a7641f970c30f274aba0f3fce79388595ff77fe4"
+    "5fc4b023e0dae82f533265b01b563c4862df444aa149163b8b8129ee019c4e98"
+    "014cfc08d5e6f283dd321f648923aec9b7ce341dcbd5fd3b07dcafcaac04b9c8"
+    "498fb698f5d37c55a8d4246fee5d459b78551c86464f31ed00dbfcb9be1e8349"
+    "287cc9fb888b71ac84c5f217a025685a71d15086193b4448fe858d72fe33095e"
+    "b32202cde2eb149a371133e608804a62d8f2cf28c0ce3b1452d3e9fb6ba23452";
+
+static int failures;
+
+#define CHECK(cond) do { if (!(cond)) { \
+    fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+    failures++; } } while (0)
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static size_t from_hex(const char *hex, u8 *buf)
+{
+    size_t i, len = strlen(hex) / 2;
+
+    for (i = 0; i < len; i++) {
+        unsigned int byte;
+        sscanf(hex + 2 * i, "%2x", &byte);
+        buf[i] = (u8) byte;
+    }
+    return len;
+}
+
+static void to_hex(const u8 *buf, size_t len, char *hex)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        sprintf(hex + 2 * i, "%02x", buf[i]);
+    }
+    hex[2 * len] = 0;
+}
+
+static int mod_exp_hex(const char *base_hex, const char *power_hex, const char *modulus_hex,
+                       char *result_hex)
+{
+    u8 base[512], power[512], modulus[512], result[512];
+    size_t base_len = from_hex(base_hex, base);
+    size_t power_len = from_hex(power_hex, power);
+    size_t modulus_len = from_hex(modulus_hex, modulus);
+    size_t result_len = modulus_len;
+
+    if (crypto_mod_exp(base, base_len, power, power_len, modulus, modulus_len,
+                       result, &result_len) < 0) {
+        return -1;
+    }
+    to_hex(result, result_len, result_hex);
+    return 0;
+}
+
+static void test_mod_exp(void)
+{
+    char result[1025];
+    size_t i;
+
+    for (i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        const struct vector *v = &vectors[i];
+
+        if (mod_exp_hex(v->base, v->power, v->modulus, result) < 0 ||
+            strcmp(result, v->result) != 0) {
+            fprintf(stderr, "crypto_mod_exp, %s: wrong result\n", v->name);
+            failures++;
+        }
+    }
+}
+
+static struct bignum *bignum_hex(const char *hex)
+{
+    u8 buf[512];
+    struct bignum *n = bignum_init();
+
+    CHECK(n != NULL && bignum_set_unsigned_bin(n, buf, from_hex(hex, buf)) == 0);
+    return n;
+}
+
+static void check_bignum(const char *name, const struct bignum *n, const char *hex)
+{
+    u8 buf[512];
+    char result[1025];
+    size_t len = sizeof(buf);
+
+    if (bignum_get_unsigned_bin(n, buf, &len) < 0) {
+        fprintf(stderr, "%s: bignum_get_unsigned_bin failed\n", name);
+        failures++;
+        return;
+    }
+    to_hex(buf, len, result);
+    if (strcmp(result, hex) != 0) {
+        fprintf(stderr, "%s: wrong result\n", name);
+        failures++;
+    }
+}
+
+static void test_ops(void)
+{
+    struct bignum *a = bignum_hex(rsa_base);
+    struct bignum *b = bignum_hex(rsa_private);
+    struct bignum *m = bignum_hex(rsa_modulus);
+    struct bignum *small = bignum_hex("7d");
+    struct bignum *r = bignum_init();
+    u8 buf[4];
+    size_t len = sizeof(buf);
+
+    CHECK(bignum_get_unsigned_bin_len(a) == strlen(rsa_base) / 2);
+    CHECK(bignum_cmp(a, b) < 0);
+    CHECK(bignum_cmp(b, a) > 0);
+    CHECK(bignum_cmp(a, a) == 0);
+    CHECK(bignum_cmp_d(small, 0x7d) == 0);
+    CHECK(bignum_cmp_d(small, 0x7e) < 0);
+    CHECK(bignum_cmp_d(small, 1) > 0);
+    CHECK(bignum_cmp_d(a, (unsigned long) -1) > 0);
+
+    CHECK(bignum_add(a, b, r) == 0);
+    check_bignum("bignum_add", r, op_sum);
+    CHECK(bignum_sub(b, a, r) == 0);
+    check_bignum("bignum_sub", r, op_difference);
+    CHECK(bignum_mul(a, b, r) == 0);
+    check_bignum("bignum_mul", r, op_product);
+    CHECK(bignum_mulmod(a, b, m, r) == 0);
+    check_bignum("bignum_mulmod", r, op_mulmod);
+    CHECK(bignum_exptmod(a, b, m, r) == 0);
+    check_bignum("bignum_exptmod", r, rsa_result_d);
+
+    /* too small a buffer: the length needed comes back */
+    CHECK(bignum_get_unsigned_bin(a, buf, &len) < 0 && len == strlen(rsa_base) / 2);
+
+    bignum_deinit(a);
+    bignum_deinit(b);
+    bignum_deinit(m);
+    bignum_deinit(small);
+    bignum_deinit(r);
+}
+
+int main(int argc, char **argv)
+{
+    char result[1025];
+    double start, t;
+    int i, runs = 20;
+
+    test_mod_exp();
+    test_ops();
+
+    if (argc < 2 || strcmp(argv[1], "-q") != 0) {
+        start = now_sec();
+        for (i = 0; i < runs; i++) {
+            CHECK(mod_exp_hex(dh_pub_b, dh_a, group5_prime, result) == 0);
+        }
+        t = now_sec() - start;
+        printf("%-8s group 5 shared value: %7.2f ms\n", BIGNUM_NAME, t * 1000 / runs);
+    }
+    return failures != 0;
+}